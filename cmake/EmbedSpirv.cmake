@@ -0,0 +1,30 @@
+# Turns compiled SPIR-V binaries into constexpr uint32_t arrays in a single header.
+# Usage: cmake -DOUTPUT=<header> -DSPIRV_FILES=<a.vert.spv,b.frag.spv,...> -P EmbedSpirv.cmake
+
+set(CONTENT "// Generated by cmake/EmbedSpirv.cmake from the sources in shaders/, do not edit\n\n")
+string(APPEND CONTENT "#ifndef EMBEDDED_SHADERS_H_\n#define EMBEDDED_SHADERS_H_\n\n")
+string(APPEND CONTENT "#include <cstddef>\n#include <cstdint>\n\n")
+string(APPEND CONTENT "struct EmbeddedShader\n{\n    const char *name;\n    const uint32_t *code;\n    size_t wordCount;\n};\n\n")
+
+set(ENTRIES "")
+string(REPLACE "," ";" SPIRV_FILES "${SPIRV_FILES}")
+
+foreach(SPIRV_FILE ${SPIRV_FILES})
+    get_filename_component(FILE_NAME ${SPIRV_FILE} NAME)
+    string(REGEX REPLACE "\\.spv$" "" SHADER_NAME ${FILE_NAME})
+    string(MAKE_C_IDENTIFIER ${SHADER_NAME} IDENTIFIER)
+
+    file(READ ${SPIRV_FILE} HEX HEX)
+    # SPIR-V words are little endian: swap every group of four bytes into a 32-bit literal
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])" "0x\\4\\3\\2\\1u," WORDS ${HEX})
+    set(WORD "0x[0-9a-f]+u,")
+    string(REGEX REPLACE "(${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD}${WORD})" "\\1\n    " WORDS ${WORDS})
+    string(REGEX REPLACE "\n    $" "" WORDS ${WORDS})
+
+    string(APPEND CONTENT "constexpr uint32_t ${IDENTIFIER}_spv[] {\n    ${WORDS}\n};\n\n")
+    string(APPEND ENTRIES "    {\"${SHADER_NAME}\", ${IDENTIFIER}_spv, sizeof(${IDENTIFIER}_spv) / sizeof(uint32_t)},\n")
+endforeach()
+
+string(APPEND CONTENT "constexpr EmbeddedShader embeddedShaders[] {\n${ENTRIES}};\n\n#endif\n")
+
+file(WRITE ${OUTPUT} "${CONTENT}")
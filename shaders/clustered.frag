@@ -0,0 +1,104 @@
+#version 450
+
+// Forward shading with clustered point lights: the fragment's froxel lists the lights that may reach it. Same grid as
+// light_cull.comp
+const uint GRID_WIDTH = 16u;
+const uint GRID_HEIGHT = 9u;
+const uint GRID_DEPTH = 24u;
+// Specialized to ClusteredLighting::MaxLightsPerCluster, as light_cull.comp, which sizes the froxel lists
+layout(constant_id = 0) const uint MAX_LIGHTS_PER_CLUSTER = 63u;
+
+// Already lit by the directional light, unshadowed
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec3 fragAlbedo;
+layout(location = 2) in vec3 fragPosition;
+layout(location = 3) in vec3 fragNormal;
+
+layout(location = 0) out vec4 outColor;
+
+struct Light {
+    vec3 position;
+    float radius;
+    vec3 color;
+    float padding;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer Lights {
+    Light lights[];
+};
+
+layout(std430, set = 1, binding = 1) readonly buffer Clusters {
+    vec2 tileSize;
+    float nearPlane;
+    float farPlane;
+    uint clusters[];
+};
+
+// Cascaded shadow maps of the directional light: ShadowUniforms
+layout(set = 1, binding = 2) uniform sampler2DArrayShadow shadowMap;
+
+layout(std140, set = 1, binding = 3) uniform Shadows {
+    mat4 cascadeViewProjection[4];
+    vec4 cascadeSplits;
+    vec4 cascadeTexelSizes;
+    vec3 lightDirection;
+    uint cascadeCount;
+} shadows;
+
+// Lit fraction of the fragment at a view distance: 3x3 comparisons in the first cascade reaching it, from a position
+// pushed off the surface by a texel and a half against acne
+float shadowFactor(float depth, vec3 normal) {
+    uint cascade = 0u;
+    while (cascade < shadows.cascadeCount && depth > shadows.cascadeSplits[cascade]) {
+        cascade++;
+    }
+
+    if (cascade >= shadows.cascadeCount) {
+        return 1.0;
+    }
+
+    vec3 position = fragPosition + normal * shadows.cascadeTexelSizes[cascade] * 1.5;
+    vec4 clip = shadows.cascadeViewProjection[cascade] * vec4(position, 1.0);
+    vec2 uv = clip.xy * 0.5 + 0.5;
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++) {
+            lit += texture(shadowMap, vec4(uv + vec2(x, y) * texel, float(cascade), clip.z));
+        }
+    }
+
+    return lit / 9.0;
+}
+
+void main() {
+    // Back from the projection's depth to the distance along the view direction
+    float depth = nearPlane * farPlane / (farPlane - gl_FragCoord.z * (farPlane - nearPlane));
+    uint slice = uint(clamp(log(depth / nearPlane) / log(farPlane / nearPlane) * float(GRID_DEPTH), 0.0, float(GRID_DEPTH - 1u)));
+    uvec2 tile = min(uvec2(gl_FragCoord.xy / tileSize), uvec2(GRID_WIDTH - 1u, GRID_HEIGHT - 1u));
+
+    uint base = ((slice * GRID_HEIGHT + tile.y) * GRID_WIDTH + tile.x) * (1u + MAX_LIGHTS_PER_CLUSTER);
+    uint count = clusters[base];
+
+    vec3 normal = normalize(fragNormal);
+    vec3 color = fragColor;
+
+    // Shaded again, as the vertex stage did, with the sun's light shadowed
+    if (shadows.cascadeCount > 0u) {
+        float shadow = shadowFactor(depth, normal);
+        color = fragAlbedo * (0.25 + 0.75 * max(dot(normal, shadows.lightDirection), 0.0) * shadow);
+    }
+
+    for (uint i = 0u; i < count; i++) {
+        Light light = lights[clusters[base + 1u + i]];
+
+        vec3 toLight = light.position - fragPosition;
+        float distanceSquared = max(dot(toLight, toLight), 1e-8);
+        float falloff = max(1.0 - distanceSquared / (light.radius * light.radius), 0.0);
+
+        color += fragAlbedo * light.color * max(dot(normal, toLight * inversesqrt(distanceSquared)), 0.0) * falloff * falloff;
+    }
+
+    outColor = vec4(color, 1.0);
+}
@@ -0,0 +1,46 @@
+#version 450
+
+// Instances batched by level of detail: one instanced draw per level, over that level's range of the index section
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+// Per instance: position, then uniform scale
+layout(location = 2) in vec4 inInstance;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragAlbedo;
+layout(location = 2) out vec3 fragPosition;
+layout(location = 3) out vec3 fragNormal;
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    vec3 boundsMin;
+    uint lod;
+    vec3 boundsExtent;
+} constants;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return normalize(normal);
+}
+
+// One color per level, from white for the full mesh, to see the levels switch
+const vec3 lodColors[8] = vec3[](
+    vec3(1.0, 1.0, 1.0), vec3(0.4, 0.9, 0.4), vec3(0.4, 0.7, 1.0), vec3(1.0, 0.85, 0.3),
+    vec3(1.0, 0.5, 0.3), vec3(0.9, 0.35, 0.8), vec3(0.6, 0.4, 1.0), vec3(1.0, 0.3, 0.3));
+
+void main() {
+    vec3 position = inInstance.xyz + inInstance.w * (constants.boundsMin + inPosition.xyz * constants.boundsExtent);
+    gl_Position = constants.viewProjection * vec4(position, 1.0);
+
+    vec3 normal = decodeOctahedral(inNormal);
+    float light = max(dot(normal, normalize(vec3(0.4, 0.8, 0.45))), 0.0);
+    fragAlbedo = lodColors[min(constants.lod, 7u)];
+    fragColor = fragAlbedo * (0.25 + 0.75 * light);
+    fragPosition = position;
+    fragNormal = normal;
+}
@@ -0,0 +1,52 @@
+#version 450
+
+// Without mesh shaders: meshlets are drawn from the index section by indexed indirect draws, one per meshlet, whose
+// first instance is the meshlet index when the device supports it
+layout(location = 0) in vec4 inPosition;
+layout(location = 1) in vec2 inNormal;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragAlbedo;
+layout(location = 2) out vec3 fragPosition;
+layout(location = 3) out vec3 fragNormal;
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    vec3 cameraPosition;
+    // Meshlets of the selected level of detail
+    uint meshletCount;
+    vec3 boundsMin;
+    uint firstMeshlet;
+    vec3 boundsExtent;
+} constants;
+
+vec3 decodeOctahedral(vec2 encoded) {
+    vec3 normal = vec3(encoded, 1.0 - abs(encoded.x) - abs(encoded.y));
+
+    if (normal.z < 0.0) {
+        normal.xy = (1.0 - abs(normal.yx)) * vec2(normal.x >= 0.0 ? 1.0 : -1.0, normal.y >= 0.0 ? 1.0 : -1.0);
+    }
+
+    return normalize(normal);
+}
+
+// Same as meshlet.mesh
+vec3 meshletColor(uint meshletIndex) {
+    uint hash = meshletIndex * 2654435761u;
+    return vec3(hash & 255u, (hash >> 8) & 255u, (hash >> 16) & 255u) / 255.0;
+}
+
+vec3 shade(vec3 color, vec3 normal) {
+    return color * (0.25 + 0.75 * max(dot(normal, normalize(vec3(0.4, 0.8, 0.45))), 0.0));
+}
+
+void main() {
+    vec3 position = constants.boundsMin + inPosition.xyz * constants.boundsExtent;
+    vec3 normal = decodeOctahedral(inNormal);
+
+    gl_Position = constants.viewProjection * vec4(position, 1.0);
+    fragAlbedo = meshletColor(uint(gl_InstanceIndex));
+    fragColor = shade(fragAlbedo, normal);
+    fragPosition = position;
+    fragNormal = normal;
+}
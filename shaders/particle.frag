@@ -0,0 +1,17 @@
+#version 450
+
+// A soft disc, added to what is behind it
+layout(location = 0) in vec3 fragColor;
+layout(location = 1) in vec2 fragCorner;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float distance = dot(fragCorner, fragCorner);
+
+    if (distance > 1.0) {
+        discard;
+    }
+
+    outColor = vec4(fragColor * (1.0 - distance), 0.0);
+}
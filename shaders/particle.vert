@@ -0,0 +1,50 @@
+#version 450
+
+// One camera-facing quad per live particle of the state just simulated, as a triangle strip of 4 vertices
+struct Particle {
+    vec3 position;
+    // Seconds left
+    float life;
+    vec3 velocity;
+    float size;
+};
+
+layout(std430, set = 0, binding = 1) readonly buffer State {
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uvec3 groups;
+    uint count;
+    Particle particles[];
+} state;
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    vec3 cameraRight;
+    float deltaTime;
+    vec3 cameraUp;
+    uint emitCount;
+    vec3 emitterPosition;
+    uint seed;
+    float particleSize;
+    uint capacity;
+    float speed;
+    float lifetime;
+} constants;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec2 fragCorner;
+
+void main() {
+    Particle particle = state.particles[gl_InstanceIndex];
+
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1) * 2.0 - 1.0;
+    vec3 position = particle.position + (constants.cameraRight * corner.x + constants.cameraUp * corner.y) * particle.size;
+    gl_Position = constants.viewProjection * vec4(position, 1.0);
+
+    // From hot yellow to dim red as the particle dies
+    float age = 1.0 - clamp(particle.life / constants.lifetime, 0.0, 1.0);
+    fragColor = mix(vec3(1.0, 0.8, 0.3), vec3(0.8, 0.15, 0.05), age) * (1.0 - age) * 0.5;
+    fragCorner = corner;
+}
@@ -0,0 +1,15 @@
+#version 450
+
+// Depth-only, without a fragment shader: a mesh in the binary format from the light's view
+layout(location = 0) in vec4 inPosition;
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    vec3 boundsMin;
+    uint padding;
+    vec3 boundsExtent;
+} constants;
+
+void main() {
+    gl_Position = constants.viewProjection * vec4(constants.boundsMin + inPosition.xyz * constants.boundsExtent, 1.0);
+}
@@ -0,0 +1,19 @@
+#version 450
+
+// Depth-only, without a fragment shader: instances batched by level of detail as in instanced.vert, from the light's
+// view
+layout(location = 0) in vec4 inPosition;
+// Per instance: position, then uniform scale
+layout(location = 1) in vec4 inInstance;
+
+layout(push_constant) uniform Constants {
+    mat4 viewProjection;
+    vec3 boundsMin;
+    uint padding;
+    vec3 boundsExtent;
+} constants;
+
+void main() {
+    vec3 position = inInstance.xyz + inInstance.w * (constants.boundsMin + inPosition.xyz * constants.boundsExtent);
+    gl_Position = constants.viewProjection * vec4(position, 1.0);
+}
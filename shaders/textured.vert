@@ -0,0 +1,16 @@
+#version 450
+
+// A quad in the middle of the screen, as a triangle strip of 4 vertices, with texture coordinates from its top left
+layout(push_constant) uniform Constants {
+    // Half of its size in normalized device coordinates
+    vec2 scale;
+} constants;
+
+layout(location = 0) out vec2 fragTexCoord;
+
+void main() {
+    vec2 corner = vec2(gl_VertexIndex & 1, gl_VertexIndex >> 1);
+
+    fragTexCoord = corner;
+    gl_Position = vec4((corner * 2.0 - 1.0) * constants.scale, 0.5, 1.0);
+}
@@ -0,0 +1,17 @@
+#version 450
+
+// The layers side by side, each filtered as if it covered the whole quad alone
+layout(set = 0, binding = 0) uniform sampler2DArray tex;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float layers = float(textureSize(tex, 0).z);
+    vec2 coord = vec2(fragTexCoord.x * layers, fragTexCoord.y);
+    float layer = min(floor(coord.x), layers - 1.0);
+
+    // Gradients of the continuous coordinates: those of the wrapped ones jump at every edge between layers
+    outColor = vec4(textureGrad(tex, vec3(coord.x - layer, coord.y, layer), dFdx(coord), dFdy(coord)).rgb, 1.0);
+}
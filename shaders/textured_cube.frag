@@ -0,0 +1,18 @@
+#version 450
+
+// The whole sphere of directions: longitude across the quad, latitude down
+const float PI = 3.14159265;
+
+layout(set = 0, binding = 0) uniform samplerCube tex;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float longitude = (fragTexCoord.x * 2.0 - 1.0) * PI;
+    float latitude = (0.5 - fragTexCoord.y) * PI;
+    vec3 direction = vec3(cos(latitude) * sin(longitude), sin(latitude), cos(latitude) * cos(longitude));
+
+    outColor = vec4(texture(tex, direction).rgb, 1.0);
+}
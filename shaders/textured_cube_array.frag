@@ -0,0 +1,23 @@
+#version 450
+
+// The cubes side by side, each as textured_cube.frag shows one. Directions are continuous from one cube to the next,
+// so that implicit derivatives need no correction
+const float PI = 3.14159265;
+
+layout(set = 0, binding = 0) uniform samplerCubeArray tex;
+
+layout(location = 0) in vec2 fragTexCoord;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    float cubes = float(textureSize(tex, 0).z);
+    float x = fragTexCoord.x * cubes;
+    float cube = min(floor(x), cubes - 1.0);
+
+    float longitude = ((x - cube) * 2.0 - 1.0) * PI;
+    float latitude = (0.5 - fragTexCoord.y) * PI;
+    vec3 direction = vec3(cos(latitude) * sin(longitude), sin(latitude), cos(latitude) * cos(longitude));
+
+    outColor = vec4(texture(tex, vec4(direction, cube)).rgb, 1.0);
+}
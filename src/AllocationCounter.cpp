@@ -0,0 +1,64 @@
+#include <cstdlib>
+#include <new>
+
+#include "AllocationCounter.h"
+
+// Constant initialized: usable from operator new before anything else of the thread has run
+static thread_local uint64_t allocations = 0;
+
+uint64_t threadAllocationCount()
+{
+    return allocations;
+}
+
+#ifdef COUNT_ALLOCATIONS
+
+// The array and nothrow forms of new and the array forms of delete forward to these by default
+void *operator new(size_t size)
+{
+    allocations++;
+
+    if (void *memory = std::malloc(size > 0 ? size : 1))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment)
+{
+    allocations++;
+
+    size_t align = static_cast<size_t>(alignment);
+
+    // aligned_alloc wants a size multiple of the alignment
+    if (void *memory = std::aligned_alloc(align, (size + align - 1) / align * align + (size == 0 ? align : 0)))
+    {
+        return memory;
+    }
+
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef ALLOCATION_COUNTER_H_
+#define ALLOCATION_COUNTER_H_
+
+#include <cstdint>
+
+// Heap allocations through the global operator new are counted per thread in builds defining COUNT_ALLOCATIONS
+// (every build type but the release ones), which replace it in AllocationCounter.cpp
+#ifdef COUNT_ALLOCATIONS
+const bool AllocationsCounted = true;
+#else
+const bool AllocationsCounted = false;
+#endif
+
+// Allocations made by the calling thread so far; always 0 when they are not counted
+uint64_t threadAllocationCount();
+
+#endif
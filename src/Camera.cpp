@@ -0,0 +1,110 @@
+#include <cmath>
+
+#include "Camera.h"
+
+static void normalize(float v[3])
+{
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+    for (int i = 0; i < 3; i++)
+    {
+        v[i] = length > 0 ? v[i] / length : 0;
+    }
+}
+
+static void cross(const float a[3], const float b[3], float result[3])
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+static float dot(const float a[3], const float b[3])
+{
+    return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+Mat4 multiply(const Mat4 &a, const Mat4 &b)
+{
+    Mat4 result {};
+
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                result.m[column * 4 + row] += a.m[k * 4 + row] * b.m[column * 4 + k];
+            }
+        }
+    }
+
+    return result;
+}
+
+Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane)
+{
+    float f = 1.0f / std::tan(fovY / 2);
+
+    Mat4 result {};
+    result.m[0] = f / aspect;
+    result.m[5] = -f;
+    result.m[10] = farPlane / (nearPlane - farPlane);
+    result.m[11] = -1.0f;
+    result.m[14] = nearPlane * farPlane / (nearPlane - farPlane);
+
+    return result;
+}
+
+Mat4 orthographic(float left, float right, float bottom, float top, float nearPlane, float farPlane)
+{
+    Mat4 result {};
+    result.m[0] = 2.0f / (right - left);
+    result.m[5] = -2.0f / (top - bottom);
+    result.m[10] = 1.0f / (nearPlane - farPlane);
+    result.m[12] = -(right + left) / (right - left);
+    result.m[13] = (top + bottom) / (top - bottom);
+    result.m[14] = nearPlane / (nearPlane - farPlane);
+    result.m[15] = 1.0f;
+
+    return result;
+}
+
+Mat4 lookAt(const float eye[3], const float target[3], const float up[3])
+{
+    float forward[3] {target[0] - eye[0], target[1] - eye[1], target[2] - eye[2]};
+    normalize(forward);
+
+    float side[3];
+    cross(forward, up, side);
+    normalize(side);
+
+    float cameraUp[3];
+    cross(side, forward, cameraUp);
+
+    Mat4 result {};
+
+    for (int i = 0; i < 3; i++)
+    {
+        result.m[i * 4 + 0] = side[i];
+        result.m[i * 4 + 1] = cameraUp[i];
+        result.m[i * 4 + 2] = -forward[i];
+    }
+
+    result.m[12] = -dot(side, eye);
+    result.m[13] = -dot(cameraUp, eye);
+    result.m[14] = dot(forward, eye);
+    result.m[15] = 1.0f;
+
+    return result;
+}
+
+Mat4 Camera::view() const
+{
+    return lookAt(position, target, up);
+}
+
+Mat4 Camera::viewProjection(float aspect) const
+{
+    return multiply(perspective(fovY, aspect, nearPlane, farPlane), view());
+}
@@ -0,0 +1,32 @@
+#ifndef CAMERA_H_
+#define CAMERA_H_
+
+// Column-major, as GLSL reads a mat4 from a push constant or buffer block
+struct Mat4
+{
+    float m[16];
+};
+
+Mat4 multiply(const Mat4 &a, const Mat4 &b);
+
+// Right handed view space looking down -Z, to Vulkan clip space: Y pointing down and depth from 0 (near) to 1 (far).
+// Counter-clockwise triangles in world space stay counter-clockwise on screen
+Mat4 perspective(float fovY, float aspect, float nearPlane, float farPlane);
+// Same conventions, for the box between the planes: depth from 0 at the near plane to 1 at the far one
+Mat4 orthographic(float left, float right, float bottom, float top, float nearPlane, float farPlane);
+Mat4 lookAt(const float eye[3], const float target[3], const float up[3]);
+
+struct Camera
+{
+    float position[3];
+    float target[3];
+    float up[3]       = {0.0f, 1.0f, 0.0f};
+    float fovY        = 1.0f;
+    float nearPlane   = 0.01f;
+    float farPlane    = 1000.0f;
+
+    Mat4 view() const;
+    Mat4 viewProjection(float aspect) const;
+};
+
+#endif
@@ -0,0 +1,349 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "ClusteredLighting.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Workgroup size of light_cull.comp, one froxel per invocation
+const uint32_t CullClustersPerWorkgroup = 64;
+
+const uint32_t ClusterCount =
+    ClusteredLighting::GridWidth * ClusteredLighting::GridHeight * ClusteredLighting::GridDepth;
+
+// Layout of a grid buffer, as the Clusters block of the lighting shaders: the tile size, near and far planes, then
+// per froxel its light count followed by its light indices
+const VkDeviceSize ClusterHeaderSize = 16;
+const VkDeviceSize ClusterSize = (1 + ClusteredLighting::MaxLightsPerCluster) * sizeof(uint32_t);
+
+ClusteredLighting::ClusteredLighting(
+    VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, ShadowMaps &shadows,
+    uint32_t framesInFlight)
+    : memory(memory), pipelines(pipelines)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+
+    cullPipeline = nullptr;
+
+    // The lights, then the grid listing them, then the shadow maps and their cascades, which only lit fragments read
+    VkDescriptorSetLayoutBinding layoutBindings[4];
+    for (uint32_t binding = 0; binding < 2; binding++)
+    {
+        layoutBindings[binding] = {
+            .binding         = binding,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_FRAGMENT_BIT,
+        };
+    }
+
+    layoutBindings[2] = {
+        .binding         = 2,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    layoutBindings[3] = {
+        .binding         = 3,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+        .descriptorCount = 1,
+        .stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 4,
+        .pBindings    = layoutBindings,
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create lighting descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = sizeof(LightCullConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create lighting pipeline layout!");
+    }
+
+    VkDeviceSize lightsSize = MaxLights * sizeof(PointLight);
+    VkDeviceSize clustersSize = ClusterHeaderSize + ClusterCount * ClusterSize;
+
+    lightBuffers.resize(framesInFlight);
+    lightMemory.resize(framesInFlight);
+    lightMemoryTypes.resize(framesInFlight);
+    mappedLights.resize(framesInFlight);
+    clusterBuffers.resize(framesInFlight);
+    clusterMemory.resize(framesInFlight);
+    clusterMemoryTypes.resize(framesInFlight);
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        createBuffer(
+            lightsSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, lightBuffers[frame],
+            lightMemory[frame], lightMemorySize, lightMemoryTypes[frame]);
+
+        void *mapped;
+        if (vkMapMemory(device, lightMemory[frame], 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map light buffer memory!");
+        }
+        mappedLights[frame] = static_cast<PointLight *>(mapped);
+
+        createBuffer(
+            clustersSize, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            clusterBuffers[frame], clusterMemory[frame], clusterMemorySize, clusterMemoryTypes[frame]);
+    }
+
+    VkDescriptorPoolSize poolSizes[3] {
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 2 * framesInFlight,
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = framesInFlight,
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .descriptorCount = framesInFlight,
+        },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets       = framesInFlight,
+        .poolSizeCount = 3,
+        .pPoolSizes    = poolSizes,
+    };
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create lighting descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, descriptorSetLayout);
+    descriptorSets.resize(framesInFlight);
+
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = descriptorPool,
+        .descriptorSetCount = framesInFlight,
+        .pSetLayouts        = setLayouts.data(),
+    };
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate lighting descriptor sets!");
+    }
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        VkDescriptorBufferInfo bufferInfos[2] {
+            {
+                .buffer = lightBuffers[frame],
+                .offset = 0,
+                .range  = lightsSize,
+            },
+            {
+                .buffer = clusterBuffers[frame],
+                .offset = 0,
+                .range  = clustersSize,
+            },
+        };
+
+        VkDescriptorImageInfo shadowImageInfo {
+            .sampler     = shadows.getSampler(),
+            .imageView   = shadows.getView(),
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        VkDescriptorBufferInfo shadowBufferInfo {
+            .buffer = shadows.getUniformBuffer(frame),
+            .offset = 0,
+            .range  = sizeof(ShadowUniforms),
+        };
+
+        VkWriteDescriptorSet writes[4];
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            writes[binding] = {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = descriptorSets[frame],
+                .dstBinding      = binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo     = &bufferInfos[binding],
+            };
+        }
+
+        writes[2] = {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = descriptorSets[frame],
+            .dstBinding      = 2,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo      = &shadowImageInfo,
+        };
+
+        writes[3] = {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = descriptorSets[frame],
+            .dstBinding      = 3,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER,
+            .pBufferInfo     = &shadowBufferInfo,
+        };
+
+        vkUpdateDescriptorSets(device, 4, writes, 0, nullptr);
+    }
+
+    PipelineKey cullKey {
+        .computeShader  = "light_cull.comp",
+        .specialization = getSpecialization(),
+        .layout         = pipelineLayout,
+    };
+
+    cullPipeline = pipelines.request(cullKey);
+}
+
+ClusteredLighting::~ClusteredLighting()
+{
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        vkDestroyBuffer(device, lightBuffers[frame], nullptr);
+        memory.free(lightMemory[frame], lightMemorySize, lightMemoryTypes[frame]);
+        vkDestroyBuffer(device, clusterBuffers[frame], nullptr);
+        memory.free(clusterMemory[frame], clusterMemorySize, clusterMemoryTypes[frame]);
+    }
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+void ClusteredLighting::createBuffer(
+    VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
+    VkDeviceMemory &bufferMemory, VkDeviceSize &memorySize, uint32_t &memoryType)
+{
+    VkBufferCreateInfo bufferInfo {
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size        = size,
+        .usage       = usage,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create lighting buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    VkMemoryPropertyFlags required =
+        properties & (VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    bufferMemory = memory.allocate(memRequirements, properties, &memoryType, required);
+    memorySize = memRequirements.size;
+
+    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+}
+
+VkDescriptorSetLayout ClusteredLighting::getDescriptorSetLayout() const
+{
+    return descriptorSetLayout;
+}
+
+std::vector<SpecializationConstant> ClusteredLighting::getSpecialization()
+{
+    return {{0, MaxLightsPerCluster}};
+}
+
+VkDescriptorSet ClusteredLighting::getDescriptorSet(uint32_t frameIndex) const
+{
+    return descriptorSets[frameIndex];
+}
+
+void ClusteredLighting::setLights(const std::vector<PointLight> &lights)
+{
+    if (lights.size() > MaxLights)
+    {
+        LOG_WARNING("{} lights, only the first {} are kept", lights.size(), MaxLights);
+    }
+
+    this->lights.assign(lights.begin(), lights.begin() + std::min<size_t>(lights.size(), MaxLights));
+}
+
+uint32_t ClusteredLighting::getLightCount() const
+{
+    return static_cast<uint32_t>(lights.size());
+}
+
+bool ClusteredLighting::prepare(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Camera &camera, VkExtent2D extent)
+{
+    VkPipeline cull = pipelines.get(cullPipeline);
+
+    if (cull == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("ClusteredLighting::prepare");
+
+    std::copy(lights.begin(), lights.end(), mappedLights[frameIndex]);
+
+    LightCullConstants constants {
+        .view        = camera.view(),
+        .tanHalfFovY = std::tan(camera.fovY / 2),
+        .aspect      = (float)extent.width / (float)extent.height,
+        .nearPlane   = camera.nearPlane,
+        .farPlane    = camera.farPlane,
+        .extent      = {(float)extent.width, (float)extent.height},
+        .lightCount  = static_cast<uint32_t>(lights.size()),
+    };
+
+    // The grid was last read by this slot's previous frame, whose fence has been waited on: no barrier before writing
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, cull);
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[frameIndex], 0, nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, (ClusterCount + CullClustersPerWorkgroup - 1) / CullClustersPerWorkgroup, 1, 1);
+
+    VkBufferMemoryBarrier barrier {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = clusterBuffers[frameIndex],
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 1,
+        &barrier, 0, nullptr);
+
+    return true;
+}
@@ -0,0 +1,104 @@
+#ifndef CLUSTERED_LIGHTING_H_
+#define CLUSTERED_LIGHTING_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Camera.h"
+#include "MemoryBudget.h"
+#include "PipelineManager.h"
+#include "ShadowMaps.h"
+
+// A point light, laid out as the Light struct of the lighting shaders: 32 bytes. It fades out to nothing at its radius
+struct PointLight
+{
+    float position[3];
+    float radius;
+    float color[3];
+    float padding;
+};
+
+// Push constants of light_cull.comp, laid out as its block: 92 bytes
+struct LightCullConstants
+{
+    Mat4 view;
+    float tanHalfFovY;
+    float aspect;
+    float nearPlane;
+    float farPlane;
+    float extent[2];
+    uint32_t lightCount;
+};
+
+// Clustered forward shading: every frame a compute pass splits the view frustum into a grid of froxels, tiles of the
+// screen cut into slices growing exponentially with depth, and lists in each the lights whose sphere touches it. Lit
+// fragments then only go through the lights of their froxel, so that their cost follows how many lights are around
+// them rather than how many there are. Draws bind the lights and the grid of their frame, along with the shadow maps,
+// as set 1 of their layout
+class ClusteredLighting
+{
+public:
+    // Froxels across, down and in depth, as in the lighting shaders
+    static const uint32_t GridWidth = 16;
+    static const uint32_t GridHeight = 9;
+    static const uint32_t GridDepth = 24;
+    // Lights a froxel can list; further ones are left out of it. Specializes the lighting shaders' constant 0
+    static const uint32_t MaxLightsPerCluster = 63;
+    static const uint32_t MaxLights = 8192;
+
+private:
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    uint32_t framesInFlight;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    PipelineHandle cullPipeline;
+
+    std::vector<PointLight> lights;
+
+    // Per frame in flight: lights host visible and persistently mapped, the grid written by the culling pass
+    std::vector<VkBuffer> lightBuffers;
+    std::vector<VkDeviceMemory> lightMemory;
+    std::vector<uint32_t> lightMemoryTypes;
+    std::vector<PointLight *> mappedLights;
+    std::vector<VkBuffer> clusterBuffers;
+    std::vector<VkDeviceMemory> clusterMemory;
+    std::vector<uint32_t> clusterMemoryTypes;
+    std::vector<VkDescriptorSet> descriptorSets;
+    // Of every frame's buffer, as allocated
+    VkDeviceSize lightMemorySize;
+    VkDeviceSize clusterMemorySize;
+
+    // Host visibility and coherence are required, for memory that is mapped; device locality is only preferred
+    void createBuffer(
+        VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer &buffer,
+        VkDeviceMemory &bufferMemory, VkDeviceSize &memorySize, uint32_t &memoryType);
+
+public:
+    ClusteredLighting(
+        VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, ShadowMaps &shadows,
+        uint32_t framesInFlight);
+
+    // For the pipeline layouts of the lit draws, as their set 1
+    VkDescriptorSetLayout getDescriptorSetLayout() const;
+    // For the pipeline keys of the lit draws, whose fragment shader is clustered.frag
+    static std::vector<SpecializationConstant> getSpecialization();
+    VkDescriptorSet getDescriptorSet(uint32_t frameIndex) const;
+
+    // Replaces the lights from the next prepared frame on; at most MaxLights are kept
+    void setLights(const std::vector<PointLight> &lights);
+    uint32_t getLightCount() const;
+
+    // Outside the render pass, after the frame slot's fence has been waited on: uploads the lights and bins them for
+    // the camera. False while the culling pipeline compiles, in which case nothing lit must be drawn
+    bool prepare(VkCommandBuffer commandBuffer, uint32_t frameIndex, const Camera &camera, VkExtent2D extent);
+
+    ~ClusteredLighting();
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+
+#include "DrawList.h"
+#include "Trace.h"
+
+// Widths of the sort key fields, from the highest bits down
+const uint32_t PassBits = 4;
+const uint32_t PipelineBits = 16;
+const uint32_t MaterialBits = 16;
+const uint32_t DepthBits = 16;
+const uint32_t MeshBits = 12;
+
+static_assert(PassBits + PipelineBits + MaterialBits + DepthBits + MeshBits == 64, "Sort keys are 64 bits");
+static_assert(DrawPassCount <= (1u << PassBits), "Too many draw passes for the sort key");
+
+// Radix sort digits
+const uint32_t RadixBits = 8;
+const uint32_t RadixBuckets = 1 << RadixBits;
+const uint32_t RadixPasses = 64 / RadixBits;
+
+// Handles are pointers or 64-bit integers depending on the platform
+template <typename Handle>
+static uint64_t foldHandle(Handle handle, uint32_t bits)
+{
+    uint64_t value;
+    if constexpr (std::is_pointer_v<Handle>)
+    {
+        value = reinterpret_cast<uintptr_t>(handle);
+    }
+    else
+    {
+        value = static_cast<uint64_t>(handle);
+    }
+
+    // Fibonacci hashing: the top bits of the product depend on every bit of the handle
+    return (value * 0x9E3779B97F4A7C15ull) >> (64 - bits);
+}
+
+// Stable LSD sort of the keys, carrying the values along, one byte per pass; passes in which every key has the same
+// byte are skipped, which with few distinct pipelines and materials is most of them. The result is in keys and values
+static void radixSort(
+    FrameVector<uint64_t> &keys, FrameVector<uint32_t> &values, FrameVector<uint64_t> &scratchKeys,
+    FrameVector<uint32_t> &scratchValues)
+{
+    size_t count = keys.size();
+
+    if (count < 2)
+    {
+        return;
+    }
+
+    scratchKeys.resize(count);
+    scratchValues.resize(count);
+
+    // Every histogram in a single read of the keys
+    uint32_t histograms[RadixPasses][RadixBuckets] = {};
+
+    for (uint64_t key : keys)
+    {
+        for (uint32_t pass = 0; pass < RadixPasses; pass++)
+        {
+            histograms[pass][(key >> (pass * RadixBits)) & (RadixBuckets - 1)]++;
+        }
+    }
+
+    for (uint32_t pass = 0; pass < RadixPasses; pass++)
+    {
+        uint32_t shift = pass * RadixBits;
+        uint32_t *histogram = histograms[pass];
+
+        if (histogram[(keys[0] >> shift) & (RadixBuckets - 1)] == count)
+        {
+            continue;
+        }
+
+        uint32_t offset = 0;
+        for (uint32_t bucket = 0; bucket < RadixBuckets; bucket++)
+        {
+            uint32_t bucketCount = histogram[bucket];
+            histogram[bucket] = offset;
+            offset += bucketCount;
+        }
+
+        for (size_t i = 0; i < count; i++)
+        {
+            uint32_t slot = histogram[(keys[i] >> shift) & (RadixBuckets - 1)]++;
+            scratchKeys[slot] = keys[i];
+            scratchValues[slot] = values[i];
+        }
+
+        keys.swap(scratchKeys);
+        values.swap(scratchValues);
+    }
+}
+
+DrawList::DrawList(VkDevice device)
+{
+    cmdDrawMeshTasks = (PFN_vkCmdDrawMeshTasksEXT)vkGetDeviceProcAddr(device, "vkCmdDrawMeshTasksEXT");
+
+    sorted = true;
+    stats = {};
+}
+
+void DrawList::reset(FrameArena &arena)
+{
+    size_t count = commands.size();
+
+    commands = FrameVector<DrawCommand>(arena);
+    keys = FrameVector<uint64_t>(arena);
+    order = FrameVector<uint32_t>(arena);
+    scratchKeys = FrameVector<uint64_t>(arena);
+    scratchOrder = FrameVector<uint32_t>(arena);
+
+    // Frames tend to look like the previous one: growing the vectors would leave their old storage in the arena
+    commands.reserve(count);
+    keys.reserve(count);
+    order.reserve(count);
+
+    sorted = true;
+    stats = {};
+}
+
+void DrawList::add(DrawPass pass, uint32_t depth, const DrawCommand &command)
+{
+    if (command.type == DrawType::DrawMeshTasks && cmdDrawMeshTasks == nullptr)
+    {
+        throw std::runtime_error("Failed to load vkCmdDrawMeshTasksEXT!");
+    }
+
+    VkBuffer mesh = command.vertexBufferCount > 0 ? command.vertexBuffers[0] : command.indexBuffer;
+
+    uint64_t key = static_cast<uint64_t>(pass) << (64 - PassBits);
+    key |= foldHandle(command.pipeline, PipelineBits) << (MaterialBits + DepthBits + MeshBits);
+    key |= foldHandle(command.descriptorSet, MaterialBits) << (DepthBits + MeshBits);
+    key |= static_cast<uint64_t>(std::min(depth, (1u << DepthBits) - 1)) << MeshBits;
+    key |= foldHandle(mesh, MeshBits);
+
+    order.push_back(static_cast<uint32_t>(commands.size()));
+    keys.push_back(key);
+    commands.push_back(command);
+    sorted = false;
+}
+
+void DrawList::sort()
+{
+    TRACE_ZONE("DrawList::sort");
+
+    radixSort(keys, order, scratchKeys, scratchOrder);
+    sorted = true;
+}
+
+void DrawList::record(VkCommandBuffer commandBuffer, DrawPass pass)
+{
+    if (!sorted)
+    {
+        sort();
+    }
+
+    TRACE_ZONE("DrawList::record");
+
+    uint64_t passKey = static_cast<uint64_t>(pass) << (64 - PassBits);
+    size_t first = std::lower_bound(keys.begin(), keys.end(), passKey) - keys.begin();
+
+    // Nothing is bound at the start of a command buffer, or assumed to be at the start of a pass
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkPipelineLayout boundLayout = VK_NULL_HANDLE;
+    VkDescriptorSet boundDescriptorSet = VK_NULL_HANDLE;
+    VkDescriptorSet boundLightingSet = VK_NULL_HANDLE;
+    uint32_t boundVertexBufferCount = 0;
+    VkBuffer boundVertexBuffers[DrawCommand::MaxVertexBuffers] = {};
+    VkDeviceSize boundVertexOffsets[DrawCommand::MaxVertexBuffers] = {};
+    VkBuffer boundIndexBuffer = VK_NULL_HANDLE;
+    VkDeviceSize boundIndexOffset = 0;
+    VkIndexType boundIndexType = VK_INDEX_TYPE_UINT16;
+    const DrawCommand *pushed = nullptr;
+
+    for (size_t i = first; i < keys.size() && (keys[i] >> (64 - PassBits)) == pass; i++)
+    {
+        const DrawCommand &command = commands[order[i]];
+
+        if (command.pipeline != boundPipeline)
+        {
+            vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command.pipeline);
+            boundPipeline = command.pipeline;
+            stats.pipelineBinds++;
+        }
+
+        // Sets and push constants are only kept across pipelines sharing a layout
+        if (command.layout != boundLayout)
+        {
+            boundLayout = command.layout;
+            boundDescriptorSet = VK_NULL_HANDLE;
+            boundLightingSet = VK_NULL_HANDLE;
+            pushed = nullptr;
+        }
+
+        if (command.descriptorSet != VK_NULL_HANDLE && command.descriptorSet != boundDescriptorSet)
+        {
+            vkCmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command.layout, 0, 1, &command.descriptorSet, 0,
+                nullptr);
+            boundDescriptorSet = command.descriptorSet;
+            stats.descriptorBinds++;
+        }
+
+        if (command.lightingSet != VK_NULL_HANDLE && command.lightingSet != boundLightingSet)
+        {
+            vkCmdBindDescriptorSets(
+                commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, command.layout, 1, 1, &command.lightingSet, 0,
+                nullptr);
+            boundLightingSet = command.lightingSet;
+            stats.descriptorBinds++;
+        }
+
+        if (command.pushConstantSize > 0 &&
+            (pushed == nullptr || pushed->pushConstantStages != command.pushConstantStages ||
+                pushed->pushConstantSize != command.pushConstantSize ||
+                std::memcmp(pushed->pushConstants, command.pushConstants, command.pushConstantSize) != 0))
+        {
+            vkCmdPushConstants(
+                commandBuffer, command.layout, command.pushConstantStages, 0, command.pushConstantSize,
+                command.pushConstants);
+            pushed = &command;
+            stats.pushConstantUpdates++;
+        }
+
+        if (command.vertexBufferCount > 0 &&
+            (command.vertexBufferCount != boundVertexBufferCount ||
+                !std::equal(command.vertexBuffers, command.vertexBuffers + command.vertexBufferCount, boundVertexBuffers) ||
+                !std::equal(command.vertexOffsets, command.vertexOffsets + command.vertexBufferCount, boundVertexOffsets)))
+        {
+            vkCmdBindVertexBuffers(
+                commandBuffer, 0, command.vertexBufferCount, command.vertexBuffers, command.vertexOffsets);
+            boundVertexBufferCount = command.vertexBufferCount;
+            std::copy(command.vertexBuffers, command.vertexBuffers + command.vertexBufferCount, boundVertexBuffers);
+            std::copy(command.vertexOffsets, command.vertexOffsets + command.vertexBufferCount, boundVertexOffsets);
+            stats.vertexBufferBinds++;
+        }
+
+        if (command.indexBuffer != VK_NULL_HANDLE &&
+            (command.indexBuffer != boundIndexBuffer || command.indexOffset != boundIndexOffset ||
+                command.indexType != boundIndexType))
+        {
+            vkCmdBindIndexBuffer(commandBuffer, command.indexBuffer, command.indexOffset, command.indexType);
+            boundIndexBuffer = command.indexBuffer;
+            boundIndexOffset = command.indexOffset;
+            boundIndexType = command.indexType;
+            stats.indexBufferBinds++;
+        }
+
+        switch (command.type)
+        {
+        case DrawType::Draw:
+            vkCmdDraw(commandBuffer, command.count, command.instanceCount, command.first, command.firstInstance);
+            break;
+        case DrawType::DrawIndexed:
+            vkCmdDrawIndexed(
+                commandBuffer, command.count, command.instanceCount, command.first, command.vertexOffset,
+                command.firstInstance);
+            break;
+        case DrawType::DrawIndirect:
+            vkCmdDrawIndirect(
+                commandBuffer, command.indirectBuffer, command.indirectOffset, command.drawCount, command.stride);
+            break;
+        case DrawType::DrawIndexedIndirect:
+            vkCmdDrawIndexedIndirect(
+                commandBuffer, command.indirectBuffer, command.indirectOffset, command.drawCount, command.stride);
+            break;
+        case DrawType::DrawMeshTasks:
+            cmdDrawMeshTasks(commandBuffer, command.count, 1, 1);
+            break;
+        }
+
+        stats.draws++;
+    }
+}
+
+const DrawListStats &DrawList::getStats() const
+{
+    return stats;
+}
+
+uint32_t DrawList::depthBucket(float distance, float nearPlane, float farPlane)
+{
+    if (!(farPlane > nearPlane) || !(nearPlane > 0.0f))
+    {
+        return 0;
+    }
+
+    float clamped = std::clamp(distance, nearPlane, farPlane);
+    float position = std::log(clamped / nearPlane) / std::log(farPlane / nearPlane);
+
+    return static_cast<uint32_t>(position * ((1u << DepthBits) - 1));
+}
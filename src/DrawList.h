@@ -0,0 +1,140 @@
+#ifndef DRAW_LIST_H_
+#define DRAW_LIST_H_
+
+#include <cstdint>
+#include <cstring>
+#include <vulkan/vulkan.h>
+
+#include "FrameArena.h"
+
+// Passes a draw list is recorded in, one after the other: the highest bits of the sort keys
+enum DrawPass : uint32_t
+{
+    DrawPassMain = 0,
+    // Blended draws, after every opaque one, in the same render pass
+    DrawPassTransparent,
+    // Depth-only draws into each shadow cascade, before the main pass and in render passes of their own
+    DrawPassShadow0,
+    DrawPassShadow1,
+    DrawPassShadow2,
+    DrawPassShadow3,
+    DrawPassCount,
+};
+
+enum class DrawType : uint8_t
+{
+    Draw,
+    DrawIndexed,
+    DrawIndirect,
+    DrawIndexedIndirect,
+    DrawMeshTasks,
+};
+
+// Everything a draw binds, pushes and draws. Handles left null and a push constant size of 0 bind nothing, leaving
+// whatever the previous draw of the pass bound
+struct DrawCommand
+{
+    // The minimum maxPushConstantsSize of every device
+    static const uint32_t MaxPushConstantSize = 128;
+    static const uint32_t MaxVertexBuffers = 2;
+
+    DrawType type;
+
+    VkPipeline pipeline;
+    VkPipelineLayout layout;
+    // Set 0 of the layout
+    VkDescriptorSet descriptorSet;
+    // Set 1 of the layout, the lights of lit draws
+    VkDescriptorSet lightingSet;
+
+    uint32_t vertexBufferCount;
+    VkBuffer vertexBuffers[MaxVertexBuffers];
+    VkDeviceSize vertexOffsets[MaxVertexBuffers];
+    VkBuffer indexBuffer;
+    VkDeviceSize indexOffset;
+    VkIndexType indexType;
+
+    VkShaderStageFlags pushConstantStages;
+    uint32_t pushConstantSize;
+    uint8_t pushConstants[MaxPushConstantSize];
+
+    // Vertices or indices, with the first of them; group count x for mesh tasks
+    uint32_t count;
+    uint32_t first;
+    int32_t vertexOffset;
+    uint32_t instanceCount;
+    uint32_t firstInstance;
+
+    // Indirect draws only
+    VkBuffer indirectBuffer;
+    VkDeviceSize indirectOffset;
+    uint32_t drawCount;
+    uint32_t stride;
+
+    template <typename T>
+    void setPushConstants(VkShaderStageFlags stages, const T &constants)
+    {
+        static_assert(sizeof(T) <= MaxPushConstantSize, "Push constants larger than every device allows");
+
+        pushConstantStages = stages;
+        pushConstantSize = sizeof(T);
+        std::memcpy(pushConstants, &constants, sizeof(T));
+    }
+};
+
+// State changes and draws recorded by the draw list in the last frame
+struct DrawListStats
+{
+    uint32_t draws;
+    uint32_t pipelineBinds;
+    uint32_t descriptorBinds;
+    uint32_t vertexBufferBinds;
+    uint32_t indexBufferBinds;
+    uint32_t pushConstantUpdates;
+};
+
+// The draws of a frame, collected from every renderer then recorded in an order that minimizes state changes. Each
+// draw gets a 64-bit sort key:
+//
+//   63    60 59      44 43      28 27         12 11   0
+//   | pass  | pipeline | material | depth bucket | mesh |
+//
+// where the pipeline, material (descriptor set) and mesh (vertex buffer) fields are hashes of the handles: draws
+// sharing state get neighbouring keys, and a collision only costs a state change, since recording compares the state
+// itself. Keys are sorted by an LSD radix sort over buffers from the frame arena, and recording skips every bind and
+// push that would not change what the previous draw left bound
+class DrawList
+{
+private:
+    // In the frame arena, reserved for as many draws as the previous frame had
+    FrameVector<DrawCommand> commands;
+    FrameVector<uint64_t> keys;
+    FrameVector<uint32_t> order;
+    FrameVector<uint64_t> scratchKeys;
+    FrameVector<uint32_t> scratchOrder;
+    bool sorted;
+
+    PFN_vkCmdDrawMeshTasksEXT cmdDrawMeshTasks;
+    DrawListStats stats;
+
+public:
+    // Loads vkCmdDrawMeshTasksEXT when the device has it; mesh task draws cannot be added otherwise
+    DrawList(VkDevice device);
+
+    // At the start of every frame, after the arena's: drops the draws and statistics of the previous one
+    void reset(FrameArena &arena);
+
+    // depth is a bucket from depthBucket(), or any value ordering the pass' draws front to back
+    void add(DrawPass pass, uint32_t depth, const DrawCommand &command);
+    void sort();
+    // Inside the render pass, with the viewport and scissor set; sorts first if needed
+    void record(VkCommandBuffer commandBuffer, DrawPass pass);
+
+    const DrawListStats &getStats() const;
+
+    // 16-bit bucket of a view distance, logarithmic between the near and far planes so that near draws, which
+    // occlude the most, are told apart the best
+    static uint32_t depthBucket(float distance, float nearPlane, float farPlane);
+};
+
+#endif
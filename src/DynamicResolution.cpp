@@ -0,0 +1,110 @@
+#include <algorithm>
+#include <cmath>
+
+#include "DynamicResolution.h"
+
+// Share of the budget aimed at, leaving room for frames costing a little more than the average
+const double BudgetHeadroom = 0.9;
+// Weight of the newest timing in the average
+const double AverageWeight = 0.2;
+// Largest raise of the scale at once
+const float ScaleStepUp = 0.05f;
+// Smaller changes are not worth their settling frames
+const float MinScaleChange = 0.01f;
+
+DynamicResolution::DynamicResolution(VkExtent2D extent, double budgetMilliseconds, uint32_t latency)
+{
+    this->extent = extent;
+    this->budget = budgetMilliseconds;
+    this->latency = latency;
+
+    scale = MaxScale;
+    averageTime = 0.0;
+    averaged = false;
+    settling = 0;
+    stats = {0, scale, scale};
+}
+
+void DynamicResolution::setScale(float newScale)
+{
+    newScale = std::clamp(newScale, MinScale, MaxScale);
+
+    if (std::abs(newScale - scale) < MinScaleChange)
+    {
+        return;
+    }
+
+    // What the frames so far would have cost at the new scale, until timings of the new scale come in
+    averageTime *= double(newScale) * newScale / (double(scale) * scale);
+    scale = newScale;
+
+    // The frames recorded before this one are still to be timed
+    settling = latency > 0 ? latency - 1 : 0;
+
+    stats.changes++;
+    stats.minScale = std::min(stats.minScale, scale);
+    stats.maxScale = std::max(stats.maxScale, scale);
+}
+
+void DynamicResolution::update(double gpuMilliseconds)
+{
+    if (gpuMilliseconds <= 0.0)
+    {
+        return;
+    }
+
+    if (settling > 0)
+    {
+        settling--;
+        return;
+    }
+
+    averageTime = averaged ? averageTime + (gpuMilliseconds - averageTime) * AverageWeight : gpuMilliseconds;
+    averaged = true;
+
+    double target = budget * BudgetHeadroom;
+
+    // A spike: straight to the scale this very frame would have fit at
+    if (gpuMilliseconds > budget)
+    {
+        setScale(scale * static_cast<float>(std::sqrt(target / gpuMilliseconds)));
+        return;
+    }
+
+    float fitting = scale * static_cast<float>(std::sqrt(target / averageTime));
+
+    if (fitting < scale)
+    {
+        setScale(fitting);
+    }
+    else
+    {
+        setScale(std::min(fitting, scale + ScaleStepUp));
+    }
+}
+
+float DynamicResolution::getScale() const
+{
+    return scale;
+}
+
+VkExtent2D DynamicResolution::getRenderExtent() const
+{
+    return {
+        std::max(static_cast<uint32_t>(extent.width * scale + 0.5f), 1u),
+        std::max(static_cast<uint32_t>(extent.height * scale + 0.5f), 1u),
+    };
+}
+
+double DynamicResolution::getBudget() const
+{
+    return budget;
+}
+
+ResolutionStats DynamicResolution::takeStats()
+{
+    ResolutionStats taken = stats;
+    stats = {0, scale, scale};
+
+    return taken;
+}
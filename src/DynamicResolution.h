@@ -0,0 +1,57 @@
+#ifndef DYNAMIC_RESOLUTION_H_
+#define DYNAMIC_RESOLUTION_H_
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+// Scale changes and extremes since the statistics were last taken
+struct ResolutionStats
+{
+    uint32_t changes;
+    float minScale;
+    float maxScale;
+};
+
+// Keeps the GPU time of frames within a budget by scaling the part of the scene target the main pass renders to,
+// which post-processing then upscales to the full extent. The cost of a frame is taken to grow with its pixels, the
+// square of the scale: a frame over budget drops the scale at once to what would have fit, while spare time raises it
+// a step at a time, so that load spikes are absorbed within a frame and recovery does not oscillate. Timings arrive
+// as many frames late as there are frames in flight, which is how long every change waits before being judged
+class DynamicResolution
+{
+public:
+    static constexpr float MinScale = 0.5f;
+    static constexpr float MaxScale = 1.0f;
+
+private:
+    VkExtent2D extent;
+    double budget;
+    uint32_t latency;
+
+    float scale;
+    // Exponential average of the GPU times, as if rendered at the current scale
+    double averageTime;
+    bool averaged;
+    // Frames left before timings reflect the current scale
+    uint32_t settling;
+    ResolutionStats stats;
+
+    void setScale(float scale);
+
+public:
+    // budgetMilliseconds: GPU time a frame should take; latency: frames between recording one and reading its timings
+    DynamicResolution(VkExtent2D extent, double budgetMilliseconds, uint32_t latency);
+
+    // Once per frame, with the GPU time of the last frame whose timings were read
+    void update(double gpuMilliseconds);
+
+    float getScale() const;
+    // Of the scene, from its top left corner: at least one pixel either way
+    VkExtent2D getRenderExtent() const;
+    double getBudget() const;
+
+    ResolutionStats takeStats();
+};
+
+#endif
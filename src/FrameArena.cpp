@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include "FrameArena.h"
+#include "Logger.h"
+
+FrameArena::FrameArena(uint32_t framesInFlight, size_t capacity)
+{
+    frames.resize(framesInFlight);
+
+    for (Frame &frame : frames)
+    {
+        frame.block = std::make_unique<std::byte[]>(capacity);
+        frame.capacity = capacity;
+        frame.used = 0;
+        frame.overflowCapacity = 0;
+        frame.overflowUsed = 0;
+        frame.overflowRequested = 0;
+    }
+
+    frameIndex = 0;
+}
+
+void FrameArena::beginFrame(uint32_t frameIndex)
+{
+    this->frameIndex = frameIndex;
+    Frame &frame = frames[frameIndex];
+
+    if (!frame.overflow.empty())
+    {
+        // Room for everything the last frame of this slot asked for, with some slack for alignment and growth
+        size_t capacity = std::max(frame.capacity * 2, (frame.used + frame.overflowRequested) * 5 / 4);
+
+        frame.overflow.clear();
+        frame.block = std::make_unique<std::byte[]>(capacity);
+        frame.capacity = capacity;
+
+        LOG_DEBUG("Frame arena {} grown to {} bytes", frameIndex, capacity);
+    }
+
+    frame.used = 0;
+    frame.overflowCapacity = 0;
+    frame.overflowUsed = 0;
+    frame.overflowRequested = 0;
+}
+
+// Offset past used within block at which an address is aligned
+static size_t alignedOffset(const std::byte *block, size_t used, size_t alignment)
+{
+    uintptr_t address = reinterpret_cast<uintptr_t>(block) + used;
+    return used + ((alignment - address % alignment) % alignment);
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    Frame &frame = frames[frameIndex];
+
+    if (frame.overflow.empty())
+    {
+        size_t offset = alignedOffset(frame.block.get(), frame.used, alignment);
+
+        if (offset + size <= frame.capacity)
+        {
+            frame.used = offset + size;
+            return frame.block.get() + offset;
+        }
+    }
+
+    frame.overflowRequested += size + alignment - 1;
+
+    size_t offset = frame.overflow.empty() ? 0 : alignedOffset(frame.overflow.back().get(), frame.overflowUsed, alignment);
+
+    if (frame.overflow.empty() || offset + size > frame.overflowCapacity)
+    {
+        frame.overflowCapacity = std::max(size + alignment - 1, frame.capacity);
+        frame.overflow.push_back(std::make_unique<std::byte[]>(frame.overflowCapacity));
+        offset = alignedOffset(frame.overflow.back().get(), 0, alignment);
+    }
+
+    frame.overflowUsed = offset + size;
+    return frame.overflow.back().get() + offset;
+}
+
+size_t FrameArena::used() const
+{
+    const Frame &frame = frames[frameIndex];
+    return frame.used + frame.overflowRequested;
+}
@@ -0,0 +1,96 @@
+#ifndef FRAME_ARENA_H_
+#define FRAME_ARENA_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+// Bump allocator for what a frame builds and throws away: draw lists, clear values, copy regions and the like. Each
+// frame slot in flight has its own block, rewound when the slot is reused, so memory allocated by a frame stays valid
+// until its fence has been waited on. Nothing is freed individually. A frame needing more than its block gets
+// overflow blocks from the heap, and the block is grown to fit when the slot comes around again: once the peak frame
+// has been seen, allocating never reaches the heap
+class FrameArena
+{
+private:
+    struct Frame
+    {
+        std::unique_ptr<std::byte[]> block;
+        size_t capacity;
+        size_t used;
+        std::vector<std::unique_ptr<std::byte[]>> overflow;
+        size_t overflowCapacity;
+        size_t overflowUsed;
+        // Bytes asked for past the block, overflow included
+        size_t overflowRequested;
+    };
+
+    std::vector<Frame> frames;
+    uint32_t frameIndex;
+
+public:
+    FrameArena(uint32_t framesInFlight, size_t capacity);
+
+    // Once the frame slot's fence has been waited on: everything it allocated last time is gone
+    void beginFrame(uint32_t frameIndex);
+
+    void *allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    T *allocate(size_t count)
+    {
+        static_assert(std::is_trivially_destructible_v<T>, "Arena memory is never destroyed");
+        return static_cast<T *>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Bytes allocated by the current frame
+    size_t used() const;
+};
+
+// Standard allocator drawing from a frame arena, for containers that must not outlive the frame. Deallocation does
+// nothing: a container growing leaves its old storage behind until the slot is rewound, so reserving is worth it
+template <typename T>
+class ArenaAllocator
+{
+public:
+    typedef T value_type;
+    typedef std::true_type propagate_on_container_copy_assignment;
+    typedef std::true_type propagate_on_container_move_assignment;
+    typedef std::true_type propagate_on_container_swap;
+
+    FrameArena *arena = nullptr;
+
+    ArenaAllocator() = default;
+    ArenaAllocator(FrameArena &arena) : arena(&arena) {}
+
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U> &other) : arena(other.arena)
+    {
+    }
+
+    T *allocate(size_t count)
+    {
+        if (arena == nullptr)
+        {
+            throw std::bad_alloc();
+        }
+
+        return static_cast<T *>(arena->allocate(count * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T *, size_t) {}
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U> &other) const
+    {
+        return arena == other.arena;
+    }
+};
+
+template <typename T>
+using FrameVector = std::vector<T, ArenaAllocator<T>>;
+
+#endif
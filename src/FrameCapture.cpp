@@ -0,0 +1,620 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "FrameCapture.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Readbacks beyond one per frame slot: frames that can wait for the writer before new ones are dropped
+static const uint32_t MaxQueuedFrames = 4;
+static const uint32_t Y4mFrameRate = 60;
+
+static uint32_t findReadbackMemoryType(VkPhysicalDevice physicalDevice, uint32_t typeFilter, bool *coherent)
+{
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    // Cached memory makes the CPU reads fast; it usually needs explicit invalidation
+    const VkMemoryPropertyFlags preferences[] {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+    };
+
+    for (VkMemoryPropertyFlags properties : preferences)
+    {
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+
+            if ((typeFilter & (1 << i)) && (flags & properties) == properties)
+            {
+                *coherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+                return i;
+            }
+        }
+    }
+
+    throw std::runtime_error("Failed to find host visible memory for frame capture!");
+}
+
+static CaptureFormat captureFormatFromPath(const std::string &path)
+{
+    if (path.empty())
+    {
+        return CaptureFormat::None;
+    }
+
+    auto endsWith = [&path](const char *extension) {
+        size_t length = strlen(extension);
+        return path.size() >= length && path.compare(path.size() - length, length, extension) == 0;
+    };
+
+    if (endsWith(".ppm"))
+    {
+        return CaptureFormat::Ppm;
+    }
+    else if (endsWith(".png"))
+    {
+        return CaptureFormat::Png;
+    }
+    else if (endsWith(".y4m"))
+    {
+        return CaptureFormat::Y4m;
+    }
+
+    throw std::runtime_error("Unsupported capture format (expected .ppm, .png or .y4m): " + path);
+}
+
+FrameCapture::FrameCapture(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D size, VkFormat colorFormat,
+    VkImageLayout targetLayout, uint32_t framesInFlight, const std::string &path)
+{
+    this->device = device;
+    this->size = size;
+    this->targetLayout = targetLayout;
+    this->path = path;
+    frameSize = static_cast<VkDeviceSize>(size.width) * size.height * 4;
+    frameNumber = 0;
+    droppedFrames = 0;
+    stream = nullptr;
+    writing = false;
+    stopping = false;
+
+    switch (colorFormat)
+    {
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+        bgra = false;
+        break;
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        bgra = true;
+        break;
+    default:
+        throw std::runtime_error("Unsupported color format for frame capture!");
+    }
+
+    format = captureFormatFromPath(path);
+
+    if (format == CaptureFormat::Y4m)
+    {
+        stream = fopen(path.c_str(), "wb");
+        if (stream == nullptr)
+        {
+            throw std::runtime_error("Failed to open capture stream " + path);
+        }
+
+        fmt::print(stream, "YUV4MPEG2 W{} H{} F{}:1 Ip A1:1 C420jpeg\n", size.width, size.height, Y4mFrameRate);
+    }
+    else if (format != CaptureFormat::None && this->path.find('{') == std::string::npos)
+    {
+        // No placeholder: number the sequence right before the extension
+        this->path.insert(this->path.size() - 4, "_{:06}");
+    }
+
+    if (format == CaptureFormat::Ppm || format == CaptureFormat::Png)
+    {
+        // Formatted again for every frame on the writer thread, where a malformed path must not throw
+        try
+        {
+            (void)fmt::format(fmt::runtime(this->path), frameNumber);
+        }
+        catch (const fmt::format_error &e)
+        {
+            throw std::runtime_error(
+                "Failed to expand the frame number in capture path " + path + ": " + e.what() + "!");
+        }
+    }
+
+    readbacks.resize(framesInFlight + MaxQueuedFrames);
+    pending.assign(framesInFlight, NoReadback);
+
+    for (uint32_t i = 0; i < readbacks.size(); i++)
+    {
+        Readback &readback = readbacks[i];
+
+        VkBufferCreateInfo bufferInfo {
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = frameSize,
+            .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &readback.buffer) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create readback buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, readback.buffer, &memRequirements);
+
+        VkMemoryAllocateInfo allocInfo {
+            .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+            .allocationSize  = memRequirements.size,
+            .memoryTypeIndex = findReadbackMemoryType(physicalDevice, memRequirements.memoryTypeBits, &coherent),
+        };
+
+        if (vkAllocateMemory(device, &allocInfo, nullptr, &readback.memory) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate readback memory!");
+        }
+
+        vkBindBufferMemory(device, readback.buffer, readback.memory, 0);
+
+        // Persistently mapped: only the fence decides when the contents can be read
+        if (vkMapMemory(device, readback.memory, 0, VK_WHOLE_SIZE, 0, &readback.mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map readback memory!");
+        }
+
+        readback.frameNumber = 0;
+        freeReadbacks.push_back(i);
+    }
+
+    writer = std::thread(&FrameCapture::writerLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    changed.notify_all();
+
+    writer.join();
+
+    if (stream != nullptr)
+    {
+        fclose(stream);
+    }
+
+    for (auto &readback : readbacks)
+    {
+        vkUnmapMemory(device, readback.memory);
+        vkDestroyBuffer(device, readback.buffer, nullptr);
+        vkFreeMemory(device, readback.memory, nullptr);
+    }
+}
+
+void FrameCapture::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkImage image)
+{
+    TRACE_ZONE("FrameCapture::record");
+
+    uint32_t index;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        if (freeReadbacks.empty())
+        {
+            // The writer is behind: dropping the frame keeps the render loop from ever waiting on the disk
+            frameNumber++;
+            droppedFrames++;
+            return;
+        }
+
+        index = freeReadbacks.back();
+        freeReadbacks.pop_back();
+    }
+
+    Readback &readback = readbacks[index];
+
+    VkImageSubresourceRange subresourceRange {
+        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel   = 0,
+        .levelCount     = 1,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
+
+    VkImageMemoryBarrier toTransfer {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout           = targetLayout,
+        .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = image,
+        .subresourceRange    = subresourceRange,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toTransfer);
+
+    VkBufferImageCopy region {
+        .bufferOffset      = 0,
+        .bufferRowLength   = 0,
+        .bufferImageHeight = 0,
+        .imageSubresource {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        },
+        .imageOffset       = {0, 0, 0},
+        .imageExtent       = {size.width, size.height, 1},
+    };
+
+    vkCmdCopyImageToBuffer(commandBuffer, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, readback.buffer, 1, &region);
+
+    VkImageMemoryBarrier toTarget {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = 0,
+        .dstAccessMask       = 0,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        .newLayout           = targetLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = image,
+        .subresourceRange    = subresourceRange,
+    };
+
+    VkBufferMemoryBarrier toHost {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_HOST_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = readback.buffer,
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        0, nullptr, 1, &toHost, 1, &toTarget);
+
+    readback.frameNumber = frameNumber++;
+    pending[frameIndex] = index;
+}
+
+void FrameCapture::collect(uint32_t frameIndex)
+{
+    uint32_t index = pending[frameIndex];
+    if (index == NoReadback)
+    {
+        return;
+    }
+
+    TRACE_ZONE("FrameCapture::collect");
+
+    pending[frameIndex] = NoReadback;
+    Readback &readback = readbacks[index];
+
+    if (!coherent)
+    {
+        VkMappedMemoryRange range {
+            .sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .memory = readback.memory,
+            .offset = 0,
+            .size   = VK_WHOLE_SIZE,
+        };
+
+        vkInvalidateMappedMemoryRanges(device, 1, &range);
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(index);
+    }
+    changed.notify_all();
+}
+
+void FrameCapture::finish()
+{
+    for (uint32_t i = 0; i < pending.size(); i++)
+    {
+        // Slots are collected in submission order so that streams stay sequential
+        uint32_t oldest = 0;
+        for (uint32_t j = 0; j < pending.size(); j++)
+        {
+            if (pending[j] != NoReadback &&
+                (pending[oldest] == NoReadback ||
+                 readbacks[pending[j]].frameNumber < readbacks[pending[oldest]].frameNumber))
+            {
+                oldest = j;
+            }
+        }
+
+        collect(oldest);
+    }
+
+    std::unique_lock<std::mutex> lock(mutex);
+    changed.wait(lock, [this] { return queue.empty() && !writing; });
+
+    if (droppedFrames > 0)
+    {
+        LOG_WARNING("Frame capture dropped {} frames: the writer could not keep up", droppedFrames);
+    }
+
+    if (stream != nullptr)
+    {
+        fflush(stream);
+    }
+}
+
+uint64_t FrameCapture::capturedFrames() const
+{
+    return frameNumber - droppedFrames;
+}
+
+void FrameCapture::setFrameCallback(std::function<void(uint64_t, const std::vector<uint8_t> &)> callback)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    frameCallback = std::move(callback);
+}
+
+void FrameCapture::writerLoop()
+{
+    Trace::setThreadName("Frame capture writer");
+
+    std::unique_lock<std::mutex> lock(mutex);
+
+    for (;;)
+    {
+        changed.wait(lock, [this] { return stopping || !queue.empty(); });
+
+        if (queue.empty())
+        {
+            return;
+        }
+
+        uint32_t index = queue.front();
+        queue.pop_front();
+        writing = true;
+
+        lock.unlock();
+        try
+        {
+            write(readbacks[index]);
+        }
+        catch (const std::exception &e)
+        {
+            // One lost frame, rather than the whole process
+            LOG_ERROR("Failed to write captured frame {}: {}", readbacks[index].frameNumber, e.what());
+        }
+        lock.lock();
+
+        writing = false;
+        freeReadbacks.push_back(index);
+        changed.notify_all();
+    }
+}
+
+void FrameCapture::write(const Readback &readback)
+{
+    TRACE_ZONE("FrameCapture::write");
+
+    const uint8_t *pixels = static_cast<const uint8_t *>(readback.mapped);
+    size_t pixelCount = static_cast<size_t>(size.width) * size.height;
+    std::vector<uint8_t> rgb(pixelCount * 3);
+
+    uint32_t red = bgra ? 2 : 0;
+    uint32_t blue = bgra ? 0 : 2;
+
+    for (size_t i = 0; i < pixelCount; i++)
+    {
+        rgb[i * 3 + 0] = pixels[i * 4 + red];
+        rgb[i * 3 + 1] = pixels[i * 4 + 1];
+        rgb[i * 3 + 2] = pixels[i * 4 + blue];
+    }
+
+    if (frameCallback)
+    {
+        frameCallback(readback.frameNumber, rgb);
+    }
+
+    switch (format)
+    {
+    case CaptureFormat::None:
+        break;
+    case CaptureFormat::Ppm:
+        writePpm(readback.frameNumber, rgb);
+        break;
+    case CaptureFormat::Png:
+        writePng(readback.frameNumber, rgb);
+        break;
+    case CaptureFormat::Y4m:
+        writeY4m(rgb);
+        break;
+    }
+}
+
+void FrameCapture::writePpm(uint64_t number, const std::vector<uint8_t> &rgb)
+{
+    std::string fileName = fmt::format(fmt::runtime(path), number);
+    FILE *file = fopen(fileName.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        LOG_ERROR("Failed to write captured frame {}", fileName);
+        return;
+    }
+
+    fmt::print(file, "P6\n{} {}\n255\n", size.width, size.height);
+    fwrite(rgb.data(), 1, rgb.size(), file);
+    fclose(file);
+}
+
+static uint32_t crc32(const uint8_t *data, size_t length, uint32_t crc = 0)
+{
+    static const auto table = [] {
+        std::vector<uint32_t> table(256);
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+            {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            table[n] = c;
+        }
+        return table;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+    {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<uint8_t> &out, uint32_t value)
+{
+    out.push_back(value >> 24);
+    out.push_back(value >> 16);
+    out.push_back(value >> 8);
+    out.push_back(value);
+}
+
+static void appendPngChunk(std::vector<uint8_t> &out, const char *type, const std::vector<uint8_t> &data)
+{
+    appendBigEndian(out, static_cast<uint32_t>(data.size()));
+
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+
+    appendBigEndian(out, crc32(out.data() + start, out.size() - start));
+}
+
+void FrameCapture::writePng(uint64_t number, const std::vector<uint8_t> &rgb)
+{
+    std::string fileName = fmt::format(fmt::runtime(path), number);
+    FILE *file = fopen(fileName.c_str(), "wb");
+
+    if (file == nullptr)
+    {
+        LOG_ERROR("Failed to write captured frame {}", fileName);
+        return;
+    }
+
+    std::vector<uint8_t> png {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+
+    std::vector<uint8_t> header;
+    appendBigEndian(header, size.width);
+    appendBigEndian(header, size.height);
+    header.insert(header.end(), {8, 2, 0, 0, 0}); // 8 bit RGB, deflate, adaptive filtering, no interlace
+    appendPngChunk(png, "IHDR", header);
+
+    // Every scanline is prefixed by its filter type (none)
+    size_t stride = static_cast<size_t>(size.width) * 3;
+    std::vector<uint8_t> scanlines;
+    scanlines.reserve((stride + 1) * size.height);
+
+    for (uint32_t y = 0; y < size.height; y++)
+    {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), rgb.begin() + y * stride, rgb.begin() + (y + 1) * stride);
+    }
+
+    // Stored (uncompressed) deflate blocks: encoding speed matters more than file size for captures, and no
+    // compression library is needed
+    std::vector<uint8_t> zlib {0x78, 0x01};
+    uint32_t adlerA = 1, adlerB = 0;
+
+    for (size_t offset = 0; offset < scanlines.size(); offset += 65535)
+    {
+        uint16_t length = static_cast<uint16_t>(std::min<size_t>(65535, scanlines.size() - offset));
+        bool last = offset + length == scanlines.size();
+
+        uint16_t complement = ~length;
+
+        zlib.insert(zlib.end(), {
+            static_cast<uint8_t>(last), static_cast<uint8_t>(length), static_cast<uint8_t>(length >> 8),
+            static_cast<uint8_t>(complement), static_cast<uint8_t>(complement >> 8)});
+        zlib.insert(zlib.end(), scanlines.begin() + offset, scanlines.begin() + offset + length);
+
+        for (size_t i = offset; i < offset + length; i++)
+        {
+            adlerA = (adlerA + scanlines[i]) % 65521;
+            adlerB = (adlerB + adlerA) % 65521;
+        }
+    }
+
+    appendBigEndian(zlib, (adlerB << 16) | adlerA);
+    appendPngChunk(png, "IDAT", zlib);
+    appendPngChunk(png, "IEND", {});
+
+    fwrite(png.data(), 1, png.size(), file);
+    fclose(file);
+}
+
+void FrameCapture::writeY4m(const std::vector<uint8_t> &rgb)
+{
+    // Full range BT.601 4:2:0, chroma averaged over 2x2 blocks
+    uint32_t width = size.width, height = size.height;
+    uint32_t chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+
+    std::vector<uint8_t> planes(width * height + chromaWidth * chromaHeight * 2);
+    uint8_t *luma = planes.data();
+    uint8_t *cb = luma + width * height;
+    uint8_t *cr = cb + chromaWidth * chromaHeight;
+
+    for (uint32_t y = 0; y < height; y++)
+    {
+        for (uint32_t x = 0; x < width; x++)
+        {
+            const uint8_t *pixel = &rgb[(y * width + x) * 3];
+            luma[y * width + x] = static_cast<uint8_t>(0.299f * pixel[0] + 0.587f * pixel[1] + 0.114f * pixel[2] + 0.5f);
+        }
+    }
+
+    for (uint32_t y = 0; y < chromaHeight; y++)
+    {
+        for (uint32_t x = 0; x < chromaWidth; x++)
+        {
+            float r = 0.0f, g = 0.0f, b = 0.0f;
+            uint32_t count = 0;
+
+            for (uint32_t sy = y * 2; sy < std::min(y * 2 + 2, height); sy++)
+            {
+                for (uint32_t sx = x * 2; sx < std::min(x * 2 + 2, width); sx++)
+                {
+                    const uint8_t *pixel = &rgb[(sy * width + sx) * 3];
+                    r += pixel[0];
+                    g += pixel[1];
+                    b += pixel[2];
+                    count++;
+                }
+            }
+
+            r /= count;
+            g /= count;
+            b /= count;
+
+            cb[y * chromaWidth + x] = static_cast<uint8_t>(std::clamp(128.0f - 0.168736f * r - 0.331264f * g + 0.5f * b + 0.5f, 0.0f, 255.0f));
+            cr[y * chromaWidth + x] = static_cast<uint8_t>(std::clamp(128.0f + 0.5f * r - 0.418688f * g - 0.081312f * b + 0.5f, 0.0f, 255.0f));
+        }
+    }
+
+    fmt::print(stream, "FRAME\n");
+    fwrite(planes.data(), 1, planes.size(), stream);
+}
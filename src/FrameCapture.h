@@ -0,0 +1,90 @@
+#ifndef FRAME_CAPTURE_H_
+#define FRAME_CAPTURE_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+enum class CaptureFormat { None, Ppm, Png, Y4m };
+
+// Copies the color target into a pool of host-visible buffers. Once the fence of its frame slot has been waited on by
+// the frame loop, a buffer is handed as is to a dedicated thread, which encodes and writes it straight from the
+// mapping and then returns it to the pool, so capturing never stalls rendering nor copies frames on its thread. A
+// frame finding no free buffer, the writer being behind, is dropped
+class FrameCapture
+{
+private:
+    struct Readback
+    {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        void *mapped;
+        uint64_t frameNumber;
+    };
+
+    static const uint32_t NoReadback = UINT32_MAX;
+
+    VkDevice device;
+    VkExtent2D size;
+    VkImageLayout targetLayout;
+    VkDeviceSize frameSize;
+    bool coherent;
+    bool bgra;
+
+    std::vector<Readback> readbacks;
+    // Per frame slot, the readback its last frame was copied into, until collected
+    std::vector<uint32_t> pending;
+    uint64_t frameNumber;
+    uint64_t droppedFrames;
+
+    CaptureFormat format;
+    std::string path;
+    FILE *stream;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable changed;
+    // Readbacks collected and waiting for the writer, and those free to be recorded into
+    std::deque<uint32_t> queue;
+    std::vector<uint32_t> freeReadbacks;
+    bool writing;
+    bool stopping;
+
+    std::function<void(uint64_t, const std::vector<uint8_t> &)> frameCallback;
+
+    void writerLoop();
+    void write(const Readback &readback);
+    void writePpm(uint64_t number, const std::vector<uint8_t> &rgb);
+    void writePng(uint64_t number, const std::vector<uint8_t> &rgb);
+    void writeY4m(const std::vector<uint8_t> &rgb);
+
+public:
+    // `path` selects the encoding through its extension (.ppm, .png or .y4m); image sequences expand a fmt
+    // placeholder with the frame number, e.g. "frames/{:05}.png". An empty path writes nothing to disk
+    FrameCapture(VkDevice device, VkPhysicalDevice physicalDevice, VkExtent2D size, VkFormat colorFormat,
+        VkImageLayout targetLayout, uint32_t framesInFlight, const std::string &path);
+
+    // Recorded after the render pass, with the image in `targetLayout`; it is left in the same layout
+    void record(VkCommandBuffer commandBuffer, uint32_t frameIndex, VkImage image);
+    // Called once the fence of the frame slot has been waited on
+    void collect(uint32_t frameIndex);
+    // Called once the device is idle: collects the remaining frames and waits for the writer
+    void finish();
+
+    uint64_t capturedFrames() const;
+
+    // Receives every captured frame as tightly packed RGB, on the writer thread
+    void setFrameCallback(std::function<void(uint64_t frameNumber, const std::vector<uint8_t> &rgb)> callback);
+
+    ~FrameCapture();
+};
+
+#endif
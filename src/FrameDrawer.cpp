@@ -1,6 +1,19 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
 #include <stdexcept>
 
+#include "AllocationCounter.h"
 #include "FrameDrawer.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Frames between two logs of the statistics
+const uint64_t StatsInterval = 256;
+// Initial size of the frame arena's blocks, grown as needed
+const size_t FrameArenaCapacity = 64 * 1024;
+// Simulated time per frame, whatever the frame rate, so that headless runs always simulate the same steps
+const float SimulationStep = 1.0f / 60.0f;
 
 FrameDrawer::FrameDrawer(SDL_Window *window, char *name)
 {
@@ -12,6 +25,8 @@ FrameDrawer::FrameDrawer(SDL_Window *window, char *name)
 
     vulkan = new VulkanHandler(sdlWindow, windowName);
     vulkan->init();
+    drawList = std::make_unique<DrawList>(vulkan->device);
+    frameArena = std::make_unique<FrameArena>(vulkan->MAX_FRAMES_IN_FLIGHT, FrameArenaCapacity);
 
     frameIndex = 0;
 }
@@ -23,47 +38,89 @@ FrameDrawer::FrameDrawer(GLFWwindow *window, char *name)
 
     vulkan = new VulkanHandler(glfwWindow, windowName);
     vulkan->init();
+    drawList = std::make_unique<DrawList>(vulkan->device);
+    frameArena = std::make_unique<FrameArena>(vulkan->MAX_FRAMES_IN_FLIGHT, FrameArenaCapacity);
+
+    frameIndex = 0;
+}
+
+FrameDrawer::FrameDrawer(VkExtent2D size, char *name)
+{
+    windowName = name;
+
+    clearColor = {0.0f, 0.0f, 0.0f, 1.0f};
+    clearDepthStencil = {1.0f, 0};
+
+    vulkan = new VulkanHandler(size, windowName);
+    vulkan->init();
+    drawList = std::make_unique<DrawList>(vulkan->device);
+    frameArena = std::make_unique<FrameArena>(vulkan->MAX_FRAMES_IN_FLIGHT, FrameArenaCapacity);
 
     frameIndex = 0;
 }
 
 FrameDrawer::~FrameDrawer() {}
 
-void FrameDrawer::acquireNextImage()
+void FrameDrawer::waitForFrame()
 {
-    if (vkWaitForFences(vulkan->device, 1, &vulkan->fences[frameIndex], VK_FALSE, UINT64_MAX) != VK_SUCCESS)
     {
-        throw std::runtime_error("Failed to wait for fences");
+        TRACE_ZONE("Wait for frame fence");
+
+        if (vkWaitForFences(vulkan->device, 1, &vulkan->fences[frameIndex], VK_FALSE, UINT64_MAX) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to wait for fences");
+        }
     }
 
-    vkAcquireNextImageKHR (
-        vulkan->device,
-        vulkan->swapchain,
-        UINT64_MAX,
-        vulkan->imageAvailableSemaphore,
-        VK_NULL_HANDLE,
-        &imageIndex
-    );
+    if (vulkan->capture)
+    {
+        vulkan->capture->collect(frameIndex);
+    }
+}
+
+void FrameDrawer::acquireNextImage()
+{
+    if (vulkan->swapchain == VK_NULL_HANDLE)
+    {
+        // Headless: each frame slot owns its target
+        imageIndex = frameIndex;
+    }
+    else
+    {
+        TRACE_ZONE("Acquire swapchain image");
+
+        vkAcquireNextImageKHR (
+            vulkan->device,
+            vulkan->swapchain,
+            UINT64_MAX,
+            vulkan->imageAvailableSemaphores[frameIndex],
+            VK_NULL_HANDLE,
+            &imageIndex
+        );
+    }
 
     if (vkResetFences(vulkan->device, 1, &vulkan->fences[frameIndex]) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to reset fences!");
     }
 
-    commandBuffer = vulkan->commandBuffers[frameIndex];
-    image = vulkan->swapchainImages[frameIndex];
+    image = vulkan->swapchainImages[imageIndex];
 }
 
-void FrameDrawer::resetCommandBuffer()
+void FrameDrawer::resetCommandBuffer(VkCommandBuffer commandBuffer)
 {
+    TRACE_ZONE("FrameDrawer::resetCommandBuffer");
+
     if (vkResetCommandBuffer(commandBuffer, 0) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to reset command buffer!");
     }
 }
 
-void FrameDrawer::beginCommandBuffer()
+void FrameDrawer::beginCommandBuffer(VkCommandBuffer commandBuffer)
 {
+    TRACE_ZONE("FrameDrawer::beginCommandBuffer");
+
     VkCommandBufferBeginInfo beginInfo {
         .sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO,
         .flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT,
@@ -75,8 +132,10 @@ void FrameDrawer::beginCommandBuffer()
     }
 }
 
-void FrameDrawer::endCommandBuffer()
+void FrameDrawer::endCommandBuffer(VkCommandBuffer commandBuffer)
 {
+    TRACE_ZONE("FrameDrawer::endCommandBuffer");
+
     if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
     {
         throw std::runtime_error("");
@@ -90,7 +149,9 @@ void FrameDrawer::freeCommandBuffers()
 
 void FrameDrawer::beginRenderPass()
 {
-    std::vector<VkClearValue> clearValues(2);
+    TRACE_ZONE("FrameDrawer::beginRenderPass");
+
+    VkClearValue *clearValues = frameArena->allocate<VkClearValue>(2);
     clearValues[0].color = clearColor;
     clearValues[1].depthStencil = clearDepthStencil;
 
@@ -100,50 +161,36 @@ void FrameDrawer::beginRenderPass()
         .framebuffer     = vulkan->swapchainFramebuffers[imageIndex],
         .renderArea {
             .offset      = {0, 0},
-            .extent      = vulkan->swapchainSize,
+            .extent      = renderExtent,
         },
-        .clearValueCount = static_cast<uint32_t>(clearValues.size()),
-        .pClearValues    = clearValues.data(),
+        .clearValueCount = 2,
+        .pClearValues    = clearValues,
     };
 
     vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
 }
 
-void FrameDrawer::bindGraphicsPipelineToCommandBuffer()
-{
-    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, vulkan->graphicsPipeline);
-}
-
 void FrameDrawer::endRenderPass()
 {
+    TRACE_ZONE("FrameDrawer::endRenderPass");
+
     vkCmdEndRenderPass(commandBuffer);
 }
 
-void FrameDrawer::queueSubmit()
+void FrameDrawer::queuePresent()
 {
-    VkSubmitInfo submitInfo {
-        .sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO,
-        .waitSemaphoreCount   = 1,
-        .pWaitSemaphores      = &vulkan->imageAvailableSemaphore,
-        .pWaitDstStageMask    = &waitDestStageMask,
-        .commandBufferCount   = 1,
-        .pCommandBuffers      = &commandBuffer,
-        .signalSemaphoreCount = 1,
-        .pSignalSemaphores    = &vulkan->renderingFinishedSemaphore,
-    };
+    TRACE_ZONE("FrameDrawer::queuePresent");
 
-    if (vkQueueSubmit(vulkan->graphicsQueue, 1, &submitInfo, vulkan->fences[frameIndex]) != VK_SUCCESS)
+    if (vulkan->swapchain == VK_NULL_HANDLE)
     {
-        throw std::runtime_error("Failed to submit draw command buffer!");
+        frameIndex = (frameIndex + 1) % vulkan->MAX_FRAMES_IN_FLIGHT;
+        return;
     }
-}
 
-void FrameDrawer::queuePresent()
-{
     VkPresentInfoKHR presentInfo {
         .sType              = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR,
         .waitSemaphoreCount = 1,
-        .pWaitSemaphores    = &vulkan->renderingFinishedSemaphore,
+        .pWaitSemaphores    = &vulkan->renderingFinishedSemaphores[imageIndex],
         .swapchainCount     = 1,
         .pSwapchains        = &vulkan->swapchain,
         .pImageIndices      = &imageIndex,
@@ -156,11 +203,7 @@ void FrameDrawer::queuePresent()
         throw std::runtime_error("");
     }
 
-    if (vkQueueWaitIdle(vulkan->presentQueue) != VK_SUCCESS)
-    {
-        throw std::runtime_error("");
-    }
-
+    // No waiting here: the next use of this frame slot waits on its fence, so the GPU keeps the queued frames busy
     frameIndex = (frameIndex + 1) % vulkan->MAX_FRAMES_IN_FLIGHT;
 }
 
@@ -169,8 +212,8 @@ void FrameDrawer::setViewport()
     VkViewport viewport {
         .x        = 0.0f,
         .y        = 0.0f,
-        .width    = (float)vulkan->swapchainSize.width,
-        .height   = (float)vulkan->swapchainSize.height,
+        .width    = (float)renderExtent.width,
+        .height   = (float)renderExtent.height,
         .minDepth = 0.0f,
         .maxDepth = 1.0f,
     };
@@ -186,17 +229,158 @@ void FrameDrawer::setScissor()
             .y      = 0,
         },
         .extent {
-            .width  = static_cast<uint32_t>(vulkan->swapchainSize.width),
-            .height = static_cast<uint32_t>(vulkan->swapchainSize.height),
+            .width  = renderExtent.width,
+            .height = renderExtent.height,
         },
     };
 
     vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 }
 
-void FrameDrawer::draw()
+void FrameDrawer::drawTriangle()
+{
+    VkPipeline pipeline = vulkan->pipelines->get(vulkan->graphicsPipeline);
+
+    // Still compiling in the background: skip the draw rather than stalling the frame
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    DrawCommand command {
+        .type          = DrawType::Draw,
+        .pipeline      = pipeline,
+        .count         = 3,
+        .instanceCount = 1,
+    };
+
+    drawList->add(DrawPassMain, 0, command);
+}
+
+void FrameDrawer::showMesh(const std::string &path, uint32_t instanceCount)
+{
+    // Kept resident while memory allows, should it be shown again
+    if (hasSceneMesh)
+    {
+        vulkan->meshes->release(sceneMesh);
+    }
+
+    sceneMesh = vulkan->meshes->load(path);
+    hasSceneMesh = true;
+    instancedScene = instanceCount > 1;
+
+    const MeshFileHeader &header = vulkan->meshes->getMesh(sceneMesh).header;
+
+    float center[3];
+    float radius = 0.0f;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        center[axis] = (header.boundsMin[axis] + header.boundsMax[axis]) / 2;
+        radius += (header.boundsMax[axis] - center[axis]) * (header.boundsMax[axis] - center[axis]);
+    }
+    radius = std::max(std::sqrt(radius), 1e-3f);
+
+    if (!instancedScene)
+    {
+        std::copy(center, center + 3, sceneCenter);
+        sceneRadius = radius;
+        vulkan->shadows->setStaticBounds(sceneCenter, sceneRadius);
+        return;
+    }
+
+    // Centered on the origin, one and a half diameters apart
+    uint32_t side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(instanceCount))));
+    float spacing = radius * 3.0f;
+    std::vector<MeshInstance> instances;
+
+    for (uint32_t i = 0; i < instanceCount; i++)
+    {
+        float column = (i % side) - (side - 1) / 2.0f;
+        float row = (i / side) - (side - 1) / 2.0f;
+
+        instances.push_back({
+            .position = {column * spacing - center[0], -center[1], row * spacing - center[2]},
+            .scale    = 1.0f,
+        });
+    }
+
+    vulkan->instances->setInstances(sceneMesh, instances);
+
+    std::fill(sceneCenter, sceneCenter + 3, 0.0f);
+    sceneRadius = (side - 1) * spacing * std::sqrt(0.5f) + radius;
+    vulkan->shadows->setStaticBounds(sceneCenter, sceneRadius);
+}
+
+void FrameDrawer::showParticles(uint32_t capacity)
+{
+    vulkan->createParticleSystem(capacity);
+    hasParticles = true;
+
+    if (hasSceneMesh)
+    {
+        return;
+    }
+
+    // Around the fountain: its particles rise up to speed^2 / 2g
+    const ParticleEmitter &emitter = vulkan->particles->getEmitter();
+    float height = emitter.speed * emitter.speed / (2.0f * 9.81f);
+
+    sceneCenter[0] = emitter.position[0];
+    sceneCenter[1] = emitter.position[1] + height / 2;
+    sceneCenter[2] = emitter.position[2];
+    sceneRadius = height;
+}
+
+void FrameDrawer::showTexture(const std::string &path)
+{
+    vulkan->createTexturedQuad();
+    sceneTexture = vulkan->textures->load(path);
+    hasTexture = true;
+}
+
+void FrameDrawer::showLights(uint32_t count)
+{
+    // Fixed seed, so that every run and every benchmark sees the same lights
+    std::mt19937 random(1234);
+    std::uniform_real_distribution<float> unit(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> channel(0.2f, 1.0f);
+
+    std::vector<PointLight> lights;
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        PointLight light {
+            .radius = sceneRadius * 0.2f,
+            .color  = {channel(random), channel(random), channel(random)},
+        };
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            light.position[axis] = sceneCenter[axis] + unit(random) * sceneRadius;
+        }
+
+        lights.push_back(light);
+    }
+
+    vulkan->lighting->setLights(lights);
+}
+
+void FrameDrawer::updateCamera()
 {
-    vkCmdDraw(commandBuffer, 3, 1, 0, 0);
+    // Advances per frame rather than per second, so that headless runs always see the same views
+    float angle = frameCount * 0.01f;
+    // Close enough to a grid of instances to have both near and far ones
+    float distance = sceneRadius * (instancedScene ? 1.2f : 2.5f);
+
+    camera.position[0] = sceneCenter[0] + distance * std::sin(angle);
+    camera.position[1] = sceneCenter[1] + distance * 0.3f;
+    camera.position[2] = sceneCenter[2] + distance * std::cos(angle);
+    camera.target[0] = sceneCenter[0];
+    camera.target[1] = sceneCenter[1];
+    camera.target[2] = sceneCenter[2];
+    camera.nearPlane = sceneRadius * 0.01f;
+    camera.farPlane = sceneRadius * 10.0f;
 }
 
 void FrameDrawer::setClearColor(int R, int G, int B, int A)
@@ -211,20 +395,239 @@ void FrameDrawer::setClearColor(int R, int G, int B)
 
 void FrameDrawer::nextFrame()
 {
+    TRACE_ZONE("FrameDrawer::nextFrame");
+
+    uint64_t allocationsAtStart = threadAllocationCount();
+
+    waitForFrame();
+    frameArena->beginFrame(frameIndex);
+    vulkan->pipelines->commitReloads();
+
+    // Uploads and culling need no swapchain image: they are submitted first, and run while the image is acquired
+    VkCommandBuffer earlyCommandBuffer = vulkan->earlyCommandBuffers[frameIndex];
+    resetCommandBuffer(earlyCommandBuffer);
+    beginCommandBuffer(earlyCommandBuffer);
+    bool timed = vulkan->gpuProfiler->beginFrame(earlyCommandBuffer, frameIndex);
+    // Before the managers, which record the evictions it asks for
+    vulkan->memory->update();
+    vulkan->textures->update(earlyCommandBuffer, frameIndex, *frameArena);
+    vulkan->meshes->update(earlyCommandBuffer, frameIndex);
+
+    if (hasSceneMesh || hasParticles)
+    {
+        updateCamera();
+    }
+
+    // Every pass sized by the screen follows the main pass' extent, light culling's tiles and level selection included
+    renderExtent = vulkan->swapchainSize;
+    if (vulkan->resolution)
+    {
+        if (timed)
+        {
+            vulkan->resolution->update(vulkan->gpuProfiler->totalMilliseconds());
+        }
+        renderExtent = vulkan->resolution->getRenderExtent();
+    }
+
+    VkExtent2D extent = renderExtent;
+
+    // The triangle stands in until the mesh is uploaded and its pipelines are compiled, light culling included
+    bool drawMesh = false;
+    if (hasSceneMesh)
+    {
+        uint32_t lightZone = vulkan->gpuProfiler->beginZone(earlyCommandBuffer, "Light culling");
+        bool lit = vulkan->lighting->prepare(earlyCommandBuffer, frameIndex, camera, extent);
+        vulkan->gpuProfiler->endZone(earlyCommandBuffer, lightZone);
+
+        if (lit && instancedScene)
+        {
+            drawMesh = vulkan->instances->prepare(frameIndex, camera, extent);
+        }
+        else if (lit)
+        {
+            uint32_t cullZone = vulkan->gpuProfiler->beginZone(earlyCommandBuffer, "Meshlet culling");
+            drawMesh = vulkan->meshlets->prepare(earlyCommandBuffer, frameIndex, sceneMesh, camera, extent);
+            vulkan->gpuProfiler->endZone(earlyCommandBuffer, cullZone);
+        }
+
+        vulkan->shadows->fit(camera, (float)extent.width / (float)extent.height);
+    }
+
+    bool drawParticles = false;
+    if (hasParticles)
+    {
+        uint32_t particleZone = vulkan->gpuProfiler->beginZone(earlyCommandBuffer, "Particles");
+        drawParticles = vulkan->particles->prepare(earlyCommandBuffer, camera, extent, SimulationStep);
+        vulkan->gpuProfiler->endZone(earlyCommandBuffer, particleZone);
+    }
+
+    endCommandBuffer(earlyCommandBuffer);
+    vulkan->gpuProfiler->submit();
+    vulkan->submitter->add(earlyCommandBuffer);
+    vulkan->submitter->flush(*frameArena);
+
     acquireNextImage();
 
-    resetCommandBuffer();
-    beginCommandBuffer();
+    commandBuffer = vulkan->commandBuffers[frameIndex];
+    resetCommandBuffer(commandBuffer);
+    beginCommandBuffer(commandBuffer);
+    drawList->reset(*frameArena);
 
+    // Lit draws go without shadows until the casters' pipelines are compiled
+    bool castShadows = false;
+    if (drawMesh && instancedScene)
+    {
+        vulkan->instances->draw(*drawList, frameIndex);
+        castShadows = vulkan->instances->drawShadows(*drawList, *vulkan->shadows, frameIndex);
+    }
+    else if (drawMesh)
+    {
+        vulkan->meshlets->draw(*drawList, frameIndex);
+        castShadows = vulkan->meshlets->drawShadows(*drawList, *vulkan->shadows);
+    }
+    else if (!hasTexture || !vulkan->texturedQuad->draw(*drawList, frameIndex, sceneTexture, renderExtent))
+    {
+        drawTriangle();
+    }
+
+    if (drawParticles)
+    {
+        vulkan->particles->draw(*drawList);
+    }
+    drawList->sort();
+
+    if (hasSceneMesh)
+    {
+        uint32_t shadowZone = vulkan->gpuProfiler->beginZone(commandBuffer, "Shadow maps");
+        vulkan->shadows->record(commandBuffer, frameIndex, *drawList, castShadows);
+        vulkan->gpuProfiler->endZone(commandBuffer, shadowZone);
+    }
+
+    uint32_t mainPassZone = vulkan->gpuProfiler->beginZone(commandBuffer, "Main render pass");
     beginRenderPass();
-    bindGraphicsPipelineToCommandBuffer();
     setViewport();
     setScissor();
-    draw();
+    drawList->record(commandBuffer, DrawPassMain);
+    drawList->record(commandBuffer, DrawPassTransparent);
     endRenderPass();
+    vulkan->gpuProfiler->endZone(commandBuffer, mainPassZone);
 
-    endCommandBuffer();
+    if (vulkan->post)
+    {
+        vulkan->post->record(commandBuffer, renderExtent, image, vulkan->colorTargetLayout, *vulkan->gpuProfiler);
+    }
 
-    queueSubmit();
+    if (vulkan->capture)
+    {
+        vulkan->capture->record(commandBuffer, frameIndex, image);
+    }
+
+    endCommandBuffer(commandBuffer);
+
+    vulkan->gpuProfiler->endFrame();
+
+    // Only the first writes to the image wait for it: the color attachment writes, or the blit after post-processing
+    bool presenting = vulkan->swapchain != VK_NULL_HANDLE;
+    if (presenting)
+    {
+        vulkan->submitter->wait(
+            vulkan->imageAvailableSemaphores[frameIndex],
+            vulkan->post ? VK_PIPELINE_STAGE_2_TRANSFER_BIT : VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    }
+    vulkan->submitter->add(commandBuffer);
+    if (presenting)
+    {
+        vulkan->submitter->signal(
+            vulkan->renderingFinishedSemaphores[imageIndex], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+    }
+    vulkan->submitter->flush(*frameArena, vulkan->fences[frameIndex]);
     queuePresent();
+
+    // Logging may allocate, and is left out of the count
+    windowAllocations += threadAllocationCount() - allocationsAtStart;
+
+    if (frameCount % StatsInterval == 0)
+    {
+        logStats(drawMesh);
+    }
+    frameCount++;
+}
+
+void FrameDrawer::logStats(bool drawMesh)
+{
+    if (drawMesh && instancedScene)
+    {
+        const InstanceStats &stats = vulkan->instances->getStats();
+
+        std::string levels;
+        for (uint32_t count : stats.instances)
+        {
+            levels += levels.empty() ? std::to_string(count) : " " + std::to_string(count);
+        }
+
+        LOG_DEBUG("Instances per level of detail: {}, culled {}, {} triangles", levels, stats.culled, stats.triangles);
+    }
+
+    if (hasSceneMesh)
+    {
+        ShadowStats shadowStats = vulkan->shadows->takeStats();
+        LOG_DEBUG(
+            "Shadow cascades: {} rendered, {} cached in the last {} frames", shadowStats.rendered, shadowStats.cached,
+            frameCount == 0 ? 1 : StatsInterval);
+    }
+
+    if (vulkan->resolution)
+    {
+        ResolutionStats resolutionStats = vulkan->resolution->takeStats();
+        LOG_DEBUG(
+            "Dynamic resolution: rendering at {}x{} ({:.2f}), {} changes between {:.2f} and {:.2f} in the last {} "
+            "frames",
+            renderExtent.width, renderExtent.height, vulkan->resolution->getScale(), resolutionStats.changes,
+            resolutionStats.minScale, resolutionStats.maxScale, frameCount == 0 ? 1 : StatsInterval);
+    }
+
+    MemoryStats memoryStats = vulkan->memory->takeStats();
+    std::string heaps;
+    for (const HeapBudget &heap : vulkan->memory->getHeaps())
+    {
+        heaps += fmt::format("{}{}/{} MiB", heaps.empty() ? "" : ", ", heap.usage >> 20, heap.budget >> 20);
+    }
+
+    LOG_DEBUG(
+        "Memory heaps: {}; {} evictions of {} MiB, {} host visible fallbacks in the last {} frames", heaps,
+        memoryStats.evictions, memoryStats.evictedBytes >> 20, memoryStats.fallbacks,
+        frameCount == 0 ? 1 : StatsInterval);
+
+    const DrawListStats &stats = drawList->getStats();
+    LOG_DEBUG(
+        "Draw list: {} draws, {} pipeline binds, {} descriptor binds, {} vertex and {} index buffer binds, {} "
+        "push constant updates", stats.draws, stats.pipelineBinds, stats.descriptorBinds, stats.vertexBufferBinds,
+        stats.indexBufferBinds, stats.pushConstantUpdates);
+
+    SubmitStats submitStats = vulkan->submitter->takeStats();
+    LOG_DEBUG(
+        "Queue submissions: {} submits, {} batches, {} command buffers in the last {} frames", submitStats.submits,
+        submitStats.batches, submitStats.commandBuffers, frameCount == 0 ? 1 : StatsInterval);
+
+    if (AllocationsCounted)
+    {
+        // The first window includes the frames warming up the arena and the containers kept across frames
+        LOG_DEBUG(
+            "Heap allocations while rendering: {} in the last {} frames, frame arena at {} bytes", windowAllocations,
+            frameCount == 0 ? 1 : StatsInterval, frameArena->used());
+    }
+
+    windowAllocations = 0;
+}
+
+void FrameDrawer::finish()
+{
+    TRACE_ZONE("FrameDrawer::finish");
+
+    vkDeviceWaitIdle(vulkan->device);
+
+    if (vulkan->capture)
+    {
+        vulkan->capture->finish();
+    }
 }
\ No newline at end of file
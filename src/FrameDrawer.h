@@ -1,9 +1,15 @@
 #ifndef VULKAN_FRAME_DRAWER_H_
 #define VULKAN_FRAME_DRAWER_H_
 
+#include <memory>
+#include <string>
+
 #include <SDL.h>
 #include <vulkan/vulkan.h>
 
+#include "Camera.h"
+#include "DrawList.h"
+#include "FrameArena.h"
 #include "VulkanHandler.h"
 
 class FrameDrawer
@@ -16,35 +22,68 @@ private:
     uint32_t frameIndex, imageIndex;
     VkCommandBuffer commandBuffer;
     VkImage image;
-    VkPipelineStageFlags waitDestStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+    // Of the main pass this frame: the swapchain's, or less with dynamic resolution
+    VkExtent2D renderExtent;
     VkClearColorValue clearColor;
     VkClearDepthStencilValue clearDepthStencil;
+    std::unique_ptr<FrameArena> frameArena;
+    std::unique_ptr<DrawList> drawList;
+
+    bool hasSceneMesh = false;
+    bool hasParticles = false;
+    bool hasTexture = false;
+    bool instancedScene = false;
+    MeshHandle sceneMesh;
+    TextureHandle sceneTexture;
+    // Bounding sphere of what is drawn, which the camera orbits
+    float sceneCenter[3];
+    float sceneRadius;
+    Camera camera;
+    uint64_t frameCount = 0;
+    // Heap allocations of the render thread since the statistics were last logged
+    uint64_t windowAllocations = 0;
 
+    void waitForFrame();
     void acquireNextImage();
-    void resetCommandBuffer();
-    void beginCommandBuffer();
+    void resetCommandBuffer(VkCommandBuffer commandBuffer);
+    void beginCommandBuffer(VkCommandBuffer commandBuffer);
     void beginRenderPass();
     void endRenderPass();
-    void endCommandBuffer();
+    void endCommandBuffer(VkCommandBuffer commandBuffer);
     void freeCommandBuffers();
-    void queueSubmit();
     void queuePresent();
     void setViewport();
     void setScissor();
-    void draw();
-    void bindGraphicsPipelineToCommandBuffer();
+    void drawTriangle();
+    void updateCamera();
+    void logStats(bool drawMesh);
 
 public:
     VulkanHandler *vulkan;
 
     FrameDrawer(SDL_Window *sdlWindow, char *sdlWindowName);
     FrameDrawer(GLFWwindow *glfwWindow, char *glfwWindowName);
+    FrameDrawer(VkExtent2D headlessSize, char *name);
 
     void setClearColor(int R, int G, int B, int A);
     void setClearColor(int R, int G, int B);
     void setClearDepthStencil();
 
+    // Draws the mesh, in the binary mesh format, instead of the triangle once it is uploaded, from a camera orbiting it.
+    // More than one instance are laid out on a square grid and drawn instanced, with a level of detail each
+    void showMesh(const std::string &path, uint32_t instanceCount = 1);
+    // Adds a fountain of up to that many particles, simulated on the GPU, at the origin
+    void showParticles(uint32_t capacity);
+    // Draws the texture, KTX2 or DDS, on a square instead of the triangle once its first level is uploaded, its finer
+    // levels streaming in over the following frames. A mesh shown as well is drawn instead
+    void showTexture(const std::string &path);
+    // Scatters that many point lights of random colors around the mesh, always the same ones for a given count. Call
+    // after showMesh(), which sizes the scene
+    void showLights(uint32_t count);
+
     void nextFrame();
+    // Waits for the frames in flight and flushes the capture, if any
+    void finish();
 
     ~FrameDrawer();
 };
@@ -0,0 +1,517 @@
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+#include "GltfLoader.h"
+#include "Json.h"
+
+typedef std::array<float, 16> Matrix;
+
+const uint32_t GlbMagic = 0x46546C67; // "glTF"
+const uint32_t GlbJsonChunk = 0x4E4F534A;
+const uint32_t GlbBinaryChunk = 0x004E4942;
+
+static const Matrix Identity {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+static std::vector<uint8_t> readFile(const std::string &path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+}
+
+static std::vector<uint8_t> decodeBase64(std::string_view text)
+{
+    std::vector<uint8_t> out;
+    out.reserve(text.size() * 3 / 4);
+
+    uint32_t accumulator = 0;
+    int bits = 0;
+
+    for (char c : text)
+    {
+        int value;
+        if (c >= 'A' && c <= 'Z')
+        {
+            value = c - 'A';
+        }
+        else if (c >= 'a' && c <= 'z')
+        {
+            value = c - 'a' + 26;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            value = c - '0' + 52;
+        }
+        else if (c == '+')
+        {
+            value = 62;
+        }
+        else if (c == '/')
+        {
+            value = 63;
+        }
+        else
+        {
+            break;
+        }
+
+        accumulator = (accumulator << 6) | value;
+        bits += 6;
+
+        if (bits >= 8)
+        {
+            bits -= 8;
+            out.push_back(static_cast<uint8_t>(accumulator >> bits));
+        }
+    }
+
+    return out;
+}
+
+static Matrix multiply(const Matrix &a, const Matrix &b)
+{
+    // Column-major, as stored by glTF
+    Matrix result {};
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            for (int k = 0; k < 4; k++)
+            {
+                result[column * 4 + row] += a[k * 4 + row] * b[column * 4 + k];
+            }
+        }
+    }
+    return result;
+}
+
+static Matrix nodeMatrix(const JsonValue &node)
+{
+    Matrix matrix = Identity;
+
+    if (node.has("matrix"))
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            matrix[i] = static_cast<float>(node["matrix"][i].asNumber());
+        }
+        return matrix;
+    }
+
+    float t[3] {0, 0, 0}, r[4] {0, 0, 0, 1}, s[3] {1, 1, 1};
+    for (int i = 0; node.has("translation") && i < 3; i++)
+    {
+        t[i] = static_cast<float>(node["translation"][i].asNumber());
+    }
+    for (int i = 0; node.has("rotation") && i < 4; i++)
+    {
+        r[i] = static_cast<float>(node["rotation"][i].asNumber());
+    }
+    for (int i = 0; node.has("scale") && i < 3; i++)
+    {
+        s[i] = static_cast<float>(node["scale"][i].asNumber());
+    }
+
+    float x = r[0], y = r[1], z = r[2], w = r[3];
+
+    // T * R * S
+    matrix = {
+        (1 - 2 * (y * y + z * z)) * s[0], 2 * (x * y + z * w) * s[0], 2 * (x * z - y * w) * s[0], 0,
+        2 * (x * y - z * w) * s[1], (1 - 2 * (x * x + z * z)) * s[1], 2 * (y * z + x * w) * s[1], 0,
+        2 * (x * z + y * w) * s[2], 2 * (y * z - x * w) * s[2], (1 - 2 * (x * x + y * y)) * s[2], 0,
+        t[0], t[1], t[2], 1,
+    };
+
+    return matrix;
+}
+
+namespace
+{
+class GltfReader
+{
+private:
+    JsonValue document;
+    std::vector<std::vector<uint8_t>> buffers;
+    MeshGeometry geometry;
+
+    // Any accessor as floats, normalized integers converted as the specification says
+    std::vector<float> readAccessor(size_t index, uint32_t components)
+    {
+        const JsonValue &accessor = document["accessors"][index];
+
+        if (accessor.has("sparse") || !accessor.has("bufferView"))
+        {
+            throw std::runtime_error("glTF: sparse or buffer-less accessors are not supported");
+        }
+
+        const JsonValue &view = document["bufferViews"][static_cast<size_t>(accessor["bufferView"].asNumber())];
+        const std::vector<uint8_t> &buffer = buffers.at(static_cast<size_t>(view["buffer"].asNumber()));
+
+        uint32_t componentType = static_cast<uint32_t>(accessor["componentType"].asNumber());
+        bool normalized = accessor.has("normalized") && accessor["normalized"].boolean;
+        size_t count = static_cast<size_t>(accessor["count"].asNumber());
+
+        size_t componentSize = componentType == 5126 || componentType == 5125 ? 4 :
+                               componentType == 5122 || componentType == 5123 ? 2 : 1;
+        size_t stride = static_cast<size_t>(view.numberOr("byteStride", double(componentSize * components)));
+        size_t offset = static_cast<size_t>(view.numberOr("byteOffset", 0) + accessor.numberOr("byteOffset", 0));
+
+        if (count > 0 && offset + (count - 1) * stride + componentSize * components > buffer.size())
+        {
+            throw std::runtime_error("glTF: accessor outside of its buffer");
+        }
+
+        std::vector<float> values(count * components);
+        const uint8_t *base = buffer.data() + offset;
+
+        for (size_t element = 0; element < count; element++)
+        {
+            const uint8_t *source = base + element * stride;
+
+            for (uint32_t component = 0; component < components; component++)
+            {
+                const uint8_t *field = source + component * componentSize;
+                float value;
+
+                switch (componentType)
+                {
+                case 5120: // BYTE
+                {
+                    int8_t v;
+                    memcpy(&v, field, 1);
+                    value = normalized ? std::max(v / 127.0f, -1.0f) : v;
+                    break;
+                }
+                case 5121: // UNSIGNED_BYTE
+                    value = normalized ? *field / 255.0f : *field;
+                    break;
+                case 5122: // SHORT
+                {
+                    int16_t v;
+                    memcpy(&v, field, 2);
+                    value = normalized ? std::max(v / 32767.0f, -1.0f) : v;
+                    break;
+                }
+                case 5123: // UNSIGNED_SHORT
+                {
+                    uint16_t v;
+                    memcpy(&v, field, 2);
+                    value = normalized ? v / 65535.0f : v;
+                    break;
+                }
+                case 5126: // FLOAT
+                    memcpy(&value, field, 4);
+                    break;
+                default:
+                    throw std::runtime_error("glTF: unsupported accessor component type");
+                }
+
+                values[element * components + component] = value;
+            }
+        }
+
+        return values;
+    }
+
+    std::vector<uint32_t> readIndices(size_t index)
+    {
+        const JsonValue &accessor = document["accessors"][index];
+        const JsonValue &view = document["bufferViews"][static_cast<size_t>(accessor["bufferView"].asNumber())];
+        const std::vector<uint8_t> &buffer = buffers.at(static_cast<size_t>(view["buffer"].asNumber()));
+
+        uint32_t componentType = static_cast<uint32_t>(accessor["componentType"].asNumber());
+        size_t count = static_cast<size_t>(accessor["count"].asNumber());
+        size_t size = componentType == 5125 ? 4 : componentType == 5123 ? 2 : 1;
+        size_t offset = static_cast<size_t>(view.numberOr("byteOffset", 0) + accessor.numberOr("byteOffset", 0));
+
+        if (offset + count * size > buffer.size())
+        {
+            throw std::runtime_error("glTF: index accessor outside of its buffer");
+        }
+
+        std::vector<uint32_t> indices(count);
+        const uint8_t *base = buffer.data() + offset;
+
+        for (size_t i = 0; i < count; i++)
+        {
+            if (size == 4)
+            {
+                memcpy(&indices[i], base + i * 4, 4);
+            }
+            else if (size == 2)
+            {
+                uint16_t v;
+                memcpy(&v, base + i * 2, 2);
+                indices[i] = v;
+            }
+            else
+            {
+                indices[i] = base[i];
+            }
+        }
+
+        return indices;
+    }
+
+    void addPrimitive(const JsonValue &primitive, const Matrix &transform)
+    {
+        if (primitive.numberOr("mode", 4) != 4)
+        {
+            // Points, lines and strips are not rendered
+            return;
+        }
+
+        const JsonValue &attributes = primitive["attributes"];
+        std::vector<float> positions = readAccessor(static_cast<size_t>(attributes["POSITION"].asNumber()), 3);
+        size_t vertexCount = positions.size() / 3;
+
+        std::vector<float> normals = attributes.has("NORMAL") ?
+            readAccessor(static_cast<size_t>(attributes["NORMAL"].asNumber()), 3) : std::vector<float>();
+        std::vector<float> texcoords = attributes.has("TEXCOORD_0") ?
+            readAccessor(static_cast<size_t>(attributes["TEXCOORD_0"].asNumber()), 2) :
+            std::vector<float>(vertexCount * 2, 0.0f);
+
+        std::vector<uint32_t> indices;
+        if (primitive.has("indices"))
+        {
+            indices = readIndices(static_cast<size_t>(primitive["indices"].asNumber()));
+        }
+        else
+        {
+            indices.resize(vertexCount);
+            for (uint32_t i = 0; i < vertexCount; i++)
+            {
+                indices[i] = i;
+            }
+        }
+
+        indices.resize(indices.size() / 3 * 3);
+        for (uint32_t index : indices)
+        {
+            if (index >= vertexCount)
+            {
+                throw std::runtime_error("glTF: index out of range");
+            }
+        }
+
+        const Matrix &m = transform;
+
+        // Normals go through the cofactor matrix: the inverse transpose up to the determinant's scale
+        float cofactor[9] {
+            m[5] * m[10] - m[6] * m[9], m[6] * m[8] - m[4] * m[10], m[4] * m[9] - m[5] * m[8],
+            m[2] * m[9] - m[1] * m[10], m[0] * m[10] - m[2] * m[8], m[1] * m[8] - m[0] * m[9],
+            m[1] * m[6] - m[2] * m[5], m[2] * m[4] - m[0] * m[6], m[0] * m[5] - m[1] * m[4],
+        };
+        float determinant = m[0] * cofactor[0] + m[4] * cofactor[3] + m[8] * cofactor[6];
+        float sign = determinant < 0 ? -1.0f : 1.0f;
+
+        uint32_t firstVertex = static_cast<uint32_t>(geometry.positions.size() / 3);
+
+        for (size_t v = 0; v < vertexCount; v++)
+        {
+            const float *p = &positions[v * 3];
+            for (int row = 0; row < 3; row++)
+            {
+                geometry.positions.push_back(m[row] * p[0] + m[4 + row] * p[1] + m[8 + row] * p[2] + m[12 + row]);
+            }
+        }
+
+        if (normals.empty())
+        {
+            // Smooth normals weighted by triangle area, in world space
+            normals.assign(vertexCount * 3, 0.0f);
+            const float *world = &geometry.positions[firstVertex * 3];
+
+            for (size_t i = 0; i < indices.size(); i += 3)
+            {
+                const float *a = &world[indices[i] * 3], *b = &world[indices[i + 1] * 3], *c = &world[indices[i + 2] * 3];
+                float e1[3] {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+                float e2[3] {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+                float n[3] {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+
+                for (int corner = 0; corner < 3; corner++)
+                {
+                    for (int axis = 0; axis < 3; axis++)
+                    {
+                        normals[indices[i + corner] * 3 + axis] += n[axis] * sign;
+                    }
+                }
+            }
+
+            // Already in world space: skip the transform below
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                const float *n = &normals[v * 3];
+                float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    geometry.normals.push_back(length > 0 ? n[axis] / length : (axis == 2 ? 1.0f : 0.0f));
+                }
+            }
+        }
+        else
+        {
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                const float *n = &normals[v * 3];
+                float t[3];
+                for (int row = 0; row < 3; row++)
+                {
+                    t[row] = (cofactor[row] * n[0] + cofactor[3 + row] * n[1] + cofactor[6 + row] * n[2]) * sign;
+                }
+
+                float length = std::sqrt(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+                for (int axis = 0; axis < 3; axis++)
+                {
+                    geometry.normals.push_back(length > 0 ? t[axis] / length : (axis == 2 ? 1.0f : 0.0f));
+                }
+            }
+        }
+
+        geometry.texcoords.insert(geometry.texcoords.end(), texcoords.begin(), texcoords.end());
+
+        // A mirroring transform flips the winding
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            geometry.indices.push_back(firstVertex + indices[i]);
+            geometry.indices.push_back(firstVertex + indices[determinant < 0 ? i + 2 : i + 1]);
+            geometry.indices.push_back(firstVertex + indices[determinant < 0 ? i + 1 : i + 2]);
+        }
+    }
+
+    void addNode(size_t index, const Matrix &parent, int depth)
+    {
+        if (depth > 64)
+        {
+            throw std::runtime_error("glTF: node hierarchy too deep or cyclic");
+        }
+
+        const JsonValue &node = document["nodes"][index];
+        Matrix transform = multiply(parent, nodeMatrix(node));
+
+        if (node.has("mesh"))
+        {
+            const JsonValue &mesh = document["meshes"][static_cast<size_t>(node["mesh"].asNumber())];
+            for (const auto &primitive : mesh["primitives"].array)
+            {
+                addPrimitive(primitive, transform);
+            }
+        }
+
+        if (node.has("children"))
+        {
+            for (const auto &child : node["children"].array)
+            {
+                addNode(static_cast<size_t>(child.asNumber()), transform, depth + 1);
+            }
+        }
+    }
+
+public:
+    MeshGeometry read(const std::string &path)
+    {
+        std::vector<uint8_t> file = readFile(path);
+        std::string directory = path.substr(0, path.find_last_of('/') + 1);
+        std::vector<uint8_t> binaryChunk;
+
+        uint32_t magic = 0;
+        if (file.size() >= 4)
+        {
+            memcpy(&magic, file.data(), 4);
+        }
+
+        if (magic == GlbMagic)
+        {
+            // 12-byte header, then chunks of {length, type, data} padded to 4 bytes
+            size_t offset = 12;
+            while (offset + 8 <= file.size())
+            {
+                uint32_t length, type;
+                memcpy(&length, &file[offset], 4);
+                memcpy(&type, &file[offset + 4], 4);
+
+                if (offset + 8 + length > file.size())
+                {
+                    throw std::runtime_error("glTF: truncated GLB chunk");
+                }
+
+                const uint8_t *data = &file[offset + 8];
+                if (type == GlbJsonChunk)
+                {
+                    document = parseJson(std::string_view(reinterpret_cast<const char *>(data), length));
+                }
+                else if (type == GlbBinaryChunk && binaryChunk.empty())
+                {
+                    binaryChunk.assign(data, data + length);
+                }
+
+                offset += 8 + (length + 3) / 4 * 4;
+            }
+        }
+        else
+        {
+            document = parseJson(std::string_view(reinterpret_cast<const char *>(file.data()), file.size()));
+        }
+
+        if (document.has("buffers"))
+        {
+            for (const auto &buffer : document["buffers"].array)
+            {
+                if (!buffer.has("uri"))
+                {
+                    buffers.push_back(std::move(binaryChunk));
+                    continue;
+                }
+
+                const std::string &uri = buffer["uri"].asString();
+                size_t comma = uri.find(',');
+
+                if (uri.rfind("data:", 0) == 0 && comma != std::string::npos)
+                {
+                    buffers.push_back(decodeBase64(std::string_view(uri).substr(comma + 1)));
+                }
+                else
+                {
+                    buffers.push_back(readFile(directory + uri));
+                }
+            }
+        }
+
+        if (document.has("scenes"))
+        {
+            const JsonValue &scene = document["scenes"][static_cast<size_t>(document.numberOr("scene", 0))];
+            for (const auto &node : scene["nodes"].array)
+            {
+                addNode(static_cast<size_t>(node.asNumber()), Identity, 0);
+            }
+        }
+        else if (document.has("meshes"))
+        {
+            for (const auto &mesh : document["meshes"].array)
+            {
+                for (const auto &primitive : mesh["primitives"].array)
+                {
+                    addPrimitive(primitive, Identity);
+                }
+            }
+        }
+
+        return std::move(geometry);
+    }
+};
+} // namespace
+
+MeshGeometry loadGltf(const std::string &path)
+{
+    GltfReader reader;
+    return reader.read(path);
+}
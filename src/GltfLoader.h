@@ -0,0 +1,21 @@
+#ifndef GLTF_LOADER_H_
+#define GLTF_LOADER_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Every triangle primitive of the default scene, flattened into one indexed mesh with node transforms applied
+struct MeshGeometry
+{
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<uint32_t> indices;
+};
+
+// .gltf (external or base64 embedded buffers) or .glb. Missing normals are computed from the triangles, missing
+// texture coordinates are zero. Sparse accessors are not supported. Throws on malformed files
+MeshGeometry loadGltf(const std::string &path);
+
+#endif
@@ -0,0 +1,212 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "GpuProfiler.h"
+#include "Trace.h"
+
+GpuProfiler::GpuProfiler(
+    VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxZones)
+{
+    this->device = device;
+    this->maxZones = maxZones;
+    frameIndex = 0;
+    enabled = Trace::active;
+    recording = false;
+    lastTotal = 0.0;
+    calibrated = false;
+    gpuToCpuOffset = 0;
+    traceTrack = Trace::active ? Trace::createTrack("Graphics queue") : 0;
+    queryPool = VK_NULL_HANDLE;
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    timestampPeriod = properties.limits.timestampPeriod;
+
+    uint32_t queueFamilyCount;
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(physicalDevice, &queueFamilyCount, queueFamilies.data());
+
+    uint32_t validBits = queueFamilies[queueFamilyIndex].timestampValidBits;
+    timestampMask = validBits >= 64 ? ~0ull : (1ull << validBits) - 1;
+    supported = validBits > 0;
+
+    frames.resize(framesInFlight, {{}, {}, false});
+
+    if (!supported)
+    {
+        return;
+    }
+
+    VkQueryPoolCreateInfo createInfo {
+        .sType      = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO,
+        .queryType  = VK_QUERY_TYPE_TIMESTAMP,
+        .queryCount = framesInFlight * maxZones * 2,
+    };
+
+    if (vkCreateQueryPool(device, &createInfo, nullptr, &queryPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create timestamp query pool!");
+    }
+}
+
+GpuProfiler::~GpuProfiler()
+{
+    if (queryPool != VK_NULL_HANDLE)
+    {
+        vkDestroyQueryPool(device, queryPool, nullptr);
+    }
+}
+
+void GpuProfiler::setEnabled(bool enabled)
+{
+    this->enabled = enabled;
+}
+
+bool GpuProfiler::isEnabled() const
+{
+    return enabled && supported;
+}
+
+bool GpuProfiler::beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    this->frameIndex = frameIndex;
+    FrameQueries &frame = frames[frameIndex];
+
+    bool collected = frame.pending && collect(frameIndex);
+
+    frame.zones.clear();
+    frame.submitTimes.clear();
+    recording = isEnabled();
+
+    if (recording)
+    {
+        vkCmdResetQueryPool(commandBuffer, queryPool, frameIndex * maxZones * 2, maxZones * 2);
+    }
+
+    return collected;
+}
+
+uint32_t GpuProfiler::beginZone(VkCommandBuffer commandBuffer, const char *name)
+{
+    FrameQueries &frame = frames[frameIndex];
+
+    if (!recording || frame.zones.size() >= maxZones)
+    {
+        return UINT32_MAX;
+    }
+
+    uint32_t query = (frameIndex * maxZones + static_cast<uint32_t>(frame.zones.size())) * 2;
+    frame.zones.push_back({name, query, static_cast<uint32_t>(frame.submitTimes.size())});
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, queryPool, query);
+
+    return static_cast<uint32_t>(frame.zones.size()) - 1;
+}
+
+void GpuProfiler::endZone(VkCommandBuffer commandBuffer, uint32_t zone)
+{
+    if (zone == UINT32_MAX)
+    {
+        return;
+    }
+
+    vkCmdWriteTimestamp(commandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, queryPool, frames[frameIndex].zones[zone].query + 1);
+}
+
+void GpuProfiler::submit()
+{
+    if (recording)
+    {
+        frames[frameIndex].submitTimes.push_back(Trace::now());
+    }
+}
+
+void GpuProfiler::endFrame()
+{
+    FrameQueries &frame = frames[frameIndex];
+
+    submit();
+    frame.pending = recording && !frame.zones.empty();
+    recording = false;
+}
+
+bool GpuProfiler::collect(uint32_t frameIndex)
+{
+    FrameQueries &frame = frames[frameIndex];
+    frame.pending = false;
+
+    uint32_t queryCount = static_cast<uint32_t>(frame.zones.size()) * 2;
+    timestamps.resize(queryCount);
+
+    // The fence of this frame slot has been waited on already: results are available without blocking
+    if (vkGetQueryPoolResults(
+            device, queryPool, frameIndex * maxZones * 2, queryCount, queryCount * sizeof(uint64_t),
+            timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS)
+    {
+        return false;
+    }
+
+    lastResults.clear();
+    lastTotal = 0.0;
+
+    for (uint32_t i = 0; i < frame.zones.size(); i++)
+    {
+        // Masked as a difference too, for the counter may wrap around within a zone
+        uint64_t ticks = (timestamps[i * 2 + 1] - timestamps[i * 2]) & timestampMask;
+
+        lastResults.push_back({frame.zones[i].name, ticks * timestampPeriod / 1e6});
+        lastTotal += lastResults.back().milliseconds;
+    }
+
+    if (!Trace::active)
+    {
+        return true;
+    }
+
+    // GPU and CPU clocks are unrelated: GPU work never starts before its submission, so the tightest offset
+    // satisfying that for every zone seen so far, against the submission it went in, places the GPU zones on the CPU
+    // timeline
+    for (uint32_t i = 0; i < frame.zones.size(); i++)
+    {
+        int64_t gpuTime = static_cast<int64_t>((timestamps[i * 2] & timestampMask) * timestampPeriod);
+        int64_t offset = static_cast<int64_t>(frame.submitTimes[frame.zones[i].submission]) - gpuTime;
+
+        gpuToCpuOffset = calibrated ? std::max(gpuToCpuOffset, offset) : offset;
+        calibrated = true;
+    }
+
+    for (uint32_t i = 0; i < frame.zones.size(); i++)
+    {
+        int64_t begin = static_cast<int64_t>((timestamps[i * 2] & timestampMask) * timestampPeriod) + gpuToCpuOffset;
+        int64_t end = begin + static_cast<int64_t>(lastResults[i].milliseconds * 1e6);
+
+        Trace::recordOnTrack(traceTrack, frame.zones[i].name, begin, end);
+    }
+
+    return true;
+}
+
+const std::vector<GpuZoneTiming> &GpuProfiler::results() const
+{
+    return lastResults;
+}
+
+double GpuProfiler::milliseconds(const char *name) const
+{
+    for (const auto &result : lastResults)
+    {
+        if (strcmp(result.name, name) == 0)
+        {
+            return result.milliseconds;
+        }
+    }
+
+    return -1.0;
+}
+
+double GpuProfiler::totalMilliseconds() const
+{
+    return lastTotal;
+}
@@ -0,0 +1,82 @@
+#ifndef GPU_PROFILER_H_
+#define GPU_PROFILER_H_
+
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct GpuZoneTiming
+{
+    const char *name;
+    double milliseconds;
+};
+
+// Timestamp queries around GPU work, read back without waiting once the frame slot's fence has been signaled
+class GpuProfiler
+{
+private:
+    struct Zone
+    {
+        const char *name;
+        uint32_t query;
+        // Index of the submission it went in, into the frame's submit times
+        uint32_t submission;
+    };
+
+    struct FrameQueries
+    {
+        std::vector<Zone> zones;
+        // CPU time right before each submission of the frame's command buffers
+        std::vector<uint64_t> submitTimes;
+        bool pending;
+    };
+
+    VkDevice device;
+    VkQueryPool queryPool;
+    double timestampPeriod;
+    uint64_t timestampMask;
+    uint32_t maxZones;
+    uint32_t frameIndex;
+    bool supported;
+    bool enabled;
+    bool recording;
+
+    std::vector<FrameQueries> frames;
+    std::vector<GpuZoneTiming> lastResults;
+    double lastTotal;
+    // Kept across frames so that collecting results does not allocate
+    std::vector<uint64_t> timestamps;
+
+    uint32_t traceTrack;
+    int64_t gpuToCpuOffset;
+    bool calibrated;
+
+    bool collect(uint32_t frame);
+
+public:
+    GpuProfiler(VkDevice device, VkPhysicalDevice physicalDevice, uint32_t queueFamilyIndex, uint32_t framesInFlight, uint32_t maxZones);
+
+    void setEnabled(bool enabled);
+    bool isEnabled() const;
+
+    // Must be recorded outside a render pass, after the fence of the frame slot has been waited on. True when the
+    // results of the slot's previous frame were read, replacing the ones of the most recently completed frame
+    bool beginFrame(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+    uint32_t beginZone(VkCommandBuffer commandBuffer, const char *name);
+    void endZone(VkCommandBuffer commandBuffer, uint32_t zone);
+    // Right before submitting the zones recorded since the previous submission, which are then placed on the trace
+    // after this point
+    void submit();
+    // Right before the last submission of the frame, instead of submit()
+    void endFrame();
+
+    // Timings of the most recently completed frame; negative if the zone was not found
+    const std::vector<GpuZoneTiming> &results() const;
+    double milliseconds(const char *name) const;
+    // Of every zone, which do not overlap: the GPU time of the frame's profiled work
+    double totalMilliseconds() const;
+
+    ~GpuProfiler();
+};
+
+#endif
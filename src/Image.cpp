@@ -0,0 +1,127 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "Image.h"
+
+bool loadPpm(const std::string &path, Image &image)
+{
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    uint32_t maxValue;
+    bool valid = fscanf(file, "P6 %u %u %u", &image.width, &image.height, &maxValue) == 3 && maxValue == 255 &&
+                 fgetc(file) != EOF;
+
+    if (valid)
+    {
+        image.rgb.resize(static_cast<size_t>(image.width) * image.height * 3);
+        valid = fread(image.rgb.data(), 1, image.rgb.size(), file) == image.rgb.size();
+    }
+
+    fclose(file);
+    return valid;
+}
+
+void savePpm(const std::string &path, const Image &image)
+{
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Failed to write image " + path);
+    }
+
+    fmt::print(file, "P6\n{} {}\n255\n", image.width, image.height);
+    fwrite(image.rgb.data(), 1, image.rgb.size(), file);
+    fclose(file);
+}
+
+struct Lab
+{
+    float l, a, b;
+};
+
+static float srgbToLinear(uint8_t value)
+{
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static float labCurve(float t)
+{
+    return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f;
+}
+
+static std::vector<Lab> toLab(const Image &image)
+{
+    std::vector<Lab> lab(static_cast<size_t>(image.width) * image.height);
+
+    for (size_t i = 0; i < lab.size(); i++)
+    {
+        float r = srgbToLinear(image.rgb[i * 3 + 0]);
+        float g = srgbToLinear(image.rgb[i * 3 + 1]);
+        float b = srgbToLinear(image.rgb[i * 3 + 2]);
+
+        // Linear sRGB to XYZ, normalized by the D65 white point
+        float x = labCurve((0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f);
+        float y = labCurve(0.2126f * r + 0.7152f * g + 0.0722f * b);
+        float z = labCurve((0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f);
+
+        lab[i] = {116.0f * y - 16.0f, 500.0f * (x - y), 200.0f * (y - z)};
+    }
+
+    return lab;
+}
+
+ImageDifference compareImages(const Image &reference, const Image &image, double pixelTolerance)
+{
+    if (reference.width != image.width || reference.height != image.height)
+    {
+        return {INFINITY, INFINITY, static_cast<uint64_t>(image.width) * image.height, 1.0};
+    }
+
+    std::vector<Lab> expected = toLab(reference);
+    std::vector<Lab> actual = toLab(image);
+
+    ImageDifference difference {0.0, 0.0, 0, 0.0};
+    int width = static_cast<int>(image.width), height = static_cast<int>(image.height);
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            const Lab &pixel = actual[y * width + x];
+            double closest = INFINITY;
+
+            for (int sy = std::max(y - 1, 0); sy <= std::min(y + 1, height - 1); sy++)
+            {
+                for (int sx = std::max(x - 1, 0); sx <= std::min(x + 1, width - 1); sx++)
+                {
+                    const Lab &candidate = expected[sy * width + sx];
+                    double dl = pixel.l - candidate.l, da = pixel.a - candidate.a, db = pixel.b - candidate.b;
+                    closest = std::min(closest, std::sqrt(dl * dl + da * da + db * db));
+                }
+            }
+
+            difference.maxDeltaE = std::max(difference.maxDeltaE, closest);
+            difference.meanDeltaE += closest;
+
+            if (closest > pixelTolerance)
+            {
+                difference.differingPixels++;
+            }
+        }
+    }
+
+    double pixelCount = static_cast<double>(width) * height;
+    difference.meanDeltaE /= pixelCount;
+    difference.differingRatio = difference.differingPixels / pixelCount;
+
+    return difference;
+}
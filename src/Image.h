@@ -0,0 +1,32 @@
+#ifndef IMAGE_H_
+#define IMAGE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Tightly packed 8 bit RGB, as produced by FrameCapture
+struct Image
+{
+    uint32_t width;
+    uint32_t height;
+    std::vector<uint8_t> rgb;
+};
+
+struct ImageDifference
+{
+    double maxDeltaE;
+    double meanDeltaE;
+    uint64_t differingPixels;
+    double differingRatio;
+};
+
+bool loadPpm(const std::string &path, Image &image);
+void savePpm(const std::string &path, const Image &image);
+
+// Perceptual difference in CIELAB (delta E 1976, where ~2.3 is a just noticeable difference). Each pixel is
+// matched against the closest one in its 3x3 neighborhood of the reference, so rasterization differences of
+// one pixel along edges between drivers are not reported
+ImageDifference compareImages(const Image &reference, const Image &image, double pixelTolerance);
+
+#endif
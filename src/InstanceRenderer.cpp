@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include "InstanceRenderer.h"
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Instances culled, given a level of detail and copied to the instance buffer by one job
+const uint32_t InstancesPerJob = 4096;
+
+InstanceRenderer::InstanceRenderer(
+    VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, MeshManager &meshes,
+    ClusteredLighting &lighting, uint32_t framesInFlight)
+    : memory(memory), pipelines(pipelines), meshes(meshes), lighting(lighting)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+
+    drawPipeline = nullptr;
+    mesh = 0;
+    capacity = 0;
+    stats = {};
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(InstanceConstants),
+    };
+
+    VkDescriptorSetLayoutCreateInfo emptyLayoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 0,
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &emptyLayoutInfo, nullptr, &emptySetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create instance descriptor set layout!");
+    }
+
+    VkDescriptorSetLayout setLayouts[2] = {emptySetLayout, lighting.getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 2,
+        .pSetLayouts            = setLayouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create instance pipeline layout!");
+    }
+}
+
+InstanceRenderer::~InstanceRenderer()
+{
+    destroyInstanceBuffers();
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, emptySetLayout, nullptr);
+}
+
+MeshInstance *InstanceRenderer::createInstanceBuffer(
+    VkDeviceSize size, VkBuffer &buffer, VkDeviceMemory &bufferMemory, VkDeviceSize &memorySize, uint32_t &memoryType)
+{
+    VkBufferCreateInfo bufferInfo {
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size        = size,
+        .usage       = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create instance buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    // Mapped and written every frame: host coherent whatever the fallback
+    VkMemoryPropertyFlags hostCoherent = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+    bufferMemory = memory.allocate(memRequirements, hostCoherent, &memoryType, hostCoherent);
+    memorySize = memRequirements.size;
+
+    vkBindBufferMemory(device, buffer, bufferMemory, 0);
+
+    void *mapped;
+    if (vkMapMemory(device, bufferMemory, 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to map instance buffer memory!");
+    }
+
+    return static_cast<MeshInstance *>(mapped);
+}
+
+void InstanceRenderer::destroyInstanceBuffers()
+{
+    for (uint32_t i = 0; i < instanceBuffers.size(); i++)
+    {
+        vkDestroyBuffer(device, instanceBuffers[i], nullptr);
+        memory.free(instanceMemory[i], instanceMemorySize, instanceMemoryTypes[i]);
+        vkDestroyBuffer(device, shadowInstanceBuffers[i], nullptr);
+        memory.free(shadowInstanceMemory[i], shadowInstanceMemorySize, shadowInstanceMemoryTypes[i]);
+    }
+
+    instanceBuffers.clear();
+    instanceMemory.clear();
+    instanceMemoryTypes.clear();
+    mappedInstances.clear();
+    shadowInstanceBuffers.clear();
+    shadowInstanceMemory.clear();
+    shadowInstanceMemoryTypes.clear();
+    mappedShadowInstances.clear();
+    capacity = 0;
+}
+
+void InstanceRenderer::requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+{
+    PipelineKey key {
+        .vertexShader     = "instanced.vert",
+        .fragmentShader   = "clustered.frag",
+        .specialization   = ClusteredLighting::getSpecialization(),
+        .vertexBindings   = {
+            {0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX},
+            {1, sizeof(MeshInstance), VK_VERTEX_INPUT_RATE_INSTANCE},
+        },
+        .vertexAttributes = {
+            {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(MeshVertex, position)},
+            {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(MeshVertex, normal)},
+            {2, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0},
+        },
+        .frontFace        = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .colorFormat      = colorFormat,
+        .depthFormat      = depthFormat,
+        .samples          = samples,
+        .layout           = pipelineLayout,
+    };
+
+    drawPipeline = pipelines.request(key);
+}
+
+void InstanceRenderer::setInstances(MeshHandle mesh, const std::vector<MeshInstance> &instances)
+{
+    TRACE_ZONE("InstanceRenderer::setInstances");
+
+    this->mesh = mesh;
+    sourceInstances = instances;
+    lods.resize(instances.size());
+    shadowLods.resize(instances.size());
+
+    this->instances = {};
+    for (const MeshInstance &instance : instances)
+    {
+        this->instances.x.push_back(instance.position[0]);
+        this->instances.y.push_back(instance.position[1]);
+        this->instances.z.push_back(instance.position[2]);
+        this->instances.scale.push_back(instance.scale);
+    }
+
+    if (instances.size() <= capacity)
+    {
+        return;
+    }
+
+    // The buffers of the frames in flight may still be read
+    vkDeviceWaitIdle(device);
+    destroyInstanceBuffers();
+
+    capacity = static_cast<uint32_t>(instances.size());
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        VkBuffer buffer;
+        VkDeviceMemory bufferMemory;
+        uint32_t memoryType;
+
+        MeshInstance *mapped = createInstanceBuffer(
+            capacity * sizeof(MeshInstance), buffer, bufferMemory, instanceMemorySize, memoryType);
+        instanceBuffers.push_back(buffer);
+        instanceMemory.push_back(bufferMemory);
+        instanceMemoryTypes.push_back(memoryType);
+        mappedInstances.push_back(mapped);
+
+        mapped = createInstanceBuffer(
+            VkDeviceSize(capacity) * ShadowMaps::CascadeCount * sizeof(MeshInstance), buffer, bufferMemory,
+            shadowInstanceMemorySize, memoryType);
+        shadowInstanceBuffers.push_back(buffer);
+        shadowInstanceMemory.push_back(bufferMemory);
+        shadowInstanceMemoryTypes.push_back(memoryType);
+        mappedShadowInstances.push_back(mapped);
+    }
+}
+
+bool InstanceRenderer::prepare(uint32_t frameIndex, const Camera &camera, VkExtent2D extent)
+{
+    if (sourceInstances.empty() || pipelines.get(drawPipeline) == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    const GpuMesh &gpuMesh = meshes.getMesh(mesh);
+
+    if (!gpuMesh.ready)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("InstanceRenderer::prepare");
+
+    float aspect = (float)extent.width / (float)extent.height;
+    LodView view = makeLodView(camera, aspect, (float)extent.height);
+
+    // Counting sort by level, over chunks of instances spread across the job system: selection sizes each chunk's
+    // share of every batch, then each chunk writes its instances at its own offsets within the batches
+    const MeshFileHeader &header = gpuMesh.header;
+    uint32_t instanceCount = static_cast<uint32_t>(lods.size());
+    uint32_t chunkCount = (instanceCount + InstancesPerJob - 1) / InstancesPerJob;
+    chunkOffsets.assign(size_t(chunkCount) * MeshMaxLods, 0);
+
+    JobSystem &jobs = JobSystem::instance();
+
+    jobs.parallelFor(0, chunkCount, 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t chunk = first; chunk < last; chunk++)
+        {
+            uint32_t begin = chunk * InstancesPerJob;
+            uint32_t end = std::min(begin + InstancesPerJob, instanceCount);
+            uint32_t *counts = &chunkOffsets[size_t(chunk) * MeshMaxLods];
+
+            selectLods(header, instances, view, begin, end, lods.data());
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                if (lods[i] != LodCulled)
+                {
+                    counts[lods[i]]++;
+                }
+            }
+        }
+    });
+
+    stats = {};
+    uint32_t offset = 0;
+
+    for (uint32_t level = 0; level < MeshMaxLods; level++)
+    {
+        batches[level].firstInstance = offset;
+
+        for (uint32_t chunk = 0; chunk < chunkCount; chunk++)
+        {
+            uint32_t &slot = chunkOffsets[size_t(chunk) * MeshMaxLods + level];
+            uint32_t count = slot;
+            slot = offset;
+            offset += count;
+        }
+
+        batches[level].instanceCount = offset - batches[level].firstInstance;
+
+        stats.instances[level] = batches[level].instanceCount;
+        stats.triangles += uint64_t(batches[level].instanceCount) * (header.lods[level].indexCount / 3);
+    }
+
+    stats.culled = instanceCount - offset;
+
+    MeshInstance *mapped = mappedInstances[frameIndex];
+
+    jobs.parallelFor(0, chunkCount, 1, [&](uint32_t first, uint32_t last) {
+        for (uint32_t chunk = first; chunk < last; chunk++)
+        {
+            uint32_t begin = chunk * InstancesPerJob;
+            uint32_t end = std::min(begin + InstancesPerJob, instanceCount);
+            uint32_t *next = &chunkOffsets[size_t(chunk) * MeshMaxLods];
+
+            for (uint32_t i = begin; i < end; i++)
+            {
+                if (lods[i] != LodCulled)
+                {
+                    mapped[next[lods[i]]++] = sourceInstances[i];
+                }
+            }
+        }
+    });
+
+    constants = {
+        .viewProjection = camera.viewProjection(aspect),
+    };
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        constants.boundsMin[axis] = gpuMesh.header.boundsMin[axis];
+        constants.boundsExtent[axis] = gpuMesh.header.boundsMax[axis] - gpuMesh.header.boundsMin[axis];
+    }
+
+    return true;
+}
+
+void InstanceRenderer::draw(DrawList &drawList, uint32_t frameIndex)
+{
+    TRACE_ZONE("InstanceRenderer::draw");
+
+    const GpuMesh &gpuMesh = meshes.getMesh(mesh);
+
+    // Levels share the vertices: only the index range, the instances and the level pushed change between batches
+    DrawCommand command {
+        .type              = DrawType::DrawIndexed,
+        .pipeline          = pipelines.get(drawPipeline),
+        .layout            = pipelineLayout,
+        .lightingSet       = lighting.getDescriptorSet(frameIndex),
+        .vertexBufferCount = 2,
+        .vertexBuffers     = {gpuMesh.buffer, instanceBuffers[frameIndex]},
+        .vertexOffsets     = {gpuMesh.header.sections[MeshVertices].offset, 0},
+        .indexBuffer       = gpuMesh.buffer,
+        .indexOffset       = gpuMesh.header.sections[MeshIndices].offset,
+        .indexType         = gpuMesh.header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+    };
+
+    for (uint32_t level = 0; level < gpuMesh.header.lodCount; level++)
+    {
+        if (batches[level].instanceCount == 0)
+        {
+            continue;
+        }
+
+        constants.lod = level;
+        command.setPushConstants(VK_SHADER_STAGE_VERTEX_BIT, constants);
+
+        const MeshLod &lod = gpuMesh.header.lods[level];
+        command.count = lod.indexCount;
+        command.first = lod.firstIndex;
+        command.instanceCount = batches[level].instanceCount;
+        command.firstInstance = batches[level].firstInstance;
+
+        // Levels grow coarser with distance, so the level itself orders the batches front to back
+        drawList.add(DrawPassMain, level, command);
+    }
+}
+
+bool InstanceRenderer::drawShadows(DrawList &drawList, ShadowMaps &shadows, uint32_t frameIndex)
+{
+    VkPipeline pipeline = shadows.getInstancedPipeline();
+
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("InstanceRenderer::drawShadows");
+
+    const GpuMesh &gpuMesh = meshes.getMesh(mesh);
+    const MeshFileHeader &header = gpuMesh.header;
+
+    // Bounding sphere of the mesh, as level selection takes it
+    float meshCenter[3];
+    float meshRadius = 0.0f;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        meshCenter[axis] = (header.boundsMin[axis] + header.boundsMax[axis]) / 2;
+        meshRadius += (header.boundsMax[axis] - meshCenter[axis]) * (header.boundsMax[axis] - meshCenter[axis]);
+    }
+
+    meshRadius = std::sqrt(meshRadius);
+
+    ShadowConstants shadowConstants {};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        shadowConstants.boundsMin[axis] = header.boundsMin[axis];
+        shadowConstants.boundsExtent[axis] = header.boundsMax[axis] - header.boundsMin[axis];
+    }
+
+    DrawCommand command {
+        .type              = DrawType::DrawIndexed,
+        .pipeline          = pipeline,
+        .layout            = shadows.getPipelineLayout(),
+        .vertexBufferCount = 2,
+        .vertexBuffers     = {gpuMesh.buffer, shadowInstanceBuffers[frameIndex]},
+        .vertexOffsets     = {header.sections[MeshVertices].offset, 0},
+        .indexBuffer       = gpuMesh.buffer,
+        .indexOffset       = header.sections[MeshIndices].offset,
+        .indexType         = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+    };
+
+    uint32_t instanceCount = static_cast<uint32_t>(shadowLods.size());
+    MeshInstance *mapped = mappedShadowInstances[frameIndex];
+    JobSystem &jobs = JobSystem::instance();
+
+    for (uint32_t cascade = 0; cascade < ShadowMaps::CascadeCount; cascade++)
+    {
+        if (!shadows.needsRender(cascade))
+        {
+            continue;
+        }
+
+        const Mat4 &viewProjection = shadows.getViewProjection(cascade);
+        float texelSize = shadows.getTexelSize(cascade);
+
+        // An orthographic projection scales every direction alike across the map, and depth on its own
+        const float *m = viewProjection.m;
+        float clipPerUnit = std::sqrt(m[0] * m[0] + m[4] * m[4] + m[8] * m[8]);
+        float depthPerUnit = std::sqrt(m[2] * m[2] + m[6] * m[6] + m[10] * m[10]);
+
+        // No frustum to speak of, nor a camera to be near: spheres against the box, and the coarsest level whose
+        // error stays within a texel of the map
+        jobs.parallelFor(0, instanceCount, InstancesPerJob, [&](uint32_t first, uint32_t last) {
+            for (uint32_t i = first; i < last; i++)
+            {
+                float scale = instances.scale[i];
+                float center[3] = {
+                    instances.x[i] + scale * meshCenter[0],
+                    instances.y[i] + scale * meshCenter[1],
+                    instances.z[i] + scale * meshCenter[2],
+                };
+
+                float clip[3];
+                for (int row = 0; row < 3; row++)
+                {
+                    clip[row] = m[12 + row] + m[row] * center[0] + m[4 + row] * center[1] + m[8 + row] * center[2];
+                }
+
+                float radius = scale * meshRadius;
+                float margin = 1.0f + radius * clipPerUnit;
+                float depthMargin = radius * depthPerUnit;
+
+                if (std::abs(clip[0]) > margin || std::abs(clip[1]) > margin || clip[2] < -depthMargin ||
+                    clip[2] > 1.0f + depthMargin)
+                {
+                    shadowLods[i] = LodCulled;
+                    continue;
+                }
+
+                uint8_t level = 0;
+                while (level + 1u < header.lodCount && header.lods[level + 1].error * scale <= texelSize)
+                {
+                    level++;
+                }
+
+                shadowLods[i] = level;
+            }
+        });
+
+        // Sorted by level into the cascade's share of the buffer
+        uint32_t counts[MeshMaxLods] = {};
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            if (shadowLods[i] != LodCulled)
+            {
+                counts[shadowLods[i]]++;
+            }
+        }
+
+        uint32_t next[MeshMaxLods];
+        uint32_t offset = cascade * capacity;
+
+        for (uint32_t level = 0; level < MeshMaxLods; level++)
+        {
+            next[level] = offset;
+            offset += counts[level];
+        }
+
+        for (uint32_t i = 0; i < instanceCount; i++)
+        {
+            if (shadowLods[i] != LodCulled)
+            {
+                mapped[next[shadowLods[i]]++] = sourceInstances[i];
+            }
+        }
+
+        shadowConstants.viewProjection = viewProjection;
+        command.setPushConstants(VK_SHADER_STAGE_VERTEX_BIT, shadowConstants);
+
+        for (uint32_t level = 0; level < header.lodCount; level++)
+        {
+            if (counts[level] == 0)
+            {
+                continue;
+            }
+
+            const MeshLod &lod = header.lods[level];
+            command.count = lod.indexCount;
+            command.first = lod.firstIndex;
+            command.instanceCount = counts[level];
+            command.firstInstance = next[level] - counts[level];
+
+            drawList.add(static_cast<DrawPass>(DrawPassShadow0 + cascade), level, command);
+        }
+    }
+
+    return true;
+}
+
+const InstanceStats &InstanceRenderer::getStats() const
+{
+    return stats;
+}
@@ -0,0 +1,125 @@
+#ifndef INSTANCE_RENDERER_H_
+#define INSTANCE_RENDERER_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Camera.h"
+#include "ClusteredLighting.h"
+#include "DrawList.h"
+#include "Lod.h"
+#include "MemoryBudget.h"
+#include "MeshManager.h"
+#include "PipelineManager.h"
+#include "ShadowMaps.h"
+
+// A copy of the mesh, uniformly scaled (scale > 0) then moved: 16 bytes, read as a per-instance vertex attribute
+struct MeshInstance
+{
+    float position[3];
+    float scale;
+};
+
+// Push constants of instanced.vert, laid out as its block: 92 bytes
+struct InstanceConstants
+{
+    Mat4 viewProjection;
+    float boundsMin[3];
+    uint32_t lod;
+    float boundsExtent[3];
+};
+
+// What was drawn in the last prepared frame
+struct InstanceStats
+{
+    uint32_t instances[MeshMaxLods];
+    uint32_t culled;
+    uint64_t triangles;
+};
+
+// Draws many instances of one mesh with the vertex pipeline. Every frame the instances are culled against the view
+// frustum and given a level of detail on the CPU, across the job system, then sorted by level into this frame's
+// instance buffer, so that each level is drawn by one instanced draw over its range of the index section
+class InstanceRenderer
+{
+private:
+    struct Batch
+    {
+        uint32_t firstInstance;
+        uint32_t instanceCount;
+    };
+
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    MeshManager &meshes;
+    ClusteredLighting &lighting;
+    uint32_t framesInFlight;
+
+    // Set 0 is left empty, set 1 holds the lights
+    VkDescriptorSetLayout emptySetLayout;
+    VkPipelineLayout pipelineLayout;
+    PipelineHandle drawPipeline;
+
+    MeshHandle mesh;
+    LodInstances instances;
+    std::vector<MeshInstance> sourceInstances;
+    std::vector<uint8_t> lods;
+    // Per chunk of instances and level: instances first counted, then where the chunk's next one goes
+    std::vector<uint32_t> chunkOffsets;
+
+    // Per frame in flight, host visible and persistently mapped
+    uint32_t capacity;
+    std::vector<VkBuffer> instanceBuffers;
+    std::vector<VkDeviceMemory> instanceMemory;
+    std::vector<uint32_t> instanceMemoryTypes;
+    std::vector<MeshInstance *> mappedInstances;
+    // As many again per shadow cascade
+    std::vector<VkBuffer> shadowInstanceBuffers;
+    std::vector<VkDeviceMemory> shadowInstanceMemory;
+    std::vector<uint32_t> shadowInstanceMemoryTypes;
+    std::vector<MeshInstance *> mappedShadowInstances;
+    // Of every frame's buffer, as allocated
+    VkDeviceSize instanceMemorySize;
+    VkDeviceSize shadowInstanceMemorySize;
+    std::vector<uint8_t> shadowLods;
+
+    // Recorded by prepare() for draw()
+    InstanceConstants constants;
+    Batch batches[MeshMaxLods];
+    InstanceStats stats;
+
+    MeshInstance *createInstanceBuffer(
+        VkDeviceSize size, VkBuffer &buffer, VkDeviceMemory &bufferMemory, VkDeviceSize &memorySize,
+        uint32_t &memoryType);
+    void destroyInstanceBuffers();
+
+public:
+    InstanceRenderer(VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, MeshManager &meshes,
+        ClusteredLighting &lighting, uint32_t framesInFlight);
+
+    // For the formats of the main pass; requested again whenever they change
+    void requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+
+    // Replaces what is drawn; waits for the device when the instance buffers have to grow
+    void setInstances(MeshHandle mesh, const std::vector<MeshInstance> &instances);
+
+    // Culls, selects levels of detail and fills this frame's instance buffer, after its fence has been waited on.
+    // False while there is nothing to draw, the mesh uploads or the pipeline compiles, in which case draw() must not
+    // be called
+    bool prepare(uint32_t frameIndex, const Camera &camera, VkExtent2D extent);
+    // Adds one draw per level of detail to the main pass, lit by the lights binned for this frame
+    void draw(DrawList &drawList, uint32_t frameIndex);
+    // After prepare(), for each cascade to render: culls the instances against it and adds one draw per level of
+    // detail, the coarsest whose error stays within a texel, to its shadow pass. False while the shadow pipeline
+    // compiles, in which case nothing was added
+    bool drawShadows(DrawList &drawList, ShadowMaps &shadows, uint32_t frameIndex);
+
+    const InstanceStats &getStats() const;
+
+    ~InstanceRenderer();
+};
+
+#endif
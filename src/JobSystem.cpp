@@ -0,0 +1,317 @@
+#include <cstdlib>
+#include <stdexcept>
+#include <string>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "JobSystem.h"
+#include "Logger.h"
+#include "Trace.h"
+
+// Attempts at finding a job before an idle worker goes to sleep
+const uint32_t IdleSpins = 64;
+// Slots of the job ring tried by a spawn before running the job on the spot
+const uint32_t AllocationAttempts = 8;
+
+thread_local JobSystem::Worker *JobSystem::current = nullptr;
+
+bool JobSystem::WorkQueue::push(Job *job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+
+    if (b - t >= static_cast<int64_t>(MaxJobsInFlight))
+    {
+        return false;
+    }
+
+    // Released with the job, for thieves acquiring bottom
+    slots[b & (MaxJobsInFlight - 1)].store(job, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+
+    return true;
+}
+
+JobSystem::Job *JobSystem::WorkQueue::pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job *job = slots[b & (MaxJobsInFlight - 1)].load(std::memory_order_relaxed);
+
+    // The last job: thieves may be after it too
+    if (t == b)
+    {
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            job = nullptr;
+        }
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return job;
+}
+
+JobSystem::Job *JobSystem::WorkQueue::steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+    {
+        return nullptr;
+    }
+
+    Job *job = slots[t & (MaxJobsInFlight - 1)].load(std::memory_order_relaxed);
+
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return nullptr;
+    }
+
+    return job;
+}
+
+JobSystem::JobSystem(uint32_t workerCount)
+{
+    workerCount = std::max(workerCount, 1u);
+
+    for (uint32_t i = 0; i < workerCount + MaxExternalThreads; i++)
+    {
+        workers.push_back(std::make_unique<Worker>());
+        workers.back()->random = 2654435761u * (i + 1);
+    }
+
+    uint32_t cores = std::max(std::thread::hardware_concurrency(), 1u);
+
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+
+#ifdef __linux__
+        // Core 0 is left to the threads owning windows and recording frames
+        cpu_set_t cpus;
+        CPU_ZERO(&cpus);
+        CPU_SET((i + 1) % cores, &cpus);
+
+        if (pthread_setaffinity_np(threads.back().native_handle(), sizeof(cpus), &cpus) != 0)
+        {
+            LOG_WARNING("Failed to pin job worker {} to core {}", i, (i + 1) % cores);
+        }
+#endif
+    }
+
+    LOG_INFO("Job system: {} workers", workerCount);
+}
+
+JobSystem::~JobSystem()
+{
+    stopping = true;
+    generation++;
+    generation.notify_all();
+
+    for (auto &thread : threads)
+    {
+        thread.join();
+    }
+}
+
+JobSystem &JobSystem::instance()
+{
+    static JobSystem jobSystem([] {
+        const char *workers = std::getenv("BASICVULKAN_JOB_WORKERS");
+        if (workers != nullptr)
+        {
+            return static_cast<uint32_t>(std::max(std::atoi(workers), 1));
+        }
+
+        return std::max(std::thread::hardware_concurrency(), 2u) - 1;
+    }());
+
+    return jobSystem;
+}
+
+uint32_t JobSystem::workerCount() const
+{
+    return static_cast<uint32_t>(threads.size());
+}
+
+JobSystem::Worker &JobSystem::currentWorker()
+{
+    if (current == nullptr)
+    {
+        uint32_t index = externalThreads++;
+
+        if (index >= MaxExternalThreads)
+        {
+            throw std::runtime_error("Too many threads using the job system!");
+        }
+
+        current = workers[threads.size() + index].get();
+    }
+
+    return *current;
+}
+
+JobSystem::Job *JobSystem::allocate(Worker &self)
+{
+    // Slots are reused in order, skipping jobs still running rather than waiting for them: those may be the caller's
+    // own, further up the stack
+    for (uint32_t attempt = 0; attempt < AllocationAttempts; attempt++)
+    {
+        Job *job = &self.jobs[self.nextJob++ & (MaxJobsInFlight - 1)];
+
+        if (!job->inFlight.load(std::memory_order_acquire))
+        {
+            job->inFlight.store(true, std::memory_order_relaxed);
+            return job;
+        }
+    }
+
+    return nullptr;
+}
+
+void JobSystem::spawn(
+    JobFunction function, const void *data, uint32_t begin, uint32_t end, JobCounter &counter, uint32_t grainSize)
+{
+    Worker &self = currentWorker();
+    Job *job = allocate(self);
+
+    // This thread has about MaxJobsInFlight jobs not finished yet: the new one runs right away instead
+    if (job == nullptr)
+    {
+        function(data, begin, end);
+        return;
+    }
+
+    counter.pending.fetch_add(1, std::memory_order_relaxed);
+
+    job->function = function;
+    job->data = data;
+    job->begin = begin;
+    job->end = end;
+    job->grainSize = grainSize;
+    job->counter = &counter;
+
+    if (!self.queue.push(job))
+    {
+        execute(job);
+        return;
+    }
+
+    // Sequentially consistent with the sleeping count, so that a worker going to sleep either sees the new
+    // generation or is seen sleeping and woken up
+    generation.fetch_add(1);
+    if (sleepingWorkers.load() > 0)
+    {
+        generation.notify_one();
+    }
+}
+
+void JobSystem::execute(Job *job)
+{
+    uint32_t begin = job->begin;
+    uint32_t end = job->end;
+
+    // Upper halves go to this thread's deque, where idle workers steal the oldest, hence largest, first
+    while (job->grainSize > 0 && end - begin > job->grainSize)
+    {
+        uint32_t middle = begin + (end - begin) / 2;
+        spawn(job->function, job->data, middle, end, *job->counter, job->grainSize);
+        end = middle;
+    }
+
+    job->function(job->data, begin, end);
+
+    // The counter may be gone as soon as it reaches 0, and the slot reused once released
+    JobCounter *counter = job->counter;
+    job->inFlight.store(false, std::memory_order_release);
+    counter->pending.fetch_sub(1, std::memory_order_release);
+}
+
+bool JobSystem::runOne(Worker &self)
+{
+    Job *job = self.queue.pop();
+
+    if (job == nullptr)
+    {
+        self.random ^= self.random << 13;
+        self.random ^= self.random >> 17;
+        self.random ^= self.random << 5;
+
+        size_t count = workers.size();
+        size_t first = self.random % count;
+
+        for (size_t i = 0; i < count && job == nullptr; i++)
+        {
+            Worker *victim = workers[(first + i) % count].get();
+            if (victim != &self)
+            {
+                job = victim->queue.steal();
+            }
+        }
+    }
+
+    if (job == nullptr)
+    {
+        return false;
+    }
+
+    execute(job);
+    return true;
+}
+
+void JobSystem::wait(JobCounter &counter)
+{
+    Worker &self = currentWorker();
+
+    while (counter.pending.load(std::memory_order_acquire) > 0)
+    {
+        if (!runOne(self))
+        {
+            std::this_thread::yield();
+        }
+    }
+}
+
+void JobSystem::workerLoop(uint32_t index)
+{
+    std::string name = "Job worker " + std::to_string(index);
+    Trace::setThreadName(name.c_str());
+
+    current = workers[index].get();
+
+    while (!stopping.load(std::memory_order_relaxed))
+    {
+        uint32_t seen = generation.load();
+        bool found = false;
+
+        for (uint32_t spin = 0; spin < IdleSpins && !found; spin++)
+        {
+            found = runOne(*current);
+            if (!found)
+            {
+                std::this_thread::yield();
+            }
+        }
+
+        if (!found)
+        {
+            sleepingWorkers++;
+            generation.wait(seen);
+            sleepingWorkers--;
+        }
+    }
+}
@@ -0,0 +1,124 @@
+#ifndef JOB_SYSTEM_H_
+#define JOB_SYSTEM_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+// Runs the part [begin, end) of a job's range; must not throw
+typedef void (*JobFunction)(const void *data, uint32_t begin, uint32_t end);
+
+// Jobs spawned against the counter and not finished yet: what wait() waits for
+struct JobCounter
+{
+    std::atomic<uint32_t> pending {0};
+};
+
+// Work-stealing job system for per-frame CPU work, one per process. A worker thread per core but one, each pinned to
+// its core (on Linux), owns a deque of jobs: it pushes and pops at the bottom while idle workers steal from the top,
+// where the largest halves of split ranges are. Threads waiting on a counter run jobs in the meantime instead of
+// blocking, so jobs can spawn and wait for jobs of their own. Besides the workers, up to MaxExternalThreads other
+// threads (e.g. render threads) may spawn and wait, each getting a deque of its own on first use
+class JobSystem
+{
+private:
+    static const uint32_t MaxJobsInFlight = 4096;
+    static const uint32_t MaxExternalThreads = 8;
+
+    struct Job
+    {
+        JobFunction function;
+        const void *data;
+        uint32_t begin;
+        uint32_t end;
+        // Ranges larger than this are halved before running, the upper half going back to the deque; 0 never splits
+        uint32_t grainSize;
+        JobCounter *counter;
+        // Until it has run: its slot in the spawning thread's ring can then be reused
+        std::atomic<bool> inFlight {false};
+    };
+
+    // Chase-Lev deque of fixed capacity, with the memory orders of Lê et al., "Correct and Efficient Work-Stealing
+    // for Weak Memory Models" (PPoPP 2013), but for a release store of bottom in push() in place of a release fence
+    class WorkQueue
+    {
+    private:
+        alignas(64) std::atomic<int64_t> top {0};
+        alignas(64) std::atomic<int64_t> bottom {0};
+        std::atomic<Job *> slots[MaxJobsInFlight];
+
+    public:
+        // Owner only; false when full
+        bool push(Job *job);
+        // Owner only, newest first
+        Job *pop();
+        // Any thread, oldest first; null when empty or when another thread won the race
+        Job *steal();
+    };
+
+    struct alignas(64) Worker
+    {
+        WorkQueue queue;
+        // Ring of the jobs spawned by this thread
+        Job jobs[MaxJobsInFlight];
+        uint32_t nextJob = 0;
+        // Xorshift state picking the first victim to steal from
+        uint32_t random;
+    };
+
+    static thread_local Worker *current;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<uint32_t> externalThreads {0};
+    // Bumped by every spawn: idle workers sleep until it changes
+    std::atomic<uint32_t> generation {0};
+    std::atomic<uint32_t> sleepingWorkers {0};
+    std::atomic<bool> stopping {false};
+
+    JobSystem(uint32_t workerCount);
+
+    Worker &currentWorker();
+    Job *allocate(Worker &self);
+    bool runOne(Worker &self);
+    void execute(Job *job);
+    void workerLoop(uint32_t index);
+
+public:
+    // Started on first use, with BASICVULKAN_JOB_WORKERS workers if set, one per core but one otherwise
+    static JobSystem &instance();
+
+    uint32_t workerCount() const;
+
+    // Runs function over [begin, end) as one job, split in halves down to grainSize when not 0
+    void spawn(
+        JobFunction function, const void *data, uint32_t begin, uint32_t end, JobCounter &counter,
+        uint32_t grainSize = 0);
+
+    // Runs jobs, stolen ones included, until every job spawned against the counter has finished
+    void wait(JobCounter &counter);
+
+    // body(first, last) over subranges of [begin, end) of at most grainSize elements, on every core; returns once
+    // all have run
+    template <typename Body>
+    void parallelFor(uint32_t begin, uint32_t end, uint32_t grainSize, const Body &body)
+    {
+        if (begin >= end)
+        {
+            return;
+        }
+
+        JobCounter counter;
+        spawn(
+            [](const void *data, uint32_t first, uint32_t last) { (*static_cast<const Body *>(data))(first, last); },
+            &body, begin, end, counter, std::max(grainSize, 1u));
+        wait(counter);
+    }
+
+    ~JobSystem();
+};
+
+#endif
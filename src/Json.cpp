@@ -0,0 +1,342 @@
+#include <cstdlib>
+#include <stdexcept>
+
+#include "Json.h"
+
+namespace
+{
+class JsonParser
+{
+private:
+    std::string_view text;
+    size_t position = 0;
+
+    [[noreturn]] void fail(const char *what)
+    {
+        throw std::runtime_error("JSON: " + std::string(what) + " at offset " + std::to_string(position));
+    }
+
+    void skipWhitespace()
+    {
+        while (position < text.size() &&
+               (text[position] == ' ' || text[position] == '\t' || text[position] == '\n' || text[position] == '\r'))
+        {
+            position++;
+        }
+    }
+
+    bool consume(std::string_view token)
+    {
+        if (text.substr(position, token.size()) == token)
+        {
+            position += token.size();
+            return true;
+        }
+        return false;
+    }
+
+    static void appendUtf8(std::string &out, uint32_t codePoint)
+    {
+        if (codePoint < 0x80)
+        {
+            out += static_cast<char>(codePoint);
+        }
+        else if (codePoint < 0x800)
+        {
+            out += static_cast<char>(0xC0 | (codePoint >> 6));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else if (codePoint < 0x10000)
+        {
+            out += static_cast<char>(0xE0 | (codePoint >> 12));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+        else
+        {
+            out += static_cast<char>(0xF0 | (codePoint >> 18));
+            out += static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F));
+            out += static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F));
+            out += static_cast<char>(0x80 | (codePoint & 0x3F));
+        }
+    }
+
+    uint32_t parseHex4()
+    {
+        if (position + 4 > text.size())
+        {
+            fail("truncated escape");
+        }
+
+        uint32_t value = 0;
+        for (int i = 0; i < 4; i++)
+        {
+            char c = text[position++];
+            value <<= 4;
+            if (c >= '0' && c <= '9')
+            {
+                value |= c - '0';
+            }
+            else if (c >= 'a' && c <= 'f')
+            {
+                value |= c - 'a' + 10;
+            }
+            else if (c >= 'A' && c <= 'F')
+            {
+                value |= c - 'A' + 10;
+            }
+            else
+            {
+                fail("invalid escape");
+            }
+        }
+        return value;
+    }
+
+    std::string parseString()
+    {
+        // Opening quote already checked by the caller
+        position++;
+        std::string out;
+
+        while (true)
+        {
+            if (position >= text.size())
+            {
+                fail("unterminated string");
+            }
+
+            char c = text[position++];
+            if (c == '"')
+            {
+                return out;
+            }
+
+            if (c != '\\')
+            {
+                out += c;
+                continue;
+            }
+
+            if (position >= text.size())
+            {
+                fail("unterminated string");
+            }
+
+            switch (text[position++])
+            {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u':
+            {
+                uint32_t codePoint = parseHex4();
+                if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u"))
+                {
+                    codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (parseHex4() - 0xDC00);
+                }
+                appendUtf8(out, codePoint);
+                break;
+            }
+            default:
+                fail("invalid escape");
+            }
+        }
+    }
+
+    double parseNumber()
+    {
+        // strtod needs a terminated string: numbers are short, copy the candidate characters
+        size_t end = position;
+        while (end < text.size() && std::string_view("+-0123456789.eE").find(text[end]) != std::string_view::npos)
+        {
+            end++;
+        }
+
+        std::string token(text.substr(position, end - position));
+        char *parsedEnd;
+        double value = std::strtod(token.c_str(), &parsedEnd);
+
+        if (token.empty() || parsedEnd != token.c_str() + token.size())
+        {
+            fail("invalid number");
+        }
+
+        position = end;
+        return value;
+    }
+
+public:
+    JsonParser(std::string_view text) : text(text) {}
+
+    JsonValue parseValue(int depth = 0)
+    {
+        if (depth > 256)
+        {
+            fail("nesting too deep");
+        }
+
+        skipWhitespace();
+        if (position >= text.size())
+        {
+            fail("unexpected end");
+        }
+
+        JsonValue value;
+        char c = text[position];
+
+        if (c == '{')
+        {
+            value.type = JsonValue::Type::Object;
+            position++;
+            skipWhitespace();
+
+            if (consume("}"))
+            {
+                return value;
+            }
+
+            do
+            {
+                skipWhitespace();
+                if (position >= text.size() || text[position] != '"')
+                {
+                    fail("expected key");
+                }
+
+                std::string key = parseString();
+                skipWhitespace();
+                if (!consume(":"))
+                {
+                    fail("expected ':'");
+                }
+
+                value.object[std::move(key)] = parseValue(depth + 1);
+                skipWhitespace();
+            } while (consume(","));
+
+            if (!consume("}"))
+            {
+                fail("expected '}'");
+            }
+        }
+        else if (c == '[')
+        {
+            value.type = JsonValue::Type::Array;
+            position++;
+            skipWhitespace();
+
+            if (consume("]"))
+            {
+                return value;
+            }
+
+            do
+            {
+                value.array.push_back(parseValue(depth + 1));
+                skipWhitespace();
+            } while (consume(","));
+
+            if (!consume("]"))
+            {
+                fail("expected ']'");
+            }
+        }
+        else if (c == '"')
+        {
+            value.type = JsonValue::Type::String;
+            value.string = parseString();
+        }
+        else if (consume("true"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+        }
+        else if (consume("false"))
+        {
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+        }
+        else if (consume("null"))
+        {
+            value.type = JsonValue::Type::Null;
+        }
+        else
+        {
+            value.type = JsonValue::Type::Number;
+            value.number = parseNumber();
+        }
+
+        return value;
+    }
+
+    void expectEnd()
+    {
+        skipWhitespace();
+        if (position != text.size())
+        {
+            fail("trailing characters");
+        }
+    }
+};
+} // namespace
+
+bool JsonValue::has(std::string_view key) const
+{
+    return type == Type::Object && object.find(key) != object.end();
+}
+
+const JsonValue &JsonValue::operator[](std::string_view key) const
+{
+    auto found = object.find(key);
+    if (type != Type::Object || found == object.end())
+    {
+        throw std::runtime_error("JSON: missing key " + std::string(key));
+    }
+    return found->second;
+}
+
+const JsonValue &JsonValue::operator[](size_t index) const
+{
+    if (type != Type::Array || index >= array.size())
+    {
+        throw std::runtime_error("JSON: index " + std::to_string(index) + " out of range");
+    }
+    return array[index];
+}
+
+double JsonValue::asNumber() const
+{
+    if (type != Type::Number)
+    {
+        throw std::runtime_error("JSON: number expected");
+    }
+    return number;
+}
+
+const std::string &JsonValue::asString() const
+{
+    if (type != Type::String)
+    {
+        throw std::runtime_error("JSON: string expected");
+    }
+    return string;
+}
+
+double JsonValue::numberOr(std::string_view key, double fallback) const
+{
+    return has(key) ? (*this)[key].asNumber() : fallback;
+}
+
+JsonValue parseJson(std::string_view text)
+{
+    JsonParser parser(text);
+    JsonValue value = parser.parseValue();
+    parser.expectEnd();
+    return value;
+}
@@ -0,0 +1,36 @@
+#ifndef JSON_H_
+#define JSON_H_
+
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Minimal JSON document, enough for glTF: numbers are doubles, objects keep their keys sorted
+class JsonValue
+{
+public:
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<JsonValue> array;
+    std::map<std::string, JsonValue, std::less<>> object;
+
+    bool has(std::string_view key) const;
+    // Throw when the key is missing or of another type
+    const JsonValue &operator[](std::string_view key) const;
+    const JsonValue &operator[](size_t index) const;
+    double asNumber() const;
+    const std::string &asString() const;
+
+    // Default when the key is missing
+    double numberOr(std::string_view key, double fallback) const;
+};
+
+// Throws std::runtime_error with the offset of the first syntax error
+JsonValue parseJson(std::string_view text);
+
+#endif
@@ -0,0 +1,79 @@
+#include "FrameDrawer.h"
+#include "LightBenchmark.h"
+#include "Logger.h"
+#include "Trace.h"
+
+static const VkExtent2D BenchmarkSize {1280, 720};
+
+// Frames for the mesh to upload and every frame in flight to see the new lights, then frames measured
+static const uint32_t WarmupFrames = 16;
+static const uint32_t MeasuredFrames = 120;
+
+struct LightTimings
+{
+    double cullMilliseconds;
+    double shadeMilliseconds;
+    double cpuMilliseconds;
+};
+
+void runLightBenchmark(const std::string &meshPath, std::vector<uint32_t> counts)
+{
+    if (counts.empty())
+    {
+        counts = {0, 16, 64, 256, 1024, 4096};
+    }
+
+    std::string name = "Light benchmark";
+    FrameDrawer drawer(BenchmarkSize, name.data());
+    VulkanHandler *vulkan = drawer.vulkan;
+
+    vulkan->gpuProfiler->setEnabled(true);
+    drawer.showMesh(meshPath);
+
+    for (uint32_t count : counts)
+    {
+        drawer.showLights(count);
+        vulkan->pipelines->waitIdle();
+
+        for (uint32_t frame = 0; frame < WarmupFrames; frame++)
+        {
+            drawer.nextFrame();
+        }
+
+        LightTimings timings {0.0, 0.0, 0.0};
+        uint32_t gpuSamples = 0;
+
+        for (uint32_t frame = 0; frame < MeasuredFrames; frame++)
+        {
+            uint64_t start = Trace::now();
+            drawer.nextFrame();
+            timings.cpuMilliseconds += (Trace::now() - start) / 1e6;
+
+            // Results lag by the frames in flight, which is irrelevant for a mean
+            double cullMilliseconds = vulkan->gpuProfiler->milliseconds("Light culling");
+            double shadeMilliseconds = vulkan->gpuProfiler->milliseconds("Main render pass");
+            if (cullMilliseconds >= 0.0 && shadeMilliseconds >= 0.0)
+            {
+                timings.cullMilliseconds += cullMilliseconds;
+                timings.shadeMilliseconds += shadeMilliseconds;
+                gpuSamples++;
+            }
+        }
+
+        drawer.finish();
+
+        timings.cpuMilliseconds /= MeasuredFrames;
+        if (gpuSamples > 0)
+        {
+            timings.cullMilliseconds /= gpuSamples;
+            timings.shadeMilliseconds /= gpuSamples;
+        }
+
+        LOG_INFO(
+            "{:>5} lights: culling {:.3f} ms, main pass {:.3f} ms, cpu {:.3f} ms per frame",
+            vulkan->lighting->getLightCount(), timings.cullMilliseconds, timings.shadeMilliseconds,
+            timings.cpuMilliseconds);
+    }
+
+    Logger::instance().flush();
+}
@@ -0,0 +1,13 @@
+#ifndef LIGHT_BENCHMARK_H_
+#define LIGHT_BENCHMARK_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Renders the mesh headless under each light count and logs the GPU time of light culling, the GPU time of the
+// render pass shading with the binned lights and the CPU time of a frame. Without counts, a default sweep from no
+// light up to a few thousand
+void runLightBenchmark(const std::string &meshPath, std::vector<uint32_t> counts);
+
+#endif
@@ -0,0 +1,130 @@
+#include <algorithm>
+#include <cmath>
+
+#include "Lod.h"
+
+LodView makeLodView(const Camera &camera, float aspect, float viewportHeight, float pixelThreshold)
+{
+    LodView view {};
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        view.cameraPosition[axis] = camera.position[axis];
+    }
+
+    // Same planes as the meshlet shaders: from the rows of the view-projection matrix, near being the third row
+    Mat4 viewProjection = camera.viewProjection(aspect);
+    float rows[4][4];
+    for (int row = 0; row < 4; row++)
+    {
+        for (int column = 0; column < 4; column++)
+        {
+            rows[row][column] = viewProjection.m[column * 4 + row];
+        }
+    }
+
+    for (int column = 0; column < 4; column++)
+    {
+        view.frustumPlanes[0][column] = rows[3][column] + rows[0][column];
+        view.frustumPlanes[1][column] = rows[3][column] - rows[0][column];
+        view.frustumPlanes[2][column] = rows[3][column] + rows[1][column];
+        view.frustumPlanes[3][column] = rows[3][column] - rows[1][column];
+        view.frustumPlanes[4][column] = rows[2][column];
+        view.frustumPlanes[5][column] = rows[3][column] - rows[2][column];
+    }
+
+    for (auto &plane : view.frustumPlanes)
+    {
+        float length = std::sqrt(plane[0] * plane[0] + plane[1] * plane[1] + plane[2] * plane[2]);
+        for (float &component : plane)
+        {
+            component /= length;
+        }
+    }
+
+    view.pixelsPerUnit = viewportHeight / (2.0f * std::tan(camera.fovY / 2.0f));
+    view.pixelThreshold = pixelThreshold;
+
+    return view;
+}
+
+void selectLods(
+    const MeshFileHeader &header, const LodInstances &instances, const LodView &view, size_t begin, size_t end,
+    uint8_t *lods)
+{
+    float center[3];
+    float radius = 0.0f;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        center[axis] = (header.boundsMin[axis] + header.boundsMax[axis]) / 2;
+        radius += (header.boundsMax[axis] - center[axis]) * (header.boundsMax[axis] - center[axis]);
+    }
+    radius = std::sqrt(radius);
+
+    // Errors in mesh space divided by the threshold: an instance can use a level when it is no larger than the
+    // distance over its scale and pixelsPerUnit. Levels are sorted by error, so counting them gives the coarsest one
+    float errors[MeshMaxLods];
+    uint32_t lodCount = std::min(header.lodCount, MeshMaxLods);
+
+    for (uint32_t level = 0; level < lodCount; level++)
+    {
+        errors[level] = header.lods[level].error * view.pixelsPerUnit / view.pixelThreshold;
+    }
+
+    const float *x = instances.x.data();
+    const float *y = instances.y.data();
+    const float *z = instances.z.data();
+    const float *scale = instances.scale.data();
+
+    // In blocks, level by level, so that every inner loop has a fixed trip count and no branch
+    const size_t BlockSize = 64;
+
+    for (size_t first = begin; first < end; first += BlockSize)
+    {
+        size_t blockCount = std::min(BlockSize, end - first);
+        float distanceSquared[BlockSize];
+        float scaledRadius[BlockSize];
+        uint8_t visible[BlockSize];
+        uint8_t level[BlockSize];
+
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            size_t instance = first + i;
+            float cx = x[instance] + scale[instance] * center[0];
+            float cy = y[instance] + scale[instance] * center[1];
+            float cz = z[instance] + scale[instance] * center[2];
+            float r = scale[instance] * radius;
+
+            int inside = 1;
+            for (const auto &plane : view.frustumPlanes)
+            {
+                inside &= plane[0] * cx + plane[1] * cy + plane[2] * cz + plane[3] >= -r;
+            }
+
+            float dx = cx - view.cameraPosition[0];
+            float dy = cy - view.cameraPosition[1];
+            float dz = cz - view.cameraPosition[2];
+
+            distanceSquared[i] = dx * dx + dy * dy + dz * dz;
+            scaledRadius[i] = r;
+            visible[i] = static_cast<uint8_t>(inside);
+            level[i] = 0;
+        }
+
+        // error * scale <= distance - radius, squared to do without the square root
+        for (uint32_t l = 1; l < lodCount; l++)
+        {
+            for (size_t i = 0; i < blockCount; i++)
+            {
+                float reach = errors[l] * scale[first + i] + scaledRadius[i];
+                level[i] += reach * reach <= distanceSquared[i];
+            }
+        }
+
+        for (size_t i = 0; i < blockCount; i++)
+        {
+            lods[first + i] = visible[i] ? level[i] : LodCulled;
+        }
+    }
+}
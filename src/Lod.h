@@ -0,0 +1,44 @@
+#ifndef LOD_H_
+#define LOD_H_
+
+#include <cstdint>
+#include <vector>
+
+#include "Camera.h"
+#include "MeshFile.h"
+
+// Largest error, in pixels, allowed on screen by the selected level of detail
+const float LodPixelThreshold = 1.0f;
+// Selected for instances outside the view frustum
+const uint8_t LodCulled = 0xFF;
+
+// Instances of a mesh, uniformly scaled then moved, as parallel arrays: selection streams through them with no
+// branch in the loop body, which the compiler turns into SIMD code
+struct LodInstances
+{
+    std::vector<float> x;
+    std::vector<float> y;
+    std::vector<float> z;
+    std::vector<float> scale;
+};
+
+struct LodView
+{
+    float cameraPosition[3];
+    // Normalized, pointing inwards
+    float frustumPlanes[6][4];
+    // Pixels covered by one unit seen at a distance of one unit
+    float pixelsPerUnit;
+    float pixelThreshold;
+};
+
+LodView makeLodView(const Camera &camera, float aspect, float viewportHeight, float pixelThreshold = LodPixelThreshold);
+
+// Per instance in [begin, end), the coarsest level whose error projects to at most the threshold from the point of the
+// mesh's bounding sphere nearest to the camera, or LodCulled when the sphere is outside the frustum. Ranges not
+// overlapping can be selected from different threads
+void selectLods(
+    const MeshFileHeader &header, const LodInstances &instances, const LodView &view, size_t begin, size_t end,
+    uint8_t *lods);
+
+#endif
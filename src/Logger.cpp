@@ -0,0 +1,242 @@
+#include <algorithm>
+#include <cstdio>
+
+#include "Logger.h"
+
+LogRing::LogRing()
+{
+    slots = std::make_unique<Slot[]>(SlotCount);
+    records = std::make_unique<LogRecord *[]>(SlotCount);
+    head = 0;
+    tail = 0;
+    orphaned = false;
+}
+
+LogRing::~LogRing()
+{
+    while (front() != nullptr)
+    {
+        pop();
+    }
+}
+
+void *LogRing::reserve()
+{
+    size_t index = head.load(std::memory_order_relaxed);
+
+    if (index - tail.load(std::memory_order_acquire) >= SlotCount)
+    {
+        return nullptr;
+    }
+
+    return slots[index % SlotCount].storage;
+}
+
+void LogRing::publish(LogRecord *record)
+{
+    size_t index = head.load(std::memory_order_relaxed);
+
+    records[index % SlotCount] = record;
+    head.store(index + 1, std::memory_order_release);
+}
+
+LogRecord *LogRing::front()
+{
+    size_t index = tail.load(std::memory_order_relaxed);
+
+    if (index == head.load(std::memory_order_acquire))
+    {
+        return nullptr;
+    }
+
+    return records[index % SlotCount];
+}
+
+void LogRing::pop()
+{
+    size_t index = tail.load(std::memory_order_relaxed);
+
+    records[index % SlotCount]->~LogRecord();
+    tail.store(index + 1, std::memory_order_release);
+}
+
+LogRateLimiter::LogRateLimiter(uint32_t maxPerWindow, std::chrono::steady_clock::duration window)
+{
+    this->maxPerWindow = std::min<uint32_t>(maxPerWindow, 0xffff);
+    this->window = window;
+
+    for (auto &bucket : buckets)
+    {
+        bucket = 0;
+    }
+}
+
+bool LogRateLimiter::allow(uint64_t key, uint32_t *suppressed)
+{
+    // Each bucket packs the current window index (32 bits), the messages allowed in it and the ones dropped (16 bits each)
+    uint64_t currentWindow = static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch() / window);
+    std::atomic<uint64_t> &bucket = buckets[(key * 0x9e3779b97f4a7c15ull) >> 56];
+
+    uint64_t old = bucket.load(std::memory_order_relaxed);
+    uint64_t updated;
+    bool allowed;
+
+    do
+    {
+        uint64_t bucketWindow = old >> 32;
+        uint64_t count = (old >> 16) & 0xffff;
+        uint64_t dropped = old & 0xffff;
+
+        if (bucketWindow != currentWindow)
+        {
+            count = 0;
+        }
+
+        allowed = count < maxPerWindow;
+        *suppressed = allowed ? static_cast<uint32_t>(dropped) : 0;
+
+        if (allowed)
+        {
+            updated = (currentWindow << 32) | ((count + 1) << 16);
+        }
+        else
+        {
+            updated = (currentWindow << 32) | (count << 16) | std::min<uint64_t>(dropped + 1, 0xffff);
+        }
+    } while (!bucket.compare_exchange_weak(old, updated, std::memory_order_relaxed));
+
+    return allowed;
+}
+
+struct ThreadRingHolder
+{
+    std::shared_ptr<LogRing> ring;
+
+    ~ThreadRingHolder()
+    {
+        if (ring)
+        {
+            ring->orphaned = true;
+        }
+    }
+};
+
+Logger::Logger()
+{
+    running = true;
+    dropped = 0;
+    start = std::chrono::steady_clock::now();
+    flusher = std::thread(&Logger::flushLoop, this);
+}
+
+Logger::~Logger()
+{
+    running = false;
+    wake.notify_one();
+    flusher.join();
+
+    drain();
+}
+
+Logger &Logger::instance()
+{
+    static Logger logger;
+    return logger;
+}
+
+LogRing &Logger::threadRing()
+{
+    thread_local ThreadRingHolder holder;
+
+    if (!holder.ring)
+    {
+        holder.ring = std::make_shared<LogRing>();
+
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        rings.push_back(holder.ring);
+    }
+
+    return *holder.ring;
+}
+
+void Logger::flushLoop()
+{
+    while (running)
+    {
+        {
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wake.wait_for(lock, std::chrono::milliseconds(5));
+        }
+
+        drain();
+    }
+}
+
+void Logger::flush()
+{
+    drain();
+}
+
+void Logger::drain()
+{
+    static const char *levelNames[] {"trace", "debug", "info", "warning", "error"};
+
+    struct Line
+    {
+        std::chrono::steady_clock::time_point timestamp;
+        bool error;
+        std::string text;
+    };
+
+    std::lock_guard<std::mutex> drainLock(drainMutex);
+    std::vector<Line> lines;
+    fmt::memory_buffer buffer;
+
+    std::vector<std::shared_ptr<LogRing>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(ringsMutex);
+        snapshot = rings;
+    }
+
+    for (auto &ring : snapshot)
+    {
+        for (LogRecord *record = ring->front(); record != nullptr; record = ring->front())
+        {
+            double seconds = std::chrono::duration<double>(record->timestamp - start).count();
+
+            buffer.clear();
+            fmt::format_to(fmt::appender(buffer), "[{:10.4f}] [{}] ", seconds, levelNames[static_cast<int>(record->level)]);
+            record->format(buffer);
+            buffer.push_back('\n');
+
+            lines.push_back({record->timestamp, record->level >= LogLevel::Warning, fmt::to_string(buffer)});
+            ring->pop();
+        }
+    }
+
+    // Rings are drained one at a time: restore the global order before writing
+    std::stable_sort(lines.begin(), lines.end(), [](const Line &a, const Line &b) { return a.timestamp < b.timestamp; });
+
+    for (const auto &line : lines)
+    {
+        fwrite(line.text.data(), 1, line.text.size(), line.error ? stderr : stdout);
+    }
+
+    uint64_t droppedCount = dropped.exchange(0, std::memory_order_relaxed);
+    if (droppedCount > 0)
+    {
+        fmt::print(stderr, "[logger] {} messages dropped, ring buffer full\n", droppedCount);
+    }
+
+    if (!lines.empty() || droppedCount > 0)
+    {
+        fflush(stdout);
+        fflush(stderr);
+    }
+
+    // Rings of threads that exited are released once empty
+    std::lock_guard<std::mutex> lock(ringsMutex);
+    rings.erase(std::remove_if(rings.begin(), rings.end(), [](const std::shared_ptr<LogRing> &ring) {
+        return ring->orphaned && ring->front() == nullptr;
+    }), rings.end());
+}
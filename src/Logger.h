@@ -0,0 +1,188 @@
+#ifndef LOGGER_H_
+#define LOGGER_H_
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+#include <fmt/format.h> // To be replaced with <format> as soon a larger compiler support is available
+
+// Lowest level compiled in: 0 = trace, 1 = debug, 2 = info, 3 = warning, 4 = error.
+// Calls below it are removed together with the evaluation of their arguments
+#ifndef LOG_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_MIN_LEVEL 2
+#else
+#define LOG_MIN_LEVEL 1
+#endif
+#endif
+
+enum class LogLevel { Trace = 0, Debug = 1, Info = 2, Warning = 3, Error = 4 };
+
+#define LOG_AT(level, ...) \
+    do { if constexpr (static_cast<int>(level) >= LOG_MIN_LEVEL) Logger::log(level, __VA_ARGS__); } while (0)
+
+#define LOG_TRACE(...)   LOG_AT(LogLevel::Trace, __VA_ARGS__)
+#define LOG_DEBUG(...)   LOG_AT(LogLevel::Debug, __VA_ARGS__)
+#define LOG_INFO(...)    LOG_AT(LogLevel::Info, __VA_ARGS__)
+#define LOG_WARNING(...) LOG_AT(LogLevel::Warning, __VA_ARGS__)
+#define LOG_ERROR(...)   LOG_AT(LogLevel::Error, __VA_ARGS__)
+
+// A message waiting in a ring buffer: arguments are captured by value and only formatted by the flush thread
+class LogRecord
+{
+public:
+    LogLevel level;
+    std::chrono::steady_clock::time_point timestamp;
+
+    virtual void format(fmt::memory_buffer &out) const = 0;
+    virtual ~LogRecord() = default;
+};
+
+template <typename T>
+using LogStored = std::conditional_t<
+    std::is_convertible_v<const std::decay_t<T> &, std::string_view>, std::string, std::decay_t<T>>;
+
+template <typename... Args>
+class FormattedLogRecord : public LogRecord
+{
+private:
+    fmt::string_view formatString;
+    std::tuple<Args...> args;
+
+public:
+    template <typename... Forwarded>
+    FormattedLogRecord(fmt::string_view formatString, Forwarded &&...forwarded)
+        : formatString(formatString), args(std::forward<Forwarded>(forwarded)...) {}
+
+    void format(fmt::memory_buffer &out) const override
+    {
+        std::apply([&](const auto &...values) {
+            fmt::vformat_to(fmt::appender(out), formatString, fmt::make_format_args(values...));
+        }, args);
+    }
+};
+
+// Single-producer/single-consumer ring owned by one logging thread and drained by the flush thread
+class LogRing
+{
+public:
+    static constexpr size_t SlotSize = 256;
+    static constexpr size_t SlotCount = 1024;
+
+    struct alignas(64) Slot
+    {
+        unsigned char storage[SlotSize];
+    };
+
+    std::unique_ptr<Slot[]> slots;
+    std::unique_ptr<LogRecord *[]> records;
+    alignas(64) std::atomic<size_t> head;
+    alignas(64) std::atomic<size_t> tail;
+    std::atomic<bool> orphaned;
+
+    LogRing();
+
+    // Producer side: storage for the next record, or nullptr if the ring is full
+    void *reserve();
+    void publish(LogRecord *record);
+
+    // Consumer side
+    LogRecord *front();
+    void pop();
+
+    ~LogRing();
+};
+
+// Thread-safe limiter for repeated messages sharing a key, e.g. the validation message id
+class LogRateLimiter
+{
+private:
+    static constexpr size_t BucketCount = 256;
+
+    uint32_t maxPerWindow;
+    std::chrono::steady_clock::duration window;
+    std::atomic<uint64_t> buckets[BucketCount];
+
+public:
+    LogRateLimiter(uint32_t maxPerWindow, std::chrono::steady_clock::duration window);
+
+    // True if a message with this key may be logged; reports how many were dropped since the last allowed one
+    bool allow(uint64_t key, uint32_t *suppressed);
+};
+
+class Logger
+{
+private:
+    std::mutex ringsMutex;
+    std::mutex drainMutex;
+    std::vector<std::shared_ptr<LogRing>> rings;
+    std::atomic<bool> running;
+    std::atomic<uint64_t> dropped;
+    std::chrono::steady_clock::time_point start;
+    std::mutex wakeMutex;
+    std::condition_variable wake;
+    std::thread flusher;
+
+    Logger();
+
+    LogRing &threadRing();
+    void flushLoop();
+    void drain();
+
+    template <typename Record, typename... Forwarded>
+    void push(LogLevel level, Forwarded &&...forwarded)
+    {
+        static_assert(sizeof(Record) <= LogRing::SlotSize && alignof(Record) <= alignof(LogRing::Slot));
+
+        LogRing &ring = threadRing();
+        void *slot = ring.reserve();
+
+        if (slot == nullptr)
+        {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        Record *record = new (slot) Record(std::forward<Forwarded>(forwarded)...);
+        record->level = level;
+        record->timestamp = std::chrono::steady_clock::now();
+        ring.publish(record);
+    }
+
+public:
+    static Logger &instance();
+
+    template <typename... Args>
+    static void log(LogLevel level, fmt::format_string<Args...> format, Args &&...args)
+    {
+        typedef FormattedLogRecord<LogStored<Args>...> Record;
+
+        if constexpr (sizeof(Record) <= LogRing::SlotSize && alignof(Record) <= alignof(LogRing::Slot))
+        {
+            instance().push<Record>(level, fmt::string_view(format), std::forward<Args>(args)...);
+        }
+        else
+        {
+            // Too large for a slot: pay for formatting on the calling thread instead
+            instance().push<FormattedLogRecord<std::string>>(
+                level, fmt::string_view("{}"), fmt::format(format, std::forward<Args>(args)...));
+        }
+    }
+
+    // Blocks until every message logged so far has been written
+    void flush();
+
+    ~Logger();
+};
+
+#endif
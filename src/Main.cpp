@@ -1,30 +1,44 @@
-#include <functional>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <memory>
+#include <string>
 #include <thread>
+#include <vector>
 
 #include <SDL.h>
 #include <GLFW/glfw3.h>
 
 #include "FrameDrawer.h"
+#include "LightBenchmark.h"
+#include "ParticleBenchmark.h"
+#include "RenderRegression.h"
+#include "RenderThread.h"
+#include "Trace.h"
 #include "VulkanHandler.h"
 
 const int WINDOW_WIDTH = 1280;
 const int WINDOW_HEIGHT = 800;
+// Longest wait for window events before the next snapshot is handed to the render thread
+const int SNAPSHOT_INTERVAL_MS = 4;
 
 class Application
 {
 public:
-    std::unique_ptr<FrameDrawer> sdlHandler, glfwHandler;
+    std::unique_ptr<FrameDrawer> sdlHandler, glfwHandler, headlessHandler;
     SDL_Window *sdlWindow;
     GLFWwindow *glfwWindow;
     SDL_Event event;
     ApplicationType appType;
     bool frameBufferResized;
+    uint32_t headlessFrameCount;
 
-    Application(enum ApplicationType type)
+    Application(enum ApplicationType type, uint32_t frameCount = 0)
     {
         appType = type;
+        headlessFrameCount = frameCount;
     }
 
     void init()
@@ -60,6 +74,78 @@ public:
 
             glfwHandler = std::unique_ptr<FrameDrawer>(new FrameDrawer(glfwWindow, glfwWindowName));
         }
+        else if (appType == ApplicationType::Headless)
+        {
+            std::string headlessNameStr = "Headless Vulkan Demo";
+            char *headlessName = headlessNameStr.data();
+
+            headlessHandler = std::unique_ptr<FrameDrawer>(
+                new FrameDrawer(VkExtent2D {WINDOW_WIDTH, WINDOW_HEIGHT}, headlessName));
+        }
+
+        const char *meshPath = std::getenv("BASICVULKAN_MESH");
+        const char *meshInstances = std::getenv("BASICVULKAN_MESH_INSTANCES");
+
+        if (meshPath != nullptr)
+        {
+            uint32_t instanceCount = meshInstances != nullptr ? std::max(std::atoi(meshInstances), 1) : 1;
+
+            for (FrameDrawer *handler : {sdlHandler.get(), glfwHandler.get(), headlessHandler.get()})
+            {
+                if (handler != nullptr)
+                {
+                    handler->showMesh(meshPath, instanceCount);
+                }
+            }
+        }
+
+        const char *lightCount = std::getenv("BASICVULKAN_LIGHTS");
+
+        if (meshPath != nullptr && lightCount != nullptr && std::atoi(lightCount) > 0)
+        {
+            for (FrameDrawer *handler : {sdlHandler.get(), glfwHandler.get(), headlessHandler.get()})
+            {
+                if (handler != nullptr)
+                {
+                    handler->showLights(std::atoi(lightCount));
+                }
+            }
+        }
+
+        const char *texturePath = std::getenv("BASICVULKAN_TEXTURE");
+
+        if (texturePath != nullptr)
+        {
+            for (FrameDrawer *handler : {sdlHandler.get(), glfwHandler.get(), headlessHandler.get()})
+            {
+                if (handler != nullptr)
+                {
+                    handler->showTexture(texturePath);
+                }
+            }
+        }
+
+        const char *particleCapacity = std::getenv("BASICVULKAN_PARTICLES");
+
+        if (particleCapacity != nullptr && std::atoi(particleCapacity) > 0)
+        {
+            for (FrameDrawer *handler : {sdlHandler.get(), glfwHandler.get(), headlessHandler.get()})
+            {
+                if (handler != nullptr)
+                {
+                    handler->showParticles(std::atoi(particleCapacity));
+                }
+            }
+        }
+
+        // Only one of the applications running side by side captures its frames
+        const char *capturePath = std::getenv("BASICVULKAN_CAPTURE");
+        FrameDrawer *capturedHandler = appType == SDL ? sdlHandler.get() : headlessHandler.get();
+
+        if (capturePath != nullptr && capturedHandler != nullptr)
+        {
+            capturedHandler->vulkan->createFrameCapture(capturePath);
+        }
     }
 
     static void frameBufferResizeCallback(GLFWwindow* window, int width, int height)
@@ -68,78 +154,101 @@ public:
         app->frameBufferResized = true;
     }
 
-    void mainLoop()
+    // Clear color channel after `step` steps of a ramp from 0 up to 255 and back down
+    static int rampChannel(uint64_t step)
     {
-        const std::function<int(int, int)> add = std::plus<int>();
-        const std::function<int(int, int)> subtract = std::minus<int>();
-        std::function<int(int, int)> currentFunction;
+        int phase = static_cast<int>(step % 510);
+        return phase <= 255 ? phase : 510 - phase;
+    }
+
+    // Windowed applications step the ramp 60 times per second, whatever the frame rate of their render thread
+    static uint64_t rampStep(std::chrono::steady_clock::time_point start)
+    {
+        auto elapsed = std::chrono::steady_clock::now() - start;
+        return 1 + std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count() * 60 / 1000000;
+    }
 
-        bool sdlRunning = true, glfwRunning = true;
+    void mainLoop()
+    {
+        bool sdlRunning = true;
         int r = 112, g = 66, b = 20;
 
         if (appType == SDL)
         {
             // sdlHandler->setClearColor(r, g, b);
 
-            int currentR = 0, currentG = 0, currentB = 0;
+            // This thread only pumps events from now on: frames are recorded and presented by the render thread
+            RenderThread renderThread(*sdlHandler, "SDL render thread");
+            FrameSnapshot snapshot {};
+            auto start = std::chrono::steady_clock::now();
 
-            while (sdlRunning)
+            while (sdlRunning && renderThread.isRunning())
             {
-                while (SDL_PollEvent(&event))
+                bool hasEvent = SDL_WaitEventTimeout(&event, SNAPSHOT_INTERVAL_MS) != 0;
+
+                while (hasEvent)
                 {
                     if (event.type == SDL_QUIT)
                     {
                         sdlRunning = false;
                     }
-                }
+                    else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_m)
+                    {
+                        snapshot.sampleCountCycles++;
+                    }
+                    else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_b)
+                    {
+                        snapshot.postEffectToggles[PostBloom]++;
+                    }
+                    else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_t)
+                    {
+                        snapshot.postEffectToggles[PostToneMapping]++;
+                    }
+                    else if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_f)
+                    {
+                        snapshot.postEffectToggles[PostFxaa]++;
+                    }
 
-                if (currentR == 0)
-                {
-                    currentFunction = add;
-                }
-                else if (currentR == 255)
-                {
-                    currentFunction = subtract;
+                    hasEvent = SDL_PollEvent(&event) != 0;
                 }
 
-                currentR = currentFunction(currentR, 1);
-                currentG = currentFunction(currentG, 1);
-                currentB = currentFunction(currentB, 1);
-                sdlHandler->setClearColor(currentR, currentG, currentB);
+                int channel = rampChannel(rampStep(start));
+                snapshot.clearColor[0] = snapshot.clearColor[1] = snapshot.clearColor[2] = channel;
 
-                sdlHandler->nextFrame();
+                renderThread.submit(snapshot);
             }
+
+            renderThread.stop();
         }
         else if (appType == GLFW)
         {
             // sdlHandler->setClearColor(r, g, b);
 
-            int currentR = 0, currentG = 0, currentB = 0;
+            RenderThread renderThread(*glfwHandler, "GLFW render thread");
+            FrameSnapshot snapshot {};
+            auto start = std::chrono::steady_clock::now();
 
-            while (glfwRunning)
+            while (!glfwWindowShouldClose(glfwWindow) && renderThread.isRunning())
             {
-                while (!glfwWindowShouldClose(glfwWindow))
-                {
-                    glfwPollEvents();
+                glfwWaitEventsTimeout(SNAPSHOT_INTERVAL_MS / 1000.0);
 
-                    if (currentR == 0)
-                    {
-                        currentFunction = add;
-                    }
-                    else if (currentR == 255)
-                    {
-                        currentFunction = subtract;
-                    }
+                int channel = rampChannel(rampStep(start));
+                snapshot.clearColor[0] = snapshot.clearColor[1] = snapshot.clearColor[2] = channel;
 
-                    currentR = currentFunction(currentR, 1);
-                    currentG = currentFunction(currentG, 1);
-                    currentB = currentFunction(currentB, 1);
-                    glfwHandler->setClearColor(currentR, currentG, currentB);
+                renderThread.submit(snapshot);
+            }
 
-                    glfwHandler->nextFrame();
-                }
+            renderThread.stop();
+        }
+        else if (appType == Headless)
+        {
+            // Stepped once per frame, on this thread, so that every run renders the same frames
+            for (uint32_t frame = 0; frame < headlessFrameCount; frame++)
+            {
+                int channel = rampChannel(frame + 1);
+                headlessHandler->setClearColor(channel, channel, channel);
 
-                // vkDeviceWaitIdle(glfwHandler->vulkan->device);
+                headlessHandler->nextFrame();
             }
         }
     }
@@ -148,6 +257,7 @@ public:
     {
         if (appType == SDL)
         {
+            sdlHandler->finish();
             SDL_DestroyWindow(sdlWindow);
             sdlWindow = nullptr;
             sdlHandler.reset();
@@ -155,15 +265,23 @@ public:
         }
         else if (appType == GLFW)
         {
+            glfwHandler->finish();
             glfwDestroyWindow(glfwWindow);
             glfwHandler.reset();
             glfwTerminate();
         }
+        else if (appType == Headless)
+        {
+            headlessHandler->finish();
+            headlessHandler.reset();
+        }
     }
 
 public:
     void run()
     {
+        Trace::setThreadName(appType == SDL ? "SDL application" : appType == GLFW ? "GLFW application" : "Headless application");
+
         init();
         mainLoop();
         cleanup();
@@ -172,6 +290,95 @@ public:
 
 int main(int argc, char *argv[])
 {
+    // --golden <directory> [scene] [--update]: headless render regression against reference images, e.g. on lavapipe
+    if (argc > 2 && strcmp(argv[1], "--golden") == 0)
+    {
+        try
+        {
+            std::string scene;
+            bool update = false;
+
+            for (int i = 3; i < argc; i++)
+            {
+                if (strcmp(argv[i], "--update") == 0)
+                {
+                    update = true;
+                }
+                else
+                {
+                    scene = argv[i];
+                }
+            }
+
+            return runRenderRegression(argv[2], scene, update);
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --particle-benchmark [capacity...]: headless particles simulated per millisecond, e.g. on lavapipe
+    if (argc > 1 && strcmp(argv[1], "--particle-benchmark") == 0)
+    {
+        try
+        {
+            std::vector<uint32_t> capacities;
+            for (int i = 2; i < argc; i++)
+            {
+                capacities.push_back(std::max(std::atoi(argv[i]), 1));
+            }
+
+            runParticleBenchmark(capacities);
+            return EXIT_SUCCESS;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --light-benchmark <mesh> [count...]: headless cost of clustered lighting per light count, e.g. on lavapipe
+    if (argc > 2 && strcmp(argv[1], "--light-benchmark") == 0)
+    {
+        try
+        {
+            std::vector<uint32_t> counts;
+            for (int i = 3; i < argc; i++)
+            {
+                counts.push_back(std::max(std::atoi(argv[i]), 0));
+            }
+
+            runLightBenchmark(argv[2], counts);
+            return EXIT_SUCCESS;
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    // --headless [frames]: renders offscreen without any window, e.g. to capture frames on a machine without display
+    if (argc > 1 && strcmp(argv[1], "--headless") == 0)
+    {
+        Application headlessApp(ApplicationType::Headless, argc > 2 ? std::atoi(argv[2]) : 60);
+
+        try
+        {
+            headlessApp.run();
+        }
+        catch (const std::exception &e)
+        {
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        return EXIT_SUCCESS;
+    }
+
     Application sdlApp(ApplicationType::SDL);
     Application glfwApp(ApplicationType::GLFW);
 
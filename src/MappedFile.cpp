@@ -0,0 +1,61 @@
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "MappedFile.h"
+
+MappedFile::MappedFile(const std::string &path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    struct stat status;
+    if (fstat(fd, &status) != 0)
+    {
+        close(fd);
+        throw std::runtime_error("Failed to stat " + path);
+    }
+
+    length = static_cast<size_t>(status.st_size);
+    mapping = nullptr;
+
+    if (length > 0)
+    {
+        void *address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (address == MAP_FAILED)
+        {
+            close(fd);
+            throw std::runtime_error("Failed to map " + path);
+        }
+
+        // Start reading ahead while the caller parses headers and creates GPU resources
+        madvise(address, length, MADV_WILLNEED);
+        mapping = static_cast<const uint8_t *>(address);
+    }
+
+    // The mapping keeps the file referenced
+    close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (mapping != nullptr)
+    {
+        munmap(const_cast<uint8_t *>(mapping), length);
+    }
+}
+
+const uint8_t *MappedFile::data() const
+{
+    return mapping;
+}
+
+size_t MappedFile::size() const
+{
+    return length;
+}
@@ -0,0 +1,26 @@
+#ifndef MAPPED_FILE_H_
+#define MAPPED_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Read-only memory mapping of a whole file: parsers point straight into it instead of reading into buffers
+class MappedFile
+{
+private:
+    const uint8_t *mapping;
+    size_t length;
+
+public:
+    MappedFile(const std::string &path);
+    MappedFile(const MappedFile &) = delete;
+    MappedFile &operator=(const MappedFile &) = delete;
+
+    const uint8_t *data() const;
+    size_t size() const;
+
+    ~MappedFile();
+};
+
+#endif
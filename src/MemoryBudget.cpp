@@ -0,0 +1,236 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "MemoryBudget.h"
+#include "Trace.h"
+
+// Without the extension: what is left to the process is a guess, leaving room for the driver and other processes
+const double FallbackBudgetShare = 0.8;
+
+static VkDeviceSize mebibytes(VkDeviceSize bytes)
+{
+    return bytes >> 20;
+}
+
+MemoryBudget::MemoryBudget(VkDevice device, VkPhysicalDevice physicalDevice, bool extension, uint32_t latency)
+{
+    this->device = device;
+    this->physicalDevice = physicalDevice;
+    this->extension = extension;
+    this->latency = latency;
+
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memoryProperties);
+
+    for (uint32_t i = 0; i < memoryProperties.memoryHeapCount; i++)
+    {
+        const VkMemoryHeap &heap = memoryProperties.memoryHeaps[i];
+
+        heaps.push_back({
+            .usage       = 0,
+            .budget      = static_cast<VkDeviceSize>(heap.size * FallbackBudgetShare),
+            .size        = heap.size,
+            .deviceLocal = (heap.flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT) != 0,
+        });
+    }
+
+    allocated.assign(heaps.size(), 0);
+    settling.assign(heaps.size(), 0);
+    stats = {};
+
+    poll();
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        LOG_INFO(
+            "Memory heap {}: {} MiB{}, budget {} MiB{}", i, mebibytes(heaps[i].size),
+            heaps[i].deviceLocal ? " device local" : "", mebibytes(heaps[i].budget),
+            extension ? "" : " (estimated)");
+    }
+}
+
+void MemoryBudget::poll()
+{
+    if (!extension)
+    {
+        for (uint32_t i = 0; i < heaps.size(); i++)
+        {
+            heaps[i].usage = allocated[i];
+        }
+        return;
+    }
+
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budgetProperties {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+    };
+
+    VkPhysicalDeviceMemoryProperties2 properties2 {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = &budgetProperties,
+    };
+
+    vkGetPhysicalDeviceMemoryProperties2(physicalDevice, &properties2);
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        heaps[i].usage = budgetProperties.heapUsage[i];
+        heaps[i].budget = budgetProperties.heapBudget[i];
+    }
+}
+
+void MemoryBudget::addEvictionCallback(EvictionCallback callback)
+{
+    callbacks.push_back(std::move(callback));
+}
+
+void MemoryBudget::update()
+{
+    TRACE_ZONE("MemoryBudget::update");
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        poll();
+    }
+
+    for (uint32_t i = 0; i < heaps.size(); i++)
+    {
+        if (settling[i] > 0)
+        {
+            settling[i]--;
+            continue;
+        }
+
+        if (heaps[i].usage > heaps[i].budget * EvictionThreshold)
+        {
+            evict(i);
+        }
+    }
+}
+
+void MemoryBudget::evict(uint32_t heap)
+{
+    TRACE_ZONE("MemoryBudget::evict");
+
+    VkDeviceSize target = static_cast<VkDeviceSize>(heaps[heap].budget * EvictionTarget);
+    VkDeviceSize excess = heaps[heap].usage - std::min(heaps[heap].usage, target);
+    VkDeviceSize freed = 0;
+
+    for (auto &callback : callbacks)
+    {
+        if (freed >= excess)
+        {
+            break;
+        }
+        freed += callback(heap, excess - freed);
+    }
+
+    // Whether or not anything could be freed, the usage only changes once the frames in flight are done
+    settling[heap] = latency;
+
+    if (freed == 0)
+    {
+        return;
+    }
+
+    LOG_WARNING(
+        "Memory heap {} at {} of its {} MiB budget: evicting {} MiB", heap, mebibytes(heaps[heap].usage),
+        mebibytes(heaps[heap].budget), mebibytes(freed));
+
+    stats.evictions++;
+    stats.evictedBytes += freed;
+}
+
+VkDeviceMemory MemoryBudget::allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags preferred,
+    uint32_t *memoryType, VkMemoryPropertyFlags required)
+{
+    // The preferred properties within the budget, then host visible memory within the budget, then anything at all,
+    // always with the required properties
+    const VkMemoryPropertyFlags passes[] {
+        preferred | required, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | required, required};
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    for (uint32_t pass = 0; pass < 3; pass++)
+    {
+        for (uint32_t type = 0; type < memoryProperties.memoryTypeCount; type++)
+        {
+            VkMemoryPropertyFlags flags = memoryProperties.memoryTypes[type].propertyFlags;
+            uint32_t heap = memoryProperties.memoryTypes[type].heapIndex;
+
+            if (!(requirements.memoryTypeBits & (1 << type)) || (flags & passes[pass]) != passes[pass])
+            {
+                continue;
+            }
+
+            if (pass < 2 && heaps[heap].usage + requirements.size > heaps[heap].budget)
+            {
+                continue;
+            }
+
+            VkMemoryAllocateInfo allocInfo {
+                .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+                .allocationSize  = requirements.size,
+                .memoryTypeIndex = type,
+            };
+
+            VkDeviceMemory memory;
+            if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+            {
+                // Out of memory in this heap whatever the budget said: on to the next type
+                continue;
+            }
+
+            // Until the next poll, the driver's figures do not include it
+            allocated[heap] += requirements.size;
+            heaps[heap].usage += requirements.size;
+
+            if ((flags & preferred) != preferred)
+            {
+                LOG_WARNING(
+                    "Allocating {} KiB in memory heap {}: the preferred heaps are full", requirements.size >> 10,
+                    heap);
+                stats.fallbacks++;
+            }
+
+            *memoryType = type;
+            return memory;
+        }
+    }
+
+    throw std::runtime_error("Failed to allocate memory in any heap!");
+}
+
+void MemoryBudget::free(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType)
+{
+    uint32_t heap = getHeapIndex(memoryType);
+
+    vkFreeMemory(device, memory, nullptr);
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    allocated[heap] -= std::min(allocated[heap], size);
+    heaps[heap].usage -= std::min(heaps[heap].usage, size);
+}
+
+uint32_t MemoryBudget::getHeapIndex(uint32_t memoryType) const
+{
+    return memoryProperties.memoryTypes[memoryType].heapIndex;
+}
+
+bool MemoryBudget::hasExtension() const
+{
+    return extension;
+}
+
+const std::vector<HeapBudget> &MemoryBudget::getHeaps() const
+{
+    return heaps;
+}
+
+MemoryStats MemoryBudget::takeStats()
+{
+    MemoryStats taken = stats;
+    stats = {};
+
+    return taken;
+}
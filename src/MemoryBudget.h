@@ -0,0 +1,91 @@
+#ifndef MEMORY_BUDGET_H_
+#define MEMORY_BUDGET_H_
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct HeapBudget
+{
+    // Of this process: as the driver reports it, or only what was allocated through the budget without the extension
+    VkDeviceSize usage;
+    // What the process can use before the driver starts paging, which moves with what other processes use
+    VkDeviceSize budget;
+    VkDeviceSize size;
+    bool deviceLocal;
+};
+
+// Evictions and fallbacks since the statistics were last taken
+struct MemoryStats
+{
+    uint32_t evictions;
+    VkDeviceSize evictedBytes;
+    // Allocations that went to host visible memory, their preferred heaps being full
+    uint32_t fallbacks;
+};
+
+// Asked to free about that many bytes of the heap; returns how many it will free, once the frames in flight are done
+typedef std::function<VkDeviceSize(uint32_t heap, VkDeviceSize bytes)> EvictionCallback;
+
+// Usage and budget of every memory heap, polled once per frame from VK_EXT_memory_budget. Without the extension the
+// budget is a share of each heap's size and the usage what was allocated through this class. A heap getting close to
+// its budget has its eviction callbacks called in the order they were added, until enough is freed; it is then left
+// alone while the frames in flight release the memory. Allocations go to the first memory type of the preferred
+// properties whose heap has room in its budget, else to host visible memory, and only fail when no type at all can
+// hold them. The subsystems allocate through it, so that their memory counts without the extension as well.
+// Allocating and freeing are thread safe, for the initialization steps running in parallel; the rest is used from the
+// thread recording frames
+class MemoryBudget
+{
+public:
+    // Evictions start past this share of a heap's budget, and free down to the lower one
+    static constexpr double EvictionThreshold = 0.9;
+    static constexpr double EvictionTarget = 0.8;
+
+private:
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    bool extension;
+    uint32_t latency;
+
+    VkPhysicalDeviceMemoryProperties memoryProperties;
+    std::vector<HeapBudget> heaps;
+    // Through this class, per heap
+    std::vector<VkDeviceSize> allocated;
+    // Frames left before an evicted heap is looked at again
+    std::vector<uint32_t> settling;
+    std::vector<EvictionCallback> callbacks;
+    MemoryStats stats;
+    // Over the usage and the allocation counts
+    std::mutex mutex;
+
+    void poll();
+    void evict(uint32_t heap);
+
+public:
+    // extension: VK_EXT_memory_budget is enabled on the device; latency: frames before freed memory is released
+    MemoryBudget(VkDevice device, VkPhysicalDevice physicalDevice, bool extension, uint32_t latency);
+
+    void addEvictionCallback(EvictionCallback callback);
+
+    // Once per frame, after the fence of the frame slot has been waited on: polls the heaps and evicts where needed
+    void update();
+
+    // Memory for the requirements, of the preferred properties where the budget allows. `required` properties, such
+    // as host visibility for memory that is mapped, hold whatever the fallback. Throws only when every allowed memory
+    // type failed
+    VkDeviceMemory allocate(const VkMemoryRequirements &requirements, VkMemoryPropertyFlags preferred,
+        uint32_t *memoryType, VkMemoryPropertyFlags required = 0);
+    void free(VkDeviceMemory memory, VkDeviceSize size, uint32_t memoryType);
+
+    uint32_t getHeapIndex(uint32_t memoryType) const;
+    bool hasExtension() const;
+    const std::vector<HeapBudget> &getHeaps() const;
+
+    MemoryStats takeStats();
+};
+
+#endif
@@ -0,0 +1,145 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include "MeshFile.h"
+
+MeshFile parseMeshFile(const MappedFile &file)
+{
+    if (file.size() < sizeof(MeshFileHeader))
+    {
+        throw std::runtime_error("Truncated mesh file!");
+    }
+
+    // The mapping is page aligned, so the header can be used in place
+    MeshFile mesh {};
+    mesh.header = reinterpret_cast<const MeshFileHeader *>(file.data());
+
+    if (mesh.header->magic != MeshFileMagic)
+    {
+        throw std::runtime_error("Not a mesh file!");
+    }
+
+    if (mesh.header->version != MeshFileVersion)
+    {
+        throw std::runtime_error("Unsupported mesh file version, convert it again!");
+    }
+
+    for (uint32_t section = 0; section < MeshSectionCount; section++)
+    {
+        const MeshFileSection &range = mesh.header->sections[section];
+
+        if (range.offset % MeshSectionAlignment != 0 || range.offset > file.size() ||
+            range.size > file.size() - range.offset)
+        {
+            throw std::runtime_error("Truncated or misaligned mesh file section!");
+        }
+
+        mesh.sections[section] = file.data() + range.offset;
+    }
+
+    const MeshFileHeader &header = *mesh.header;
+
+    if ((header.indexSize != 2 && header.indexSize != 4) ||
+        header.sections[MeshVertices].size != uint64_t(header.vertexCount) * sizeof(MeshVertex) ||
+        header.sections[MeshIndices].size != uint64_t(header.indexCount) * header.indexSize ||
+        header.sections[MeshMeshlets].size != uint64_t(header.meshletCount) * sizeof(Meshlet))
+    {
+        throw std::runtime_error("Inconsistent mesh file header!");
+    }
+
+    if (header.lodCount == 0 || header.lodCount > MeshMaxLods)
+    {
+        throw std::runtime_error("Inconsistent mesh file levels of detail!");
+    }
+
+    for (uint32_t level = 0; level < header.lodCount; level++)
+    {
+        const MeshLod &lod = header.lods[level];
+
+        if (lod.firstIndex > header.indexCount || lod.indexCount > header.indexCount - lod.firstIndex ||
+            lod.firstMeshlet > header.meshletCount || lod.meshletCount > header.meshletCount - lod.firstMeshlet)
+        {
+            throw std::runtime_error("Inconsistent mesh file levels of detail!");
+        }
+    }
+
+    return mesh;
+}
+
+void writeMeshFile(const std::string &path, const MeshFileContents &contents)
+{
+    std::ofstream out(path, std::ios::binary);
+    if (!out)
+    {
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+
+    bool shortIndices = contents.vertices.size() <= 65536;
+
+    std::vector<uint16_t> indices16;
+    if (shortIndices)
+    {
+        indices16.assign(contents.indices.begin(), contents.indices.end());
+    }
+
+    MeshFileHeader header {};
+    header.magic = MeshFileMagic;
+    header.version = MeshFileVersion;
+    header.vertexCount = static_cast<uint32_t>(contents.vertices.size());
+    header.indexCount = static_cast<uint32_t>(contents.indices.size());
+    header.indexSize = shortIndices ? 2 : 4;
+    header.meshletCount = static_cast<uint32_t>(contents.meshlets.size());
+    memcpy(header.boundsMin, contents.boundsMin, sizeof(header.boundsMin));
+    memcpy(header.boundsMax, contents.boundsMax, sizeof(header.boundsMax));
+
+    if (contents.lods.empty() || contents.lods.size() > MeshMaxLods)
+    {
+        throw std::runtime_error("A mesh needs between 1 and " + std::to_string(MeshMaxLods) + " levels of detail");
+    }
+
+    header.lodCount = static_cast<uint32_t>(contents.lods.size());
+    std::copy(contents.lods.begin(), contents.lods.end(), header.lods);
+
+    const void *data[MeshSectionCount] {
+        contents.vertices.data(),
+        shortIndices ? static_cast<const void *>(indices16.data()) : contents.indices.data(),
+        contents.meshlets.data(),
+        contents.meshletVertices.data(),
+        contents.meshletTriangles.data(),
+    };
+
+    uint64_t sizes[MeshSectionCount] {
+        contents.vertices.size() * sizeof(MeshVertex),
+        contents.indices.size() * header.indexSize,
+        contents.meshlets.size() * sizeof(Meshlet),
+        contents.meshletVertices.size() * sizeof(uint32_t),
+        contents.meshletTriangles.size(),
+    };
+
+    uint64_t offset = sizeof(MeshFileHeader);
+    for (uint32_t section = 0; section < MeshSectionCount; section++)
+    {
+        offset = (offset + MeshSectionAlignment - 1) / MeshSectionAlignment * MeshSectionAlignment;
+        header.sections[section] = {offset, sizes[section]};
+        offset += sizes[section];
+    }
+
+    out.write(reinterpret_cast<const char *>(&header), sizeof(header));
+
+    const char padding[MeshSectionAlignment] {};
+    uint64_t written = sizeof(header);
+
+    for (uint32_t section = 0; section < MeshSectionCount; section++)
+    {
+        out.write(padding, static_cast<std::streamsize>(header.sections[section].offset - written));
+        out.write(static_cast<const char *>(data[section]), static_cast<std::streamsize>(sizes[section]));
+        written = header.sections[section].offset + sizes[section];
+    }
+
+    if (!out)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
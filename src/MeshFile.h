@@ -0,0 +1,121 @@
+#ifndef MESH_FILE_H_
+#define MESH_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "MappedFile.h"
+
+// Binary mesh format written by the mesh converter: a header followed by sections, each starting on a
+// MeshSectionAlignment boundary, so that the whole file is copied to one GPU buffer as is and every section can be
+// bound at its file offset (256 is the largest minStorageBufferOffsetAlignment a device may report)
+const uint32_t MeshFileMagic = 0x534D5642; // "BVMS"
+const uint32_t MeshFileVersion = 3;
+const uint64_t MeshSectionAlignment = 256;
+const uint32_t MeshMaxLods = 8;
+
+enum MeshSection
+{
+    MeshVertices,
+    // Triangles of every level of detail, finest first, each in meshlet order: a meshlet's triangles are contiguous,
+    // starting at its firstIndex
+    MeshIndices,
+    MeshMeshlets,
+    // Per meshlet, the indices of its vertices in the vertex section (uint32_t)
+    MeshMeshletVertices,
+    // Per meshlet, three local vertex indices (uint8_t) per triangle, padded to 4 bytes
+    MeshMeshletTriangles,
+    MeshSectionCount,
+};
+
+// 16 bytes: positions are unorm16 within the mesh bounds (R16G16B16A16_UNORM, w unused), normals are octahedral
+// snorm16 (R16G16_SNORM) and texture coordinates are half floats (R16G16_SFLOAT)
+struct MeshVertex
+{
+    uint16_t position[4];
+    int16_t normal[2];
+    uint16_t texcoord[2];
+};
+
+// 48 bytes, laid out for std430: bounding sphere and normal cone in mesh space, then where its data lives. Shaders
+// read the two counts as one uint: vertexCount = counts & 0xFF, triangleCount = (counts >> 8) & 0xFF
+struct Meshlet
+{
+    float center[3];
+    float radius;
+    float coneAxis[3];
+    // Sine of the cone's half angle; 1 when the triangles face too many directions for the cone to cull anything
+    float coneCutoff;
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    // The same triangles in the index section, for drawing the meshlet without mesh shaders
+    uint32_t firstIndex;
+    uint8_t vertexCount;
+    uint8_t triangleCount;
+    uint16_t reserved;
+};
+
+// A level of detail: the triangles of a simplified mesh over the same vertices, and the meshlets built from them
+struct MeshLod
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t firstMeshlet;
+    uint32_t meshletCount;
+    // Largest distance, in mesh space, between a vertex and the one standing in for it: 0 for the full mesh
+    float error;
+};
+
+struct MeshFileSection
+{
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    // Over all levels of detail, as meshletCount
+    uint32_t indexCount;
+    // 2 or 4
+    uint32_t indexSize;
+    uint32_t meshletCount;
+    // Dequantized position = boundsMin + position / 65535 * (boundsMax - boundsMin)
+    float boundsMin[3];
+    float boundsMax[3];
+    // At least one; errors grow with the level
+    uint32_t lodCount;
+    MeshLod lods[MeshMaxLods];
+    MeshFileSection sections[MeshSectionCount];
+};
+
+// Points into the mapping: nothing is parsed per vertex
+struct MeshFile
+{
+    const MeshFileHeader *header;
+    const uint8_t *sections[MeshSectionCount];
+};
+
+// Throws on a wrong magic or version, or sections or levels of detail outside the file
+MeshFile parseMeshFile(const MappedFile &file);
+
+struct MeshFileContents
+{
+    float boundsMin[3];
+    float boundsMax[3];
+    std::vector<MeshVertex> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> meshletVertices;
+    std::vector<uint8_t> meshletTriangles;
+    std::vector<MeshLod> lods;
+};
+
+// Indices are stored on 16 bits when every vertex can be addressed with them
+void writeMeshFile(const std::string &path, const MeshFileContents &contents);
+
+#endif
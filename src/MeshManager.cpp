@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "MeshManager.h"
+#include "Trace.h"
+
+MeshManager::MeshManager(
+    VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, uint32_t framesInFlight,
+    VkDeviceSize stagingSize, VkDeviceSize uploadBudget, bool meshShaders)
+    : memory(memory), staging(device, physicalDevice, stagingSize, framesInFlight)
+{
+    this->device = device;
+    this->physicalDevice = physicalDevice;
+    this->framesInFlight = framesInFlight;
+    this->uploadBudget = uploadBudget;
+    frameNumber = 0;
+
+    readStages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT |
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    if (meshShaders)
+    {
+        readStages |= VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT | VK_PIPELINE_STAGE_MESH_SHADER_BIT_EXT;
+    }
+}
+
+MeshManager::~MeshManager()
+{
+    for (auto &retired : retiredBuffers)
+    {
+        vkDestroyBuffer(device, retired.buffer, nullptr);
+        memory.free(retired.memory, retired.size, retired.memoryType);
+    }
+
+    for (auto &mesh : meshes)
+    {
+        if (mesh.evicted)
+        {
+            continue;
+        }
+        vkDestroyBuffer(device, mesh.gpu.buffer, nullptr);
+        memory.free(mesh.memory, mesh.size, mesh.memoryType);
+    }
+}
+
+MeshHandle MeshManager::load(const std::string &path)
+{
+    TRACE_ZONE("MeshManager::load");
+
+    for (MeshHandle handle = 0; handle < meshes.size(); handle++)
+    {
+        Mesh &cached = meshes[handle];
+        if (cached.released && !cached.evicted && cached.path == path)
+        {
+            LOG_INFO("Reusing resident mesh {}", path);
+            cached.released = false;
+            return handle;
+        }
+    }
+
+    Mesh mesh {};
+    mesh.path = path;
+    mesh.file = std::make_unique<MappedFile>(path);
+    mesh.gpu.header = *parseMeshFile(*mesh.file).header;
+
+    VkBufferCreateInfo bufferInfo {
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size        = mesh.file->size(),
+        .usage       = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                       VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &mesh.gpu.buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create mesh buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, mesh.gpu.buffer, &memRequirements);
+
+    mesh.memory = memory.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &mesh.memoryType);
+    mesh.size = memRequirements.size;
+
+    vkBindBufferMemory(device, mesh.gpu.buffer, mesh.memory, 0);
+
+    LOG_INFO(
+        "Loading mesh {}: {} vertices, {} triangles, {} meshlets", path, mesh.gpu.header.vertexCount,
+        mesh.gpu.header.indexCount / 3, mesh.gpu.header.meshletCount);
+
+    MeshHandle handle = static_cast<MeshHandle>(meshes.size());
+    meshes.push_back(std::move(mesh));
+    streaming.push_back(handle);
+
+    return handle;
+}
+
+void MeshManager::update(VkCommandBuffer commandBuffer, uint32_t frameIndex)
+{
+    TRACE_ZONE("MeshManager::update");
+
+    staging.beginFrame(frameIndex);
+
+    auto retired = std::remove_if(retiredBuffers.begin(), retiredBuffers.end(), [this](const RetiredBuffer &retired) {
+        if (retired.retiredAt + framesInFlight < frameNumber)
+        {
+            vkDestroyBuffer(device, retired.buffer, nullptr);
+            memory.free(retired.memory, retired.size, retired.memoryType);
+            return true;
+        }
+        return false;
+    });
+    retiredBuffers.erase(retired, retiredBuffers.end());
+
+    VkDeviceSize budget = uploadBudget;
+    bool copied = false;
+
+    // Meshes complete in load order: a partially uploaded mesh is of no use, so the budget is not spread
+    while (!streaming.empty() && budget > 0)
+    {
+        Mesh &mesh = meshes[streaming.front()];
+
+        VkDeviceSize chunk = std::min({mesh.file->size() - mesh.uploaded, budget, staging.getCapacity() / 2});
+
+        StagingAllocation allocation;
+        if (!staging.allocate(chunk, 16, &allocation))
+        {
+            break;
+        }
+
+        // The only CPU copy: from the mapped file straight into the staging ring
+        memcpy(allocation.mapped, mesh.file->data() + mesh.uploaded, chunk);
+
+        VkBufferCopy region {
+            .srcOffset = allocation.offset,
+            .dstOffset = mesh.uploaded,
+            .size      = chunk,
+        };
+
+        vkCmdCopyBuffer(commandBuffer, allocation.buffer, mesh.gpu.buffer, 1, &region);
+
+        mesh.uploaded += chunk;
+        budget -= chunk;
+        copied = true;
+
+        if (mesh.uploaded == mesh.file->size())
+        {
+            mesh.gpu.ready = true;
+            mesh.file.reset();
+            streaming.erase(streaming.begin());
+        }
+    }
+
+    if (copied)
+    {
+        // One barrier for everything copied this frame, towards every way the sections can be read
+        VkMemoryBarrier barrier {
+            .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+            .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+        };
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, readStages, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+    }
+
+    staging.flush();
+    frameNumber++;
+}
+
+void MeshManager::release(MeshHandle mesh)
+{
+    meshes[mesh].released = true;
+}
+
+VkDeviceSize MeshManager::evict(uint32_t heap, VkDeviceSize bytes)
+{
+    // Only complete ones: a mesh still streaming is in the upload queue
+    std::vector<MeshHandle> candidates;
+    for (MeshHandle handle = 0; handle < meshes.size(); handle++)
+    {
+        const Mesh &mesh = meshes[handle];
+        if (mesh.released && !mesh.evicted && mesh.gpu.ready && memory.getHeapIndex(mesh.memoryType) == heap)
+        {
+            candidates.push_back(handle);
+        }
+    }
+
+    std::sort(candidates.begin(), candidates.end(), [this](MeshHandle a, MeshHandle b) {
+        return meshes[a].size > meshes[b].size;
+    });
+
+    VkDeviceSize freed = 0;
+    for (MeshHandle handle : candidates)
+    {
+        if (freed >= bytes)
+        {
+            break;
+        }
+
+        Mesh &mesh = meshes[handle];
+        retiredBuffers.push_back({mesh.gpu.buffer, mesh.memory, mesh.memoryType, mesh.size, frameNumber});
+
+        LOG_INFO("Evicting mesh {}", mesh.path);
+        mesh.gpu.buffer = VK_NULL_HANDLE;
+        mesh.gpu.ready = false;
+        mesh.memory = VK_NULL_HANDLE;
+        mesh.evicted = true;
+        freed += mesh.size;
+    }
+
+    return freed;
+}
+
+const GpuMesh &MeshManager::getMesh(MeshHandle mesh) const
+{
+    return meshes[mesh].gpu;
+}
@@ -0,0 +1,94 @@
+#ifndef MESH_MANAGER_H_
+#define MESH_MANAGER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "MappedFile.h"
+#include "MemoryBudget.h"
+#include "MeshFile.h"
+#include "StagingRing.h"
+
+typedef uint32_t MeshHandle;
+
+// A loaded mesh lives in one buffer holding the whole file: sections are bound at their offsets in the header
+struct GpuMesh
+{
+    VkBuffer buffer;
+    MeshFileHeader header;
+    // Set once the last byte has been copied; the copy is visible to every command recorded after that
+    bool ready;
+};
+
+// Meshes in the binary format written by the mesh converter. Files are copied from their mapping straight into
+// the staging ring, in chunks within a per-frame upload budget, then to device local memory, or wherever the memory
+// budget has room. A released mesh stays resident as a cache, handed back by a later load of the same file, until the
+// budget evicts it. Not thread safe: used from the thread recording frames
+class MeshManager
+{
+private:
+    struct Mesh
+    {
+        std::string path;
+        std::unique_ptr<MappedFile> file;
+        GpuMesh gpu;
+        VkDeviceMemory memory;
+        uint32_t memoryType;
+        VkDeviceSize size;
+        VkDeviceSize uploaded;
+        bool released;
+        // Its handle is never handed out again: renderers may keep bindings of the buffer per handle
+        bool evicted;
+    };
+
+    struct RetiredBuffer
+    {
+        VkBuffer buffer;
+        VkDeviceMemory memory;
+        uint32_t memoryType;
+        VkDeviceSize size;
+        uint64_t retiredAt;
+    };
+
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    MemoryBudget &memory;
+    uint32_t framesInFlight;
+    uint64_t frameNumber;
+    VkDeviceSize uploadBudget;
+    // Every stage reading the sections: vertex input and shaders, compute culling, and task and mesh shaders if enabled
+    VkPipelineStageFlags readStages;
+
+    StagingRing staging;
+    std::vector<Mesh> meshes;
+    std::vector<MeshHandle> streaming;
+    std::vector<RetiredBuffer> retiredBuffers;
+
+public:
+    // meshShaders: the task and mesh shader stages are enabled, and read the meshes as storage buffers
+    MeshManager(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, uint32_t framesInFlight,
+        VkDeviceSize stagingSize, VkDeviceSize uploadBudget, bool meshShaders);
+
+    // Maps and validates the file and creates its buffer; the contents are uploaded by update(). A released mesh of
+    // the same file, still resident, is handed back as is
+    MeshHandle load(const std::string &path);
+    // The mesh is no longer drawn: it stays resident until the memory budget evicts it
+    void release(MeshHandle mesh);
+
+    // Records this frame's copies: after the fence of `frameIndex` has been waited on, outside a render pass
+    void update(VkCommandBuffer commandBuffer, uint32_t frameIndex);
+
+    // Eviction callback of the memory budget: released meshes in the heap, largest first, freed once the frames in
+    // flight are done with them
+    VkDeviceSize evict(uint32_t heap, VkDeviceSize bytes);
+
+    const GpuMesh &getMesh(MeshHandle mesh) const;
+
+    ~MeshManager();
+};
+
+#endif
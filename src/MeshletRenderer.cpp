@@ -0,0 +1,468 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "MeshletRenderer.h"
+#include "Trace.h"
+
+// Workgroup sizes of meshlet.task and meshlet_cull.comp
+const uint32_t TaskMeshletsPerWorkgroup = 32;
+const uint32_t CullMeshletsPerWorkgroup = 64;
+
+MeshletRenderer::MeshletRenderer(
+    VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, MeshManager &meshes,
+    ClusteredLighting &lighting, uint32_t framesInFlight, const MeshletFeatures &features)
+    : memory(memory), pipelines(pipelines), meshes(meshes), lighting(lighting)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+    this->features = features;
+
+    cullPipeline = nullptr;
+    drawPipeline = nullptr;
+
+    origin = {{0.0f}, {0.0f}, {0.0f}, {1.0f}};
+
+    // Vertices, meshlets, meshlet vertices and meshlet triangles at their section offsets, then the fallback's draws
+    VkShaderStageFlags stages = features.meshShaders ?
+        VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT : VK_SHADER_STAGE_COMPUTE_BIT;
+    uint32_t bindingCount = features.meshShaders ? 4 : 5;
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
+    for (uint32_t binding = 0; binding < bindingCount; binding++)
+    {
+        layoutBindings.push_back({
+            .binding         = binding,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags      = stages,
+        });
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = bindingCount,
+        .pBindings    = layoutBindings.data(),
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create meshlet descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = features.meshShaders ? stages : VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(MeshletConstants),
+    };
+
+    // The mesh, then the lights
+    VkDescriptorSetLayout setLayouts[2] = {descriptorSetLayout, lighting.getDescriptorSetLayout()};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 2,
+        .pSetLayouts            = setLayouts,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create meshlet pipeline layout!");
+    }
+
+    if (!features.meshShaders)
+    {
+        PipelineKey cullKey {
+            .computeShader  = "meshlet_cull.comp",
+            .specialization = {{0, features.drawIndirectFirstInstance}},
+            .layout         = pipelineLayout,
+        };
+
+        cullPipeline = pipelines.request(cullKey);
+    }
+
+    LOG_INFO("Meshlets: {}", features.meshShaders ? "task and mesh shaders" : "compute culling and indirect draws");
+}
+
+MeshletRenderer::~MeshletRenderer()
+{
+    for (auto &[mesh, meshBindings] : bindings)
+    {
+        for (uint32_t i = 0; i < meshBindings.drawCommands.size(); i++)
+        {
+            vkDestroyBuffer(device, meshBindings.drawCommands[i], nullptr);
+            memory.free(
+                meshBindings.drawCommandMemory[i], meshBindings.drawCommandSizes[i],
+                meshBindings.drawCommandMemoryTypes[i]);
+        }
+
+        vkDestroyDescriptorPool(device, meshBindings.descriptorPool, nullptr);
+    }
+
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+void MeshletRenderer::requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+{
+    // Both paths keep the mesh's counter-clockwise winding; fragments are shaded by clustered.frag
+    if (features.meshShaders)
+    {
+        PipelineKey key {
+            .fragmentShader = "clustered.frag",
+            .taskShader     = "meshlet.task",
+            .meshShader     = "meshlet.mesh",
+            .specialization = ClusteredLighting::getSpecialization(),
+            .frontFace      = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .colorFormat    = colorFormat,
+            .depthFormat    = depthFormat,
+            .samples        = samples,
+            .layout         = pipelineLayout,
+        };
+
+        drawPipeline = pipelines.request(key);
+    }
+    else
+    {
+        PipelineKey key {
+            .vertexShader     = "meshlet.vert",
+            .fragmentShader   = "clustered.frag",
+            .specialization   = ClusteredLighting::getSpecialization(),
+            .vertexBindings   = {{0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX}},
+            .vertexAttributes = {
+                {0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(MeshVertex, position)},
+                {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(MeshVertex, normal)},
+            },
+            .frontFace        = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+            .colorFormat      = colorFormat,
+            .depthFormat      = depthFormat,
+            .samples          = samples,
+            .layout           = pipelineLayout,
+        };
+
+        drawPipeline = pipelines.request(key);
+    }
+}
+
+MeshletRenderer::MeshBindings &MeshletRenderer::getBindings(MeshHandle mesh)
+{
+    auto found = bindings.find(mesh);
+    if (found != bindings.end())
+    {
+        return found->second;
+    }
+
+    TRACE_ZONE("MeshletRenderer::getBindings");
+
+    const GpuMesh &gpuMesh = meshes.getMesh(mesh);
+    uint32_t bindingCount = features.meshShaders ? 4 : 5;
+
+    MeshBindings meshBindings {};
+
+    VkDescriptorPoolSize poolSize {
+        .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = bindingCount * framesInFlight,
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets       = framesInFlight,
+        .poolSizeCount = 1,
+        .pPoolSizes    = &poolSize,
+    };
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &meshBindings.descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create meshlet descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, descriptorSetLayout);
+    meshBindings.descriptorSets.resize(framesInFlight);
+
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = meshBindings.descriptorPool,
+        .descriptorSetCount = framesInFlight,
+        .pSetLayouts        = setLayouts.data(),
+    };
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, meshBindings.descriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate meshlet descriptor sets!");
+    }
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        VkDescriptorBufferInfo bufferInfos[5];
+
+        const MeshSection sections[] {MeshVertices, MeshMeshlets, MeshMeshletVertices, MeshMeshletTriangles};
+        for (uint32_t binding = 0; binding < 4; binding++)
+        {
+            bufferInfos[binding] = {
+                .buffer = gpuMesh.buffer,
+                .offset = gpuMesh.header.sections[sections[binding]].offset,
+                .range  = gpuMesh.header.sections[sections[binding]].size,
+            };
+        }
+
+        if (!features.meshShaders)
+        {
+            VkBuffer drawCommands;
+            uint32_t memoryType;
+            // Enough for the finest level of detail, which has the most meshlets
+            VkDeviceSize size = gpuMesh.header.lods[0].meshletCount * sizeof(VkDrawIndexedIndirectCommand);
+
+            VkBufferCreateInfo bufferInfo {
+                .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+                .size        = size,
+                .usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT,
+                .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+            };
+
+            if (vkCreateBuffer(device, &bufferInfo, nullptr, &drawCommands) != VK_SUCCESS)
+            {
+                throw std::runtime_error("Failed to create meshlet draw command buffer!");
+            }
+
+            VkMemoryRequirements memRequirements;
+            vkGetBufferMemoryRequirements(device, drawCommands, &memRequirements);
+
+            VkDeviceMemory drawCommandMemory =
+                memory.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryType);
+            vkBindBufferMemory(device, drawCommands, drawCommandMemory, 0);
+
+            meshBindings.drawCommands.push_back(drawCommands);
+            meshBindings.drawCommandMemory.push_back(drawCommandMemory);
+            meshBindings.drawCommandSizes.push_back(memRequirements.size);
+            meshBindings.drawCommandMemoryTypes.push_back(memoryType);
+
+            bufferInfos[4] = {
+                .buffer = drawCommands,
+                .offset = 0,
+                .range  = size,
+            };
+        }
+
+        std::vector<VkWriteDescriptorSet> writes;
+        for (uint32_t binding = 0; binding < bindingCount; binding++)
+        {
+            writes.push_back({
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = meshBindings.descriptorSets[frame],
+                .dstBinding      = binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo     = &bufferInfos[binding],
+            });
+        }
+
+        vkUpdateDescriptorSets(device, static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+    }
+
+    return bindings.emplace(mesh, std::move(meshBindings)).first->second;
+}
+
+bool MeshletRenderer::prepare(
+    VkCommandBuffer commandBuffer, uint32_t frameIndex, MeshHandle mesh, const Camera &camera, VkExtent2D extent)
+{
+    const GpuMesh &gpuMesh = meshes.getMesh(mesh);
+
+    if (!gpuMesh.ready || gpuMesh.header.meshletCount == 0 || pipelines.get(drawPipeline) == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    if (!features.meshShaders && pipelines.get(cullPipeline) == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("MeshletRenderer::prepare");
+
+    float aspect = (float)extent.width / (float)extent.height;
+
+    uint8_t level;
+    selectLods(gpuMesh.header, origin, makeLodView(camera, aspect, (float)extent.height), 0, 1, &level);
+
+    // Outside the frustum as a whole: nothing to cull, and draw() records nothing
+    const MeshLod &lod = gpuMesh.header.lods[level == LodCulled ? 0 : level];
+
+    preparedMesh = mesh;
+
+    constants = {
+        .viewProjection = camera.viewProjection(aspect),
+        .cameraPosition = {camera.position[0], camera.position[1], camera.position[2]},
+        .meshletCount   = level == LodCulled ? 0 : lod.meshletCount,
+        .firstMeshlet   = lod.firstMeshlet,
+    };
+
+    float distance = 0.0f;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        constants.boundsMin[axis] = gpuMesh.header.boundsMin[axis];
+        constants.boundsExtent[axis] = gpuMesh.header.boundsMax[axis] - gpuMesh.header.boundsMin[axis];
+
+        float offset = gpuMesh.header.boundsMin[axis] + constants.boundsExtent[axis] / 2 - camera.position[axis];
+        distance += offset * offset;
+    }
+
+    depthBucket = DrawList::depthBucket(std::sqrt(distance), camera.nearPlane, camera.farPlane);
+
+    if (constants.meshletCount == 0)
+    {
+        return true;
+    }
+
+    if (features.meshShaders)
+    {
+        getBindings(mesh);
+        return true;
+    }
+
+    MeshBindings &meshBindings = getBindings(mesh);
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelines.get(cullPipeline));
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &meshBindings.descriptorSets[frameIndex], 0,
+        nullptr);
+    vkCmdPushConstants(
+        commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants),
+        &constants);
+    vkCmdDispatch(commandBuffer, (constants.meshletCount + CullMeshletsPerWorkgroup - 1) / CullMeshletsPerWorkgroup, 1, 1);
+
+    VkBufferMemoryBarrier barrier {
+        .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .buffer              = meshBindings.drawCommands[frameIndex],
+        .offset              = 0,
+        .size                = VK_WHOLE_SIZE,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0, 0, nullptr, 1,
+        &barrier, 0, nullptr);
+
+    return true;
+}
+
+void MeshletRenderer::draw(DrawList &drawList, uint32_t frameIndex)
+{
+    TRACE_ZONE("MeshletRenderer::draw");
+
+    if (constants.meshletCount == 0)
+    {
+        return;
+    }
+
+    const GpuMesh &gpuMesh = meshes.getMesh(preparedMesh);
+    MeshBindings &meshBindings = getBindings(preparedMesh);
+
+    if (features.meshShaders)
+    {
+        DrawCommand command {
+            .type          = DrawType::DrawMeshTasks,
+            .pipeline      = pipelines.get(drawPipeline),
+            .layout        = pipelineLayout,
+            .descriptorSet = meshBindings.descriptorSets[frameIndex],
+            .lightingSet   = lighting.getDescriptorSet(frameIndex),
+            .count         = (constants.meshletCount + TaskMeshletsPerWorkgroup - 1) / TaskMeshletsPerWorkgroup,
+        };
+        command.setPushConstants(VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, constants);
+
+        drawList.add(DrawPassMain, depthBucket, command);
+        return;
+    }
+
+    DrawCommand command {
+        .type              = DrawType::DrawIndexedIndirect,
+        .pipeline          = pipelines.get(drawPipeline),
+        .layout            = pipelineLayout,
+        .lightingSet       = lighting.getDescriptorSet(frameIndex),
+        .vertexBufferCount = 1,
+        .vertexBuffers     = {gpuMesh.buffer},
+        .vertexOffsets     = {gpuMesh.header.sections[MeshVertices].offset},
+        .indexBuffer       = gpuMesh.buffer,
+        .indexOffset       = gpuMesh.header.sections[MeshIndices].offset,
+        .indexType         = gpuMesh.header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+        .indirectBuffer    = meshBindings.drawCommands[frameIndex],
+        .stride            = sizeof(VkDrawIndexedIndirectCommand),
+    };
+    command.setPushConstants(VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, constants);
+
+    // Culled meshlets still cost the command processor an empty draw, but no vertex work
+    for (uint32_t first = 0; first < constants.meshletCount; first += features.maxDrawIndirectCount)
+    {
+        command.indirectOffset = first * command.stride;
+        command.drawCount = std::min(constants.meshletCount - first, features.maxDrawIndirectCount);
+        drawList.add(DrawPassMain, depthBucket, command);
+    }
+}
+
+bool MeshletRenderer::drawShadows(DrawList &drawList, ShadowMaps &shadows)
+{
+    VkPipeline pipeline = shadows.getMeshPipeline();
+
+    if (pipeline == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("MeshletRenderer::drawShadows");
+
+    const GpuMesh &gpuMesh = meshes.getMesh(preparedMesh);
+    const MeshFileHeader &header = gpuMesh.header;
+
+    // Casters are drawn from the index section with the vertex pipeline: light space has no use for the meshlets'
+    // cones, and a handful of cascades for one mesh do not need culling
+    DrawCommand command {
+        .type              = DrawType::DrawIndexed,
+        .pipeline          = pipeline,
+        .layout            = shadows.getPipelineLayout(),
+        .vertexBufferCount = 1,
+        .vertexBuffers     = {gpuMesh.buffer},
+        .vertexOffsets     = {header.sections[MeshVertices].offset},
+        .indexBuffer       = gpuMesh.buffer,
+        .indexOffset       = header.sections[MeshIndices].offset,
+        .indexType         = header.indexSize == 2 ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32,
+        .instanceCount     = 1,
+    };
+
+    ShadowConstants shadowConstants {};
+    for (int axis = 0; axis < 3; axis++)
+    {
+        shadowConstants.boundsMin[axis] = constants.boundsMin[axis];
+        shadowConstants.boundsExtent[axis] = constants.boundsExtent[axis];
+    }
+
+    for (uint32_t cascade = 0; cascade < ShadowMaps::CascadeCount; cascade++)
+    {
+        if (!shadows.needsRender(cascade))
+        {
+            continue;
+        }
+
+        uint32_t level = 0;
+        while (level + 1 < header.lodCount && header.lods[level + 1].error <= shadows.getTexelSize(cascade))
+        {
+            level++;
+        }
+
+        shadowConstants.viewProjection = shadows.getViewProjection(cascade);
+        command.setPushConstants(VK_SHADER_STAGE_VERTEX_BIT, shadowConstants);
+        command.count = header.lods[level].indexCount;
+        command.first = header.lods[level].firstIndex;
+
+        drawList.add(static_cast<DrawPass>(DrawPassShadow0 + cascade), 0, command);
+    }
+
+    return true;
+}
@@ -0,0 +1,107 @@
+#ifndef MESHLET_RENDERER_H_
+#define MESHLET_RENDERER_H_
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Camera.h"
+#include "ClusteredLighting.h"
+#include "DrawList.h"
+#include "Lod.h"
+#include "MemoryBudget.h"
+#include "MeshManager.h"
+#include "PipelineManager.h"
+#include "ShadowMaps.h"
+
+// What the device offers to meshlet rendering, decided when the device is created
+struct MeshletFeatures
+{
+    // VK_EXT_mesh_shader, with task shaders
+    bool meshShaders;
+    // Draws per indirect draw call in the fallback: 1 without the multiDrawIndirect feature
+    uint32_t maxDrawIndirectCount;
+    // Without it, indirect draws start at instance 0 and meshlets cannot be told apart by color
+    bool drawIndirectFirstInstance;
+};
+
+// Push constants shared by the meshlet shaders, laid out as their block: 108 bytes
+struct MeshletConstants
+{
+    Mat4 viewProjection;
+    float cameraPosition[3];
+    // Meshlets of the selected level of detail
+    uint32_t meshletCount;
+    float boundsMin[3];
+    uint32_t firstMeshlet;
+    float boundsExtent[3];
+};
+
+// Draws meshes in the binary format meshlet by meshlet, at the coarsest level of detail whose error stays under a
+// pixel, dropping the meshlets outside the view frustum and those whose normal cone faces away from the camera. With
+// VK_EXT_mesh_shader a task shader culls and feeds the survivors to a mesh shader. Elsewhere, software drivers
+// included, a compute pass writes one indexed indirect draw per meshlet over the index section, left empty when the
+// meshlet is culled
+class MeshletRenderer
+{
+private:
+    struct MeshBindings
+    {
+        VkDescriptorPool descriptorPool;
+        // Per frame in flight: the fallback rewrites its draw commands every frame
+        std::vector<VkDescriptorSet> descriptorSets;
+        std::vector<VkBuffer> drawCommands;
+        std::vector<VkDeviceMemory> drawCommandMemory;
+        std::vector<VkDeviceSize> drawCommandSizes;
+        std::vector<uint32_t> drawCommandMemoryTypes;
+    };
+
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    MeshManager &meshes;
+    ClusteredLighting &lighting;
+    uint32_t framesInFlight;
+    MeshletFeatures features;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    PipelineHandle cullPipeline;
+    PipelineHandle drawPipeline;
+
+    std::unordered_map<MeshHandle, MeshBindings> bindings;
+
+    // The mesh drawn as is, as the one instance levels of detail are selected for
+    LodInstances origin;
+
+    // Recorded by prepare() for draw()
+    MeshHandle preparedMesh;
+    MeshletConstants constants;
+    uint32_t depthBucket;
+
+    MeshBindings &getBindings(MeshHandle mesh);
+
+public:
+    MeshletRenderer(VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, MeshManager &meshes,
+        ClusteredLighting &lighting, uint32_t framesInFlight, const MeshletFeatures &features);
+
+    // For the formats of the main pass; requested again whenever they change
+    void requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+
+    // Outside the render pass, where the fallback culls. False while the mesh uploads or the pipelines compile, in
+    // which case draw() must not be called
+    bool prepare(
+        VkCommandBuffer commandBuffer, uint32_t frameIndex, MeshHandle mesh, const Camera &camera, VkExtent2D extent);
+    // Adds the draws of the prepared mesh to the main pass, lit by the lights binned for this frame
+    void draw(DrawList &drawList, uint32_t frameIndex);
+    // After prepare(), for each cascade to render: adds the prepared mesh, whole and at the coarsest level of detail
+    // whose error stays within a texel, to its shadow pass. False while the shadow pipeline compiles, in which case
+    // nothing was added
+    bool drawShadows(DrawList &drawList, ShadowMaps &shadows);
+
+    ~MeshletRenderer();
+};
+
+#endif
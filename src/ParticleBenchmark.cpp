@@ -0,0 +1,88 @@
+#include <string>
+
+#include "FrameDrawer.h"
+#include "Logger.h"
+#include "ParticleBenchmark.h"
+#include "Trace.h"
+
+static const VkExtent2D BenchmarkSize {512, 512};
+
+// Frames measured once the pool is full, after warming up for the longest particle life
+static const uint32_t MeasuredFrames = 120;
+static const uint32_t FramesPerSecond = 60;
+
+struct ParticleTimings
+{
+    double simulateMilliseconds;
+    double drawMilliseconds;
+    double cpuMilliseconds;
+};
+
+void runParticleBenchmark(std::vector<uint32_t> capacities)
+{
+    if (capacities.empty())
+    {
+        capacities = {1u << 16, 1u << 18, 1u << 20, 1u << 22};
+    }
+
+    std::string name = "Particle benchmark";
+    FrameDrawer drawer(BenchmarkSize, name.data());
+    VulkanHandler *vulkan = drawer.vulkan;
+
+    vulkan->gpuProfiler->setEnabled(true);
+
+    for (uint32_t capacity : capacities)
+    {
+        drawer.showParticles(capacity);
+        vulkan->pipelines->waitIdle();
+
+        const ParticleEmitter &emitter = vulkan->particles->getEmitter();
+        uint32_t warmupFrames = static_cast<uint32_t>(emitter.lifetime * FramesPerSecond) + 1;
+
+        for (uint32_t frame = 0; frame < warmupFrames; frame++)
+        {
+            drawer.nextFrame();
+        }
+
+        ParticleTimings timings {0.0, 0.0, 0.0};
+        uint32_t gpuSamples = 0;
+
+        for (uint32_t frame = 0; frame < MeasuredFrames; frame++)
+        {
+            uint64_t start = Trace::now();
+            drawer.nextFrame();
+            timings.cpuMilliseconds += (Trace::now() - start) / 1e6;
+
+            // Results lag by the frames in flight, which is irrelevant for a mean
+            double simulateMilliseconds = vulkan->gpuProfiler->milliseconds("Particles");
+            double drawMilliseconds = vulkan->gpuProfiler->milliseconds("Main render pass");
+            if (simulateMilliseconds >= 0.0 && drawMilliseconds >= 0.0)
+            {
+                timings.simulateMilliseconds += simulateMilliseconds;
+                timings.drawMilliseconds += drawMilliseconds;
+                gpuSamples++;
+            }
+        }
+
+        drawer.finish();
+
+        timings.cpuMilliseconds /= MeasuredFrames;
+        if (gpuSamples > 0)
+        {
+            timings.simulateMilliseconds /= gpuSamples;
+            timings.drawMilliseconds /= gpuSamples;
+        }
+
+        // The emission rate keeps the pool about full: every particle of the capacity is simulated each frame
+        uint32_t particles = vulkan->particles->getCapacity();
+        double particlesPerMillisecond =
+            timings.simulateMilliseconds > 0.0 ? particles / timings.simulateMilliseconds : 0.0;
+
+        LOG_INFO(
+            "{:>8} particles: simulate {:.3f} ms ({:.0f} particles/ms), draw {:.3f} ms, cpu {:.3f} ms per frame",
+            particles, timings.simulateMilliseconds, particlesPerMillisecond, timings.drawMilliseconds,
+            timings.cpuMilliseconds);
+    }
+
+    Logger::instance().flush();
+}
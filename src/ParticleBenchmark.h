@@ -0,0 +1,12 @@
+#ifndef PARTICLE_BENCHMARK_H_
+#define PARTICLE_BENCHMARK_H_
+
+#include <cstdint>
+#include <vector>
+
+// Runs the particle fountain headless at each capacity, once its pool is full, and logs the GPU time of the
+// simulation, the particles simulated per millisecond, the GPU time of the render pass drawing them and the CPU time
+// of a frame. Without capacities, a default sweep up to a few million particles
+void runParticleBenchmark(std::vector<uint32_t> capacities);
+
+#endif
@@ -0,0 +1,417 @@
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "ParticleSystem.h"
+#include "Trace.h"
+
+// Workgroup size of particle_simulate.comp and particle_emit.comp
+const uint32_t ParticlesPerWorkgroup = 64;
+
+// Layout of a state buffer, as the State block of the particle shaders: the draw arguments, the simulation's dispatch
+// arguments and the particle count, then 32 bytes per particle
+const VkDeviceSize StateHeaderSize = 32;
+const VkDeviceSize StateDispatchOffset = sizeof(VkDrawIndirectCommand);
+const VkDeviceSize StateCountOffset = 28;
+const VkDeviceSize ParticleSize = 32;
+
+static void normalize(float v[3])
+{
+    float length = std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        v[axis] /= length;
+    }
+}
+
+static void cross(const float a[3], const float b[3], float result[3])
+{
+    result[0] = a[1] * b[2] - a[2] * b[1];
+    result[1] = a[2] * b[0] - a[0] * b[2];
+    result[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+// Every compute and draw command of the particles against every earlier one: they all touch both state buffers
+static void barrier(
+    VkCommandBuffer commandBuffer, VkPipelineStageFlags srcStages, VkAccessFlags srcAccess,
+    VkPipelineStageFlags dstStages, VkAccessFlags dstAccess)
+{
+    VkMemoryBarrier memoryBarrier {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+    };
+
+    vkCmdPipelineBarrier(commandBuffer, srcStages, dstStages, 0, 1, &memoryBarrier, 0, nullptr, 0, nullptr);
+}
+
+ParticleSystem::ParticleSystem(
+    VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, PipelineManager &pipelines,
+    uint32_t capacity)
+    : memory(memory), pipelines(pipelines)
+{
+    this->device = device;
+
+    simulatePipeline = nullptr;
+    emitPipeline = nullptr;
+    finishPipeline = nullptr;
+    drawPipeline = nullptr;
+
+    current = 0;
+    cleared = false;
+    emitDebt = 0.0f;
+    seed = 0;
+    constants = {};
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    uint64_t maxCapacity = std::min(
+        (properties.limits.maxStorageBufferRange - StateHeaderSize) / ParticleSize,
+        static_cast<uint64_t>(properties.limits.maxComputeWorkGroupCount[0]) * ParticlesPerWorkgroup);
+
+    if (capacity > maxCapacity)
+    {
+        LOG_WARNING("Particle capacity {} clamped to {}", capacity, maxCapacity);
+        capacity = static_cast<uint32_t>(maxCapacity);
+    }
+
+    this->capacity = std::max(capacity, 1u);
+
+    emitter = {
+        .position = {0.0f, 0.0f, 0.0f},
+        .speed    = 5.0f,
+        .lifetime = 2.0f,
+        .size     = 0.02f,
+    };
+
+    // A fountain kept full: particles live three quarters of the lifetime on average
+    emitter.rate = this->capacity / (0.75f * emitter.lifetime);
+
+    // The particles to simulate, then those simulated, both read as well by the draw
+    VkDescriptorSetLayoutBinding layoutBindings[2];
+    for (uint32_t binding = 0; binding < 2; binding++)
+    {
+        layoutBindings[binding] = {
+            .binding         = binding,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+            .descriptorCount = 1,
+            .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 2,
+        .pBindings    = layoutBindings,
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(ParticleConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle pipeline layout!");
+    }
+
+    VkDeviceSize size = StateHeaderSize + this->capacity * ParticleSize;
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        VkBufferCreateInfo bufferInfo {
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = size,
+            .usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                           VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &stateBuffers[i]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create particle buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, stateBuffers[i], &memRequirements);
+
+        stateMemory[i] = memory.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &stateMemoryTypes[i]);
+        stateMemorySizes[i] = memRequirements.size;
+        vkBindBufferMemory(device, stateBuffers[i], stateMemory[i], 0);
+    }
+
+    VkDescriptorPoolSize poolSize {
+        .type            = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .descriptorCount = 4,
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets       = 2,
+        .poolSizeCount = 1,
+        .pPoolSizes    = &poolSize,
+    };
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create particle descriptor pool!");
+    }
+
+    VkDescriptorSetLayout setLayouts[2] {descriptorSetLayout, descriptorSetLayout};
+
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = descriptorPool,
+        .descriptorSetCount = 2,
+        .pSetLayouts        = setLayouts,
+    };
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate particle descriptor sets!");
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        VkDescriptorBufferInfo bufferInfos[2] {
+            {
+                .buffer = stateBuffers[i],
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE,
+            },
+            {
+                .buffer = stateBuffers[1 - i],
+                .offset = 0,
+                .range  = VK_WHOLE_SIZE,
+            },
+        };
+
+        VkWriteDescriptorSet writes[2];
+        for (uint32_t binding = 0; binding < 2; binding++)
+        {
+            writes[binding] = {
+                .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet          = descriptorSets[i],
+                .dstBinding      = binding,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType  = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                .pBufferInfo     = &bufferInfos[binding],
+            };
+        }
+
+        vkUpdateDescriptorSets(device, 2, writes, 0, nullptr);
+    }
+
+    PipelineKey simulateKey {
+        .computeShader = "particle_simulate.comp",
+        .layout        = pipelineLayout,
+    };
+
+    PipelineKey emitKey {
+        .computeShader = "particle_emit.comp",
+        .layout        = pipelineLayout,
+    };
+
+    PipelineKey finishKey {
+        .computeShader = "particle_finish.comp",
+        .layout        = pipelineLayout,
+    };
+
+    simulatePipeline = pipelines.request(simulateKey);
+    emitPipeline = pipelines.request(emitKey);
+    finishPipeline = pipelines.request(finishKey);
+
+    LOG_INFO("Particles: up to {}, {} MiB of state", this->capacity, 2 * size / (1024 * 1024));
+}
+
+ParticleSystem::~ParticleSystem()
+{
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        vkDestroyBuffer(device, stateBuffers[i], nullptr);
+        memory.free(stateMemory[i], stateMemorySizes[i], stateMemoryTypes[i]);
+    }
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+}
+
+void ParticleSystem::requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+{
+    // Additive: the order particles are compacted in does not show. They are tested against the depth of the opaque
+    // draws, but do not hide each other
+    PipelineKey key {
+        .vertexShader        = "particle.vert",
+        .fragmentShader      = "particle.frag",
+        .topology            = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+        .cullMode            = VK_CULL_MODE_NONE,
+        .blendEnable         = VK_TRUE,
+        .srcColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .dstColorBlendFactor = VK_BLEND_FACTOR_ONE,
+        .srcAlphaBlendFactor = VK_BLEND_FACTOR_ZERO,
+        .dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE,
+        .depthWriteEnable    = VK_FALSE,
+        .colorFormat         = colorFormat,
+        .depthFormat         = depthFormat,
+        .samples             = samples,
+        .layout              = pipelineLayout,
+    };
+
+    drawPipeline = pipelines.request(key);
+}
+
+uint32_t ParticleSystem::getCapacity() const
+{
+    return capacity;
+}
+
+const ParticleEmitter &ParticleSystem::getEmitter() const
+{
+    return emitter;
+}
+
+void ParticleSystem::setEmitter(const ParticleEmitter &emitter)
+{
+    this->emitter = emitter;
+}
+
+bool ParticleSystem::prepare(VkCommandBuffer commandBuffer, const Camera &camera, VkExtent2D extent, float deltaTime)
+{
+    VkPipeline simulate = pipelines.get(simulatePipeline);
+    VkPipeline emit = pipelines.get(emitPipeline);
+    VkPipeline finish = pipelines.get(finishPipeline);
+
+    if (simulate == VK_NULL_HANDLE || emit == VK_NULL_HANDLE || finish == VK_NULL_HANDLE ||
+        pipelines.get(drawPipeline) == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("ParticleSystem::prepare");
+
+    float aspect = (float)extent.width / (float)extent.height;
+
+    float forward[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        forward[axis] = camera.target[axis] - camera.position[axis];
+    }
+    normalize(forward);
+
+    constants.viewProjection = camera.viewProjection(aspect);
+    cross(forward, camera.up, constants.cameraRight);
+    normalize(constants.cameraRight);
+    cross(constants.cameraRight, forward, constants.cameraUp);
+
+    emitDebt += emitter.rate * deltaTime;
+    uint32_t emitCount = static_cast<uint32_t>(std::min(emitDebt, static_cast<float>(capacity)));
+    emitDebt = std::min(emitDebt - emitCount, 1.0f);
+
+    constants.deltaTime = deltaTime;
+    constants.emitCount = emitCount;
+    std::copy(emitter.position, emitter.position + 3, constants.emitterPosition);
+    constants.seed = seed++;
+    constants.particleSize = emitter.size;
+    constants.capacity = capacity;
+    constants.speed = emitter.speed;
+    constants.lifetime = emitter.lifetime;
+
+    uint32_t source = current;
+    VkBuffer target = stateBuffers[1 - source];
+
+    // The buffer about to be written was last read by the previous frame's simulation, and drawn the frame before
+    barrier(
+        commandBuffer,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0, VK_PIPELINE_STAGE_TRANSFER_BIT, 0);
+
+    // Nothing alive at first: a zero dispatch, and a zero draw should the first frame be drawn from it
+    if (!cleared)
+    {
+        vkCmdFillBuffer(commandBuffer, stateBuffers[source], 0, StateHeaderSize, 0);
+        cleared = true;
+    }
+
+    vkCmdFillBuffer(commandBuffer, target, StateCountOffset, sizeof(uint32_t), 0);
+
+    barrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &descriptorSets[source], 0, nullptr);
+    vkCmdPushConstants(
+        commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(constants),
+        &constants);
+
+    // Survivors first, so that newborn particles are the ones dropped when the pool is full
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, simulate);
+    vkCmdDispatchIndirect(commandBuffer, stateBuffers[source], StateDispatchOffset);
+
+    barrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+
+    if (emitCount > 0)
+    {
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, emit);
+        vkCmdDispatch(commandBuffer, (emitCount + ParticlesPerWorkgroup - 1) / ParticlesPerWorkgroup, 1, 1);
+
+        barrier(
+            commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+            VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, finish);
+    vkCmdDispatch(commandBuffer, 1, 1, 1);
+
+    // For this frame's draw, and the next frame's simulation
+    barrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT);
+
+    current = 1 - source;
+
+    return true;
+}
+
+void ParticleSystem::draw(DrawList &drawList)
+{
+    TRACE_ZONE("ParticleSystem::draw");
+
+    DrawCommand command {
+        .type           = DrawType::DrawIndirect,
+        .pipeline       = pipelines.get(drawPipeline),
+        .layout         = pipelineLayout,
+        // The set writing to the current buffer, which the vertex shader reads as well
+        .descriptorSet  = descriptorSets[1 - current],
+        .indirectBuffer = stateBuffers[current],
+        .indirectOffset = 0,
+        .drawCount      = 1,
+        .stride         = sizeof(VkDrawIndirectCommand),
+    };
+    command.setPushConstants(VK_SHADER_STAGE_COMPUTE_BIT | VK_SHADER_STAGE_VERTEX_BIT, constants);
+
+    drawList.add(DrawPassTransparent, 0, command);
+}
@@ -0,0 +1,102 @@
+#ifndef PARTICLE_SYSTEM_H_
+#define PARTICLE_SYSTEM_H_
+
+#include <cstdint>
+
+#include <vulkan/vulkan.h>
+
+#include "Camera.h"
+#include "DrawList.h"
+#include "MemoryBudget.h"
+#include "PipelineManager.h"
+
+// Where and how fast particles are born; they then fall under gravity and bounce on the emitter's plane
+struct ParticleEmitter
+{
+    float position[3];
+    // Particles per second, dropped while the pool is full
+    float rate;
+    float speed;
+    // Longest life in seconds; each particle lives between half of it and all of it
+    float lifetime;
+    // Largest half side of a particle's quad
+    float size;
+};
+
+// Push constants shared by the particle shaders, laid out as their block: 128 bytes, the most every device allows
+struct ParticleConstants
+{
+    Mat4 viewProjection;
+    float cameraRight[3];
+    float deltaTime;
+    float cameraUp[3];
+    uint32_t emitCount;
+    float emitterPosition[3];
+    uint32_t seed;
+    float particleSize;
+    uint32_t capacity;
+    float speed;
+    float lifetime;
+};
+
+// Particles living entirely on the GPU. Their state is double buffered: every frame a compute pass moves the live
+// particles of one buffer, appending the survivors to the other, a second one appends the newborn, and a last one
+// turns the count into the arguments of the next frame's simulation dispatch and of this frame's draw, an indirect
+// draw of one camera-facing quad per particle. The CPU records the same few commands whatever the particle count,
+// and never reads it back
+class ParticleSystem
+{
+private:
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    uint32_t capacity;
+    ParticleEmitter emitter;
+
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    PipelineHandle simulatePipeline;
+    PipelineHandle emitPipeline;
+    PipelineHandle finishPipeline;
+    PipelineHandle drawPipeline;
+
+    // Draw and dispatch arguments then particles, read by set i and written by set 1 - i
+    VkBuffer stateBuffers[2];
+    VkDeviceMemory stateMemory[2];
+    VkDeviceSize stateMemorySizes[2];
+    uint32_t stateMemoryTypes[2];
+    VkDescriptorSet descriptorSets[2];
+    // The buffer holding the live particles, drawn this frame and simulated next
+    uint32_t current;
+    bool cleared;
+
+    // Newborn particles owed by fractions of a particle per frame
+    float emitDebt;
+    uint32_t seed;
+
+    // Recorded by prepare() for draw()
+    ParticleConstants constants;
+
+public:
+    // Capacity is clamped to what a storage buffer and a dispatch can hold
+    ParticleSystem(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, PipelineManager &pipelines,
+        uint32_t capacity);
+
+    // For the formats of the main pass; requested again whenever they change
+    void requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+
+    uint32_t getCapacity() const;
+    const ParticleEmitter &getEmitter() const;
+    void setEmitter(const ParticleEmitter &emitter);
+
+    // Outside the render pass: steps the simulation by deltaTime seconds. False while the pipelines compile, in which
+    // case draw() must not be called
+    bool prepare(VkCommandBuffer commandBuffer, const Camera &camera, VkExtent2D extent, float deltaTime);
+    // Adds the particles to the transparent pass
+    void draw(DrawList &drawList);
+
+    ~ParticleSystem();
+};
+
+#endif
@@ -0,0 +1,517 @@
+#include <stdexcept>
+
+#include "Logger.h"
+#include "PipelineManager.h"
+
+static void hashCombine(size_t &seed, size_t value)
+{
+    seed ^= value + 0x9e3779b97f4a7c15ull + (seed << 6) + (seed >> 2);
+}
+
+size_t PipelineKeyHash::operator()(const PipelineKey &key) const
+{
+    size_t seed = 0;
+
+    hashCombine(seed, std::hash<std::string>()(key.vertexShader));
+    hashCombine(seed, std::hash<std::string>()(key.fragmentShader));
+    hashCombine(seed, std::hash<std::string>()(key.taskShader));
+    hashCombine(seed, std::hash<std::string>()(key.meshShader));
+    hashCombine(seed, std::hash<std::string>()(key.computeShader));
+
+    for (const auto &constant : key.specialization)
+    {
+        hashCombine(seed, constant.constantId);
+        hashCombine(seed, constant.value);
+    }
+
+    for (const auto &binding : key.vertexBindings)
+    {
+        hashCombine(seed, binding.binding);
+        hashCombine(seed, binding.stride);
+        hashCombine(seed, binding.inputRate);
+    }
+
+    for (const auto &attribute : key.vertexAttributes)
+    {
+        hashCombine(seed, attribute.location);
+        hashCombine(seed, attribute.binding);
+        hashCombine(seed, attribute.format);
+        hashCombine(seed, attribute.offset);
+    }
+
+    hashCombine(seed, key.topology);
+    hashCombine(seed, key.polygonMode);
+    hashCombine(seed, key.cullMode);
+    hashCombine(seed, key.frontFace);
+    hashCombine(seed, key.depthBiasEnable);
+    hashCombine(seed, std::hash<float>()(key.depthBiasConstantFactor));
+    hashCombine(seed, std::hash<float>()(key.depthBiasSlopeFactor));
+    hashCombine(seed, key.blendEnable);
+    hashCombine(seed, key.srcColorBlendFactor);
+    hashCombine(seed, key.dstColorBlendFactor);
+    hashCombine(seed, key.colorBlendOp);
+    hashCombine(seed, key.srcAlphaBlendFactor);
+    hashCombine(seed, key.dstAlphaBlendFactor);
+    hashCombine(seed, key.alphaBlendOp);
+    hashCombine(seed, key.depthTestEnable);
+    hashCombine(seed, key.depthWriteEnable);
+    hashCombine(seed, key.depthCompareOp);
+    hashCombine(seed, key.colorFormat);
+    hashCombine(seed, key.depthFormat);
+    hashCombine(seed, key.samples);
+    hashCombine(seed, std::hash<VkPipelineLayout>()(key.layout));
+
+    return seed;
+}
+
+PipelineManager::PipelineManager(VkDevice device, ShaderLibrary &shaders, uint32_t workerCount, uint32_t framesInFlight)
+    : shaders(shaders), workers(workerCount)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+    frameNumber = 0;
+
+    VkPipelineCacheCreateInfo cacheInfo {
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO,
+    };
+
+    if (vkCreatePipelineCache(device, &cacheInfo, nullptr, &pipelineCache) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create pipeline cache!");
+    }
+}
+
+PipelineManager::~PipelineManager()
+{
+    workers.waitIdle();
+
+    for (auto &[key, entry] : entries)
+    {
+        VkPipeline pipeline = entry->pipeline.load();
+        if (pipeline != VK_NULL_HANDLE)
+        {
+            vkDestroyPipeline(device, pipeline, nullptr);
+        }
+    }
+
+    for (auto &[entry, pipeline] : finishedReloads)
+    {
+        vkDestroyPipeline(device, pipeline, nullptr);
+    }
+
+    for (auto &retired : retiredPipelines)
+    {
+        vkDestroyPipeline(device, retired.pipeline, nullptr);
+    }
+
+    vkDestroyPipelineCache(device, pipelineCache, nullptr);
+}
+
+void PipelineManager::registerRenderPass(
+    VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkRenderPass renderPass)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    for (auto &target : renderTargets)
+    {
+        if (target.colorFormat == colorFormat && target.depthFormat == depthFormat && target.samples == samples)
+        {
+            target.renderPass = renderPass;
+            return;
+        }
+    }
+
+    renderTargets.push_back({colorFormat, depthFormat, samples, renderPass});
+}
+
+VkRenderPass PipelineManager::findRenderPass(const PipelineKey &key)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    for (const auto &target : renderTargets)
+    {
+        if (target.colorFormat == key.colorFormat && target.depthFormat == key.depthFormat && target.samples == key.samples)
+        {
+            return target.renderPass;
+        }
+    }
+
+    throw std::runtime_error("No render pass registered for the requested pipeline formats!");
+}
+
+PipelineHandle PipelineManager::request(const PipelineKey &key)
+{
+    PipelineEntry *entry;
+
+    {
+        std::lock_guard<std::mutex> lock(entriesMutex);
+
+        auto found = entries.find(key);
+        if (found != entries.end())
+        {
+            return found->second.get();
+        }
+
+        entry = entries.emplace(key, std::make_unique<PipelineEntry>()).first->second.get();
+    }
+
+    workers.submit([this, key, entry] {
+        try
+        {
+            entry->pipeline.store(compile(key));
+            entry->state.store(PipelineState::Ready, std::memory_order_release);
+        }
+        catch (const std::exception &e)
+        {
+            LOG_ERROR("Pipeline compilation failed: {}", e.what());
+            entry->state.store(PipelineState::Failed, std::memory_order_release);
+        }
+    });
+
+    return entry;
+}
+
+PipelineState PipelineManager::state(PipelineHandle handle) const
+{
+    return handle->state.load(std::memory_order_acquire);
+}
+
+VkPipeline PipelineManager::get(PipelineHandle handle) const
+{
+    if (handle == nullptr || handle->state.load(std::memory_order_acquire) != PipelineState::Ready)
+    {
+        return VK_NULL_HANDLE;
+    }
+
+    return handle->pipeline.load(std::memory_order_relaxed);
+}
+
+VkPipeline PipelineManager::get(PipelineHandle handle, PipelineHandle fallback) const
+{
+    VkPipeline pipeline = get(handle);
+    return pipeline != VK_NULL_HANDLE ? pipeline : get(fallback);
+}
+
+void PipelineManager::reload(const std::string &shaderName)
+{
+    std::lock_guard<std::mutex> lock(entriesMutex);
+
+    for (auto &[key, entry] : entries)
+    {
+        bool usesShader = key.vertexShader == shaderName || key.fragmentShader == shaderName ||
+            key.taskShader == shaderName || key.meshShader == shaderName || key.computeShader == shaderName;
+
+        if (!usesShader)
+        {
+            continue;
+        }
+
+        workers.submit([this, key = key, entry = entry.get()] {
+            try
+            {
+                VkPipeline pipeline = compile(key);
+
+                std::lock_guard<std::mutex> lock(reloadsMutex);
+                finishedReloads.push_back({entry, pipeline});
+            }
+            catch (const std::exception &e)
+            {
+                // Keep using the previous pipeline until the shader is fixed
+                LOG_ERROR("Pipeline reload failed: {}", e.what());
+            }
+        });
+    }
+}
+
+void PipelineManager::commitReloads()
+{
+    frameNumber++;
+
+    std::vector<std::pair<PipelineEntry *, VkPipeline>> reloads;
+
+    {
+        std::lock_guard<std::mutex> lock(reloadsMutex);
+
+        // Initial compilations still running would overwrite a swapped pipeline: keep those for a later frame
+        for (auto it = finishedReloads.begin(); it != finishedReloads.end();)
+        {
+            if (it->first->state.load(std::memory_order_acquire) == PipelineState::Pending)
+            {
+                it++;
+                continue;
+            }
+
+            reloads.push_back(*it);
+            it = finishedReloads.erase(it);
+        }
+    }
+
+    for (auto &[entry, pipeline] : reloads)
+    {
+        VkPipeline old = entry->pipeline.exchange(pipeline);
+        entry->state.store(PipelineState::Ready, std::memory_order_release);
+
+        if (old != VK_NULL_HANDLE)
+        {
+            retiredPipelines.push_back({old, frameNumber});
+        }
+    }
+
+    while (!retiredPipelines.empty() && retiredPipelines.front().retiredAt + framesInFlight < frameNumber)
+    {
+        vkDestroyPipeline(device, retiredPipelines.front().pipeline, nullptr);
+        retiredPipelines.erase(retiredPipelines.begin());
+    }
+}
+
+void PipelineManager::waitIdle()
+{
+    workers.waitIdle();
+}
+
+VkShaderModule PipelineManager::createShaderModule(const std::string &name)
+{
+    SpirvCode code = shaders.get(name);
+
+    VkShaderModuleCreateInfo createInfo {
+        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
+        .codeSize = code.wordCount * sizeof(uint32_t),
+        .pCode    = code.code,
+    };
+
+    VkShaderModule shaderModule;
+    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shader module!");
+    }
+
+    return shaderModule;
+}
+
+VkPipeline PipelineManager::compile(const PipelineKey &key)
+{
+    std::vector<VkSpecializationMapEntry> specializationEntries;
+    for (uint32_t i = 0; i < key.specialization.size(); i++)
+    {
+        specializationEntries.push_back({key.specialization[i].constantId, i * (uint32_t)sizeof(uint32_t), sizeof(uint32_t)});
+    }
+
+    std::vector<uint32_t> specializationData;
+    for (const auto &constant : key.specialization)
+    {
+        specializationData.push_back(constant.value);
+    }
+
+    VkSpecializationInfo specializationInfo {
+        .mapEntryCount = static_cast<uint32_t>(specializationEntries.size()),
+        .pMapEntries   = specializationEntries.data(),
+        .dataSize      = specializationData.size() * sizeof(uint32_t),
+        .pData         = specializationData.data(),
+    };
+
+    const VkSpecializationInfo *pSpecializationInfo = key.specialization.empty() ? nullptr : &specializationInfo;
+
+    if (!key.computeShader.empty())
+    {
+        return compileCompute(key, pSpecializationInfo);
+    }
+
+    VkRenderPass renderPass = findRenderPass(key);
+
+    // Task, mesh or vertex, then fragment unless depth-only
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+
+    auto addStage = [&](VkShaderStageFlagBits stage, const std::string &name) {
+        shaderStages.push_back({
+            .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage               = stage,
+            .module              = createShaderModule(name),
+            .pName               = "main",
+            .pSpecializationInfo = pSpecializationInfo,
+        });
+    };
+
+    bool meshPipeline = !key.meshShader.empty();
+
+    try
+    {
+        if (meshPipeline)
+        {
+            if (!key.taskShader.empty())
+            {
+                addStage(VK_SHADER_STAGE_TASK_BIT_EXT, key.taskShader);
+            }
+            addStage(VK_SHADER_STAGE_MESH_BIT_EXT, key.meshShader);
+        }
+        else
+        {
+            addStage(VK_SHADER_STAGE_VERTEX_BIT, key.vertexShader);
+        }
+        if (!key.fragmentShader.empty())
+        {
+            addStage(VK_SHADER_STAGE_FRAGMENT_BIT, key.fragmentShader);
+        }
+    }
+    catch (...)
+    {
+        for (const auto &stage : shaderStages)
+        {
+            vkDestroyShaderModule(device, stage.module, nullptr);
+        }
+        throw;
+    }
+
+    std::vector<VkVertexInputBindingDescription> bindings;
+    for (const auto &binding : key.vertexBindings)
+    {
+        bindings.push_back({binding.binding, binding.stride, binding.inputRate});
+    }
+
+    std::vector<VkVertexInputAttributeDescription> attributes;
+    for (const auto &attribute : key.vertexAttributes)
+    {
+        attributes.push_back({attribute.location, attribute.binding, attribute.format, attribute.offset});
+    }
+
+    VkPipelineVertexInputStateCreateInfo vertexInputInfo {
+        .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
+        .vertexBindingDescriptionCount   = static_cast<uint32_t>(bindings.size()),
+        .pVertexBindingDescriptions      = bindings.data(),
+        .vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size()),
+        .pVertexAttributeDescriptions    = attributes.data(),
+    };
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
+        .topology               = key.topology,
+        .primitiveRestartEnable = VK_FALSE,
+    };
+
+    VkPipelineViewportStateCreateInfo viewportState {
+        .sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
+        .viewportCount = 1,
+        .scissorCount  = 1,
+    };
+
+    VkPipelineRasterizationStateCreateInfo rasterizer {
+        .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
+        .depthClampEnable        = VK_FALSE,
+        .rasterizerDiscardEnable = VK_FALSE,
+        .polygonMode             = key.polygonMode,
+        .cullMode                = key.cullMode,
+        .frontFace               = key.frontFace,
+        .depthBiasEnable         = key.depthBiasEnable,
+        .depthBiasConstantFactor = key.depthBiasConstantFactor,
+        .depthBiasClamp          = 0.0f,
+        .depthBiasSlopeFactor    = key.depthBiasSlopeFactor,
+        .lineWidth               = 1.0f,
+    };
+
+    VkPipelineMultisampleStateCreateInfo multisampling {
+        .sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
+        .rasterizationSamples = key.samples,
+        .sampleShadingEnable  = VK_FALSE,
+    };
+
+    VkPipelineColorBlendAttachmentState colorBlendAttachment {
+        .blendEnable         = key.blendEnable,
+        .srcColorBlendFactor = key.srcColorBlendFactor,
+        .dstColorBlendFactor = key.dstColorBlendFactor,
+        .colorBlendOp        = key.colorBlendOp,
+        .srcAlphaBlendFactor = key.srcAlphaBlendFactor,
+        .dstAlphaBlendFactor = key.dstAlphaBlendFactor,
+        .alphaBlendOp        = key.alphaBlendOp,
+        .colorWriteMask      = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
+    };
+
+    VkPipelineColorBlendStateCreateInfo colorBlending {
+        .sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
+        .logicOpEnable   = VK_FALSE,
+        .logicOp         = VK_LOGIC_OP_COPY,
+        .attachmentCount = key.colorFormat == VK_FORMAT_UNDEFINED ? 0u : 1u,
+        .pAttachments    = &colorBlendAttachment,
+        .blendConstants  = {0.0f, 0.0f, 0.0f, 0.0f},
+    };
+
+    VkDynamicState dynamicStates[] {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+
+    VkPipelineDynamicStateCreateInfo dynamicState {
+        .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
+        .dynamicStateCount = 2,
+        .pDynamicStates    = dynamicStates,
+    };
+
+    VkPipelineDepthStencilStateCreateInfo depthStencil {
+        .sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
+        .depthTestEnable       = key.depthTestEnable,
+        .depthWriteEnable      = key.depthWriteEnable,
+        .depthCompareOp        = key.depthCompareOp,
+        .depthBoundsTestEnable = VK_FALSE,
+        .stencilTestEnable     = VK_FALSE,
+    };
+
+    VkGraphicsPipelineCreateInfo pipelineInfo {
+        .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext               = nullptr,
+        .flags               = 0,
+        .stageCount          = static_cast<uint32_t>(shaderStages.size()),
+        .pStages             = shaderStages.data(),
+        .pVertexInputState   = meshPipeline ? nullptr : &vertexInputInfo,
+        .pInputAssemblyState = meshPipeline ? nullptr : &inputAssembly,
+        .pTessellationState  = nullptr,
+        .pViewportState      = &viewportState,
+        .pRasterizationState = &rasterizer,
+        .pMultisampleState   = &multisampling,
+        .pDepthStencilState  = &depthStencil,
+        .pColorBlendState    = &colorBlending,
+        .pDynamicState       = &dynamicState,
+        .layout              = key.layout,
+        .renderPass          = renderPass,
+        .subpass             = 0,
+        .basePipelineHandle  = VK_NULL_HANDLE,
+    };
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateGraphicsPipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+
+    for (const auto &stage : shaderStages)
+    {
+        vkDestroyShaderModule(device, stage.module, nullptr);
+    }
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create graphics pipeline!");
+    }
+
+    return pipeline;
+}
+
+VkPipeline PipelineManager::compileCompute(const PipelineKey &key, const VkSpecializationInfo *specializationInfo)
+{
+    VkShaderModule computeShaderModule = createShaderModule(key.computeShader);
+
+    VkComputePipelineCreateInfo pipelineInfo {
+        .sType  = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage {
+            .sType               = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+            .stage               = VK_SHADER_STAGE_COMPUTE_BIT,
+            .module              = computeShaderModule,
+            .pName               = "main",
+            .pSpecializationInfo = specializationInfo,
+        },
+        .layout = key.layout,
+    };
+
+    VkPipeline pipeline;
+    VkResult result = vkCreateComputePipelines(device, pipelineCache, 1, &pipelineInfo, nullptr, &pipeline);
+
+    vkDestroyShaderModule(device, computeShaderModule, nullptr);
+
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create compute pipeline!");
+    }
+
+    return pipeline;
+}
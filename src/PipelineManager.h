@@ -0,0 +1,163 @@
+#ifndef PIPELINE_MANAGER_H_
+#define PIPELINE_MANAGER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "ShaderLibrary.h"
+#include "ThreadPool.h"
+
+struct VertexBinding
+{
+    uint32_t binding;
+    uint32_t stride;
+    VkVertexInputRate inputRate;
+
+    bool operator==(const VertexBinding &) const = default;
+};
+
+struct VertexAttribute
+{
+    uint32_t location;
+    uint32_t binding;
+    VkFormat format;
+    uint32_t offset;
+
+    bool operator==(const VertexAttribute &) const = default;
+};
+
+// Value for a `layout(constant_id = ...)` constant, applied to every stage declaring it
+struct SpecializationConstant
+{
+    uint32_t constantId;
+    uint32_t value;
+
+    bool operator==(const SpecializationConstant &) const = default;
+};
+
+// Everything that makes two pipelines different: requesting the same key twice yields the same pipeline. Graphics
+// pipelines use either a vertex shader or a mesh shader (with an optional task shader, and no vertex input state);
+// depth-only ones leave the fragment shader and the color format empty. A key with a compute shader describes a
+// compute pipeline, for which only specialization and layout matter
+struct PipelineKey
+{
+    std::string vertexShader;
+    std::string fragmentShader;
+    std::string taskShader;
+    std::string meshShader;
+    std::string computeShader;
+    std::vector<SpecializationConstant> specialization;
+
+    std::vector<VertexBinding> vertexBindings;
+    std::vector<VertexAttribute> vertexAttributes;
+    VkPrimitiveTopology topology     = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    VkPolygonMode polygonMode        = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode         = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace            = VK_FRONT_FACE_CLOCKWISE;
+    // Constant and slope-scaled, as rasterized depth offsets: for shadow maps
+    VkBool32 depthBiasEnable         = VK_FALSE;
+    float depthBiasConstantFactor    = 0.0f;
+    float depthBiasSlopeFactor       = 0.0f;
+
+    VkBool32 blendEnable             = VK_FALSE;
+    VkBlendFactor srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp colorBlendOp           = VK_BLEND_OP_ADD;
+    VkBlendFactor srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    VkBlendFactor dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    VkBlendOp alphaBlendOp           = VK_BLEND_OP_ADD;
+
+    VkBool32 depthTestEnable         = VK_TRUE;
+    VkBool32 depthWriteEnable        = VK_TRUE;
+    VkCompareOp depthCompareOp       = VK_COMPARE_OP_LESS;
+
+    VkFormat colorFormat             = VK_FORMAT_UNDEFINED;
+    VkFormat depthFormat             = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits samples    = VK_SAMPLE_COUNT_1_BIT;
+
+    VkPipelineLayout layout          = VK_NULL_HANDLE;
+
+    bool operator==(const PipelineKey &) const = default;
+};
+
+struct PipelineKeyHash
+{
+    size_t operator()(const PipelineKey &key) const;
+};
+
+enum class PipelineState { Pending, Ready, Failed };
+
+struct PipelineEntry
+{
+    std::atomic<VkPipeline> pipeline {VK_NULL_HANDLE};
+    std::atomic<PipelineState> state {PipelineState::Pending};
+};
+
+// Reference to a pipeline that may still be compiling; stays valid for the lifetime of the manager
+typedef const PipelineEntry *PipelineHandle;
+
+class PipelineManager
+{
+private:
+    struct RenderTarget
+    {
+        VkFormat colorFormat;
+        VkFormat depthFormat;
+        VkSampleCountFlagBits samples;
+        VkRenderPass renderPass;
+    };
+
+    struct RetiredPipeline
+    {
+        VkPipeline pipeline;
+        uint64_t retiredAt;
+    };
+
+    VkDevice device;
+    VkPipelineCache pipelineCache;
+    ShaderLibrary &shaders;
+    ThreadPool workers;
+    uint32_t framesInFlight;
+    uint64_t frameNumber;
+
+    std::mutex entriesMutex;
+    std::unordered_map<PipelineKey, std::unique_ptr<PipelineEntry>, PipelineKeyHash> entries;
+    std::vector<RenderTarget> renderTargets;
+
+    std::mutex reloadsMutex;
+    std::vector<std::pair<PipelineEntry *, VkPipeline>> finishedReloads;
+    std::vector<RetiredPipeline> retiredPipelines;
+
+    VkRenderPass findRenderPass(const PipelineKey &key);
+    VkShaderModule createShaderModule(const std::string &name);
+    VkPipeline compile(const PipelineKey &key);
+    VkPipeline compileCompute(const PipelineKey &key, const VkSpecializationInfo *specializationInfo);
+
+public:
+    PipelineManager(VkDevice device, ShaderLibrary &shaders, uint32_t workerCount, uint32_t framesInFlight);
+
+    void registerRenderPass(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples, VkRenderPass renderPass);
+
+    PipelineHandle request(const PipelineKey &key);
+    PipelineState state(PipelineHandle handle) const;
+    VkPipeline get(PipelineHandle handle) const;
+    VkPipeline get(PipelineHandle handle, PipelineHandle fallback) const;
+
+    // Recompiles every pipeline using the shader off-thread; results are swapped in by commitReloads()
+    void reload(const std::string &shaderName);
+    // To be called once per frame at a frame boundary; old pipelines are destroyed once no frame in flight uses them
+    void commitReloads();
+
+    void waitIdle();
+
+    ~PipelineManager();
+};
+
+#endif
@@ -0,0 +1,652 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "PostProcessor.h"
+#include "Trace.h"
+
+// Tone mapped images, storable by every device
+const VkFormat LdrFormat = VK_FORMAT_R8G8B8A8_UNORM;
+
+// Workgroup tile of every post-processing shader
+const uint32_t PostTileSize = 8;
+
+static const char *EffectNames[PostEffectCount] = {"bloom", "tonemap", "fxaa"};
+
+// Whatever was last written by compute shaders, before the next dispatch reads or overwrites it
+static void computeBarrier(VkCommandBuffer commandBuffer)
+{
+    VkMemoryBarrier barrier {
+        .sType         = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &barrier, 0,
+        nullptr, 0, nullptr);
+}
+
+static uint32_t groupCount(uint32_t size)
+{
+    return (size + PostTileSize - 1) / PostTileSize;
+}
+
+PostProcessor::PostProcessor(
+    VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, VkExtent2D extent, bool subgroupQuad)
+    : memory(memory), pipelines(pipelines)
+{
+    this->device = device;
+    this->extent = extent;
+
+    std::fill(enabled, enabled + PostEffectCount, true);
+    exposure = 1.0f;
+    bloomThreshold = 1.0f;
+    bloomIntensity = 0.5f;
+
+    VkSamplerCreateInfo samplerInfo {
+        .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter    = VK_FILTER_LINEAR,
+        .minFilter    = VK_FILTER_LINEAR,
+        .mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod       = 0.0f,
+    };
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing sampler!");
+    }
+
+    // Two sampled sources, then two storage targets: each shader uses the ones it needs
+    VkDescriptorSetLayoutBinding layoutBindings[4];
+    for (uint32_t binding = 0; binding < 4; binding++)
+    {
+        layoutBindings[binding] = {
+            .binding         = binding,
+            .descriptorType  = binding < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 1,
+            .stageFlags      = VK_SHADER_STAGE_COMPUTE_BIT,
+        };
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 4,
+        .pBindings    = layoutBindings,
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_COMPUTE_BIT,
+        .offset     = 0,
+        .size       = sizeof(PostConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing pipeline layout!");
+    }
+
+    scene = createTarget(
+        SceneFormat,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+    ldr = createTarget(LdrFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT);
+    output = createTarget(LdrFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT);
+
+    VkExtent2D size = extent;
+    for (uint32_t level = 0; level < BloomLevels; level++)
+    {
+        size = {std::max(size.width / 2, 1u), std::max(size.height / 2, 1u)};
+        bloomSizes[level] = size;
+    }
+
+    createImage(
+        bloomSizes[0], BloomLevels, SceneFormat, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, bloomImage,
+        bloomMemory, bloomMemorySize, bloomMemoryType);
+
+    for (uint32_t level = 0; level < BloomLevels; level++)
+    {
+        bloomViews[level] = createImageView(bloomImage, SceneFormat, level);
+    }
+
+    createDescriptorSets();
+
+    PipelineKey downsampleKey {
+        .computeShader = subgroupQuad ? "bloom_downsample_subgroup.comp" : "bloom_downsample.comp",
+        .layout        = pipelineLayout,
+    };
+    PipelineKey upsampleKey {
+        .computeShader = "bloom_upsample.comp",
+        .layout        = pipelineLayout,
+    };
+    PipelineKey toneMapKey {
+        .computeShader = "tonemap.comp",
+        .layout        = pipelineLayout,
+    };
+    PipelineKey fxaaKey {
+        .computeShader = "fxaa.comp",
+        .layout        = pipelineLayout,
+    };
+
+    downsamplePipeline = pipelines.request(downsampleKey);
+    upsamplePipeline = pipelines.request(upsampleKey);
+    toneMapPipeline = pipelines.request(toneMapKey);
+    fxaaPipeline = pipelines.request(fxaaKey);
+
+    LOG_INFO("Post-processing: bloom downsampled through {}", subgroupQuad ? "subgroup quads" : "shared memory");
+}
+
+PostProcessor::~PostProcessor()
+{
+    for (VkImageView view : bloomViews)
+    {
+        vkDestroyImageView(device, view, nullptr);
+    }
+    vkDestroyImage(device, bloomImage, nullptr);
+    memory.free(bloomMemory, bloomMemorySize, bloomMemoryType);
+
+    destroyTarget(output);
+    destroyTarget(ldr);
+    destroyTarget(scene);
+
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroySampler(device, sampler, nullptr);
+}
+
+void PostProcessor::createImage(
+    VkExtent2D size, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VkImage &image,
+    VkDeviceMemory &imageMemory, VkDeviceSize &memorySize, uint32_t &memoryType)
+{
+    VkImageCreateInfo imageInfo {
+        .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .imageType     = VK_IMAGE_TYPE_2D,
+        .format        = format,
+        .extent {
+            .width     = size.width,
+            .height    = size.height,
+            .depth     = 1,
+        },
+        .mipLevels     = mipLevels,
+        .arrayLayers   = 1,
+        .samples       = VK_SAMPLE_COUNT_1_BIT,
+        .tiling        = VK_IMAGE_TILING_OPTIMAL,
+        .usage         = usage,
+        .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, image, &memRequirements);
+
+    imageMemory = memory.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &memoryType);
+    memorySize = memRequirements.size;
+
+    vkBindImageMemory(device, image, imageMemory, 0);
+}
+
+VkImageView PostProcessor::createImageView(VkImage image, VkFormat format, uint32_t mipLevel)
+{
+    VkImageViewCreateInfo viewInfo {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image               = image,
+        .viewType            = VK_IMAGE_VIEW_TYPE_2D,
+        .format              = format,
+        .subresourceRange {
+            .aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel    = mipLevel,
+            .levelCount      = 1,
+            .baseArrayLayer  = 0,
+            .layerCount      = 1,
+        },
+    };
+
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing image view!");
+    }
+
+    return view;
+}
+
+PostProcessor::Target PostProcessor::createTarget(VkFormat format, VkImageUsageFlags usage)
+{
+    Target target;
+
+    createImage(extent, 1, format, usage, target.image, target.memory, target.memorySize, target.memoryType);
+    target.view = createImageView(target.image, format, 0);
+
+    return target;
+}
+
+void PostProcessor::destroyTarget(Target &target)
+{
+    vkDestroyImageView(device, target.view, nullptr);
+    vkDestroyImage(device, target.image, nullptr);
+    memory.free(target.memory, target.memorySize, target.memoryType);
+}
+
+// Every image stays in the same place for the processor's life: the sets are written once
+void PostProcessor::createDescriptorSets()
+{
+    const uint32_t setCount = BloomLevels / 2 + (BloomLevels - 1) + 2 + 1;
+
+    VkDescriptorPoolSize poolSizes[2] {
+        {
+            .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 2 * setCount,
+        },
+        {
+            .type            = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .descriptorCount = 2 * setCount,
+        },
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets       = setCount,
+        .poolSizeCount = 2,
+        .pPoolSizes    = poolSizes,
+    };
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create post-processing descriptor pool!");
+    }
+
+    auto allocate = [this]() {
+        VkDescriptorSetAllocateInfo allocInfo {
+            .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+            .descriptorPool     = descriptorPool,
+            .descriptorSetCount = 1,
+            .pSetLayouts        = &descriptorSetLayout,
+        };
+
+        VkDescriptorSet set;
+        if (vkAllocateDescriptorSets(device, &allocInfo, &set) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to allocate post-processing descriptor set!");
+        }
+
+        return set;
+    };
+
+    // Sampled sources at bindings 0 and 1, storage targets at 2 and 3
+    auto write = [this](VkDescriptorSet set, uint32_t binding, VkImageView view, VkImageLayout layout) {
+        VkDescriptorImageInfo imageInfo {
+            .sampler     = binding < 2 ? sampler : VK_NULL_HANDLE,
+            .imageView   = view,
+            .imageLayout = layout,
+        };
+
+        VkWriteDescriptorSet descriptorWrite {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = set,
+            .dstBinding      = binding,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType  = binding < 2 ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+            .pImageInfo      = &imageInfo,
+        };
+
+        vkUpdateDescriptorSets(device, 1, &descriptorWrite, 0, nullptr);
+    };
+
+    // The scene is left by the render pass in SHADER_READ_ONLY_OPTIMAL; everything written by compute stays GENERAL
+    for (uint32_t pass = 0; pass < BloomLevels / 2; pass++)
+    {
+        downsampleSets[pass] = allocate();
+
+        if (pass == 0)
+        {
+            write(downsampleSets[pass], 0, scene.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        }
+        else
+        {
+            write(downsampleSets[pass], 0, bloomViews[2 * pass - 1], VK_IMAGE_LAYOUT_GENERAL);
+        }
+
+        write(downsampleSets[pass], 2, bloomViews[2 * pass], VK_IMAGE_LAYOUT_GENERAL);
+        write(downsampleSets[pass], 3, bloomViews[2 * pass + 1], VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    for (uint32_t level = 0; level < BloomLevels - 1; level++)
+    {
+        upsampleSets[level] = allocate();
+        write(upsampleSets[level], 0, bloomViews[level + 1], VK_IMAGE_LAYOUT_GENERAL);
+        write(upsampleSets[level], 2, bloomViews[level], VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    for (uint32_t i = 0; i < 2; i++)
+    {
+        toneMapSets[i] = allocate();
+        write(toneMapSets[i], 0, scene.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+        write(toneMapSets[i], 1, bloomViews[0], VK_IMAGE_LAYOUT_GENERAL);
+        write(toneMapSets[i], 2, i == 0 ? ldr.view : output.view, VK_IMAGE_LAYOUT_GENERAL);
+    }
+
+    fxaaSet = allocate();
+    write(fxaaSet, 0, ldr.view, VK_IMAGE_LAYOUT_GENERAL);
+    write(fxaaSet, 2, output.view, VK_IMAGE_LAYOUT_GENERAL);
+}
+
+VkImageView PostProcessor::getSceneView() const
+{
+    return scene.view;
+}
+
+void PostProcessor::setEnabled(PostEffect effect, bool enabled)
+{
+    this->enabled[effect] = enabled;
+}
+
+bool PostProcessor::isEnabled(PostEffect effect) const
+{
+    return enabled[effect];
+}
+
+void PostProcessor::toggle(PostEffect effect)
+{
+    enabled[effect] = !enabled[effect];
+
+    LOG_INFO("Post-processing: {} {}", effectName(effect), enabled[effect] ? "on" : "off");
+}
+
+void PostProcessor::setEffects(const std::string &list)
+{
+    std::fill(enabled, enabled + PostEffectCount, list == "all");
+
+    if (list == "all")
+    {
+        return;
+    }
+
+    std::stringstream names(list);
+    std::string name;
+
+    while (std::getline(names, name, ','))
+    {
+        auto found = std::find_if(EffectNames, EffectNames + PostEffectCount, [&](const char *effectName) {
+            return name == effectName;
+        });
+
+        if (found == EffectNames + PostEffectCount)
+        {
+            LOG_WARNING("Unknown post-processing effect '{}'", name);
+            continue;
+        }
+
+        enabled[found - EffectNames] = true;
+    }
+}
+
+const char *PostProcessor::effectName(PostEffect effect)
+{
+    return EffectNames[effect];
+}
+
+void PostProcessor::recordBloom(
+    VkCommandBuffer commandBuffer, VkPipeline downsample, VkPipeline upsample, const float sceneScale[2])
+{
+    PostConstants constants {
+        .threshold = bloomThreshold,
+    };
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, downsample);
+
+    for (uint32_t pass = 0; pass < BloomLevels / 2; pass++)
+    {
+        VkExtent2D source = pass == 0 ? extent : bloomSizes[2 * pass - 1];
+        VkExtent2D target = bloomSizes[2 * pass];
+
+        constants.sourceTexelSize[0] = 1.0f / source.width;
+        constants.sourceTexelSize[1] = 1.0f / source.height;
+        constants.targetSize[0] = target.width;
+        constants.targetSize[1] = target.height;
+        // Only the bright parts of the scene go into the pyramid, which covers the full extent whatever the scale
+        constants.flags = pass == 0 ? 1 : 0;
+        constants.sceneScale[0] = pass == 0 ? sceneScale[0] : 1.0f;
+        constants.sceneScale[1] = pass == 0 ? sceneScale[1] : 1.0f;
+
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &downsampleSets[pass], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, groupCount(target.width), groupCount(target.height), 1);
+        computeBarrier(commandBuffer);
+    }
+
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, upsample);
+
+    for (uint32_t level = BloomLevels - 1; level-- > 0;)
+    {
+        VkExtent2D source = bloomSizes[level + 1];
+        VkExtent2D target = bloomSizes[level];
+
+        constants.sourceTexelSize[0] = 1.0f / source.width;
+        constants.sourceTexelSize[1] = 1.0f / source.height;
+        constants.targetSize[0] = target.width;
+        constants.targetSize[1] = target.height;
+        constants.flags = 0;
+        constants.sceneScale[0] = 1.0f;
+        constants.sceneScale[1] = 1.0f;
+
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &upsampleSets[level], 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, groupCount(target.width), groupCount(target.height), 1);
+        computeBarrier(commandBuffer);
+    }
+}
+
+// The target's previous contents are discarded; it is first touched here, at the transfer stage. A source smaller
+// than the target is stretched over it, filtered
+void PostProcessor::recordBlit(
+    VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent, VkImage target, VkImageLayout targetLayout)
+{
+    VkImageSubresourceRange subresourceRange {
+        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel   = 0,
+        .levelCount     = 1,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
+
+    VkImageMemoryBarrier toTransfer[2] {
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = VK_ACCESS_SHADER_WRITE_BIT,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+            .oldLayout           = source == output.image ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = source,
+            .subresourceRange    = subresourceRange,
+        },
+        {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = target,
+            .subresourceRange    = subresourceRange,
+        },
+    };
+
+    // The scene's writes were made available to compute shaders by the render pass: chaining from that stage covers
+    // the blit of an unprocessed scene too
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, toTransfer);
+
+    VkImageBlit region {
+        .srcSubresource {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        },
+        .srcOffsets         = {{0, 0, 0}, {(int32_t)sourceExtent.width, (int32_t)sourceExtent.height, 1}},
+        .dstSubresource {
+            .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+            .mipLevel       = 0,
+            .baseArrayLayer = 0,
+            .layerCount     = 1,
+        },
+        .dstOffsets         = {{0, 0, 0}, {(int32_t)extent.width, (int32_t)extent.height, 1}},
+    };
+
+    bool stretched = sourceExtent.width != extent.width || sourceExtent.height != extent.height;
+
+    vkCmdBlitImage(
+        commandBuffer, source, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1,
+        &region, stretched ? VK_FILTER_LINEAR : VK_FILTER_NEAREST);
+
+    // Frame capture reads the target right after, as it would after the render pass
+    VkImageMemoryBarrier toTarget {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT,
+        .oldLayout           = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        .newLayout           = targetLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = target,
+        .subresourceRange    = subresourceRange,
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0, 0, nullptr, 0, nullptr, 1,
+        &toTarget);
+}
+
+void PostProcessor::record(
+    VkCommandBuffer commandBuffer, VkExtent2D sceneExtent, VkImage target, VkImageLayout targetLayout,
+    GpuProfiler &profiler)
+{
+    TRACE_ZONE("PostProcessor::record");
+
+    VkPipeline downsample = pipelines.get(downsamplePipeline);
+    VkPipeline upsample = pipelines.get(upsamplePipeline);
+    VkPipeline toneMap = pipelines.get(toneMapPipeline);
+    VkPipeline fxaa = pipelines.get(fxaaPipeline);
+
+    bool bloom = enabled[PostBloom] && downsample != VK_NULL_HANDLE && upsample != VK_NULL_HANDLE;
+    bool antialias = enabled[PostFxaa] && fxaa != VK_NULL_HANDLE;
+
+    uint32_t blitZone = 0;
+
+    if (toneMap == VK_NULL_HANDLE)
+    {
+        blitZone = profiler.beginZone(commandBuffer, "Blit to swapchain");
+        recordBlit(commandBuffer, scene.image, sceneExtent, target, targetLayout);
+        profiler.endZone(commandBuffer, blitZone);
+        return;
+    }
+
+    VkImageSubresourceRange subresourceRange {
+        .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel   = 0,
+        .levelCount     = VK_REMAINING_MIP_LEVELS,
+        .baseArrayLayer = 0,
+        .layerCount     = 1,
+    };
+
+    // Contents of the previous frame are discarded, once its passes are done reading them. The pyramid is brought to
+    // GENERAL even with bloom off, as tone mapping's descriptors expect it there
+    VkImageMemoryBarrier toGeneral[3];
+    VkImage images[3] = {bloomImage, ldr.image, output.image};
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        toGeneral[i] = {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_GENERAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = images[i],
+            .subresourceRange    = subresourceRange,
+        };
+    }
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 3, toGeneral);
+
+    float sceneScale[2] = {
+        (float)sceneExtent.width / extent.width,
+        (float)sceneExtent.height / extent.height,
+    };
+
+    if (bloom)
+    {
+        uint32_t bloomZone = profiler.beginZone(commandBuffer, "Bloom");
+        recordBloom(commandBuffer, downsample, upsample, sceneScale);
+        profiler.endZone(commandBuffer, bloomZone);
+    }
+
+    PostConstants constants {
+        .sourceTexelSize = {1.0f / extent.width, 1.0f / extent.height},
+        .targetSize      = {extent.width, extent.height},
+        .intensity       = bloomIntensity,
+        .exposure        = exposure,
+        .flags           = (bloom ? 1u : 0u) | (enabled[PostToneMapping] ? 2u : 0u),
+        .sceneScale      = {sceneScale[0], sceneScale[1]},
+    };
+
+    uint32_t toneMapZone = profiler.beginZone(commandBuffer, "Tone mapping");
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, toneMap);
+    vkCmdBindDescriptorSets(
+        commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &toneMapSets[antialias ? 0 : 1], 0,
+        nullptr);
+    vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(commandBuffer, groupCount(extent.width), groupCount(extent.height), 1);
+    profiler.endZone(commandBuffer, toneMapZone);
+
+    if (antialias)
+    {
+        computeBarrier(commandBuffer);
+
+        uint32_t fxaaZone = profiler.beginZone(commandBuffer, "FXAA");
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, fxaa);
+        vkCmdBindDescriptorSets(
+            commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pipelineLayout, 0, 1, &fxaaSet, 0, nullptr);
+        vkCmdPushConstants(commandBuffer, pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+        vkCmdDispatch(commandBuffer, groupCount(extent.width), groupCount(extent.height), 1);
+        profiler.endZone(commandBuffer, fxaaZone);
+    }
+
+    blitZone = profiler.beginZone(commandBuffer, "Blit to swapchain");
+    recordBlit(commandBuffer, output.image, extent, target, targetLayout);
+    profiler.endZone(commandBuffer, blitZone);
+}
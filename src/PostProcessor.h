@@ -0,0 +1,138 @@
+#ifndef POST_PROCESSOR_H_
+#define POST_PROCESSOR_H_
+
+#include <cstdint>
+#include <string>
+
+#include <vulkan/vulkan.h>
+
+#include "GpuProfiler.h"
+#include "MemoryBudget.h"
+#include "PipelineManager.h"
+
+enum PostEffect : uint32_t
+{
+    PostBloom = 0,
+    PostToneMapping,
+    PostFxaa,
+    PostEffectCount,
+};
+
+// Push constants shared by the post-processing shaders, laid out as their block: 40 bytes
+struct PostConstants
+{
+    float sourceTexelSize[2];
+    uint32_t targetSize[2];
+    float threshold;
+    float intensity;
+    float exposure;
+    uint32_t flags;
+    // Of the scene, the part rendered to, for the passes reading it; 1 for the others
+    float sceneScale[2];
+};
+
+// Post-processing in compute shaders, after the main render pass: the scene is rendered in HDR into an image of its
+// own, which a chain of dispatches turns into the displayed frame. Bloom downsamples the bright parts into a pyramid,
+// two levels per dispatch with the second one reduced across subgroup quads (or shared memory where the device lacks
+// them), then adds each level back onto the finer one; tone mapping composites the bloom and maps the scene to the
+// display range; FXAA smooths the edges, reading luma from shared memory. The last pass writes a storage image that is
+// blitted to the swapchain image, so that no full screen raster pass is needed. Each effect can be switched on and off
+// and is timed by the GPU profiler under its own name. The main pass may render to a smaller part of the scene, from
+// its top left corner: the passes reading the scene upscale it with bilinear filtering, and so does the blit while
+// tone mapping compiles
+class PostProcessor
+{
+public:
+    static const uint32_t BloomLevels = 6;
+    static const VkFormat SceneFormat = VK_FORMAT_R16G16B16A16_SFLOAT;
+
+private:
+    struct Target
+    {
+        VkImage image;
+        VkDeviceMemory memory;
+        VkDeviceSize memorySize;
+        uint32_t memoryType;
+        VkImageView view;
+    };
+
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    VkExtent2D extent;
+
+    VkSampler sampler;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    PipelineHandle downsamplePipeline;
+    PipelineHandle upsamplePipeline;
+    PipelineHandle toneMapPipeline;
+    PipelineHandle fxaaPipeline;
+
+    // Rendered by the main pass, then read by tone mapping
+    Target scene;
+    // Tone mapped, for FXAA to read
+    Target ldr;
+    // Blitted to the swapchain image
+    Target output;
+
+    // Half the size of the scene at its first level
+    VkImage bloomImage;
+    VkDeviceMemory bloomMemory;
+    VkDeviceSize bloomMemorySize;
+    uint32_t bloomMemoryType;
+    VkImageView bloomViews[BloomLevels];
+    VkExtent2D bloomSizes[BloomLevels];
+
+    VkDescriptorSet downsampleSets[BloomLevels / 2];
+    VkDescriptorSet upsampleSets[BloomLevels - 1];
+    // Writing the LDR image for FXAA, or straight to the output
+    VkDescriptorSet toneMapSets[2];
+    VkDescriptorSet fxaaSet;
+
+    bool enabled[PostEffectCount];
+    float exposure;
+    float bloomThreshold;
+    float bloomIntensity;
+
+    void createImage(
+        VkExtent2D size, uint32_t mipLevels, VkFormat format, VkImageUsageFlags usage, VkImage &image,
+        VkDeviceMemory &imageMemory, VkDeviceSize &memorySize, uint32_t &memoryType);
+    VkImageView createImageView(VkImage image, VkFormat format, uint32_t mipLevel);
+    Target createTarget(VkFormat format, VkImageUsageFlags usage);
+    void destroyTarget(Target &target);
+    void createDescriptorSets();
+
+    void recordBloom(
+        VkCommandBuffer commandBuffer, VkPipeline downsample, VkPipeline upsample, const float sceneScale[2]);
+    void recordBlit(
+        VkCommandBuffer commandBuffer, VkImage source, VkExtent2D sourceExtent, VkImage target,
+        VkImageLayout targetLayout);
+
+public:
+    // subgroupQuad: compute shaders have quad operations, on subgroups of at least 4 invocations
+    PostProcessor(VkDevice device, MemoryBudget &memory, PipelineManager &pipelines, VkExtent2D extent,
+        bool subgroupQuad);
+
+    // The main pass' resolved color attachment, left in SHADER_READ_ONLY_OPTIMAL by it
+    VkImageView getSceneView() const;
+
+    void setEnabled(PostEffect effect, bool enabled);
+    bool isEnabled(PostEffect effect) const;
+    void toggle(PostEffect effect);
+    // A comma-separated list of "bloom", "tonemap" and "fxaa", or "all": the effects enabled, every other disabled
+    void setEffects(const std::string &list);
+    static const char *effectName(PostEffect effect);
+
+    // After the main render pass, in the same command buffer: turns the part of the scene rendered to, sceneExtent
+    // from its top left corner, into the full target image, left in targetLayout. Until the pipelines are compiled the
+    // scene is blitted as is
+    void record(
+        VkCommandBuffer commandBuffer, VkExtent2D sceneExtent, VkImage target, VkImageLayout targetLayout,
+        GpuProfiler &profiler);
+
+    ~PostProcessor();
+};
+
+#endif
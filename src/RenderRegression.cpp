@@ -0,0 +1,240 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <iterator>
+#include <mutex>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+#include "FrameDrawer.h"
+#include "Image.h"
+#include "Logger.h"
+#include "RenderRegression.h"
+#include "Trace.h"
+
+static const VkExtent2D RegressionSize {256, 256};
+
+// Delta E above which a pixel differs, and share of differing pixels above which a scene fails
+static const double PixelTolerance = 2.3;
+static const double MaxDifferingRatio = 0.001;
+
+// A scene is slower than its reference when its mean frame time grows by more than this factor plus slack
+static const double MaxSlowdown = 1.5;
+static const double TimingSlackMilliseconds = 0.25;
+
+struct RegressionScene
+{
+    const char *name;
+    int clearColor[3];
+    uint32_t frames;
+    // In the reference directory, drawn instead of the triangle
+    const char *texture;
+    // Texture bytes uploaded per frame, if not the default
+    VkDeviceSize uploadBudget;
+    // Frame at which every complete texture is evicted down to half its size, if any
+    uint32_t demoteFrame;
+};
+
+// What a scene shows stays for the scenes after it: those changing more come last
+static const RegressionScene scenes[] {
+    {"triangle", {0, 0, 0}, 16},
+    {"triangle_clear_color", {112, 66, 20}, 16},
+    // Mips generated by blits, and a full chain streamed coarsest level first
+    {"texture_ktx2", {0, 0, 0}, 16, "checker.ktx2"},
+    {"texture_dds_cube", {0, 0, 0}, 16, "faces.dds"},
+    {"texture_array_demoted", {0, 0, 0}, 24, "stripes.ktx2", 0, 8},
+    // Every level larger than the budget copied in bands of rows over several frames
+    {"texture_banded", {0, 0, 0}, 24, "checker.ktx2", 64 << 10},
+};
+
+struct FrameTimings
+{
+    double cpuMilliseconds;
+    double gpuMilliseconds;
+};
+
+static bool loadTimings(const std::string &path, FrameTimings &timings)
+{
+    FILE *file = fopen(path.c_str(), "r");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    bool valid = fscanf(file, "%lf %lf", &timings.cpuMilliseconds, &timings.gpuMilliseconds) == 2;
+    fclose(file);
+
+    return valid;
+}
+
+static void saveTimings(const std::string &path, const FrameTimings &timings)
+{
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        throw std::runtime_error("Failed to write timings " + path);
+    }
+
+    fmt::print(file, "{:.4f} {:.4f}\n", timings.cpuMilliseconds, timings.gpuMilliseconds);
+    fclose(file);
+}
+
+static bool slower(double measured, double reference)
+{
+    // A zero reference is a device without timestamp queries
+    return reference > 0.0 && measured > reference * MaxSlowdown + TimingSlackMilliseconds;
+}
+
+int runRenderRegression(const std::string &directory, const std::string &only, bool update)
+{
+    auto selected = [&only](const RegressionScene &scene) { return only.empty() || only == scene.name; };
+    size_t sceneCount = std::count_if(std::begin(scenes), std::end(scenes), selected);
+
+    if (sceneCount == 0)
+    {
+        LOG_ERROR("Unknown render regression scene {}", only);
+        Logger::instance().flush();
+        return EXIT_FAILURE;
+    }
+
+    std::string name = "Render regression";
+    FrameDrawer drawer(RegressionSize, name.data());
+    VulkanHandler *vulkan = drawer.vulkan;
+
+    // Deterministic frames: the triangle must be there from the first one
+    vulkan->pipelines->waitIdle();
+    vulkan->gpuProfiler->setEnabled(true);
+    vulkan->createFrameCapture("");
+
+    std::mutex mutex;
+    Image lastFrame {RegressionSize.width, RegressionSize.height, {}};
+
+    vulkan->capture->setFrameCallback([&](uint64_t, const std::vector<uint8_t> &rgb) {
+        std::lock_guard<std::mutex> lock(mutex);
+        lastFrame.rgb = rgb;
+    });
+
+    int failures = 0;
+    int skipped = 0;
+
+    for (const auto &scene : scenes)
+    {
+        if (!selected(scene))
+        {
+            continue;
+        }
+
+        drawer.setClearColor(scene.clearColor[0], scene.clearColor[1], scene.clearColor[2]);
+
+        if (scene.texture != nullptr)
+        {
+            if (scene.uploadBudget > 0)
+            {
+                vulkan->textures->setUploadBudget(scene.uploadBudget);
+            }
+
+            drawer.showTexture(fmt::format("{}/{}", directory, scene.texture));
+            vulkan->pipelines->waitIdle();
+        }
+
+        FrameTimings timings {0.0, 0.0};
+        uint32_t gpuSamples = 0;
+
+        for (uint32_t frame = 0; frame < scene.frames; frame++)
+        {
+            if (scene.demoteFrame > 0 && frame == scene.demoteFrame)
+            {
+                // As the memory budget would, past its threshold: demoted at the next update
+                for (uint32_t heap = 0; heap < vulkan->memory->getHeaps().size(); heap++)
+                {
+                    vulkan->textures->evict(heap, UINT64_MAX);
+                }
+            }
+
+            uint64_t start = Trace::now();
+            drawer.nextFrame();
+            timings.cpuMilliseconds += (Trace::now() - start) / 1e6;
+
+            // Results lag by the frames in flight, which is irrelevant for a mean
+            double gpuMilliseconds = vulkan->gpuProfiler->milliseconds("Main render pass");
+            if (gpuMilliseconds >= 0.0)
+            {
+                timings.gpuMilliseconds += gpuMilliseconds;
+                gpuSamples++;
+            }
+        }
+
+        drawer.finish();
+
+        timings.cpuMilliseconds /= scene.frames;
+        timings.gpuMilliseconds = gpuSamples > 0 ? timings.gpuMilliseconds / gpuSamples : 0.0;
+
+        std::string imagePath = fmt::format("{}/{}.ppm", directory, scene.name);
+        std::string timingPath = fmt::format("{}/{}.timing", directory, scene.name);
+
+        if (update)
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            savePpm(imagePath, lastFrame);
+            saveTimings(timingPath, timings);
+
+            LOG_INFO("[ UPDATED ] {} (cpu {:.3f} ms, gpu {:.3f} ms)", scene.name, timings.cpuMilliseconds, timings.gpuMilliseconds);
+            continue;
+        }
+
+        Image reference;
+        if (!loadPpm(imagePath, reference))
+        {
+            // First run on this device: what it renders becomes the reference, to be reviewed and committed
+            std::lock_guard<std::mutex> lock(mutex);
+            savePpm(imagePath, lastFrame);
+            saveTimings(timingPath, timings);
+
+            LOG_WARNING("[ SKIPPED ] {}: no reference image, recorded {} and {}", scene.name, imagePath, timingPath);
+            skipped++;
+            continue;
+        }
+
+        ImageDifference difference;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            difference = compareImages(reference, lastFrame, PixelTolerance);
+        }
+
+        FrameTimings referenceTimings {0.0, 0.0};
+        bool timingSkipped = !loadTimings(timingPath, referenceTimings);
+
+        bool imageFailed = difference.differingRatio > MaxDifferingRatio;
+        bool timingFailed = !timingSkipped && (slower(timings.cpuMilliseconds, referenceTimings.cpuMilliseconds) ||
+                                               slower(timings.gpuMilliseconds, referenceTimings.gpuMilliseconds));
+
+        if (imageFailed || timingFailed)
+        {
+            failures++;
+        }
+        else if (timingSkipped)
+        {
+            // Timings only compare on the device that recorded them, which is the one running the tests
+            saveTimings(timingPath, timings);
+
+            LOG_WARNING("[ SKIPPED ] {}: no timing baseline, recorded {}", scene.name, timingPath);
+            skipped++;
+        }
+
+        LOG_INFO("[ {} ] {}: {} pixels differ ({:.3f}%), delta E mean {:.3f} max {:.3f}; cpu {:.3f} ms (ref {:.3f}), gpu {:.3f} ms (ref {:.3f})",
+            imageFailed ? "FAILED " : timingFailed ? " SLOWER" : "   OK  ", scene.name, difference.differingPixels,
+            difference.differingRatio * 100.0, difference.meanDeltaE, difference.maxDeltaE, timings.cpuMilliseconds,
+            referenceTimings.cpuMilliseconds, timings.gpuMilliseconds, referenceTimings.gpuMilliseconds);
+    }
+
+    LOG_INFO("{} of {} render regression scenes failed, {} skipped", failures, sceneCount, skipped);
+    Logger::instance().flush();
+
+    if (failures > 0)
+    {
+        return EXIT_FAILURE;
+    }
+    return skipped > 0 ? RenderRegressionSkipped : EXIT_SUCCESS;
+}
@@ -0,0 +1,16 @@
+#ifndef RENDER_REGRESSION_H_
+#define RENDER_REGRESSION_H_
+
+#include <string>
+
+// Exit code of a run where nothing failed but some scene had no reference to check against, CTest's default skip code
+const int RenderRegressionSkipped = 77;
+
+// Renders every regression scene headless and compares the last frame against `<directory>/<scene>.ppm`, and its
+// frame timings against `<directory>/<scene>.timing`. A missing reference is recorded from this run and the check
+// skipped; with `update` every reference is rewritten instead. A non-empty `scene` runs that scene only. Returns
+// EXIT_FAILURE if any scene failed or is unknown, else RenderRegressionSkipped if any check was skipped, else
+// EXIT_SUCCESS
+int runRenderRegression(const std::string &directory, const std::string &scene, bool update);
+
+#endif
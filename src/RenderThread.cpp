@@ -0,0 +1,91 @@
+#include <utility>
+
+#include "Logger.h"
+#include "RenderThread.h"
+#include "Trace.h"
+
+RenderThread::RenderThread(FrameDrawer &drawer, const std::string &name) : drawer(drawer)
+{
+    this->name = name;
+
+    running = true;
+    thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread()
+{
+    if (thread.joinable())
+    {
+        running = false;
+        thread.join();
+    }
+}
+
+void RenderThread::run()
+{
+    Trace::setThreadName(name.c_str());
+
+    uint32_t sampleCountCycles = 0;
+    uint32_t postEffectToggles[PostEffectCount] {};
+
+    try
+    {
+        while (running.load(std::memory_order_relaxed))
+        {
+            // Without a new snapshot the last one still holds: frames never wait for the window thread
+            snapshots.update();
+            const FrameSnapshot &snapshot = snapshots.front();
+
+            for (; sampleCountCycles < snapshot.sampleCountCycles; sampleCountCycles++)
+            {
+                drawer.vulkan->cycleSampleCount();
+            }
+
+            for (uint32_t effect = 0; effect < PostEffectCount; effect++)
+            {
+                for (; postEffectToggles[effect] < snapshot.postEffectToggles[effect]; postEffectToggles[effect]++)
+                {
+                    if (drawer.vulkan->post)
+                    {
+                        drawer.vulkan->post->toggle(static_cast<PostEffect>(effect));
+                    }
+                }
+            }
+
+            drawer.setClearColor(snapshot.clearColor[0], snapshot.clearColor[1], snapshot.clearColor[2]);
+            drawer.nextFrame();
+        }
+    }
+    catch (...)
+    {
+        LOG_ERROR("{} stopped", name);
+        failure = std::current_exception();
+        running = false;
+    }
+}
+
+void RenderThread::submit(const FrameSnapshot &snapshot)
+{
+    snapshots.back() = snapshot;
+    snapshots.publish();
+}
+
+bool RenderThread::isRunning() const
+{
+    return running.load(std::memory_order_relaxed);
+}
+
+void RenderThread::stop()
+{
+    running = false;
+
+    if (thread.joinable())
+    {
+        thread.join();
+    }
+
+    if (failure)
+    {
+        std::rethrow_exception(std::exchange(failure, nullptr));
+    }
+}
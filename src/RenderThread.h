@@ -0,0 +1,53 @@
+#ifndef RENDER_THREAD_H_
+#define RENDER_THREAD_H_
+
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <string>
+#include <thread>
+
+#include "FrameDrawer.h"
+#include "TripleBuffer.h"
+
+// What the window thread decides for the frames to come, taken as a whole by the render thread
+struct FrameSnapshot
+{
+    int clearColor[3];
+    // Presses of the key cycling the MSAA sample count so far: a count survives snapshots that are never rendered
+    uint32_t sampleCountCycles;
+    // Likewise for the keys toggling each post-processing effect
+    uint32_t postEffectToggles[PostEffectCount];
+};
+
+// Records and submits the frames of a FrameDrawer on a thread of its own, from the latest snapshot handed over by
+// the window thread, which keeps pumping events however long a present takes. The FrameDrawer is only used from the
+// render thread until stop() returns
+class RenderThread
+{
+private:
+    FrameDrawer &drawer;
+    std::string name;
+    TripleBuffer<FrameSnapshot> snapshots;
+    std::atomic<bool> running;
+    std::exception_ptr failure;
+    std::thread thread;
+
+    void run();
+
+public:
+    RenderThread(FrameDrawer &drawer, const std::string &name);
+
+    // Window thread: never waits for the render thread
+    void submit(const FrameSnapshot &snapshot);
+
+    // False once stopped, or after rendering threw
+    bool isRunning() const;
+
+    // Lets the frame being recorded finish, waits for the thread and rethrows what made it stop, if anything
+    void stop();
+
+    ~RenderThread();
+};
+
+#endif
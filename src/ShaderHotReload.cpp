@@ -0,0 +1,177 @@
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include <shaderc/shaderc.h>
+
+#include "Logger.h"
+#include "ShaderHotReload.h"
+
+static bool shaderKind(const std::string &name, shaderc_shader_kind *kind)
+{
+    size_t dot = name.rfind('.');
+    std::string extension = dot == std::string::npos ? "" : name.substr(dot + 1);
+
+    if (extension == "vert")
+    {
+        *kind = shaderc_glsl_vertex_shader;
+    }
+    else if (extension == "frag")
+    {
+        *kind = shaderc_glsl_fragment_shader;
+    }
+    else if (extension == "comp")
+    {
+        *kind = shaderc_glsl_compute_shader;
+    }
+    else if (extension == "task")
+    {
+        *kind = shaderc_glsl_task_shader;
+    }
+    else if (extension == "mesh")
+    {
+        *kind = shaderc_glsl_mesh_shader;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+ShaderHotReload::ShaderHotReload(ShaderLibrary &shaders, PipelineManager &pipelines)
+    : shaders(shaders), pipelines(pipelines)
+{
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0)
+    {
+        throw std::runtime_error("Failed to initialize inotify!");
+    }
+
+    // Editors commonly save through a temporary file and a rename, hence IN_MOVED_TO
+    watchDescriptor = inotify_add_watch(inotifyFd, shaders.getDirectory().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+    if (watchDescriptor < 0)
+    {
+        close(inotifyFd);
+        throw std::runtime_error("Failed to watch shader directory " + shaders.getDirectory() + "!");
+    }
+
+    running = true;
+    watcher = std::thread(&ShaderHotReload::watchLoop, this);
+}
+
+ShaderHotReload::~ShaderHotReload()
+{
+    running = false;
+    watcher.join();
+
+    inotify_rm_watch(inotifyFd, watchDescriptor);
+    close(inotifyFd);
+}
+
+void ShaderHotReload::watchLoop()
+{
+    alignas(inotify_event) char buffer[4096];
+
+    while (running)
+    {
+        pollfd pollFd {inotifyFd, POLLIN, 0};
+        if (poll(&pollFd, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        // A single save usually produces several events: collect them before compiling
+        std::set<std::string> changed;
+        ssize_t length;
+
+        while ((length = read(inotifyFd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char *ptr = buffer; ptr < buffer + length;)
+            {
+                const inotify_event *event = reinterpret_cast<const inotify_event *>(ptr);
+                shaderc_shader_kind kind;
+
+                if (event->len > 0 && shaderKind(event->name, &kind))
+                {
+                    changed.insert(event->name);
+                }
+
+                ptr += sizeof(inotify_event) + event->len;
+            }
+        }
+
+        for (const auto &name : changed)
+        {
+            std::vector<uint32_t> spirv;
+
+            if (compile(name, spirv))
+            {
+                LOG_INFO("Reloaded shader {}", name);
+                shaders.set(name, std::move(spirv));
+                pipelines.reload(name);
+            }
+        }
+    }
+}
+
+bool ShaderHotReload::compile(const std::string &name, std::vector<uint32_t> &spirv)
+{
+    shaderc_shader_kind kind;
+    shaderKind(name, &kind);
+
+    std::ifstream file(shaders.getDirectory() + "/" + name);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    std::stringstream source;
+    source << file.rdbuf();
+    std::string sourceText = source.str();
+
+    shaderc_compiler_t compiler = shaderc_compiler_initialize();
+    shaderc_compile_options_t options = shaderc_compile_options_initialize();
+
+    // Same targets as the build: VK_EXT_mesh_shader needs SPIR-V 1.4, subgroup operations SPIR-V 1.3
+    if (kind == shaderc_glsl_task_shader || kind == shaderc_glsl_mesh_shader)
+    {
+        shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+        shaderc_compile_options_set_target_spirv(options, shaderc_spirv_version_1_4);
+    }
+    else if (name.find("_subgroup.") != std::string::npos)
+    {
+        shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_1);
+    }
+    else
+    {
+        shaderc_compile_options_set_target_env(options, shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_0);
+    }
+
+    shaderc_compilation_result_t result = shaderc_compile_into_spv(
+        compiler, sourceText.data(), sourceText.size(), kind, name.c_str(), "main", options);
+
+    bool success = shaderc_result_get_compilation_status(result) == shaderc_compilation_status_success;
+
+    if (success)
+    {
+        const uint32_t *words = reinterpret_cast<const uint32_t *>(shaderc_result_get_bytes(result));
+        spirv.assign(words, words + shaderc_result_get_length(result) / sizeof(uint32_t));
+    }
+    else
+    {
+        LOG_ERROR("Failed to compile {}:\n{}", name, shaderc_result_get_error_message(result));
+    }
+
+    shaderc_result_release(result);
+    shaderc_compile_options_release(options);
+    shaderc_compiler_release(compiler);
+
+    return success;
+}
@@ -0,0 +1,33 @@
+#ifndef SHADER_HOT_RELOAD_H_
+#define SHADER_HOT_RELOAD_H_
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "PipelineManager.h"
+#include "ShaderLibrary.h"
+
+// Development mode: watches the shader directory, recompiles changed GLSL off the render thread and asks
+// the pipeline manager to rebuild the pipelines using it
+class ShaderHotReload
+{
+private:
+    ShaderLibrary &shaders;
+    PipelineManager &pipelines;
+    std::atomic<bool> running;
+    std::thread watcher;
+    int inotifyFd;
+    int watchDescriptor;
+
+    void watchLoop();
+    bool compile(const std::string &name, std::vector<uint32_t> &spirv);
+
+public:
+    ShaderHotReload(ShaderLibrary &shaders, PipelineManager &pipelines);
+
+    ~ShaderHotReload();
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <fstream>
+#include <stdexcept>
+
+#include "EmbeddedShaders.h"
+#include "ShaderLibrary.h"
+
+ShaderLibrary::ShaderLibrary(const std::string &directory)
+{
+    this->directory = directory;
+}
+
+const std::string &ShaderLibrary::getDirectory() const
+{
+    return directory;
+}
+
+SpirvCode ShaderLibrary::get(const std::string &name)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+
+        auto found = shaders.find(name);
+        if (found != shaders.end())
+        {
+            return found->second;
+        }
+    }
+
+    SpirvCode code = load(name);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    return shaders.emplace(name, code).first->second;
+}
+
+void ShaderLibrary::set(const std::string &name, std::vector<uint32_t> code)
+{
+    auto storage = std::make_shared<const std::vector<uint32_t>>(std::move(code));
+
+    std::lock_guard<std::mutex> lock(mutex);
+    shaders[name] = {storage->data(), storage->size(), storage};
+}
+
+SpirvCode ShaderLibrary::load(const std::string &name)
+{
+    for (const auto &shader : embeddedShaders)
+    {
+        if (name == shader.name)
+        {
+            return {shader.code, shader.wordCount, nullptr};
+        }
+    }
+
+    std::string filename = directory + "/" + name + ".spv";
+    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+
+    if (!file.is_open())
+    {
+        throw std::runtime_error("Failed to open file " + filename + "!");
+    }
+
+    size_t fileSize = (size_t)file.tellg();
+    if (fileSize % sizeof(uint32_t) != 0)
+    {
+        throw std::runtime_error("Invalid SPIR-V file " + filename + "!");
+    }
+
+    std::vector<uint32_t> code(fileSize / sizeof(uint32_t));
+
+    file.seekg(0);
+    file.read(reinterpret_cast<char *>(code.data()), fileSize);
+
+    file.close();
+
+    auto storage = std::make_shared<const std::vector<uint32_t>>(std::move(code));
+    return {storage->data(), storage->size(), storage};
+}
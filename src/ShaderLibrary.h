@@ -0,0 +1,39 @@
+#ifndef SHADER_LIBRARY_H_
+#define SHADER_LIBRARY_H_
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// View over a SPIR-V binary: embedded shaders point straight into the executable, reloaded ones own their storage
+struct SpirvCode
+{
+    const uint32_t *code;
+    size_t wordCount;
+    std::shared_ptr<const std::vector<uint32_t>> storage;
+};
+
+// SPIR-V binaries by shader source name (e.g. "shader.vert"), shared between the render thread and compile workers.
+// Lookups prefer runtime replacements, then the binaries embedded at build time, then <directory>/<name>.spv
+class ShaderLibrary
+{
+private:
+    std::string directory;
+    std::mutex mutex;
+    std::unordered_map<std::string, SpirvCode> shaders;
+
+    SpirvCode load(const std::string &name);
+
+public:
+    ShaderLibrary(const std::string &directory);
+
+    SpirvCode get(const std::string &name);
+    void set(const std::string &name, std::vector<uint32_t> code);
+
+    const std::string &getDirectory() const;
+};
+
+#endif
@@ -0,0 +1,607 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "MeshFile.h"
+#include "ShadowMaps.h"
+#include "Trace.h"
+
+static_assert(DrawPassShadow0 + ShadowMaps::CascadeCount <= DrawPassCount, "A shadow pass per cascade");
+
+// Between logarithmic splits, which keep texels the same size on screen, and uniform ones, which spare the far
+// cascades from covering too little
+const float SplitLambda = 0.75f;
+
+// Cached cascades move by whole cells of this many texels, a tenth of the map, and cover their slice with a margin of
+// a cell
+const uint32_t CachedCellTexels = ShadowMaps::MapSize / 10;
+
+// Offsets of rasterized depth, in units of the format's resolution and scaled by the slope of the triangle
+const float DepthBiasConstant = 1.25f;
+const float DepthBiasSlope = 1.75f;
+
+static float length(const float v[3])
+{
+    return std::sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+}
+
+// Point through the upper 3x4 of a transform
+static void transformPoint(const Mat4 &transform, const float point[3], float result[3])
+{
+    for (int row = 0; row < 3; row++)
+    {
+        result[row] = transform.m[12 + row];
+
+        for (int column = 0; column < 3; column++)
+        {
+            result[row] += transform.m[column * 4 + row] * point[column];
+        }
+    }
+}
+
+ShadowMaps::ShadowMaps(
+    VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, PipelineManager &pipelines, VkImage image,
+    VkFormat format, uint32_t framesInFlight)
+    : memory(memory), pipelines(pipelines)
+{
+    this->device = device;
+    this->framesInFlight = framesInFlight;
+    this->image = image;
+    this->format = format;
+
+    initialized = false;
+    staticRadius = 0.0f;
+    stats = {};
+
+    for (Cascade &cascade : cascades)
+    {
+        cascade = {};
+    }
+
+    // As the vertex shaders light the meshes
+    const float defaultDirection[3] = {0.4f, 0.8f, 0.45f};
+    setLightDirection(defaultDirection);
+
+    arrayView = createView(VK_IMAGE_VIEW_TYPE_2D_ARRAY, 0, CascadeCount);
+    for (uint32_t layer = 0; layer < CascadeCount; layer++)
+    {
+        layerViews[layer] = createView(VK_IMAGE_VIEW_TYPE_2D, layer, 1);
+    }
+
+    // Comparisons against the map, filtered across 2x2 texels where the format allows it; outside of it is lit
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProperties);
+    VkFilter filter = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT) ?
+        VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+    VkSamplerCreateInfo samplerInfo {
+        .sType         = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter     = filter,
+        .minFilter     = filter,
+        .mipmapMode    = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+        .addressModeU  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeV  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .addressModeW  = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_BORDER,
+        .compareEnable = VK_TRUE,
+        .compareOp     = VK_COMPARE_OP_LESS_OR_EQUAL,
+        .maxLod        = 0.0f,
+        .borderColor   = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE,
+    };
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shadow sampler!");
+    }
+
+    createRenderPass();
+
+    for (uint32_t layer = 0; layer < CascadeCount; layer++)
+    {
+        VkFramebufferCreateInfo framebufferInfo {
+            .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
+            .renderPass      = renderPass,
+            .attachmentCount = 1,
+            .pAttachments    = &layerViews[layer],
+            .width           = MapSize,
+            .height          = MapSize,
+            .layers          = 1,
+        };
+
+        if (vkCreateFramebuffer(device, &framebufferInfo, nullptr, &framebuffers[layer]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create shadow framebuffer!");
+        }
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(ShadowConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 0,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shadow pipeline layout!");
+    }
+
+    // Both faces are drawn, so that open meshes cast too: the bias keeps lit faces from shadowing themselves
+    PipelineKey meshKey {
+        .vertexShader            = "shadow.vert",
+        .vertexBindings          = {{0, sizeof(MeshVertex), VK_VERTEX_INPUT_RATE_VERTEX}},
+        .vertexAttributes        = {{0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(MeshVertex, position)}},
+        .cullMode                = VK_CULL_MODE_NONE,
+        .frontFace               = VK_FRONT_FACE_COUNTER_CLOCKWISE,
+        .depthBiasEnable         = VK_TRUE,
+        .depthBiasConstantFactor = DepthBiasConstant,
+        .depthBiasSlopeFactor    = DepthBiasSlope,
+        .depthFormat             = format,
+        .layout                  = pipelineLayout,
+    };
+
+    // The instances as InstanceRenderer lays them out: position, then uniform scale
+    PipelineKey instancedKey = meshKey;
+    instancedKey.vertexShader = "shadow_instanced.vert";
+    instancedKey.vertexBindings.push_back({1, 4 * sizeof(float), VK_VERTEX_INPUT_RATE_INSTANCE});
+    instancedKey.vertexAttributes.push_back({1, 1, VK_FORMAT_R32G32B32A32_SFLOAT, 0});
+
+    meshPipeline = pipelines.request(meshKey);
+    instancedPipeline = pipelines.request(instancedKey);
+
+    uniformBuffers.resize(framesInFlight);
+    uniformMemory.resize(framesInFlight);
+    uniformMemorySizes.resize(framesInFlight);
+    uniformMemoryTypes.resize(framesInFlight);
+    mappedUniforms.resize(framesInFlight);
+
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        VkBufferCreateInfo bufferInfo {
+            .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+            .size        = sizeof(ShadowUniforms),
+            .usage       = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+            .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+        };
+
+        if (vkCreateBuffer(device, &bufferInfo, nullptr, &uniformBuffers[frame]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create shadow uniform buffer!");
+        }
+
+        VkMemoryRequirements memRequirements;
+        vkGetBufferMemoryRequirements(device, uniformBuffers[frame], &memRequirements);
+
+        VkMemoryPropertyFlags hostCoherent =
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+        uniformMemory[frame] = memory.allocate(memRequirements, hostCoherent, &uniformMemoryTypes[frame], hostCoherent);
+        uniformMemorySizes[frame] = memRequirements.size;
+
+        vkBindBufferMemory(device, uniformBuffers[frame], uniformMemory[frame], 0);
+
+        void *mapped;
+        if (vkMapMemory(device, uniformMemory[frame], 0, VK_WHOLE_SIZE, 0, &mapped) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to map shadow uniform buffer memory!");
+        }
+
+        mappedUniforms[frame] = static_cast<ShadowUniforms *>(mapped);
+        mappedUniforms[frame]->cascadeCount = 0;
+    }
+
+    LOG_INFO("Shadows: {} cascades of {}x{}, the last {} cached", CascadeCount, MapSize, MapSize,
+        CascadeCount - FirstCachedCascade);
+}
+
+ShadowMaps::~ShadowMaps()
+{
+    for (uint32_t frame = 0; frame < framesInFlight; frame++)
+    {
+        vkDestroyBuffer(device, uniformBuffers[frame], nullptr);
+        memory.free(uniformMemory[frame], uniformMemorySizes[frame], uniformMemoryTypes[frame]);
+    }
+
+    for (uint32_t layer = 0; layer < CascadeCount; layer++)
+    {
+        vkDestroyFramebuffer(device, framebuffers[layer], nullptr);
+        vkDestroyImageView(device, layerViews[layer], nullptr);
+    }
+
+    vkDestroyImageView(device, arrayView, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyRenderPass(device, renderPass, nullptr);
+    vkDestroySampler(device, sampler, nullptr);
+}
+
+VkImageView ShadowMaps::createView(VkImageViewType type, uint32_t firstLayer, uint32_t layerCount)
+{
+    VkImageViewCreateInfo viewInfo {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image               = image,
+        .viewType            = type,
+        .format              = format,
+        .subresourceRange {
+            .aspectMask      = VK_IMAGE_ASPECT_DEPTH_BIT,
+            .baseMipLevel    = 0,
+            .levelCount      = 1,
+            .baseArrayLayer  = firstLayer,
+            .layerCount      = layerCount,
+        },
+    };
+
+    VkImageView view;
+    if (vkCreateImageView(device, &viewInfo, nullptr, &view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shadow image view!");
+    }
+
+    return view;
+}
+
+void ShadowMaps::createRenderPass()
+{
+    // Cleared, rendered, then left for the lit fragments to sample
+    VkAttachmentDescription depthAttachment {
+        .format         = format,
+        .samples        = VK_SAMPLE_COUNT_1_BIT,
+        .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
+        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+        .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+        .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+        .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+        .finalLayout    = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    VkAttachmentReference depthReference {
+        .attachment = 0,
+        .layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+    };
+
+    VkSubpassDescription subpassDescription {
+        .pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
+        .colorAttachmentCount    = 0,
+        .pDepthStencilAttachment = &depthReference,
+    };
+
+    VkSubpassDependency dependencies[2] {
+        // The previous frame's lit fragments are done sampling the layer
+        {
+            .srcSubpass      = VK_SUBPASS_EXTERNAL,
+            .dstSubpass      = 0,
+            .srcStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .srcAccessMask   = 0,
+            .dstAccessMask   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dependencyFlags = 0,
+        },
+        // And this frame's sample it once written
+        {
+            .srcSubpass      = 0,
+            .dstSubpass      = VK_SUBPASS_EXTERNAL,
+            .srcStageMask    = VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+            .srcAccessMask   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask   = VK_ACCESS_SHADER_READ_BIT,
+            .dependencyFlags = 0,
+        },
+    };
+
+    VkRenderPassCreateInfo renderPassInfo {
+        .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
+        .attachmentCount = 1,
+        .pAttachments    = &depthAttachment,
+        .subpassCount    = 1,
+        .pSubpasses      = &subpassDescription,
+        .dependencyCount = 2,
+        .pDependencies   = dependencies,
+    };
+
+    if (vkCreateRenderPass(device, &renderPassInfo, nullptr, &renderPass) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create shadow render pass!");
+    }
+
+    // Depth-only pipelines are looked up without a color format
+    pipelines.registerRenderPass(VK_FORMAT_UNDEFINED, format, VK_SAMPLE_COUNT_1_BIT, renderPass);
+}
+
+VkImageView ShadowMaps::getView() const
+{
+    return arrayView;
+}
+
+VkSampler ShadowMaps::getSampler() const
+{
+    return sampler;
+}
+
+VkBuffer ShadowMaps::getUniformBuffer(uint32_t frameIndex) const
+{
+    return uniformBuffers[frameIndex];
+}
+
+VkPipelineLayout ShadowMaps::getPipelineLayout() const
+{
+    return pipelineLayout;
+}
+
+VkPipeline ShadowMaps::getMeshPipeline() const
+{
+    return pipelines.get(meshPipeline);
+}
+
+VkPipeline ShadowMaps::getInstancedPipeline() const
+{
+    return pipelines.get(instancedPipeline);
+}
+
+void ShadowMaps::setLightDirection(const float direction[3])
+{
+    float norm = length(direction);
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        lightDirection[axis] = direction[axis] / norm;
+    }
+
+    // Looking down the light, from a unit away from the origin: only the orientation matters to the cascades
+    const float origin[3] = {0.0f, 0.0f, 0.0f};
+    const float up[3] = {0.0f, 1.0f, 0.0f};
+    const float side[3] = {1.0f, 0.0f, 0.0f};
+    lightView = lookAt(lightDirection, origin, std::abs(lightDirection[1]) > 0.99f ? side : up);
+
+    for (Cascade &cascade : cascades)
+    {
+        cascade.valid = false;
+    }
+}
+
+void ShadowMaps::setStaticBounds(const float center[3], float radius)
+{
+    std::copy(center, center + 3, staticCenter);
+    staticRadius = radius;
+
+    for (Cascade &cascade : cascades)
+    {
+        cascade.valid = false;
+    }
+}
+
+void ShadowMaps::fitCascade(uint32_t index, const Camera &camera, float aspect, float nearSplit, float farSplit)
+{
+    Cascade &cascade = cascades[index];
+    bool cached = index >= FirstCachedCascade;
+
+    // Sphere through the near and far corners of the slice, centered on the view axis: its radius only depends on the
+    // splits and the field of view
+    float tanHalfFov = std::tan(camera.fovY / 2);
+    float slope = tanHalfFov * tanHalfFov * (1.0f + aspect * aspect);
+    float centerDistance = std::min((farSplit + nearSplit) * (1.0f + slope) / 2, farSplit);
+    float radius = std::sqrt((farSplit - centerDistance) * (farSplit - centerDistance) + farSplit * farSplit * slope);
+
+    float forward[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        forward[axis] = camera.target[axis] - camera.position[axis];
+    }
+
+    float forwardLength = length(forward);
+    float center[3];
+    for (int axis = 0; axis < 3; axis++)
+    {
+        center[axis] = camera.position[axis] + forward[axis] / forwardLength * centerDistance;
+    }
+
+    float lightCenter[3];
+    transformPoint(lightView, center, lightCenter);
+
+    // Whole texels for the cascades rendered every frame; whole cells for the cached ones, whose sphere grows by a cell
+    // to keep covering the slice wherever it lies within it
+    if (cached)
+    {
+        radius *= 1.25f;
+    }
+
+    float texelSize = 2.0f * radius / MapSize;
+    float step = cached ? texelSize * CachedCellTexels : texelSize;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        lightCenter[axis] = std::floor(lightCenter[axis] / step + 0.5f) * step;
+    }
+
+    bool moved = !std::equal(lightCenter, lightCenter + 3, cascade.center) || radius != cascade.radius;
+
+    cascade.split = farSplit;
+
+    if (cached && cascade.valid && !moved)
+    {
+        cascade.render = false;
+        return;
+    }
+
+    // Light space looks down -Z: the box runs from whatever static geometry lies towards the light, to the far side
+    // of the sphere
+    float top = lightCenter[2] + radius;
+    float bottom = lightCenter[2] - radius;
+
+    if (staticRadius > 0.0f)
+    {
+        float staticLight[3];
+        transformPoint(lightView, staticCenter, staticLight);
+        top = std::max(top, staticLight[2] + staticRadius);
+    }
+
+    Mat4 projection = orthographic(
+        lightCenter[0] - radius, lightCenter[0] + radius, lightCenter[1] - radius, lightCenter[1] + radius, -top, -bottom);
+
+    cascade.viewProjection = multiply(projection, lightView);
+    std::copy(lightCenter, lightCenter + 3, cascade.center);
+    cascade.radius = radius;
+    cascade.texelSize = texelSize;
+    cascade.valid = false;
+    cascade.render = true;
+}
+
+void ShadowMaps::fit(const Camera &camera, float aspect)
+{
+    TRACE_ZONE("ShadowMaps::fit");
+
+    float nearPlane = camera.nearPlane;
+    float farPlane = camera.farPlane;
+
+    // Nothing past the static geometry casts or receives. Rounded up to a quarter of its radius, so that the splits,
+    // and the cached cascades with them, stay put as the camera moves a little
+    if (staticRadius > 0.0f)
+    {
+        float offset[3];
+        for (int axis = 0; axis < 3; axis++)
+        {
+            offset[axis] = staticCenter[axis] - camera.position[axis];
+        }
+
+        float step = staticRadius * 0.25f;
+        float reach = std::ceil((length(offset) + staticRadius) / step) * step;
+        farPlane = std::max(std::min(farPlane, reach), nearPlane * 2);
+    }
+
+    float previous = nearPlane;
+
+    for (uint32_t cascade = 0; cascade < CascadeCount; cascade++)
+    {
+        float ratio = float(cascade + 1) / CascadeCount;
+        float logarithmic = nearPlane * std::pow(farPlane / nearPlane, ratio);
+        float uniform = nearPlane + (farPlane - nearPlane) * ratio;
+        float split = SplitLambda * logarithmic + (1.0f - SplitLambda) * uniform;
+
+        fitCascade(cascade, camera, aspect, previous, split);
+        previous = split;
+    }
+}
+
+bool ShadowMaps::needsRender(uint32_t cascade) const
+{
+    return cascades[cascade].render;
+}
+
+const Mat4 &ShadowMaps::getViewProjection(uint32_t cascade) const
+{
+    return cascades[cascade].viewProjection;
+}
+
+float ShadowMaps::getTexelSize(uint32_t cascade) const
+{
+    return cascades[cascade].texelSize;
+}
+
+void ShadowMaps::record(VkCommandBuffer commandBuffer, uint32_t frameIndex, DrawList &drawList, bool castersReady)
+{
+    TRACE_ZONE("ShadowMaps::record");
+
+    // Lit pipelines may sample layers that were never rendered: every layer starts out in the layout they expect
+    if (!initialized)
+    {
+        VkImageMemoryBarrier barrier {
+            .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+            .srcAccessMask       = 0,
+            .dstAccessMask       = VK_ACCESS_SHADER_READ_BIT,
+            .oldLayout           = VK_IMAGE_LAYOUT_UNDEFINED,
+            .newLayout           = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+            .image               = image,
+            .subresourceRange {
+                .aspectMask      = VK_IMAGE_ASPECT_DEPTH_BIT,
+                .baseMipLevel    = 0,
+                .levelCount      = 1,
+                .baseArrayLayer  = 0,
+                .layerCount      = CascadeCount,
+            },
+        };
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0,
+            nullptr, 1, &barrier);
+
+        initialized = true;
+    }
+
+    ShadowUniforms &uniforms = *mappedUniforms[frameIndex];
+
+    if (!castersReady)
+    {
+        uniforms.cascadeCount = 0;
+        return;
+    }
+
+    VkClearValue clearValue {
+        .depthStencil = {1.0f, 0},
+    };
+
+    VkViewport viewport {
+        .x        = 0.0f,
+        .y        = 0.0f,
+        .width    = (float)MapSize,
+        .height   = (float)MapSize,
+        .minDepth = 0.0f,
+        .maxDepth = 1.0f,
+    };
+
+    VkRect2D scissor {
+        .offset = {0, 0},
+        .extent = {MapSize, MapSize},
+    };
+
+    for (uint32_t cascade = 0; cascade < CascadeCount; cascade++)
+    {
+        if (!cascades[cascade].render)
+        {
+            stats.cached++;
+            continue;
+        }
+
+        VkRenderPassBeginInfo renderPassInfo {
+            .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+            .renderPass      = renderPass,
+            .framebuffer     = framebuffers[cascade],
+            .renderArea      = scissor,
+            .clearValueCount = 1,
+            .pClearValues    = &clearValue,
+        };
+
+        vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
+        vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
+        drawList.record(commandBuffer, static_cast<DrawPass>(DrawPassShadow0 + cascade));
+        vkCmdEndRenderPass(commandBuffer);
+
+        cascades[cascade].valid = true;
+        cascades[cascade].render = false;
+        stats.rendered++;
+    }
+
+    for (uint32_t cascade = 0; cascade < CascadeCount; cascade++)
+    {
+        uniforms.viewProjection[cascade] = cascades[cascade].viewProjection;
+        uniforms.splits[cascade] = cascades[cascade].split;
+        uniforms.texelSizes[cascade] = cascades[cascade].texelSize;
+    }
+
+    std::copy(lightDirection, lightDirection + 3, uniforms.lightDirection);
+    uniforms.cascadeCount = CascadeCount;
+}
+
+ShadowStats ShadowMaps::takeStats()
+{
+    ShadowStats taken = stats;
+    stats = {};
+
+    return taken;
+}
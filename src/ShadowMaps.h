@@ -0,0 +1,148 @@
+#ifndef SHADOW_MAPS_H_
+#define SHADOW_MAPS_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "Camera.h"
+#include "DrawList.h"
+#include "MemoryBudget.h"
+#include "PipelineManager.h"
+
+// Push constants of the shadow vertex shaders, laid out as their block: 92 bytes, as InstanceConstants
+struct ShadowConstants
+{
+    Mat4 viewProjection;
+    float boundsMin[3];
+    uint32_t padding;
+    float boundsExtent[3];
+};
+
+// Uniform block of the shadows in the lighting shaders, std140: 304 bytes
+struct ShadowUniforms
+{
+    Mat4 viewProjection[4];
+    // View distance at which each cascade ends
+    float splits[4];
+    // World size of a texel of each cascade, for the normal offset of the lookups
+    float texelSizes[4];
+    // Towards the light
+    float lightDirection[3];
+    // 0 while the maps hold nothing, for lit shaders to skip them
+    uint32_t cascadeCount;
+};
+
+// Cascades rendered and reused from earlier frames since the statistics were last taken
+struct ShadowStats
+{
+    uint32_t rendered;
+    uint32_t cached;
+};
+
+// One directional light's cascaded shadow maps, the layers of one depth image array. Every frame the view range up
+// to the static geometry is split into cascades, each fitted by a sphere around its slice of the view frustum, so
+// that its size does not change as the camera turns, and moved by whole texels in light space, so that its texels
+// do not swim as the camera moves. The near cascades are rendered every frame. The far ones only hold static
+// geometry and are snapped to a coarser grid, over a margin as wide: they are only rendered again when they move to
+// another cell, when the light turns or when the static geometry changes, which bounds the shadow cost of a frame
+// to the near cascades most of the time. Casters are drawn by depth-only pipelines, without fragment shaders, with a
+// depth bias against acne
+class ShadowMaps
+{
+public:
+    static const uint32_t CascadeCount = 4;
+    // The last ones, at or after this index
+    static const uint32_t FirstCachedCascade = 2;
+    static const uint32_t MapSize = 2048;
+
+private:
+    struct Cascade
+    {
+        // What the map was or will be rendered with
+        Mat4 viewProjection;
+        float center[3];
+        float radius;
+        float texelSize;
+        float split;
+        bool valid;
+        bool render;
+    };
+
+    VkDevice device;
+    MemoryBudget &memory;
+    PipelineManager &pipelines;
+    uint32_t framesInFlight;
+
+    VkImage image;
+    VkFormat format;
+    VkImageView arrayView;
+    VkImageView layerViews[CascadeCount];
+    VkSampler sampler;
+    VkRenderPass renderPass;
+    VkFramebuffer framebuffers[CascadeCount];
+    bool initialized;
+
+    VkPipelineLayout pipelineLayout;
+    PipelineHandle meshPipeline;
+    PipelineHandle instancedPipeline;
+
+    // Per frame in flight, host visible and persistently mapped
+    std::vector<VkBuffer> uniformBuffers;
+    std::vector<VkDeviceMemory> uniformMemory;
+    std::vector<VkDeviceSize> uniformMemorySizes;
+    std::vector<uint32_t> uniformMemoryTypes;
+    std::vector<ShadowUniforms *> mappedUniforms;
+
+    float lightDirection[3];
+    Mat4 lightView;
+    // Bounding sphere of the static geometry, which every cascade's depth range takes in
+    float staticCenter[3];
+    float staticRadius;
+
+    Cascade cascades[CascadeCount];
+    ShadowStats stats;
+
+    VkImageView createView(VkImageViewType type, uint32_t firstLayer, uint32_t layerCount);
+    void createRenderPass();
+    void fitCascade(uint32_t cascade, const Camera &camera, float aspect, float nearSplit, float farSplit);
+
+public:
+    // image: a depth image of CascadeCount layers, MapSize texels square, which is rendered to and sampled
+    ShadowMaps(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, PipelineManager &pipelines,
+        VkImage image, VkFormat format, uint32_t framesInFlight);
+
+    // For set 1 of the lit draws
+    VkImageView getView() const;
+    VkSampler getSampler() const;
+    VkBuffer getUniformBuffer(uint32_t frameIndex) const;
+
+    // Depth-only pipelines for meshes in the binary format, drawn once or instanced as by InstanceRenderer, both
+    // pushing ShadowConstants to the vertex stage. Null while compiling
+    VkPipelineLayout getPipelineLayout() const;
+    VkPipeline getMeshPipeline() const;
+    VkPipeline getInstancedPipeline() const;
+
+    // Towards the light, normalized here; every cascade is rendered again when it changes
+    void setLightDirection(const float direction[3]);
+    // Whenever static geometry changes: cached cascades are rendered again
+    void setStaticBounds(const float center[3], float radius);
+
+    // Once per frame, before the casters are drawn: places the cascades and decides which ones to render
+    void fit(const Camera &camera, float aspect);
+    bool needsRender(uint32_t cascade) const;
+    const Mat4 &getViewProjection(uint32_t cascade) const;
+    float getTexelSize(uint32_t cascade) const;
+
+    // Outside any render pass, before the main one: renders the cascades that need it from the shadow passes of the
+    // draw list, and updates the frame's uniforms. Without casters ready nothing is rendered and lit draws go without
+    // shadows
+    void record(VkCommandBuffer commandBuffer, uint32_t frameIndex, DrawList &drawList, bool castersReady);
+
+    ShadowStats takeStats();
+
+    ~ShadowMaps();
+};
+
+#endif
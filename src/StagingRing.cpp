@@ -0,0 +1,179 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "StagingRing.h"
+
+StagingRing::StagingRing(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize capacity, uint32_t framesInFlight)
+{
+    this->device = device;
+    this->capacity = capacity;
+    head = 0;
+    tail = 0;
+    frameStart = 0;
+    frameEnds.resize(framesInFlight, 0);
+    frameIndex = 0;
+
+    VkBufferCreateInfo bufferInfo {
+        .sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+        .size        = capacity,
+        .usage       = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    };
+
+    if (vkCreateBuffer(device, &bufferInfo, nullptr, &buffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create staging buffer!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetBufferMemoryRequirements(device, buffer, &memRequirements);
+
+    VkPhysicalDeviceMemoryProperties memProperties;
+    vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+    nonCoherentAtomSize = properties.limits.nonCoherentAtomSize;
+
+    // Coherent memory saves the explicit flushes; any host visible type works with them
+    const VkMemoryPropertyFlags preferences[] {
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT,
+    };
+
+    uint32_t memoryType = UINT32_MAX;
+
+    for (VkMemoryPropertyFlags preference : preferences)
+    {
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount && memoryType == UINT32_MAX; i++)
+        {
+            VkMemoryPropertyFlags flags = memProperties.memoryTypes[i].propertyFlags;
+
+            if ((memRequirements.memoryTypeBits & (1 << i)) && (flags & preference) == preference)
+            {
+                memoryType = i;
+                coherent = flags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
+            }
+        }
+    }
+
+    if (memoryType == UINT32_MAX)
+    {
+        throw std::runtime_error("Failed to find host visible memory for staging!");
+    }
+
+    VkMemoryAllocateInfo allocInfo {
+        .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+        .allocationSize  = memRequirements.size,
+        .memoryTypeIndex = memoryType,
+    };
+
+    if (vkAllocateMemory(device, &allocInfo, nullptr, &memory) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate staging memory!");
+    }
+
+    vkBindBufferMemory(device, buffer, memory, 0);
+
+    void *address;
+    if (vkMapMemory(device, memory, 0, VK_WHOLE_SIZE, 0, &address) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to map staging memory!");
+    }
+
+    mapped = static_cast<uint8_t *>(address);
+}
+
+StagingRing::~StagingRing()
+{
+    vkUnmapMemory(device, memory);
+    vkDestroyBuffer(device, buffer, nullptr);
+    vkFreeMemory(device, memory, nullptr);
+}
+
+void StagingRing::beginFrame(uint32_t frameIndex)
+{
+    this->frameIndex = frameIndex;
+
+    // Frames complete in submission order: the slot's previous end is as far as the GPU is known to have read
+    tail = std::max(tail, frameEnds[frameIndex]);
+    frameStart = head;
+}
+
+bool StagingRing::allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation)
+{
+    if (size > capacity)
+    {
+        return false;
+    }
+
+    uint64_t start = (head + alignment - 1) / alignment * alignment;
+
+    // Allocations never straddle the end of the buffer: skip to its beginning instead
+    if (start % capacity + size > capacity)
+    {
+        start = (start / capacity + 1) * capacity;
+    }
+
+    if (start + size - tail > capacity)
+    {
+        return false;
+    }
+
+    head = start + size;
+    frameEnds[frameIndex] = head;
+
+    *allocation = {buffer, start % capacity, mapped + start % capacity};
+    return true;
+}
+
+void StagingRing::flush()
+{
+    if (coherent || head == frameStart)
+    {
+        return;
+    }
+
+    // Non-coherent ranges must be flushed in whole atoms
+    std::vector<VkMappedMemoryRange> ranges;
+
+    auto addRange = [&](VkDeviceSize begin, VkDeviceSize end) {
+        begin = begin / nonCoherentAtomSize * nonCoherentAtomSize;
+        end = std::min((end + nonCoherentAtomSize - 1) / nonCoherentAtomSize * nonCoherentAtomSize, capacity);
+
+        ranges.push_back({
+            .sType  = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE,
+            .memory = memory,
+            .offset = begin,
+            .size   = end == capacity ? VK_WHOLE_SIZE : end - begin,
+        });
+    };
+
+    uint64_t begin = frameStart % capacity;
+    uint64_t end = head % capacity;
+
+    if (head - frameStart >= capacity)
+    {
+        addRange(0, capacity);
+    }
+    else if (begin < end)
+    {
+        addRange(begin, end);
+    }
+    else
+    {
+        addRange(begin, capacity);
+        if (end > 0)
+        {
+            addRange(0, end);
+        }
+    }
+
+    vkFlushMappedMemoryRanges(device, static_cast<uint32_t>(ranges.size()), ranges.data());
+    frameStart = head;
+}
+
+VkDeviceSize StagingRing::getCapacity() const
+{
+    return capacity;
+}
@@ -0,0 +1,51 @@
+#ifndef STAGING_RING_H_
+#define STAGING_RING_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+struct StagingAllocation
+{
+    VkBuffer buffer;
+    VkDeviceSize offset;
+    uint8_t *mapped;
+};
+
+// Persistently mapped upload buffer used as a ring: space written during a frame is reclaimed once the fence of
+// that frame slot has been waited on, so uploads never allocate and never wait for the GPU
+class StagingRing
+{
+private:
+    VkDevice device;
+    VkBuffer buffer;
+    VkDeviceMemory memory;
+    uint8_t *mapped;
+    VkDeviceSize capacity;
+    bool coherent;
+    VkDeviceSize nonCoherentAtomSize;
+
+    // Monotonic byte positions: offsets in the buffer are taken modulo the capacity
+    uint64_t head;
+    uint64_t tail;
+    uint64_t frameStart;
+    std::vector<uint64_t> frameEnds;
+    uint32_t frameIndex;
+
+public:
+    StagingRing(VkDevice device, VkPhysicalDevice physicalDevice, VkDeviceSize capacity, uint32_t framesInFlight);
+
+    // After the fence of `frameIndex` has been waited on: everything that slot used before is free again
+    void beginFrame(uint32_t frameIndex);
+    // False when the ring is full for this frame: the caller retries on a later one
+    bool allocate(VkDeviceSize size, VkDeviceSize alignment, StagingAllocation *allocation);
+    // Before the command buffer reading this frame's allocations is submitted
+    void flush();
+
+    VkDeviceSize getCapacity() const;
+
+    ~StagingRing();
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include <algorithm>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "SubmitScheduler.h"
+#include "Trace.h"
+
+// Stages of the legacy wait masks: synchronization2 keeps their bits and adds finer ones above 32 bits, which only
+// ALL_COMMANDS covers
+static VkPipelineStageFlags legacyStages(VkPipelineStageFlags2 stages)
+{
+    VkPipelineStageFlags legacy = static_cast<VkPipelineStageFlags>(stages & 0xFFFFFFFFull);
+
+    if ((stages >> 32) != 0 || legacy == 0)
+    {
+        legacy |= VK_PIPELINE_STAGE_ALL_COMMANDS_BIT;
+    }
+
+    return legacy;
+}
+
+SubmitScheduler::SubmitScheduler(VkDevice device, VkQueue queue, bool synchronization2)
+{
+    this->queue = queue;
+
+    queueSubmit2 = nullptr;
+    batch = 0;
+    stats = {};
+
+    if (synchronization2)
+    {
+        queueSubmit2 = (PFN_vkQueueSubmit2)vkGetDeviceProcAddr(device, "vkQueueSubmit2KHR");
+
+        if (queueSubmit2 == nullptr)
+        {
+            throw std::runtime_error("Failed to load vkQueueSubmit2KHR!");
+        }
+    }
+}
+
+void SubmitScheduler::add(VkCommandBuffer commandBuffer, uint32_t order)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    commandBuffers.push_back({batch, order, static_cast<uint32_t>(commandBuffers.size()), commandBuffer});
+}
+
+void SubmitScheduler::wait(VkSemaphore semaphore, VkPipelineStageFlags2 stages)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    waits.push_back({batch, semaphore, stages});
+}
+
+void SubmitScheduler::signal(VkSemaphore semaphore, VkPipelineStageFlags2 stages)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    signals.push_back({batch, semaphore, stages});
+    batch++;
+}
+
+void SubmitScheduler::flush(FrameArena &arena, VkFence fence)
+{
+    TRACE_ZONE("SubmitScheduler::flush");
+
+    std::lock_guard<std::mutex> lock(mutex);
+
+    if (commandBuffers.empty() && waits.empty() && signals.empty() && fence == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    std::sort(commandBuffers.begin(), commandBuffers.end(), [](const auto &a, const auto &b) {
+        return std::tie(a.batch, a.order, a.sequence) < std::tie(b.batch, b.order, b.sequence);
+    });
+
+    if (queueSubmit2 != nullptr)
+    {
+        submit(arena, fence);
+    }
+    else
+    {
+        submitLegacy(arena, fence);
+    }
+
+    commandBuffers.clear();
+    waits.clear();
+    signals.clear();
+    batch = 0;
+}
+
+// Batches left empty by the last signal are not submitted
+uint32_t SubmitScheduler::countBatches() const
+{
+    uint32_t batchCount = 0;
+    for (const auto &pending : commandBuffers)
+    {
+        batchCount = std::max(batchCount, pending.batch + 1);
+    }
+    for (const auto &pending : waits)
+    {
+        batchCount = std::max(batchCount, pending.batch + 1);
+    }
+    for (const auto &pending : signals)
+    {
+        batchCount = std::max(batchCount, pending.batch + 1);
+    }
+
+    return batchCount;
+}
+
+// Batches are numbered in the order they were filled, and the waits and signals were added in that order too: each
+// batch takes a contiguous run of every array
+void SubmitScheduler::submit(FrameArena &arena, VkFence fence)
+{
+    uint32_t batchCount = countBatches();
+
+    VkSubmitInfo2 *submitInfos = arena.allocate<VkSubmitInfo2>(batchCount);
+    VkCommandBufferSubmitInfo *commandBufferInfos = arena.allocate<VkCommandBufferSubmitInfo>(commandBuffers.size());
+    VkSemaphoreSubmitInfo *waitInfos = arena.allocate<VkSemaphoreSubmitInfo>(waits.size());
+    VkSemaphoreSubmitInfo *signalInfos = arena.allocate<VkSemaphoreSubmitInfo>(signals.size());
+
+    for (uint32_t i = 0; i < batchCount; i++)
+    {
+        submitInfos[i] = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2,
+        };
+    }
+
+    for (size_t i = 0; i < commandBuffers.size(); i++)
+    {
+        VkSubmitInfo2 &submitInfo = submitInfos[commandBuffers[i].batch];
+
+        commandBufferInfos[i] = {
+            .sType         = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO,
+            .commandBuffer = commandBuffers[i].commandBuffer,
+        };
+
+        if (submitInfo.commandBufferInfoCount++ == 0)
+        {
+            submitInfo.pCommandBufferInfos = &commandBufferInfos[i];
+        }
+    }
+
+    for (size_t i = 0; i < waits.size(); i++)
+    {
+        VkSubmitInfo2 &submitInfo = submitInfos[waits[i].batch];
+
+        waitInfos[i] = {
+            .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = waits[i].semaphore,
+            .stageMask = waits[i].stages,
+        };
+
+        if (submitInfo.waitSemaphoreInfoCount++ == 0)
+        {
+            submitInfo.pWaitSemaphoreInfos = &waitInfos[i];
+        }
+    }
+
+    for (size_t i = 0; i < signals.size(); i++)
+    {
+        VkSubmitInfo2 &submitInfo = submitInfos[signals[i].batch];
+
+        signalInfos[i] = {
+            .sType     = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO,
+            .semaphore = signals[i].semaphore,
+            .stageMask = signals[i].stages,
+        };
+
+        if (submitInfo.signalSemaphoreInfoCount++ == 0)
+        {
+            submitInfo.pSignalSemaphoreInfos = &signalInfos[i];
+        }
+    }
+
+    if (queueSubmit2(queue, batchCount, submitInfos, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit command buffers!");
+    }
+
+    stats.submits++;
+    stats.batches += batchCount;
+    stats.commandBuffers += static_cast<uint32_t>(commandBuffers.size());
+}
+
+void SubmitScheduler::submitLegacy(FrameArena &arena, VkFence fence)
+{
+    uint32_t batchCount = countBatches();
+
+    VkSubmitInfo *submitInfos = arena.allocate<VkSubmitInfo>(batchCount);
+    VkCommandBuffer *commandBufferHandles = arena.allocate<VkCommandBuffer>(commandBuffers.size());
+    VkSemaphore *waitSemaphores = arena.allocate<VkSemaphore>(waits.size());
+    VkPipelineStageFlags *waitStages = arena.allocate<VkPipelineStageFlags>(waits.size());
+    VkSemaphore *signalSemaphores = arena.allocate<VkSemaphore>(signals.size());
+
+    for (uint32_t i = 0; i < batchCount; i++)
+    {
+        submitInfos[i] = {
+            .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        };
+    }
+
+    for (size_t i = 0; i < commandBuffers.size(); i++)
+    {
+        VkSubmitInfo &submitInfo = submitInfos[commandBuffers[i].batch];
+        commandBufferHandles[i] = commandBuffers[i].commandBuffer;
+
+        if (submitInfo.commandBufferCount++ == 0)
+        {
+            submitInfo.pCommandBuffers = &commandBufferHandles[i];
+        }
+    }
+
+    for (size_t i = 0; i < waits.size(); i++)
+    {
+        VkSubmitInfo &submitInfo = submitInfos[waits[i].batch];
+        waitSemaphores[i] = waits[i].semaphore;
+        waitStages[i] = legacyStages(waits[i].stages);
+
+        if (submitInfo.waitSemaphoreCount++ == 0)
+        {
+            submitInfo.pWaitSemaphores = &waitSemaphores[i];
+            submitInfo.pWaitDstStageMask = &waitStages[i];
+        }
+    }
+
+    // Legacy signals happen once the whole batch has completed, whatever the stages
+    for (size_t i = 0; i < signals.size(); i++)
+    {
+        VkSubmitInfo &submitInfo = submitInfos[signals[i].batch];
+        signalSemaphores[i] = signals[i].semaphore;
+
+        if (submitInfo.signalSemaphoreCount++ == 0)
+        {
+            submitInfo.pSignalSemaphores = &signalSemaphores[i];
+        }
+    }
+
+    if (vkQueueSubmit(queue, batchCount, submitInfos, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit command buffers!");
+    }
+
+    stats.submits++;
+    stats.batches += batchCount;
+    stats.commandBuffers += static_cast<uint32_t>(commandBuffers.size());
+}
+
+bool SubmitScheduler::usesSynchronization2() const
+{
+    return queueSubmit2 != nullptr;
+}
+
+SubmitStats SubmitScheduler::takeStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    return std::exchange(stats, {});
+}
@@ -0,0 +1,81 @@
+#ifndef SUBMIT_SCHEDULER_H_
+#define SUBMIT_SCHEDULER_H_
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "FrameArena.h"
+
+// Queue submissions made by the scheduler since the statistics were last taken
+struct SubmitStats
+{
+    uint32_t submits;
+    uint32_t batches;
+    uint32_t commandBuffers;
+};
+
+// Collects the command buffers of one queue, from any pass and any thread, and hands them to the queue in as few
+// calls as possible: everything added between two flushes goes in a single vkQueueSubmit2, one batch per signal.
+// Semaphore waits and signals carry synchronization2 stage masks, so that waiting on e.g. the swapchain image only
+// holds back the stages writing to it, and the rest of the batch runs meanwhile. A frame flushes once early, as soon
+// as the work not depending on the swapchain image is recorded, and once late, with its fence. Without
+// VK_KHR_synchronization2 the same batches go through vkQueueSubmit, with wait stages mapped to the legacy ones
+class SubmitScheduler
+{
+private:
+    struct PendingCommandBuffer
+    {
+        uint32_t batch;
+        uint32_t order;
+        uint32_t sequence;
+        VkCommandBuffer commandBuffer;
+    };
+
+    struct PendingSemaphore
+    {
+        uint32_t batch;
+        VkSemaphore semaphore;
+        VkPipelineStageFlags2 stages;
+    };
+
+    VkQueue queue;
+    // Null without synchronization2
+    PFN_vkQueueSubmit2 queueSubmit2;
+
+    std::mutex mutex;
+    std::vector<PendingCommandBuffer> commandBuffers;
+    std::vector<PendingSemaphore> waits;
+    std::vector<PendingSemaphore> signals;
+    // The batch being filled, closed by a signal
+    uint32_t batch;
+    SubmitStats stats;
+
+    uint32_t countBatches() const;
+    void submit(FrameArena &arena, VkFence fence);
+    void submitLegacy(FrameArena &arena, VkFence fence);
+
+public:
+    SubmitScheduler(VkDevice device, VkQueue queue, bool synchronization2);
+
+    // Thread safe. Within a batch command buffers run by increasing order, then in the order they were added, so that
+    // passes recorded on different threads keep their dependencies
+    void add(VkCommandBuffer commandBuffer, uint32_t order = 0);
+    // Thread safe. The batch being filled waits on the semaphore before any of the stages, in any of its command
+    // buffers, earlier or later ones
+    void wait(VkSemaphore semaphore, VkPipelineStageFlags2 stages);
+    // Thread safe. Signaled once the stages of the batch being filled are done; later command buffers go in a new batch
+    void signal(VkSemaphore semaphore, VkPipelineStageFlags2 stages);
+
+    // Submits everything added so far, the submit infos built in the frame's arena; the fence, if any, signals once
+    // it has all completed. Calls nothing when there is nothing to submit nor fence to signal
+    void flush(FrameArena &arena, VkFence fence = VK_NULL_HANDLE);
+
+    bool usesSynchronization2() const;
+    // Statistics since the last call
+    SubmitStats takeStats();
+};
+
+#endif
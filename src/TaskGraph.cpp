@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <numeric>
+
+#include "Logger.h"
+#include "TaskGraph.h"
+#include "Trace.h"
+
+TaskId TaskGraph::add(const char *name, std::function<void()> work, std::initializer_list<TaskId> dependencies)
+{
+    TaskId id = tasks.size();
+    tasks.push_back({name, std::move(work), false, {}, static_cast<uint32_t>(dependencies.size()), 0, 0});
+
+    for (TaskId dependency : dependencies)
+    {
+        tasks[dependency].dependents.push_back(id);
+    }
+
+    return id;
+}
+
+TaskId TaskGraph::addMainThread(const char *name, std::function<void()> work, std::initializer_list<TaskId> dependencies)
+{
+    TaskId id = add(name, std::move(work), dependencies);
+    tasks[id].mainThread = true;
+
+    return id;
+}
+
+// Called with the mutex held
+void TaskGraph::schedule(ThreadPool &pool, TaskId id)
+{
+    runningTasks++;
+
+    if (tasks[id].mainThread)
+    {
+        mainThreadQueue.push(id);
+        changed.notify_all();
+    }
+    else
+    {
+        pool.submit([this, &pool, id] { execute(pool, id); });
+    }
+}
+
+void TaskGraph::execute(ThreadPool &pool, TaskId id)
+{
+    Task &task = tasks[id];
+    task.start = Trace::now();
+
+    std::exception_ptr error;
+    try
+    {
+        task.work();
+    }
+    catch (...)
+    {
+        error = std::current_exception();
+    }
+
+    task.end = Trace::now();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    finishedTasks++;
+    runningTasks--;
+
+    if (error && !failure)
+    {
+        failure = error;
+    }
+
+    // After a failure nothing new is started, so dependents of the failed step never observe its missing results
+    if (!failure)
+    {
+        for (TaskId dependent : task.dependents)
+        {
+            if (--tasks[dependent].remainingDependencies == 0)
+            {
+                schedule(pool, dependent);
+            }
+        }
+    }
+
+    changed.notify_all();
+}
+
+void TaskGraph::run(ThreadPool &pool)
+{
+    std::unique_lock<std::mutex> lock(mutex);
+
+    finishedTasks = 0;
+    runningTasks = 0;
+    failure = nullptr;
+    startTime = Trace::now();
+
+    for (TaskId id = 0; id < tasks.size(); id++)
+    {
+        if (tasks[id].remainingDependencies == 0)
+        {
+            schedule(pool, id);
+        }
+    }
+
+    for (;;)
+    {
+        changed.wait(lock, [this] {
+            return !mainThreadQueue.empty() || finishedTasks == tasks.size() || (failure && runningTasks == 0);
+        });
+
+        if (mainThreadQueue.empty())
+        {
+            break;
+        }
+
+        TaskId id = mainThreadQueue.front();
+        mainThreadQueue.pop();
+
+        if (failure)
+        {
+            runningTasks--;
+            continue;
+        }
+
+        lock.unlock();
+        execute(pool, id);
+        lock.lock();
+    }
+
+    endTime = Trace::now();
+
+    if (failure)
+    {
+        std::rethrow_exception(failure);
+    }
+}
+
+void TaskGraph::report(const char *title) const
+{
+    std::vector<TaskId> order(tasks.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [this](TaskId a, TaskId b) { return tasks[a].start < tasks[b].start; });
+
+    double busy = 0.0;
+    for (const auto &task : tasks)
+    {
+        busy += (task.end - task.start) / 1e6;
+    }
+
+    LOG_INFO("{}: {:.2f} ms ({:.2f} ms of work over {} steps)", title, (endTime - startTime) / 1e6, busy, tasks.size());
+
+    for (TaskId id : order)
+    {
+        const Task &task = tasks[id];
+        LOG_INFO("  {:<40} {:8.2f} ms  at +{:.2f} ms{}", task.name, (task.end - task.start) / 1e6,
+            (task.start - startTime) / 1e6, task.mainThread ? "  [main thread]" : "");
+    }
+}
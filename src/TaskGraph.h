@@ -0,0 +1,57 @@
+#ifndef TASK_GRAPH_H_
+#define TASK_GRAPH_H_
+
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <mutex>
+#include <queue>
+#include <vector>
+
+#include "ThreadPool.h"
+
+typedef size_t TaskId;
+
+// One-shot dependency graph: each task starts on the pool as soon as the tasks it depends on have finished.
+// Tasks flagged as main thread ones (e.g. windowing calls) run on the thread calling run()
+class TaskGraph
+{
+private:
+    struct Task
+    {
+        const char *name;
+        std::function<void()> work;
+        bool mainThread;
+        std::vector<TaskId> dependents;
+        uint32_t remainingDependencies;
+        uint64_t start;
+        uint64_t end;
+    };
+
+    std::vector<Task> tasks;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::queue<TaskId> mainThreadQueue;
+    size_t finishedTasks;
+    size_t runningTasks;
+    std::exception_ptr failure;
+    uint64_t startTime;
+    uint64_t endTime;
+
+    void schedule(ThreadPool &pool, TaskId id);
+    void execute(ThreadPool &pool, TaskId id);
+
+public:
+    TaskId add(const char *name, std::function<void()> work, std::initializer_list<TaskId> dependencies = {});
+    TaskId addMainThread(const char *name, std::function<void()> work, std::initializer_list<TaskId> dependencies = {});
+
+    // Blocks until every task has run; rethrows the first exception once running tasks have drained
+    void run(ThreadPool &pool);
+
+    // Logs the time spent in each task, in start order
+    void report(const char *title) const;
+};
+
+#endif
@@ -0,0 +1,277 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "TextureFile.h"
+
+static const uint8_t ktx2Identifier[12] {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+static uint32_t fourCC(const char (&code)[5])
+{
+    return code[0] | (code[1] << 8) | (code[2] << 16) | (code[3] << 24);
+}
+
+// Little-endian fields at any alignment
+template <typename T> static T read(const MappedFile &file, size_t offset)
+{
+    if (offset + sizeof(T) > file.size())
+    {
+        throw std::runtime_error("Truncated texture file!");
+    }
+
+    T value;
+    memcpy(&value, file.data() + offset, sizeof(T));
+    return value;
+}
+
+static const uint8_t *range(const MappedFile &file, uint64_t offset, uint64_t size)
+{
+    if (offset > file.size() || size > file.size() - offset)
+    {
+        throw std::runtime_error("Truncated texture file!");
+    }
+
+    return file.data() + offset;
+}
+
+bool getFormatBlock(VkFormat format, FormatBlock *block)
+{
+    switch (format)
+    {
+    case VK_FORMAT_R8_UNORM:
+        *block = {1, 1, 1};
+        return true;
+    case VK_FORMAT_R8G8_UNORM:
+        *block = {2, 1, 1};
+        return true;
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+    case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
+    case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
+    case VK_FORMAT_R32_SFLOAT:
+        *block = {4, 1, 1};
+        return true;
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        *block = {8, 1, 1};
+        return true;
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        *block = {16, 1, 1};
+        return true;
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        *block = {8, 4, 4};
+        return true;
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        *block = {16, 4, 4};
+        return true;
+    default:
+        return false;
+    }
+}
+
+static size_t levelSize(VkFormat format, uint32_t width, uint32_t height, uint32_t level)
+{
+    FormatBlock block;
+    getFormatBlock(format, &block);
+
+    uint32_t levelWidth = std::max(width >> level, 1u);
+    uint32_t levelHeight = std::max(height >> level, 1u);
+
+    return static_cast<size_t>((levelWidth + block.width - 1) / block.width) *
+           ((levelHeight + block.height - 1) / block.height) * block.bytes;
+}
+
+static TextureFile parseKtx2(const MappedFile &file)
+{
+    TextureFile texture {};
+    texture.format = static_cast<VkFormat>(read<uint32_t>(file, 12));
+    texture.width = read<uint32_t>(file, 20);
+    texture.height = std::max(read<uint32_t>(file, 24), 1u);
+    uint32_t depth = read<uint32_t>(file, 28);
+    texture.layers = std::max(read<uint32_t>(file, 32), 1u);
+    texture.faces = read<uint32_t>(file, 36);
+    uint32_t levelCount = read<uint32_t>(file, 40);
+    uint32_t supercompression = read<uint32_t>(file, 44);
+
+    FormatBlock block;
+    if (!getFormatBlock(texture.format, &block))
+    {
+        throw std::runtime_error("Unsupported KTX2 format!");
+    }
+
+    if (supercompression != 0 || depth > 1 || (texture.faces != 1 && texture.faces != 6))
+    {
+        throw std::runtime_error("Unsupported KTX2 texture (supercompressed, 3D or invalid faces)!");
+    }
+
+    // A level count of 0 asks the loader to generate the mip chain
+    texture.generateMips = levelCount == 0;
+    texture.levels = std::max(levelCount, 1u);
+
+    uint32_t images = texture.layers * texture.faces;
+
+    for (uint32_t level = 0; level < texture.levels; level++)
+    {
+        size_t entry = 80 + level * 24;
+        uint64_t offset = read<uint64_t>(file, entry);
+        uint64_t length = read<uint64_t>(file, entry + 8);
+        const uint8_t *data = range(file, offset, length);
+
+        // Within a level, the images of every layer and face follow each other without padding
+        size_t imageSize = levelSize(texture.format, texture.width, texture.height, level);
+        if (imageSize * images > length)
+        {
+            throw std::runtime_error("Truncated KTX2 level!");
+        }
+
+        for (uint32_t layer = 0; layer < images; layer++)
+        {
+            texture.regions.push_back({level, layer, data + layer * imageSize, imageSize});
+        }
+    }
+
+    return texture;
+}
+
+static VkFormat formatFromDxgi(uint32_t dxgiFormat)
+{
+    switch (dxgiFormat)
+    {
+    case 2:  return VK_FORMAT_R32G32B32A32_SFLOAT;
+    case 10: return VK_FORMAT_R16G16B16A16_SFLOAT;
+    case 24: return VK_FORMAT_A2B10G10R10_UNORM_PACK32;
+    case 26: return VK_FORMAT_B10G11R11_UFLOAT_PACK32;
+    case 28: return VK_FORMAT_R8G8B8A8_UNORM;
+    case 29: return VK_FORMAT_R8G8B8A8_SRGB;
+    case 41: return VK_FORMAT_R32_SFLOAT;
+    case 49: return VK_FORMAT_R8G8_UNORM;
+    case 61: return VK_FORMAT_R8_UNORM;
+    case 71: return VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+    case 72: return VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    case 74: return VK_FORMAT_BC2_UNORM_BLOCK;
+    case 75: return VK_FORMAT_BC2_SRGB_BLOCK;
+    case 77: return VK_FORMAT_BC3_UNORM_BLOCK;
+    case 78: return VK_FORMAT_BC3_SRGB_BLOCK;
+    case 80: return VK_FORMAT_BC4_UNORM_BLOCK;
+    case 81: return VK_FORMAT_BC4_SNORM_BLOCK;
+    case 83: return VK_FORMAT_BC5_UNORM_BLOCK;
+    case 84: return VK_FORMAT_BC5_SNORM_BLOCK;
+    case 87: return VK_FORMAT_B8G8R8A8_UNORM;
+    case 91: return VK_FORMAT_B8G8R8A8_SRGB;
+    case 95: return VK_FORMAT_BC6H_UFLOAT_BLOCK;
+    case 96: return VK_FORMAT_BC6H_SFLOAT_BLOCK;
+    case 98: return VK_FORMAT_BC7_UNORM_BLOCK;
+    case 99: return VK_FORMAT_BC7_SRGB_BLOCK;
+    default: return VK_FORMAT_UNDEFINED;
+    }
+}
+
+static TextureFile parseDds(const MappedFile &file)
+{
+    const uint32_t pixelFormatFourCC = 0x4;
+    const uint32_t pixelFormatRgb = 0x40;
+    const uint32_t cubemap = 0x200;
+    const uint32_t dx10MiscCube = 0x4;
+
+    TextureFile texture {};
+    texture.height = read<uint32_t>(file, 12);
+    texture.width = read<uint32_t>(file, 16);
+    texture.levels = std::max(read<uint32_t>(file, 28), 1u);
+    texture.layers = 1;
+    texture.faces = read<uint32_t>(file, 112) & cubemap ? 6 : 1;
+    texture.format = VK_FORMAT_UNDEFINED;
+
+    uint32_t pixelFlags = read<uint32_t>(file, 80);
+    uint32_t code = read<uint32_t>(file, 84);
+    size_t dataOffset = 128;
+
+    if ((pixelFlags & pixelFormatFourCC) && code == fourCC("DX10"))
+    {
+        texture.format = formatFromDxgi(read<uint32_t>(file, 128));
+        texture.faces = read<uint32_t>(file, 136) & dx10MiscCube ? 6 : 1;
+        texture.layers = std::max(read<uint32_t>(file, 140), 1u);
+        dataOffset = 148;
+    }
+    else if (pixelFlags & pixelFormatFourCC)
+    {
+        if (code == fourCC("DXT1"))
+        {
+            texture.format = VK_FORMAT_BC1_RGBA_UNORM_BLOCK;
+        }
+        else if (code == fourCC("DXT2") || code == fourCC("DXT3"))
+        {
+            texture.format = VK_FORMAT_BC2_UNORM_BLOCK;
+        }
+        else if (code == fourCC("DXT4") || code == fourCC("DXT5"))
+        {
+            texture.format = VK_FORMAT_BC3_UNORM_BLOCK;
+        }
+        else if (code == fourCC("ATI1") || code == fourCC("BC4U"))
+        {
+            texture.format = VK_FORMAT_BC4_UNORM_BLOCK;
+        }
+        else if (code == fourCC("ATI2") || code == fourCC("BC5U"))
+        {
+            texture.format = VK_FORMAT_BC5_UNORM_BLOCK;
+        }
+    }
+    else if ((pixelFlags & pixelFormatRgb) && read<uint32_t>(file, 88) == 32)
+    {
+        uint32_t redMask = read<uint32_t>(file, 92);
+        texture.format = redMask == 0x000000FF ? VK_FORMAT_R8G8B8A8_UNORM :
+                         redMask == 0x00FF0000 ? VK_FORMAT_B8G8R8A8_UNORM : VK_FORMAT_UNDEFINED;
+    }
+
+    if (texture.format == VK_FORMAT_UNDEFINED)
+    {
+        throw std::runtime_error("Unsupported DDS format!");
+    }
+
+    // DDS files without a mip chain get one generated
+    texture.generateMips = texture.levels == 1;
+
+    // Stored layer by layer (faces included), each with its whole mip chain
+    size_t offset = dataOffset;
+
+    for (uint32_t layer = 0; layer < texture.layers * texture.faces; layer++)
+    {
+        for (uint32_t level = 0; level < texture.levels; level++)
+        {
+            size_t size = levelSize(texture.format, texture.width, texture.height, level);
+            texture.regions.push_back({level, layer, range(file, offset, size), size});
+            offset += size;
+        }
+    }
+
+    return texture;
+}
+
+TextureFile parseTextureFile(const MappedFile &file)
+{
+    if (file.size() >= sizeof(ktx2Identifier) && memcmp(file.data(), ktx2Identifier, sizeof(ktx2Identifier)) == 0)
+    {
+        return parseKtx2(file);
+    }
+
+    if (file.size() >= 128 && read<uint32_t>(file, 0) == fourCC("DDS "))
+    {
+        return parseDds(file);
+    }
+
+    throw std::runtime_error("Unknown texture file format (expected KTX2 or DDS)!");
+}
@@ -0,0 +1,47 @@
+#ifndef TEXTURE_FILE_H_
+#define TEXTURE_FILE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "MappedFile.h"
+
+// One mip level of one layer (array layer * face count + face), pointing into the mapped file
+struct TextureRegion
+{
+    uint32_t level;
+    uint32_t layer;
+    const uint8_t *data;
+    size_t size;
+};
+
+struct TextureFile
+{
+    VkFormat format;
+    uint32_t width;
+    uint32_t height;
+    uint32_t layers;
+    uint32_t faces;
+    uint32_t levels;
+    // The file stores only the base level and asks for the rest of the chain to be generated
+    bool generateMips;
+    std::vector<TextureRegion> regions;
+};
+
+struct FormatBlock
+{
+    uint32_t bytes;
+    uint32_t width;
+    uint32_t height;
+};
+
+// Size of a texel block for the formats that can be loaded; false for anything else
+bool getFormatBlock(VkFormat format, FormatBlock *block);
+
+// KTX2 (without supercompression) or DDS, recognized by their magic. Throws on unsupported or truncated files
+TextureFile parseTextureFile(const MappedFile &file);
+
+#endif
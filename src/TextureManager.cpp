@@ -0,0 +1,606 @@
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#include "Logger.h"
+#include "TextureManager.h"
+#include "Trace.h"
+
+static const VkPipelineStageFlags ShaderStages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+
+static VkImageMemoryBarrier layoutBarrier(
+    VkImage image, uint32_t baseLevel, uint32_t levelCount, uint32_t layerCount, VkImageLayout oldLayout,
+    VkImageLayout newLayout, VkAccessFlags srcAccess, VkAccessFlags dstAccess)
+{
+    return {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask       = srcAccess,
+        .dstAccessMask       = dstAccess,
+        .oldLayout           = oldLayout,
+        .newLayout           = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image               = image,
+        .subresourceRange {
+            .aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel    = baseLevel,
+            .levelCount      = levelCount,
+            .baseArrayLayer  = 0,
+            .layerCount      = layerCount,
+        },
+    };
+}
+
+TextureManager::TextureManager(
+    VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, uint32_t framesInFlight,
+    VkDeviceSize stagingSize, VkDeviceSize uploadBudget)
+    : memory(memory), staging(device, physicalDevice, stagingSize, framesInFlight)
+{
+    this->device = device;
+    this->physicalDevice = physicalDevice;
+    this->framesInFlight = framesInFlight;
+    this->uploadBudget = uploadBudget;
+    frameNumber = 0;
+}
+
+TextureManager::~TextureManager()
+{
+    for (auto &retired : retiredViews)
+    {
+        vkDestroyImageView(device, retired.view, nullptr);
+    }
+
+    for (auto &retired : retiredImages)
+    {
+        vkDestroyImage(device, retired.image, nullptr);
+        memory.free(retired.memory, retired.size, retired.memoryType);
+    }
+
+    for (auto &texture : textures)
+    {
+        if (texture.view != VK_NULL_HANDLE)
+        {
+            vkDestroyImageView(device, texture.view, nullptr);
+        }
+        vkDestroyImage(device, texture.image, nullptr);
+        memory.free(texture.memory, texture.size, texture.memoryType);
+    }
+}
+
+bool TextureManager::canGenerateMips(VkFormat format)
+{
+    VkFormatProperties formatProps;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, format, &formatProps);
+
+    VkFormatFeatureFlags required = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT |
+                                    VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+
+    return (formatProps.optimalTilingFeatures & required) == required;
+}
+
+TextureHandle TextureManager::load(const std::string &path)
+{
+    TRACE_ZONE("TextureManager::load");
+
+    Texture texture {};
+    texture.file = std::make_unique<MappedFile>(path);
+    texture.contents = parseTextureFile(*texture.file);
+
+    const TextureFile &contents = texture.contents;
+
+    // Levels are copied a band of rows at a time: a row of the base level has to fit in a band
+    FormatBlock block;
+    getFormatBlock(contents.format, &block);
+    VkDeviceSize rowBytes = VkDeviceSize((contents.width + block.width - 1) / block.width) * block.bytes;
+
+    if (rowBytes > staging.getCapacity() / 2)
+    {
+        throw std::runtime_error("Failed to load texture " + path + ": a row does not fit in the staging ring!");
+    }
+
+    texture.generateMips = contents.generateMips && canGenerateMips(contents.format);
+    if (contents.generateMips && !texture.generateMips)
+    {
+        LOG_WARNING("Cannot generate mips for {} (format {}): using its base level only", path, static_cast<int>(contents.format));
+    }
+
+    uint32_t largest = std::max(contents.width, contents.height);
+    texture.mipLevels = texture.generateMips ? 32 - __builtin_clz(largest) : contents.levels;
+    texture.arrayLayers = contents.layers * contents.faces;
+    texture.residentLevel = texture.mipLevels;
+    texture.view = VK_NULL_HANDLE;
+
+    if (contents.faces == 6)
+    {
+        texture.viewType = contents.layers > 1 ? VK_IMAGE_VIEW_TYPE_CUBE_ARRAY : VK_IMAGE_VIEW_TYPE_CUBE;
+    }
+    else
+    {
+        texture.viewType = contents.layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+    }
+
+    createImage(texture);
+
+    TextureHandle handle = static_cast<TextureHandle>(textures.size());
+    textures.push_back(std::move(texture));
+    streaming.push_back(handle);
+
+    return handle;
+}
+
+void TextureManager::createImage(Texture &texture)
+{
+    VkImageCreateInfo imageInfo {
+        .sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+        .flags         = texture.contents.faces == 6 ? VK_IMAGE_CREATE_CUBE_COMPATIBLE_BIT : 0u,
+        .imageType     = VK_IMAGE_TYPE_2D,
+        .format        = texture.contents.format,
+        .extent {
+            .width     = texture.contents.width,
+            .height    = texture.contents.height,
+            .depth     = 1,
+        },
+        .mipLevels     = texture.mipLevels,
+        .arrayLayers   = texture.arrayLayers,
+        .samples       = VK_SAMPLE_COUNT_1_BIT,
+        .tiling        = VK_IMAGE_TILING_OPTIMAL,
+        // Read by mip generation, and by the copy into a smaller image on eviction
+        .usage         = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
+        .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+    };
+
+    if (vkCreateImage(device, &imageInfo, nullptr, &texture.image) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture image!");
+    }
+
+    VkMemoryRequirements memRequirements;
+    vkGetImageMemoryRequirements(device, texture.image, &memRequirements);
+
+    texture.memory = memory.allocate(memRequirements, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, &texture.memoryType);
+    texture.size = memRequirements.size;
+
+    vkBindImageMemory(device, texture.image, texture.memory, 0);
+}
+
+void TextureManager::updateView(Texture &texture)
+{
+    // The previous view may still be referenced by frames in flight
+    if (texture.view != VK_NULL_HANDLE)
+    {
+        retiredViews.push_back({texture.view, frameNumber});
+    }
+
+    VkImageViewCreateInfo viewInfo {
+        .sType               = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image               = texture.image,
+        .viewType            = texture.viewType,
+        .format              = texture.contents.format,
+        .subresourceRange {
+            .aspectMask      = VK_IMAGE_ASPECT_COLOR_BIT,
+            .baseMipLevel    = texture.residentLevel,
+            .levelCount      = texture.mipLevels - texture.residentLevel,
+            .baseArrayLayer  = 0,
+            .layerCount      = texture.arrayLayers,
+        },
+    };
+
+    if (vkCreateImageView(device, &viewInfo, nullptr, &texture.view) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create texture image view!");
+    }
+}
+
+VkDeviceSize TextureManager::uploadLevel(
+    VkCommandBuffer commandBuffer, FrameArena &arena, Texture &texture, uint32_t level, VkDeviceSize budget,
+    bool first, bool *complete)
+{
+    FormatBlock block;
+    getFormatBlock(texture.contents.format, &block);
+
+    // Copy offsets must be multiples of both 4 and the texel block size
+    VkDeviceSize alignment = std::max(block.bytes, 4u);
+
+    uint32_t width = std::max(texture.contents.width >> level, 1u);
+    uint32_t height = std::max(texture.contents.height >> level, 1u);
+    uint32_t blockRows = (height + block.height - 1) / block.height;
+    VkDeviceSize rowBytes = VkDeviceSize((width + block.width - 1) / block.width) * block.bytes;
+
+    // Bands of rows of half the ring at most, as for meshes, so that a band always fits once the ring has drained, and
+    // of the per-frame budget at most, so that a level larger than the budget spreads over frames
+    VkDeviceSize bandBytes = std::min(staging.getCapacity() / 2, uploadBudget);
+    uint32_t bandRows = static_cast<uint32_t>(std::max<VkDeviceSize>(bandBytes / rowBytes, 1));
+
+    bool started = texture.uploadRegion > 0 || texture.uploadRow > 0;
+    VkDeviceSize copied = 0;
+    VkBuffer buffer = VK_NULL_HANDLE;
+    FrameVector<VkBufferImageCopy> copies(arena);
+    *complete = false;
+
+    uint32_t index = 0;
+    for (const auto &region : texture.contents.regions)
+    {
+        if (region.level != level)
+        {
+            continue;
+        }
+
+        if (index++ < texture.uploadRegion)
+        {
+            continue;
+        }
+
+        while (texture.uploadRow < blockRows)
+        {
+            uint32_t rows = std::min(bandRows, blockRows - texture.uploadRow);
+            VkDeviceSize bytes = rows * rowBytes;
+
+            // A band larger than the whole budget still goes through, alone, so that nothing stalls forever
+            if (copied + bytes > budget && !(first && copied == 0))
+            {
+                break;
+            }
+
+            StagingAllocation allocation;
+            if (!staging.allocate(bytes, alignment, &allocation))
+            {
+                // Ring full: the rest of the level is copied on a later frame
+                break;
+            }
+
+            // The only CPU copy: from the mapped file straight into the staging ring
+            memcpy(allocation.mapped, region.data + texture.uploadRow * rowBytes, bytes);
+            buffer = allocation.buffer;
+
+            uint32_t y = texture.uploadRow * block.height;
+
+            copies.push_back({
+                .bufferOffset      = allocation.offset,
+                .bufferRowLength   = 0,
+                .bufferImageHeight = 0,
+                .imageSubresource {
+                    .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                    .mipLevel       = level,
+                    .baseArrayLayer = region.layer,
+                    .layerCount     = 1,
+                },
+                .imageOffset       = {0, static_cast<int32_t>(y), 0},
+                .imageExtent       = {width, std::min(rows * block.height, height - y), 1},
+            });
+
+            texture.uploadRow += rows;
+            copied += bytes;
+        }
+
+        if (texture.uploadRow < blockRows)
+        {
+            break;
+        }
+
+        texture.uploadRegion++;
+        texture.uploadRow = 0;
+    }
+
+    if (copies.empty())
+    {
+        return 0;
+    }
+
+    // Bands copied on earlier frames are kept: only the first one finds the level undefined
+    if (!started)
+    {
+        VkImageMemoryBarrier toTransfer = layoutBarrier(
+            texture.image, level, 1, texture.arrayLayers, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &toTransfer);
+    }
+
+    vkCmdCopyBufferToImage(
+        commandBuffer, buffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        static_cast<uint32_t>(copies.size()), copies.data());
+
+    // Every region of the level is copied once the resume point has gone past the last one
+    uint32_t levelRegions = static_cast<uint32_t>(std::count_if(
+        texture.contents.regions.begin(), texture.contents.regions.end(),
+        [level](const TextureRegion &region) { return region.level == level; }));
+
+    if (texture.uploadRegion < levelRegions)
+    {
+        return copied;
+    }
+
+    texture.uploadRegion = 0;
+    texture.uploadRow = 0;
+    *complete = true;
+
+    if (texture.generateMips)
+    {
+        recordMipGeneration(commandBuffer, texture);
+        return copied;
+    }
+
+    VkImageMemoryBarrier toShader = layoutBarrier(
+        texture.image, level, 1, texture.arrayLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ShaderStages, 0, 0, nullptr, 0, nullptr, 1, &toShader);
+
+    return copied;
+}
+
+void TextureManager::recordMipGeneration(VkCommandBuffer commandBuffer, Texture &texture)
+{
+    TRACE_ZONE("TextureManager::recordMipGeneration");
+
+    VkImageMemoryBarrier prepare = layoutBarrier(
+        texture.image, 1, texture.mipLevels - 1, texture.arrayLayers, VK_IMAGE_LAYOUT_UNDEFINED,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT);
+
+    if (texture.mipLevels > 1)
+    {
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &prepare);
+    }
+
+    int32_t width = static_cast<int32_t>(texture.contents.width);
+    int32_t height = static_cast<int32_t>(texture.contents.height);
+
+    // Each level is downsampled from the previous one, which is then final
+    for (uint32_t level = 1; level < texture.mipLevels; level++)
+    {
+        VkImageMemoryBarrier toSource = layoutBarrier(
+            texture.image, level - 1, 1, texture.arrayLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_TRANSFER_READ_BIT);
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, 1, &toSource);
+
+        int32_t nextWidth = std::max(width / 2, 1);
+        int32_t nextHeight = std::max(height / 2, 1);
+
+        VkImageBlit blit {
+            .srcSubresource {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level - 1,
+                .baseArrayLayer = 0,
+                .layerCount     = texture.arrayLayers,
+            },
+            .srcOffsets        = {{0, 0, 0}, {width, height, 1}},
+            .dstSubresource {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level,
+                .baseArrayLayer = 0,
+                .layerCount     = texture.arrayLayers,
+            },
+            .dstOffsets        = {{0, 0, 0}, {nextWidth, nextHeight, 1}},
+        };
+
+        vkCmdBlitImage(
+            commandBuffer, texture.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        VkImageMemoryBarrier toShader = layoutBarrier(
+            texture.image, level - 1, 1, texture.arrayLayers, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+            VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_READ_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+        vkCmdPipelineBarrier(
+            commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ShaderStages, 0, 0, nullptr, 0, nullptr, 1, &toShader);
+
+        width = nextWidth;
+        height = nextHeight;
+    }
+
+    VkImageMemoryBarrier last = layoutBarrier(
+        texture.image, texture.mipLevels - 1, 1, texture.arrayLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ShaderStages, 0, 0, nullptr, 0, nullptr, 1, &last);
+}
+
+void TextureManager::demote(VkCommandBuffer commandBuffer, FrameArena &arena, Texture &texture)
+{
+    TRACE_ZONE("TextureManager::demote");
+
+    RetiredImage retired {texture.image, texture.memory, texture.memoryType, texture.size, frameNumber};
+
+    // Every level moves one down: the old level 1 is the new level 0
+    texture.contents.width = std::max(texture.contents.width >> 1, 1u);
+    texture.contents.height = std::max(texture.contents.height >> 1, 1u);
+    texture.mipLevels--;
+    createImage(texture);
+
+    VkImageMemoryBarrier toTransfer[] {
+        layoutBarrier(
+            retired.image, 1, texture.mipLevels, texture.arrayLayers, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+            VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_TRANSFER_READ_BIT),
+        layoutBarrier(
+            texture.image, 0, texture.mipLevels, texture.arrayLayers, VK_IMAGE_LAYOUT_UNDEFINED,
+            VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 0, VK_ACCESS_TRANSFER_WRITE_BIT),
+    };
+
+    vkCmdPipelineBarrier(
+        commandBuffer, ShaderStages, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 2, toTransfer);
+
+    FrameVector<VkImageCopy> copies(arena);
+    copies.reserve(texture.mipLevels);
+
+    for (uint32_t level = 0; level < texture.mipLevels; level++)
+    {
+        copies.push_back({
+            .srcSubresource {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level + 1,
+                .baseArrayLayer = 0,
+                .layerCount     = texture.arrayLayers,
+            },
+            .srcOffset         = {0, 0, 0},
+            .dstSubresource {
+                .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
+                .mipLevel       = level,
+                .baseArrayLayer = 0,
+                .layerCount     = texture.arrayLayers,
+            },
+            .dstOffset         = {0, 0, 0},
+            .extent            = {
+                std::max(texture.contents.width >> level, 1u), std::max(texture.contents.height >> level, 1u), 1},
+        });
+    }
+
+    vkCmdCopyImage(
+        commandBuffer, retired.image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, texture.image,
+        VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, static_cast<uint32_t>(copies.size()), copies.data());
+
+    VkImageMemoryBarrier toShader = layoutBarrier(
+        texture.image, 0, texture.mipLevels, texture.arrayLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_ACCESS_TRANSFER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT);
+
+    vkCmdPipelineBarrier(
+        commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, ShaderStages, 0, 0, nullptr, 0, nullptr, 1, &toShader);
+
+    // The old image and view may still be read by frames in flight
+    updateView(texture);
+    retiredImages.push_back(retired);
+}
+
+void TextureManager::update(VkCommandBuffer commandBuffer, uint32_t frameIndex, FrameArena &arena)
+{
+    TRACE_ZONE("TextureManager::update");
+
+    staging.beginFrame(frameIndex);
+
+    auto retired = std::remove_if(retiredViews.begin(), retiredViews.end(), [this](const RetiredView &retired) {
+        if (retired.retiredAt + framesInFlight < frameNumber)
+        {
+            vkDestroyImageView(device, retired.view, nullptr);
+            return true;
+        }
+        return false;
+    });
+    retiredViews.erase(retired, retiredViews.end());
+
+    auto retiredImage = std::remove_if(retiredImages.begin(), retiredImages.end(), [this](const RetiredImage &retired) {
+        if (retired.retiredAt + framesInFlight < frameNumber)
+        {
+            vkDestroyImage(device, retired.image, nullptr);
+            memory.free(retired.memory, retired.size, retired.memoryType);
+            return true;
+        }
+        return false;
+    });
+    retiredImages.erase(retiredImage, retiredImages.end());
+
+    for (TextureHandle handle : demotions)
+    {
+        demote(commandBuffer, arena, textures[handle]);
+    }
+    demotions.clear();
+
+    VkDeviceSize budget = uploadBudget;
+    bool uploaded = false;
+
+    while (!streaming.empty())
+    {
+        // Coarsest missing level first, across all textures: everything becomes visible early, then sharpens
+        auto next = std::max_element(streaming.begin(), streaming.end(), [this](TextureHandle a, TextureHandle b) {
+            return textures[a].residentLevel < textures[b].residentLevel;
+        });
+
+        Texture &texture = textures[*next];
+        uint32_t level = texture.generateMips ? 0 : texture.residentLevel - 1;
+
+        bool complete;
+        VkDeviceSize copied = uploadLevel(commandBuffer, arena, texture, level, budget, !uploaded, &complete);
+
+        budget -= std::min(budget, copied);
+        uploaded = uploaded || copied > 0;
+
+        // Out of budget or staging space: the level resumes on a later frame
+        if (!complete)
+        {
+            break;
+        }
+
+        texture.residentLevel = texture.generateMips ? 0 : level;
+        updateView(texture);
+
+        if (texture.residentLevel == 0)
+        {
+            // Everything is on the GPU: the file mapping is no longer needed
+            texture.contents.regions.clear();
+            texture.file.reset();
+            streaming.erase(next);
+        }
+    }
+
+    staging.flush();
+    frameNumber++;
+}
+
+void TextureManager::setUploadBudget(VkDeviceSize bytesPerFrame)
+{
+    uploadBudget = bytesPerFrame;
+}
+
+VkDeviceSize TextureManager::evict(uint32_t heap, VkDeviceSize bytes)
+{
+    // Textures still streaming are left alone: their levels are not all on the GPU to be copied
+    std::vector<TextureHandle> candidates;
+    for (TextureHandle handle = 0; handle < textures.size(); handle++)
+    {
+        const Texture &texture = textures[handle];
+        bool pending = std::find(demotions.begin(), demotions.end(), handle) != demotions.end();
+
+        if (texture.residentLevel == 0 && texture.mipLevels > 1 && !pending &&
+            memory.getHeapIndex(texture.memoryType) == heap)
+        {
+            candidates.push_back(handle);
+        }
+    }
+
+    // Largest first: the most memory for the fewest textures made blurrier
+    std::sort(candidates.begin(), candidates.end(), [this](TextureHandle a, TextureHandle b) {
+        return textures[a].size > textures[b].size;
+    });
+
+    VkDeviceSize freed = 0;
+    for (TextureHandle handle : candidates)
+    {
+        if (freed >= bytes)
+        {
+            break;
+        }
+
+        demotions.push_back(handle);
+        freed += textures[handle].size - textures[handle].size / 4;
+    }
+
+    return freed;
+}
+
+VkImageView TextureManager::getView(TextureHandle texture) const
+{
+    return textures[texture].view;
+}
+
+VkImageViewType TextureManager::getViewType(TextureHandle texture) const
+{
+    return textures[texture].viewType;
+}
+
+uint32_t TextureManager::getResidentLevel(TextureHandle texture) const
+{
+    return textures[texture].residentLevel;
+}
+
+bool TextureManager::isComplete(TextureHandle texture) const
+{
+    return textures[texture].residentLevel == 0;
+}
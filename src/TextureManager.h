@@ -0,0 +1,116 @@
+#ifndef TEXTURE_MANAGER_H_
+#define TEXTURE_MANAGER_H_
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "FrameArena.h"
+#include "MappedFile.h"
+#include "MemoryBudget.h"
+#include "StagingRing.h"
+#include "TextureFile.h"
+
+typedef uint32_t TextureHandle;
+
+// Textures are created at load and filled in over the following frames: the smallest mips of every texture come
+// first, then each texture is refined level by level within a per-frame upload budget, a level too large for the
+// staging ring or the budget being copied a band of rows at a time over several frames. The view of a texture
+// always covers its resident levels only. Memory comes from the budget, which can have complete textures drop their
+// finest level: each is copied on the GPU into an image half the size, which replaces it once the frames in flight
+// are done with the old one. Not thread safe: used from the thread recording frames
+class TextureManager
+{
+private:
+    struct Texture
+    {
+        std::unique_ptr<MappedFile> file;
+        TextureFile contents;
+
+        VkImage image;
+        VkDeviceMemory memory;
+        uint32_t memoryType;
+        VkDeviceSize size;
+        VkImageView view;
+        VkImageViewType viewType;
+        uint32_t mipLevels;
+        uint32_t arrayLayers;
+
+        // Levels below this one are still missing; mipLevels when nothing has been uploaded yet
+        uint32_t residentLevel;
+        // Where the copy of the level being uploaded resumes, when it did not fit in one frame: the index among the
+        // level's regions, and the row of texel blocks within that region
+        uint32_t uploadRegion;
+        uint32_t uploadRow;
+        bool generateMips;
+    };
+
+    struct RetiredView
+    {
+        VkImageView view;
+        uint64_t retiredAt;
+    };
+
+    struct RetiredImage
+    {
+        VkImage image;
+        VkDeviceMemory memory;
+        uint32_t memoryType;
+        VkDeviceSize size;
+        uint64_t retiredAt;
+    };
+
+    VkDevice device;
+    VkPhysicalDevice physicalDevice;
+    MemoryBudget &memory;
+    uint32_t framesInFlight;
+    uint64_t frameNumber;
+    VkDeviceSize uploadBudget;
+
+    StagingRing staging;
+    std::vector<Texture> textures;
+    std::vector<TextureHandle> streaming;
+    std::vector<RetiredView> retiredViews;
+    // Complete textures to lose their finest level this frame
+    std::vector<TextureHandle> demotions;
+    std::vector<RetiredImage> retiredImages;
+
+    bool canGenerateMips(VkFormat format);
+    void createImage(Texture &texture);
+    void updateView(Texture &texture);
+    VkDeviceSize uploadLevel(
+        VkCommandBuffer commandBuffer, FrameArena &arena, Texture &texture, uint32_t level, VkDeviceSize budget,
+        bool first, bool *complete);
+    void recordMipGeneration(VkCommandBuffer commandBuffer, Texture &texture);
+    void demote(VkCommandBuffer commandBuffer, FrameArena &arena, Texture &texture);
+
+public:
+    TextureManager(VkDevice device, VkPhysicalDevice physicalDevice, MemoryBudget &memory, uint32_t framesInFlight,
+        VkDeviceSize stagingSize, VkDeviceSize uploadBudget);
+
+    // Maps the file and creates the image; the contents are streamed by update()
+    TextureHandle load(const std::string &path);
+
+    // Records this frame's uploads: after the fence of `frameIndex` has been waited on, outside a render pass. Copy
+    // regions are built in the frame's arena
+    void update(VkCommandBuffer commandBuffer, uint32_t frameIndex, FrameArena &arena);
+
+    void setUploadBudget(VkDeviceSize bytesPerFrame);
+
+    // Eviction callback of the memory budget: the largest complete textures in the heap lose their finest level at
+    // the next update(), about three quarters of their memory each
+    VkDeviceSize evict(uint32_t heap, VkDeviceSize bytes);
+
+    // VK_NULL_HANDLE until the first level has been uploaded
+    VkImageView getView(TextureHandle texture) const;
+    VkImageViewType getViewType(TextureHandle texture) const;
+    uint32_t getResidentLevel(TextureHandle texture) const;
+    bool isComplete(TextureHandle texture) const;
+
+    ~TextureManager();
+};
+
+#endif
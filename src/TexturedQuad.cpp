@@ -0,0 +1,223 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "TexturedQuad.h"
+#include "Trace.h"
+
+// Share of the shorter side of the screen the quad covers
+const float QuadSize = 0.8f;
+
+// Push constants of textured.vert, laid out as its block
+struct QuadConstants
+{
+    float scale[2];
+};
+
+static const char *fragmentShaders[4] {
+    "textured.frag",
+    "textured_array.frag",
+    "textured_cube.frag",
+    "textured_cube_array.frag",
+};
+
+static uint32_t pipelineIndex(VkImageViewType viewType)
+{
+    switch (viewType)
+    {
+    case VK_IMAGE_VIEW_TYPE_2D_ARRAY:
+        return 1;
+    case VK_IMAGE_VIEW_TYPE_CUBE:
+        return 2;
+    case VK_IMAGE_VIEW_TYPE_CUBE_ARRAY:
+        return 3;
+    default:
+        return 0;
+    }
+}
+
+TexturedQuad::TexturedQuad(
+    VkDevice device, VkPhysicalDevice physicalDevice, PipelineManager &pipelines, TextureManager &textures,
+    uint32_t framesInFlight)
+    : pipelines(pipelines), textures(textures)
+{
+    this->device = device;
+
+    VkPhysicalDeviceFeatures features;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &features);
+    cubeArrays = features.imageCubeArray;
+
+    std::fill(drawPipelines, drawPipelines + 4, nullptr);
+
+    // Every resident level, trilinearly filtered
+    VkSamplerCreateInfo samplerInfo {
+        .sType        = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+        .magFilter    = VK_FILTER_LINEAR,
+        .minFilter    = VK_FILTER_LINEAR,
+        .mipmapMode   = VK_SAMPLER_MIPMAP_MODE_LINEAR,
+        .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+        .maxLod       = VK_LOD_CLAMP_NONE,
+    };
+
+    if (vkCreateSampler(device, &samplerInfo, nullptr, &sampler) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create textured quad sampler!");
+    }
+
+    VkDescriptorSetLayoutBinding layoutBinding {
+        .binding         = 0,
+        .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = 1,
+        .stageFlags      = VK_SHADER_STAGE_FRAGMENT_BIT,
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo {
+        .sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = 1,
+        .pBindings    = &layoutBinding,
+    };
+
+    if (vkCreateDescriptorSetLayout(device, &layoutInfo, nullptr, &descriptorSetLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create textured quad descriptor set layout!");
+    }
+
+    VkPushConstantRange pushConstantRange {
+        .stageFlags = VK_SHADER_STAGE_VERTEX_BIT,
+        .offset     = 0,
+        .size       = sizeof(QuadConstants),
+    };
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo {
+        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount         = 1,
+        .pSetLayouts            = &descriptorSetLayout,
+        .pushConstantRangeCount = 1,
+        .pPushConstantRanges    = &pushConstantRange,
+    };
+
+    if (vkCreatePipelineLayout(device, &pipelineLayoutInfo, nullptr, &pipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create textured quad pipeline layout!");
+    }
+
+    VkDescriptorPoolSize poolSize {
+        .type            = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+        .descriptorCount = framesInFlight,
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo {
+        .sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .maxSets       = framesInFlight,
+        .poolSizeCount = 1,
+        .pPoolSizes    = &poolSize,
+    };
+
+    if (vkCreateDescriptorPool(device, &poolInfo, nullptr, &descriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create textured quad descriptor pool!");
+    }
+
+    std::vector<VkDescriptorSetLayout> setLayouts(framesInFlight, descriptorSetLayout);
+    descriptorSets.resize(framesInFlight);
+    boundViews.assign(framesInFlight, VK_NULL_HANDLE);
+
+    VkDescriptorSetAllocateInfo allocInfo {
+        .sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .descriptorPool     = descriptorPool,
+        .descriptorSetCount = framesInFlight,
+        .pSetLayouts        = setLayouts.data(),
+    };
+
+    if (vkAllocateDescriptorSets(device, &allocInfo, descriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate textured quad descriptor sets!");
+    }
+}
+
+TexturedQuad::~TexturedQuad()
+{
+    vkDestroyDescriptorPool(device, descriptorPool, nullptr);
+    vkDestroyPipelineLayout(device, pipelineLayout, nullptr);
+    vkDestroyDescriptorSetLayout(device, descriptorSetLayout, nullptr);
+    vkDestroySampler(device, sampler, nullptr);
+}
+
+void TexturedQuad::requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples)
+{
+    for (uint32_t i = 0; i < 4; i++)
+    {
+        if (i == pipelineIndex(VK_IMAGE_VIEW_TYPE_CUBE_ARRAY) && !cubeArrays)
+        {
+            continue;
+        }
+
+        PipelineKey key {
+            .vertexShader   = "textured.vert",
+            .fragmentShader = fragmentShaders[i],
+            .topology       = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
+            .cullMode       = VK_CULL_MODE_NONE,
+            .colorFormat    = colorFormat,
+            .depthFormat    = depthFormat,
+            .samples        = samples,
+            .layout         = pipelineLayout,
+        };
+
+        drawPipelines[i] = pipelines.request(key);
+    }
+}
+
+bool TexturedQuad::draw(DrawList &drawList, uint32_t frameIndex, TextureHandle texture, VkExtent2D extent)
+{
+    PipelineHandle handle = drawPipelines[pipelineIndex(textures.getViewType(texture))];
+    VkImageView view = textures.getView(texture);
+
+    if (handle == nullptr || view == VK_NULL_HANDLE || pipelines.get(handle) == VK_NULL_HANDLE)
+    {
+        return false;
+    }
+
+    TRACE_ZONE("TexturedQuad::draw");
+
+    if (boundViews[frameIndex] != view)
+    {
+        VkDescriptorImageInfo imageInfo {
+            .sampler     = sampler,
+            .imageView   = view,
+            .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+        };
+
+        VkWriteDescriptorSet write {
+            .sType           = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet          = descriptorSets[frameIndex],
+            .dstBinding      = 0,
+            .dstArrayElement = 0,
+            .descriptorCount = 1,
+            .descriptorType  = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo      = &imageInfo,
+        };
+
+        vkUpdateDescriptorSets(device, 1, &write, 0, nullptr);
+        boundViews[frameIndex] = view;
+    }
+
+    float side = QuadSize * std::min(extent.width, extent.height);
+    QuadConstants constants {
+        .scale = {side / extent.width, side / extent.height},
+    };
+
+    DrawCommand command {
+        .type          = DrawType::Draw,
+        .pipeline      = pipelines.get(handle),
+        .layout        = pipelineLayout,
+        .descriptorSet = descriptorSets[frameIndex],
+        .count         = 4,
+        .instanceCount = 1,
+    };
+    command.setPushConstants(VK_SHADER_STAGE_VERTEX_BIT, constants);
+
+    drawList.add(DrawPassMain, 0, command);
+
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef TEXTURED_QUAD_H_
+#define TEXTURED_QUAD_H_
+
+#include <cstdint>
+#include <vector>
+
+#include <vulkan/vulkan.h>
+
+#include "DrawList.h"
+#include "PipelineManager.h"
+#include "TextureManager.h"
+
+// Shows a texture of the texture manager on a square in the middle of the screen, whatever levels of it are resident:
+// 2D textures as they are, the layers of arrays side by side, cubes unwrapped as longitude and latitude. Its view
+// changes as levels stream in or are evicted, so each frame slot has its own descriptor set, rewritten once the slot's
+// fence has been waited on whenever the view it holds is no longer the texture's
+class TexturedQuad
+{
+private:
+    VkDevice device;
+    PipelineManager &pipelines;
+    TextureManager &textures;
+
+    VkSampler sampler;
+    VkDescriptorSetLayout descriptorSetLayout;
+    VkPipelineLayout pipelineLayout;
+    VkDescriptorPool descriptorPool;
+    std::vector<VkDescriptorSet> descriptorSets;
+    std::vector<VkImageView> boundViews;
+
+    // The device enables imageCubeArray wherever it is supported
+    bool cubeArrays;
+    // Per view type, for the sampler type of its fragment shader; none for cube arrays without the feature
+    PipelineHandle drawPipelines[4];
+
+public:
+    TexturedQuad(
+        VkDevice device, VkPhysicalDevice physicalDevice, PipelineManager &pipelines, TextureManager &textures,
+        uint32_t framesInFlight);
+
+    // For the formats of the main pass; requested again whenever they change
+    void requestPipelines(VkFormat colorFormat, VkFormat depthFormat, VkSampleCountFlagBits samples);
+
+    // Adds the quad to the main pass, after the fence of `frameIndex` has been waited on. False, drawing nothing,
+    // until the texture's first level is resident and the pipeline of its view type is compiled
+    bool draw(DrawList &drawList, uint32_t frameIndex, TextureHandle texture, VkExtent2D extent);
+
+    ~TexturedQuad();
+};
+
+#endif
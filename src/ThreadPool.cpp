@@ -0,0 +1,84 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(uint32_t workerCount)
+{
+    pendingTasks = 0;
+    stopping = false;
+
+    if (workerCount == 0)
+    {
+        workerCount = 1;
+    }
+
+    workers.reserve(workerCount);
+    for (uint32_t i = 0; i < workerCount; i++)
+    {
+        workers.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    taskAvailable.notify_all();
+
+    for (auto &worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::submit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        tasks.push(std::move(task));
+        pendingTasks++;
+    }
+    taskAvailable.notify_one();
+}
+
+void ThreadPool::waitIdle()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    allDone.wait(lock, [this] { return pendingTasks == 0; });
+}
+
+uint32_t ThreadPool::size() const
+{
+    return static_cast<uint32_t>(workers.size());
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            taskAvailable.wait(lock, [this] { return stopping || !tasks.empty(); });
+
+            if (tasks.empty())
+            {
+                return;
+            }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+
+        task();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pendingTasks == 0)
+            {
+                allDone.notify_all();
+            }
+        }
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+class ThreadPool
+{
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable taskAvailable;
+    std::condition_variable allDone;
+    size_t pendingTasks;
+    bool stopping;
+
+    void workerLoop();
+
+public:
+    ThreadPool(uint32_t workerCount);
+
+    void submit(std::function<void()> task);
+    void waitIdle();
+
+    uint32_t size() const;
+
+    ~ThreadPool();
+};
+
+#endif
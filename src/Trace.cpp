@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+
+#include <fmt/format.h>
+
+#include "Trace.h"
+
+static const uint32_t CpuProcess = 1;
+static const uint32_t GpuProcess = 2;
+
+static std::string escape(const std::string &text)
+{
+    std::string escaped;
+
+    for (char c : text)
+    {
+        if (c == '"' || c == '\\')
+        {
+            escaped.push_back('\\');
+        }
+        escaped.push_back(c);
+    }
+
+    return escaped;
+}
+
+Trace::Trace()
+{
+    if (active)
+    {
+        path = std::getenv("BASICVULKAN_TRACE");
+    }
+}
+
+Trace::~Trace()
+{
+    if (active)
+    {
+        write();
+    }
+}
+
+Trace &Trace::instance()
+{
+    static Trace trace;
+    return trace;
+}
+
+uint64_t Trace::now()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+Trace::Track *Trace::threadTrack()
+{
+    thread_local Track *track = nullptr;
+
+    if (track == nullptr)
+    {
+        Trace &trace = instance();
+        std::lock_guard<std::mutex> lock(trace.mutex);
+
+        uint32_t thread = static_cast<uint32_t>(trace.tracks.size()) + 1;
+        trace.tracks.push_back(std::make_unique<Track>(Track {CpuProcess, thread, fmt::format("Thread {}", thread), {}}));
+        track = trace.tracks.back().get();
+        track->events.reserve(1 << 16);
+    }
+
+    return track;
+}
+
+void Trace::record(const char *name, uint64_t start, uint64_t end)
+{
+    threadTrack()->events.push_back({name, start, end - start});
+}
+
+void Trace::setThreadName(const char *name)
+{
+    if (active)
+    {
+        threadTrack()->name = name;
+    }
+}
+
+uint32_t Trace::createTrack(const char *name)
+{
+    Trace &trace = instance();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+
+    uint32_t thread = static_cast<uint32_t>(trace.tracks.size()) + 1;
+    trace.tracks.push_back(std::make_unique<Track>(Track {GpuProcess, thread, name, {}}));
+
+    return thread - 1;
+}
+
+void Trace::recordOnTrack(uint32_t track, const char *name, uint64_t start, uint64_t end)
+{
+    Trace &trace = instance();
+    std::lock_guard<std::mutex> lock(trace.mutex);
+
+    trace.tracks[track]->events.push_back({name, start, end - start});
+}
+
+void Trace::write()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+
+    FILE *file = fopen(path.c_str(), "w");
+    if (file == nullptr)
+    {
+        fmt::print(stderr, "Failed to write trace to {}\n", path);
+        return;
+    }
+
+    uint64_t origin = UINT64_MAX;
+    for (const auto &track : tracks)
+    {
+        for (const auto &event : track->events)
+        {
+            origin = std::min(origin, event.start);
+        }
+    }
+
+    fmt::print(file, "{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fmt::print(file, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"CPU\"}}}},\n", CpuProcess);
+    fmt::print(file, "{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":{},\"args\":{{\"name\":\"GPU\"}}}}", GpuProcess);
+
+    for (const auto &track : tracks)
+    {
+        fmt::print(file, ",\n{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":{},\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+            track->process, track->thread, escape(track->name));
+
+        for (const auto &event : track->events)
+        {
+            fmt::print(file, ",\n{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":{},\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                escape(event.name), track->process, track->thread, (event.start - origin) / 1000.0, event.duration / 1000.0);
+        }
+    }
+
+    fmt::print(file, "\n]}}\n");
+    fclose(file);
+}
@@ -0,0 +1,86 @@
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+
+// Scoped CPU zone; `name` must outlive the process (a string literal)
+#define TRACE_ZONE(name) TraceZone TRACE_CONCAT(traceZone, __LINE__)(name)
+
+// Chrome trace-event recorder, enabled by BASICVULKAN_TRACE=<file.json>; the file is written at exit and can be
+// opened in chrome://tracing or ui.perfetto.dev. When disabled every zone costs a single branch
+class Trace
+{
+private:
+    struct Event
+    {
+        const char *name;
+        uint64_t start;
+        uint64_t duration;
+    };
+
+    struct Track
+    {
+        uint32_t process;
+        uint32_t thread;
+        std::string name;
+        std::vector<Event> events;
+    };
+
+    std::mutex mutex;
+    std::vector<std::unique_ptr<Track>> tracks;
+    std::string path;
+
+    Trace();
+
+    static Trace &instance();
+    static Track *threadTrack();
+
+    void write();
+
+public:
+    static inline const bool active = std::getenv("BASICVULKAN_TRACE") != nullptr;
+
+    // Nanoseconds on the steady clock, the time base of every event
+    static uint64_t now();
+
+    static void record(const char *name, uint64_t start, uint64_t end);
+    static void setThreadName(const char *name);
+
+    // Tracks not bound to a CPU thread, e.g. a GPU queue
+    static uint32_t createTrack(const char *name);
+    static void recordOnTrack(uint32_t track, const char *name, uint64_t start, uint64_t end);
+
+    ~Trace();
+};
+
+class TraceZone
+{
+private:
+    const char *name;
+    uint64_t start;
+
+public:
+    TraceZone(const char *name)
+    {
+        this->name = Trace::active ? name : nullptr;
+        start = this->name ? Trace::now() : 0;
+    }
+
+    ~TraceZone()
+    {
+        if (name)
+        {
+            Trace::record(name, start, Trace::now());
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,56 @@
+#ifndef TRIPLE_BUFFER_H_
+#define TRIPLE_BUFFER_H_
+
+#include <atomic>
+#include <cstdint>
+
+// Lock-free handoff of the latest value from one producer thread to one consumer thread. Three slots: the producer
+// fills its own, then swaps it with the shared one; the consumer swaps its own with the shared one when it holds a
+// newer value. Neither side ever waits, and values published faster than they are consumed are overwritten, so
+// anything that must not be missed has to be a running count rather than an event
+template <typename T>
+class TripleBuffer
+{
+private:
+    // Set together with the index of the shared slot when the producer published into it
+    static constexpr uint8_t Fresh = 4;
+
+    T slots[3] {};
+
+    alignas(64) std::atomic<uint8_t> shared {1};
+    alignas(64) uint8_t producerSlot = 0;
+    alignas(64) uint8_t consumerSlot = 2;
+
+public:
+    // Producer: the slot to fill before publish(); it holds an older value, not necessarily the last one published
+    T &back()
+    {
+        return slots[producerSlot];
+    }
+
+    void publish()
+    {
+        // Release the slot just filled, acquire the one the consumer may have handed back
+        producerSlot = shared.exchange(producerSlot | Fresh, std::memory_order_acq_rel) & 3;
+    }
+
+    // Consumer: takes the latest published value, if newer than the one in front(). False otherwise, with front()
+    // unchanged
+    bool update()
+    {
+        if ((shared.load(std::memory_order_relaxed) & Fresh) == 0)
+        {
+            return false;
+        }
+
+        consumerSlot = shared.exchange(consumerSlot, std::memory_order_acq_rel) & 3;
+        return true;
+    }
+
+    const T &front() const
+    {
+        return slots[consumerSlot];
+    }
+};
+
+#endif
@@ -0,0 +1,36 @@
+#include <cstdlib>
+#include <cstring>
+
+#include "Validation.h"
+
+ValidationLevel selectValidationLevel()
+{
+    ValidationLevel level = static_cast<ValidationLevel>(VALIDATION_LEVEL);
+
+#if VALIDATION_LEVEL > 0
+    const char *requested = std::getenv("BASICVULKAN_VALIDATION");
+
+    if (requested != nullptr)
+    {
+        if (strcmp(requested, "off") == 0)
+        {
+            level = ValidationLevel::Off;
+        }
+        else if (strcmp(requested, "errors") == 0)
+        {
+            level = ValidationLevel::Errors;
+        }
+        else if (strcmp(requested, "full") == 0)
+        {
+            level = ValidationLevel::Full;
+        }
+
+        if (static_cast<int>(level) > VALIDATION_LEVEL)
+        {
+            level = static_cast<ValidationLevel>(VALIDATION_LEVEL);
+        }
+    }
+#endif
+
+    return level;
+}
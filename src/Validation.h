@@ -0,0 +1,19 @@
+#ifndef VALIDATION_H_
+#define VALIDATION_H_
+
+// Highest validation level compiled in: 0 = off, 1 = errors, 2 = full (with synchronization validation).
+// With 0 the validation layer, the debug messenger and the startup diagnostics are compiled out entirely
+#ifndef VALIDATION_LEVEL
+#ifdef NDEBUG
+#define VALIDATION_LEVEL 0
+#else
+#define VALIDATION_LEVEL 2
+#endif
+#endif
+
+enum class ValidationLevel { Off = 0, Errors = 1, Full = 2 };
+
+// Runtime level: BASICVULKAN_VALIDATION=off|errors|full, never above the compiled-in level
+ValidationLevel selectValidationLevel();
+
+#endif
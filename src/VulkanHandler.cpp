@@ -1,39 +1,37 @@
+#include <algorithm>
+#include <cstdlib>
 #include <cstring>
-#include <fmt/format.h> // To be replaced with <format> as soon a larger compiler support is available
-#include <fstream>
-#include <iostream>
 #include <set>
+#include <stdexcept>
+#include <thread>
 
 #include <SDL.h>
 #include <SDL_vulkan.h>
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
 
+#include "Logger.h"
+#include "TaskGraph.h"
+#include "Trace.h"
 #include "VulkanHandler.h"
 
 #define CLAMP(x, lo, hi) ((x) < (lo) ? (lo) : (x) > (hi) ? (hi) : (x))
 
+#if VALIDATION_LEVEL > 0
 const std::vector<const char *> requiredInstanceLayers {
     "VK_LAYER_KHRONOS_validation",
     // VK_KHR_SURFACE_EXTENSION_NAME,
 };
+#endif
 
 const std::vector<const char*> deviceExtensions {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
 
-// static VKAPI_ATTR VkBool32 VKAPI_CALL debugCallback(
-//     VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity, VkDebugUtilsMessageTypeFlagsEXT messageType,
-//     const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData)
-// {
-//     std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
-
-//     return VK_FALSE;
-// }
-
 VulkanHandler::VulkanHandler(SDL_Window *window, char *name)
 {
     sdlWindow = window;
     windowName = name;
     applicationType = ApplicationType::SDL;
+    validationLevel = selectValidationLevel();
     MAX_FRAMES_IN_FLIGHT = 2;
 }
 
@@ -42,6 +40,16 @@ VulkanHandler::VulkanHandler(GLFWwindow *window, char *name)
     glfwWindow = window;
     windowName = name;
     applicationType = ApplicationType::GLFW;
+    validationLevel = selectValidationLevel();
+    MAX_FRAMES_IN_FLIGHT = 2;
+}
+
+VulkanHandler::VulkanHandler(VkExtent2D headlessSize, char *name)
+{
+    swapchainSize = headlessSize;
+    windowName = name;
+    applicationType = ApplicationType::Headless;
+    validationLevel = selectValidationLevel();
     MAX_FRAMES_IN_FLIGHT = 2;
 }
 
@@ -49,66 +57,144 @@ VulkanHandler::~VulkanHandler() {}
 
 void VulkanHandler::init()
 {
-    checkInstanceLayers();
-    checkSupportedInstanceExtensions();
-    createInstance();
-    checkAvailablePhysicalDevices();
-    createDebug(); // Depends on SDL/GLFW
-    createSurface();
-    selectPhysicalDevice();
-    selectQueueFamily();
-    createDevice();
-    createSwapchain(false); // Depends on SDL/GLFW
-    createImageViews();
-    setupDepthStencil();
-    createRenderPass();
-    createGraphicsPipeline();
-    createFramebuffers();
-    createCommandPool();
-    createCommandBuffers();
-    createSemaphores();
-    createFences();
+    TRACE_ZONE("VulkanHandler::init");
+
+    // Steps only wait for what they consume: once the device exists, shader pipelines compile while the swapchain,
+    // its views and the depth buffer are created. Windowing calls stay on the calling thread
+    TaskGraph steps;
+
+    TaskId layersStep = steps.add("checkInstanceLayers", [this] {
+#if VALIDATION_LEVEL > 0
+        if (validationLevel != ValidationLevel::Off && !checkInstanceLayers())
+        {
+            LOG_WARNING("Validation layer not available, running without validation");
+            validationLevel = ValidationLevel::Off;
+        }
+
+        if (validationLevel == ValidationLevel::Full)
+        {
+            checkSupportedInstanceExtensions();
+        }
+#endif
+    });
+
+    TaskId instanceStep = steps.addMainThread("createInstance", [this] { createInstance(); }, {layersStep});
+
+    // The messenger exists before the device so that device creation is already reported on. Creating it must not
+    // overlap any other command on the instance, so it runs on the main thread before anything else uses the instance
+    TaskId debugStep = instanceStep;
+#if VALIDATION_LEVEL > 0
+    debugStep = steps.addMainThread("createDebug", [this] {
+        if (validationLevel == ValidationLevel::Full)
+        {
+            checkAvailablePhysicalDevices();
+        }
+
+        if (validationLevel != ValidationLevel::Off)
+        {
+            createDebug();
+        }
+    }, {instanceStep});
+#endif
+
+    TaskId surfaceStep = steps.addMainThread("createSurface", [this] { createSurface(); }, {debugStep});
+    TaskId physicalDeviceStep = steps.add("selectPhysicalDevice", [this] { selectPhysicalDevice(); }, {debugStep});
+    TaskId queueFamilyStep = steps.add("selectQueueFamily", [this] { selectQueueFamily(); }, {physicalDeviceStep, surfaceStep});
+    TaskId depthFormatStep = steps.add("selectDepthFormat", [this] { selectDepthFormat(); }, {physicalDeviceStep});
+    TaskId sampleCountStep = steps.add("selectSampleCount", [this] { selectSampleCount(); }, {physicalDeviceStep});
+    TaskId deviceStep = steps.add("createDevice", [this] { createDevice(); }, {queueFamilyStep});
+
+    TaskId pipelineManagerStep = steps.add("createPipelineManager", [this] { createPipelineManager(); }, {deviceStep});
+    steps.add("createGpuProfiler", [this] { createGpuProfiler(); }, {deviceStep});
+    steps.add("createSubmitScheduler", [this] { createSubmitScheduler(); }, {deviceStep});
+    TaskId memoryBudgetStep = steps.add("createMemoryBudget", [this] { createMemoryBudget(); }, {deviceStep});
+    steps.add("createTextureManager", [this] { createTextureManager(); }, {memoryBudgetStep});
+    TaskId meshManagerStep = steps.add("createMeshManager", [this] { createMeshManager(); }, {memoryBudgetStep});
+
+    TaskId swapchainStep = steps.addMainThread("createSwapchain", [this] { createSwapchain(false); }, {deviceStep});
+    TaskId imageViewsStep = steps.add("createImageViews", [this] { createImageViews(); }, {swapchainStep});
+    TaskId postStep = steps.add("createPostProcessor", [this] { createPostProcessor(); }, {swapchainStep, pipelineManagerStep, memoryBudgetStep});
+    TaskId colorTargetStep = steps.add("createColorTarget", [this] { createColorTarget(); }, {postStep, sampleCountStep});
+    TaskId depthStencilStep = steps.add("setupDepthStencil", [this] { setupDepthStencil(); }, {swapchainStep, depthFormatStep, sampleCountStep});
+    TaskId renderPassStep = steps.add("createRenderPass", [this] { createRenderPass(); }, {postStep, depthFormatStep, sampleCountStep, pipelineManagerStep});
+    steps.add("createGraphicsPipeline", [this] { createGraphicsPipeline(); }, {renderPassStep});
+    TaskId shadowStep = steps.add("createShadowMaps", [this] { createShadowMaps(); }, {pipelineManagerStep, memoryBudgetStep});
+    TaskId lightingStep = steps.add("createClusteredLighting", [this] { createClusteredLighting(); }, {shadowStep});
+    steps.add("createMeshletRenderer", [this] { createMeshletRenderer(); }, {renderPassStep, meshManagerStep, lightingStep});
+    steps.add("createInstanceRenderer", [this] { createInstanceRenderer(); }, {renderPassStep, meshManagerStep, lightingStep});
+    steps.add("createFramebuffers", [this] { createFramebuffers(); }, {imageViewsStep, colorTargetStep, depthStencilStep, renderPassStep});
+
+    TaskId commandPoolStep = steps.add("createCommandPool", [this] { createCommandPool(); }, {deviceStep});
+    steps.add("createCommandBuffers", [this] { createCommandBuffers(); }, {commandPoolStep});
+    steps.add("createSemaphores", [this] { createSemaphores(); }, {swapchainStep});
+    steps.add("createFences", [this] { createFences(); }, {deviceStep});
+
+    ThreadPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    steps.run(pool);
+    steps.report("Startup");
+
+    // Released meshes first, which nothing draws, then the finest mips of textures, which only blurs them
+    memory->addEvictionCallback([this](uint32_t heap, VkDeviceSize bytes) { return meshes->evict(heap, bytes); });
+    memory->addEvictionCallback([this](uint32_t heap, VkDeviceSize bytes) { return textures->evict(heap, bytes); });
+
+    // Dynamic resolution follows the GPU timings of the frames
+    if (resolution)
+    {
+        gpuProfiler->setEnabled(true);
+    }
 }
 
+#if VALIDATION_LEVEL > 0
 void VulkanHandler::checkSupportedInstanceExtensions()
 {
+    TRACE_ZONE("VulkanHandler::checkSupportedInstanceExtensions");
+
     uint32_t extensionCount = 0;
 
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, nullptr);
     std::vector<VkExtensionProperties> extensions(extensionCount);
     vkEnumerateInstanceExtensionProperties(nullptr, &extensionCount, extensions.data());
 
-    std::cout << "------------------------------" << std::endl;
-    std::cout << "Supported instance extensions:" << std::endl;
-    std::cout << "------------------------------" << std::endl;
+    LOG_INFO("------------------------------");
+    LOG_INFO("Supported instance extensions:");
+    LOG_INFO("------------------------------");
 
     for (const auto &extension : extensions)
     {
-        std::cout << '\t' << extension.extensionName << std::endl;
+        LOG_INFO("\t{}", extension.extensionName);
     }
-    std::cout << std::endl;
 }
 
-void VulkanHandler::checkInstanceLayers()
+bool VulkanHandler::checkInstanceLayers()
 {
+    TRACE_ZONE("VulkanHandler::checkInstanceLayers");
+
     uint32_t propCount;
 
     vkEnumerateInstanceLayerProperties(&propCount, nullptr);
     std::vector<VkLayerProperties> layerProps(propCount);
     vkEnumerateInstanceLayerProperties(&propCount, layerProps.data());
 
-    std::cout << "----------------" << std::endl;
-    std::cout << "Instance layers: " << std::endl;
-    std::cout << "----------------" << std::endl;
+    bool verbose = validationLevel == ValidationLevel::Full;
+
+    if (verbose)
+    {
+        LOG_INFO("----------------");
+        LOG_INFO("Instance layers: ");
+        LOG_INFO("----------------");
+    }
 
     std::vector<bool> requestedLayerFound(requiredInstanceLayers.size(), false);
 
     for (auto &prop : layerProps)
     {
-        std::cout << "\t" << "Layer Name: " << prop.layerName << std::endl;
-        std::cout << "\t" << "Description: " << prop.description << std::endl;
-        std::cout << "\t" << "Spec version: " << prop.specVersion << std::endl;
-        std::cout << "\t" << "Implementation version: " << prop.implementationVersion << std::endl;
+        if (verbose)
+        {
+            LOG_INFO("\tLayer Name: {}", prop.layerName);
+            LOG_INFO("\tDescription: {}", prop.description);
+            LOG_INFO("\tSpec version: {}", prop.specVersion);
+            LOG_INFO("\tImplementation version: {}", prop.implementationVersion);
+        }
 
         for (int i = 0; i < requiredInstanceLayers.size(); i++)
         {
@@ -118,21 +204,24 @@ void VulkanHandler::checkInstanceLayers()
                 break;
             }
         }
-
-        std::cout << std::endl;
     }
 
     for (int i = 0; i < requestedLayerFound.size(); i++)
     {
         if (!requestedLayerFound[i])
         {
-            throw std::runtime_error(fmt::format("Layer {} requested but not available!", requiredInstanceLayers[i]));
+            LOG_WARNING("Layer {} requested but not available!", requiredInstanceLayers[i]);
+            return false;
         }
     }
+
+    return true;
 }
 
 void VulkanHandler::checkAvailablePhysicalDevices()
 {
+    TRACE_ZONE("VulkanHandler::checkAvailablePhysicalDevices");
+
     uint32_t deviceCount = 0;
     vkEnumeratePhysicalDevices(instance, &deviceCount, nullptr);
 
@@ -144,9 +233,9 @@ void VulkanHandler::checkAvailablePhysicalDevices()
     std::vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-    std::cout << "-----------------------------------------------" << std::endl;
-    std::cout << "Available physical devices with Vulkan support:" << std::endl;
-    std::cout << "-----------------------------------------------" << std::endl;
+    LOG_INFO("-----------------------------------------------");
+    LOG_INFO("Available physical devices with Vulkan support:");
+    LOG_INFO("-----------------------------------------------");
 
     for (auto &device : devices)
     {
@@ -159,11 +248,10 @@ void VulkanHandler::checkPhysicalDevice(VkPhysicalDevice *device)
     VkPhysicalDeviceProperties deviceProps;
     vkGetPhysicalDeviceProperties(*device, &deviceProps);
 
-    std::cout << '\t' << "Vendor ID: " << deviceProps.vendorID << std::endl;
-    std::cout << '\t' << "Device name: " << deviceProps.deviceName << std::endl;
-    std::cout << '\t' << "Device type: " << deviceProps.deviceType << std::endl;
-    std::cout << '\t' << "Driver version: " << deviceProps.driverVersion << std::endl;
-    std::cout << '\t' << "" << std::endl;
+    LOG_INFO("\tVendor ID: {}", deviceProps.vendorID);
+    LOG_INFO("\tDevice name: {}", deviceProps.deviceName);
+    LOG_INFO("\tDevice type: {}", static_cast<int>(deviceProps.deviceType));
+    LOG_INFO("\tDriver version: {}", deviceProps.driverVersion);
 
     // TODO: Consider printing a list of selected features to be checked
     // -----------------------------------------------------------------
@@ -172,6 +260,8 @@ void VulkanHandler::checkPhysicalDevice(VkPhysicalDevice *device)
     // ...
 }
 
+#endif
+
 std::vector<const char *> VulkanHandler::getRequiredInstanceExtensions()
 {
     // TODO: Refactor this mess
@@ -181,7 +271,10 @@ std::vector<const char *> VulkanHandler::getRequiredInstanceExtensions()
         bool step1 = SDL_Vulkan_GetInstanceExtensions(sdlWindow, &extensionCount, nullptr);
         std::vector<const char *> extensions(extensionCount);
         bool step2 = SDL_Vulkan_GetInstanceExtensions(sdlWindow, &extensionCount, extensions.data());
-        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        if (validationLevel != ValidationLevel::Off)
+        {
+            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        }
 
         return extensions;
     }
@@ -191,72 +284,175 @@ std::vector<const char *> VulkanHandler::getRequiredInstanceExtensions()
         const char **glfwExtensions;
         glfwExtensions = glfwGetRequiredInstanceExtensions(&extensionCount);
         std::vector<const char *> extensions(glfwExtensions, glfwExtensions + extensionCount);
-        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        if (validationLevel != ValidationLevel::Off)
+        {
+            extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+        }
 
         return extensions;
     }
+
+    std::vector<const char *> extensions;
+    if (validationLevel != ValidationLevel::Off)
+    {
+        extensions.push_back(VK_EXT_DEBUG_UTILS_EXTENSION_NAME);
+    }
+
+    return extensions;
 }
 
 void VulkanHandler::createInstance()
 {
+    TRACE_ZONE("VulkanHandler::createInstance");
+
+    // Vulkan 1.1 when the loader has it, for the feature queries and extensions that depend on it; plain 1.0 otherwise
+    auto enumerateInstanceVersion =
+        (PFN_vkEnumerateInstanceVersion)vkGetInstanceProcAddr(VK_NULL_HANDLE, "vkEnumerateInstanceVersion");
+
+    instanceApiVersion = VK_API_VERSION_1_0;
+    if (enumerateInstanceVersion != nullptr && enumerateInstanceVersion(&instanceApiVersion) == VK_SUCCESS)
+    {
+        instanceApiVersion = std::min<uint32_t>(instanceApiVersion, VK_API_VERSION_1_1);
+    }
+
     VkApplicationInfo appInfo {
         .sType              = VK_STRUCTURE_TYPE_APPLICATION_INFO,
         .pApplicationName   = windowName,
         .applicationVersion = VK_MAKE_VERSION(1, 0, 0),
         .pEngineName        = "No Engine",
         .engineVersion      = VK_MAKE_VERSION(1, 0, 0),
-        .apiVersion         = VK_API_VERSION_1_0,
+        .apiVersion         = instanceApiVersion,
     };
 
     auto extensions = getRequiredInstanceExtensions();
 
+#if VALIDATION_LEVEL > 0
+    // Synchronization validation is switched on through VK_EXT_validation_features, which the validation layer
+    // provides: only chained when the layer reports it, and enabled along with it
+    bool validationFeaturesAvailable = false;
+
+    if (validationLevel == ValidationLevel::Full)
+    {
+        uint32_t layerExtensionCount = 0;
+        vkEnumerateInstanceExtensionProperties(requiredInstanceLayers[0], &layerExtensionCount, nullptr);
+        std::vector<VkExtensionProperties> layerExtensions(layerExtensionCount);
+        vkEnumerateInstanceExtensionProperties(requiredInstanceLayers[0], &layerExtensionCount, layerExtensions.data());
+
+        validationFeaturesAvailable = std::any_of(
+            layerExtensions.begin(), layerExtensions.end(), [](const VkExtensionProperties &extension) {
+                return strcmp(extension.extensionName, VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME) == 0;
+            });
+
+        if (validationFeaturesAvailable)
+        {
+            extensions.push_back(VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+        }
+        else
+        {
+            LOG_WARNING(
+                "{} not available: synchronization validation is off", VK_EXT_VALIDATION_FEATURES_EXTENSION_NAME);
+        }
+    }
+#endif
+
     VkInstanceCreateInfo instanceCreateInfo {
         .sType                   = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO,
         .pApplicationInfo        = &appInfo,
-        .enabledLayerCount       = static_cast<uint32_t>(requiredInstanceLayers.size()),
-        .ppEnabledLayerNames     = requiredInstanceLayers.data(),
         .enabledExtensionCount   = static_cast<uint32_t>(extensions.size()),
         .ppEnabledExtensionNames = extensions.data(),
     };
 
+#if VALIDATION_LEVEL > 0
+    VkValidationFeatureEnableEXT enabledValidationFeatures[] {
+        VK_VALIDATION_FEATURE_ENABLE_SYNCHRONIZATION_VALIDATION_EXT,
+    };
+
+    VkValidationFeaturesEXT validationFeatures {
+        .sType                         = VK_STRUCTURE_TYPE_VALIDATION_FEATURES_EXT,
+        .enabledValidationFeatureCount = 1,
+        .pEnabledValidationFeatures    = enabledValidationFeatures,
+    };
+
+    if (validationLevel != ValidationLevel::Off)
+    {
+        instanceCreateInfo.enabledLayerCount   = static_cast<uint32_t>(requiredInstanceLayers.size());
+        instanceCreateInfo.ppEnabledLayerNames = requiredInstanceLayers.data();
+    }
+
+    if (validationFeaturesAvailable)
+    {
+        instanceCreateInfo.pNext = &validationFeatures;
+    }
+#endif
+
     if (vkCreateInstance(&instanceCreateInfo, nullptr, &instance) != VK_SUCCESS)
     {
         throw std::runtime_error("Failed to create instance!");
     }
 }
 
+#if VALIDATION_LEVEL > 0
 static VKAPI_ATTR VkBool32 VKAPI_CALL VulkanReportFunc(
-    VkDebugReportFlagsEXT flags,
-    VkDebugReportObjectTypeEXT objType,
-    uint64_t obj,
-    size_t location,
-    int32_t code,
-    const char *layerPrefix,
-    const char *msg,
+    VkDebugUtilsMessageSeverityFlagBitsEXT messageSeverity,
+    VkDebugUtilsMessageTypeFlagsEXT messageType,
+    const VkDebugUtilsMessengerCallbackDataEXT *callbackData,
     void *userData)
 {
-    printf("VULKAN VALIDATION: %s\n", msg);
+    // Validation tends to repeat the same message every frame: let a few through per second and count the rest
+    static LogRateLimiter rateLimiter(5, std::chrono::seconds(1));
+    uint32_t suppressed;
+
+    if (!rateLimiter.allow(static_cast<uint32_t>(callbackData->messageIdNumber), &suppressed))
+    {
+        return VK_FALSE;
+    }
+
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+    {
+        LOG_ERROR("VULKAN VALIDATION: {} ({} similar messages suppressed)", callbackData->pMessage, suppressed);
+    }
+    else
+    {
+        LOG_WARNING("VULKAN VALIDATION: {} ({} similar messages suppressed)", callbackData->pMessage, suppressed);
+    }
+
     return VK_FALSE;
 }
 
 void VulkanHandler::createDebug()
 {
-    VkDebugReportCallbackCreateInfoEXT debugCallbackCreateInfo
+    TRACE_ZONE("VulkanHandler::createDebug");
+
+    VkDebugUtilsMessageSeverityFlagsEXT severity = VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT;
+
+    if (validationLevel == ValidationLevel::Full)
     {
-        .sType       = VK_STRUCTURE_TYPE_DEBUG_REPORT_CALLBACK_CREATE_INFO_EXT,
-        .flags       = VK_DEBUG_REPORT_ERROR_BIT_EXT | VK_DEBUG_REPORT_WARNING_BIT_EXT,
-        .pfnCallback = VulkanReportFunc,
+        severity |= VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT;
+    }
+
+    VkDebugUtilsMessengerCreateInfoEXT debugMessengerCreateInfo {
+        .sType           = VK_STRUCTURE_TYPE_DEBUG_UTILS_MESSENGER_CREATE_INFO_EXT,
+        .messageSeverity = severity,
+        .messageType     = VK_DEBUG_UTILS_MESSAGE_TYPE_GENERAL_BIT_EXT | VK_DEBUG_UTILS_MESSAGE_TYPE_VALIDATION_BIT_EXT |
+                           VK_DEBUG_UTILS_MESSAGE_TYPE_PERFORMANCE_BIT_EXT,
+        .pfnUserCallback = VulkanReportFunc,
     };
 
-    if (applicationType == ApplicationType::SDL)
+    auto createDebugUtilsMessenger =
+        (PFN_vkCreateDebugUtilsMessengerEXT)vkGetInstanceProcAddr(instance, "vkCreateDebugUtilsMessengerEXT");
+
+    if (createDebugUtilsMessenger == nullptr ||
+        createDebugUtilsMessenger(instance, &debugMessengerCreateInfo, nullptr, &debugMessenger) != VK_SUCCESS)
     {
-        SDL2_vkCreateDebugReportCallbackEXT = (PFN_vkCreateDebugReportCallbackEXT)SDL_Vulkan_GetVkGetInstanceProcAddr();
-        SDL2_vkCreateDebugReportCallbackEXT(instance, &debugCallbackCreateInfo, 0, &debugCallback);
+        throw std::runtime_error("Failed to create debug messenger!");
     }
 }
+#endif
 
 void VulkanHandler::createSurface()
 {
+    TRACE_ZONE("VulkanHandler::createSurface");
+
     if (applicationType == ApplicationType::SDL)
     {
         if (SDL_Vulkan_CreateSurface(sdlWindow, instance, &surface) == SDL_FALSE)
@@ -271,14 +467,26 @@ void VulkanHandler::createSurface()
             throw std::runtime_error("Failed to create window surface!");
         }
     }
+    else
+    {
+        surface = VK_NULL_HANDLE;
+    }
 }
 
 void VulkanHandler::selectPhysicalDevice()
 {
+    TRACE_ZONE("VulkanHandler::selectPhysicalDevice");
+
     std::vector<VkPhysicalDevice> physicalDevices;
     uint32_t physicalDeviceCount = 0;
 
     vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, nullptr);
+
+    if (physicalDeviceCount == 0)
+    {
+        throw std::runtime_error("Failed to find device with Vulkan support!");
+    }
+
     physicalDevices.resize(physicalDeviceCount);
     vkEnumeratePhysicalDevices(instance, &physicalDeviceCount, physicalDevices.data());
 
@@ -289,14 +497,21 @@ void VulkanHandler::selectPhysicalDevice()
         throw std::runtime_error("Failed to select a physical device!");
     }
 
-    std::cout << "-------------------------" << std::endl;
-    std::cout << "Selected physical device:" << std::endl;
-    std::cout << "-------------------------" << std::endl;
-    checkPhysicalDevice(&physicalDevice);
+#if VALIDATION_LEVEL > 0
+    if (validationLevel == ValidationLevel::Full)
+    {
+        LOG_INFO("-------------------------");
+        LOG_INFO("Selected physical device:");
+        LOG_INFO("-------------------------");
+        checkPhysicalDevice(&physicalDevice);
+    }
+#endif
 }
 
 void VulkanHandler::selectQueueFamily()
 {
+    TRACE_ZONE("VulkanHandler::selectQueueFamily");
+
     std::vector<VkQueueFamilyProperties> queueFamilyProperties;
     uint32_t queueFamilyCount;
 
@@ -317,7 +532,12 @@ void VulkanHandler::selectQueueFamily()
 
         VkBool32 presentSupport = false;
 
-        if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport) != VK_SUCCESS)
+        // Headless rendering never presents: the graphics queue doubles as the present one
+        if (surface == VK_NULL_HANDLE)
+        {
+            presentSupport = queueFamily.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+        }
+        else if (vkGetPhysicalDeviceSurfaceSupportKHR(physicalDevice, i, surface, &presentSupport) != VK_SUCCESS)
         {
             throw std::runtime_error("Failed to get physical device surface support!");
         }
@@ -341,6 +561,8 @@ void VulkanHandler::selectQueueFamily()
 
 void VulkanHandler::createDevice()
 {
+    TRACE_ZONE("VulkanHandler::createDevice");
+
     const float queuePriorities[] {1.0f};
 
     std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
@@ -366,18 +588,153 @@ void VulkanHandler::createDevice()
         .pQueuePriorities = &queuePriority,
     };
 
+    VkPhysicalDeviceFeatures supportedFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &supportedFeatures);
+
     VkPhysicalDeviceFeatures deviceFeatures {
+        // Arrays of cube maps are only viewable as such with this feature
+        .imageCubeArray            = supportedFeatures.imageCubeArray,
+        // Both only change how the meshlet fallback issues its indirect draws
+        .multiDrawIndirect         = supportedFeatures.multiDrawIndirect,
+        .drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance,
         // .samplerAnisotropy = VK_TRUE,
     };
 
+    std::vector<const char *> enabledExtensions;
+    if (surface != VK_NULL_HANDLE)
+    {
+        enabledExtensions = deviceExtensions;
+    }
+
+    // Task and mesh shaders need their extension and SPIR-V 1.4, whose extensions only exist from Vulkan 1.1
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, nullptr);
+    std::vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(physicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    auto hasExtension = [&](const char *name) {
+        return std::any_of(availableExtensions.begin(), availableExtensions.end(), [name](const VkExtensionProperties &extension) {
+            return strcmp(extension.extensionName, name) == 0;
+        });
+    };
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+    };
+
+    const char *meshShadersSetting = std::getenv("BASICVULKAN_MESH_SHADERS");
+    bool meshShadersAllowed = meshShadersSetting == nullptr || strcmp(meshShadersSetting, "0") != 0;
+
+    // Stage masks on semaphore waits and signals, for the submit scheduler; the instance stops at 1.1, so it is the
+    // extension rather than core 1.3
+    VkPhysicalDeviceSynchronization2Features synchronization2Features {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+    };
+
+    bool features2Available = instanceApiVersion >= VK_API_VERSION_1_1 && deviceProperties.apiVersion >= VK_API_VERSION_1_1;
+    bool meshShadersAvailable = meshShadersAllowed && features2Available && hasExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+        hasExtension(VK_KHR_SPIRV_1_4_EXTENSION_NAME) && hasExtension(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME);
+    bool synchronization2Available = features2Available && hasExtension(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+
+    if (meshShadersAvailable || synchronization2Available)
+    {
+        VkPhysicalDeviceFeatures2 features2 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+        };
+
+        if (meshShadersAvailable)
+        {
+            meshShaderFeatures.pNext = features2.pNext;
+            features2.pNext = &meshShaderFeatures;
+        }
+
+        if (synchronization2Available)
+        {
+            synchronization2Features.pNext = features2.pNext;
+            features2.pNext = &synchronization2Features;
+        }
+
+        vkGetPhysicalDeviceFeatures2(physicalDevice, &features2);
+    }
+
+    synchronization2 = synchronization2Features.synchronization2 == VK_TRUE;
+
+    // Heap budgets are queried with the 1.1 memory properties
+    memoryBudget = features2Available && hasExtension(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+
+    // Quad operations in compute shaders, for the bloom downsampling; a 2x2 quad needs subgroups of 4 at least
+    subgroupQuad = false;
+
+    if (features2Available)
+    {
+        VkPhysicalDeviceSubgroupProperties subgroupProperties {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_PROPERTIES,
+        };
+
+        VkPhysicalDeviceProperties2 properties2 {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+            .pNext = &subgroupProperties,
+        };
+
+        vkGetPhysicalDeviceProperties2(physicalDevice, &properties2);
+
+        subgroupQuad = (subgroupProperties.supportedStages & VK_SHADER_STAGE_COMPUTE_BIT) &&
+            (subgroupProperties.supportedOperations & VK_SUBGROUP_FEATURE_QUAD_BIT) && subgroupProperties.subgroupSize >= 4;
+    }
+
+    meshletFeatures = {
+        .meshShaders               = meshShaderFeatures.taskShader && meshShaderFeatures.meshShader,
+        .maxDrawIndirectCount      = supportedFeatures.multiDrawIndirect ? deviceProperties.limits.maxDrawIndirectCount : 1,
+        .drawIndirectFirstInstance = supportedFeatures.drawIndirectFirstInstance == VK_TRUE,
+    };
+
+    // Only the two stages are enabled: the other mesh shader features have requirements of their own
+    VkPhysicalDeviceMeshShaderFeaturesEXT enabledMeshShaderFeatures {
+        .sType      = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+        .taskShader = VK_TRUE,
+        .meshShader = VK_TRUE,
+    };
+
+    VkPhysicalDeviceSynchronization2Features enabledSynchronization2Features {
+        .sType            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES,
+        .synchronization2 = VK_TRUE,
+    };
+
+    void *enabledFeatures = nullptr;
+
+    if (meshletFeatures.meshShaders)
+    {
+        enabledExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_SPIRV_1_4_EXTENSION_NAME);
+        enabledExtensions.push_back(VK_KHR_SHADER_FLOAT_CONTROLS_EXTENSION_NAME);
+
+        enabledMeshShaderFeatures.pNext = enabledFeatures;
+        enabledFeatures = &enabledMeshShaderFeatures;
+    }
+
+    if (memoryBudget)
+    {
+        enabledExtensions.push_back(VK_EXT_MEMORY_BUDGET_EXTENSION_NAME);
+    }
+
+    if (synchronization2)
+    {
+        enabledExtensions.push_back(VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME);
+
+        enabledSynchronization2Features.pNext = enabledFeatures;
+        enabledFeatures = &enabledSynchronization2Features;
+    }
+
     VkDeviceCreateInfo createInfo {
         .sType                   = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
+        .pNext                   = enabledFeatures,
         .queueCreateInfoCount    = static_cast<uint32_t>(queueCreateInfos.size()),
         .pQueueCreateInfos       = queueCreateInfos.data(),
-        .enabledLayerCount       = static_cast<uint32_t>(requiredInstanceLayers.size()),
-        .ppEnabledLayerNames     = requiredInstanceLayers.data(),
-        .enabledExtensionCount   = static_cast<uint32_t>(deviceExtensions.size()),
-        .ppEnabledExtensionNames = deviceExtensions.data(),
+        .enabledExtensionCount   = static_cast<uint32_t>(enabledExtensions.size()),
+        .ppEnabledExtensionNames = enabledExtensions.data(),
         .pEnabledFeatures        = &deviceFeatures,
     };
 
@@ -392,6 +749,14 @@ void VulkanHandler::createDevice()
 
 void VulkanHandler::createSwapchain(bool resize)
 {
+    TRACE_ZONE("VulkanHandler::createSwapchain");
+
+    if (applicationType == ApplicationType::Headless)
+    {
+        createOffscreenTargets();
+        return;
+    }
+
     std::vector<VkSurfaceFormatKHR> surfaceFormats;
     uint32_t surfaceFormatsCount;
     uint32_t queueFamilyIndices[] {graphicsQueueFamilyIndex, presentQueueFamilyIndex};
@@ -445,7 +810,9 @@ void VulkanHandler::createSwapchain(bool resize)
         .imageColorSpace  = surfaceFormat.colorSpace,
         .imageExtent      = swapchainSize,
         .imageArrayLayers = 1,
-        .imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT,
+        .imageUsage       = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                            (surfaceCapabilities.supportedUsageFlags &
+                             (VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT)),
         .preTransform     = surfaceCapabilities.currentTransform,
         .compositeAlpha   = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR,
         .presentMode      = VK_PRESENT_MODE_FIFO_KHR,
@@ -471,6 +838,71 @@ void VulkanHandler::createSwapchain(bool resize)
     vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, nullptr);
     swapchainImages.resize(swapchainImageCount);
     vkGetSwapchainImagesKHR(device, swapchain, &swapchainImageCount, swapchainImages.data());
+
+    colorTargetLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+}
+
+void VulkanHandler::createOffscreenTargets()
+{
+    TRACE_ZONE("VulkanHandler::createOffscreenTargets");
+
+    surfaceFormat = {VK_FORMAT_R8G8B8A8_UNORM, VK_COLOR_SPACE_SRGB_NONLINEAR_KHR};
+    colorTargetLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    swapchain = VK_NULL_HANDLE;
+
+    // One target per frame in flight, used in turn in place of acquired swapchain images
+    swapchainImageCount = MAX_FRAMES_IN_FLIGHT;
+    swapchainImages.resize(swapchainImageCount);
+    offscreenImageMemory.resize(swapchainImageCount);
+
+    for (uint32_t i = 0; i < swapchainImageCount; i++)
+    {
+        createImage(
+            swapchainSize.width, swapchainSize.height, 1, VK_SAMPLE_COUNT_1_BIT,
+            surfaceFormat.format, VK_IMAGE_TILING_OPTIMAL,
+            VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            swapchainImages[i], offscreenImageMemory[i]);
+    }
+}
+
+void VulkanHandler::createFrameCapture(const std::string &path)
+{
+    if (applicationType != ApplicationType::Headless &&
+        !(surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_SRC_BIT))
+    {
+        throw std::runtime_error("Swapchain images cannot be read back for capture!");
+    }
+
+    capture = std::make_unique<FrameCapture>(
+        device, physicalDevice, swapchainSize, surfaceFormat.format, colorTargetLayout, MAX_FRAMES_IN_FLIGHT, path);
+}
+
+void VulkanHandler::createParticleSystem(uint32_t capacity)
+{
+    TRACE_ZONE("VulkanHandler::createParticleSystem");
+
+    if (particles)
+    {
+        vkDeviceWaitIdle(device);
+    }
+
+    particles = std::make_unique<ParticleSystem>(device, physicalDevice, *memory, *pipelines, capacity);
+    particles->requestPipelines(colorFormat, depthFormat, sampleCount);
+}
+
+void VulkanHandler::createTexturedQuad()
+{
+    TRACE_ZONE("VulkanHandler::createTexturedQuad");
+
+    if (texturedQuad)
+    {
+        return;
+    }
+
+    texturedQuad = std::make_unique<TexturedQuad>(
+        device, physicalDevice, *pipelines, *textures, MAX_FRAMES_IN_FLIGHT);
+    texturedQuad->requestPipelines(colorFormat, depthFormat, sampleCount);
 }
 
 VkImageView VulkanHandler::createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags)
@@ -500,6 +932,8 @@ VkImageView VulkanHandler::createImageView(VkImage image, VkFormat format, VkIma
 
 void VulkanHandler::createImageViews()
 {
+    TRACE_ZONE("VulkanHandler::createImageViews");
+
     swapchainImageViews.resize(swapchainImages.size());
 
     for (uint32_t i = 0; i < swapchainImages.size(); i++)
@@ -549,7 +983,8 @@ uint32_t VulkanHandler::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlag
 }
 
 void VulkanHandler::createImage(
-    uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling,
+    uint32_t width, uint32_t height, uint32_t arrayLayers, VkSampleCountFlagBits samples, VkFormat format,
+    VkImageTiling tiling,
     VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage &image,
     VkDeviceMemory &imageMemory)
 {
@@ -563,8 +998,8 @@ void VulkanHandler::createImage(
             .depth     = 1,
         },
         .mipLevels     = 1,
-        .arrayLayers   = 1,
-        .samples       = VK_SAMPLE_COUNT_1_BIT,
+        .arrayLayers   = arrayLayers,
+        .samples       = samples,
         .tiling        = tiling,
         .usage         = usage,
         .sharingMode   = VK_SHARING_MODE_EXCLUSIVE,
@@ -579,6 +1014,25 @@ void VulkanHandler::createImage(
     VkMemoryRequirements memRequirements;
     vkGetImageMemoryRequirements(device, image, &memRequirements);
 
+    // Lazily allocated memory only exists on tiled GPUs: elsewhere transient attachments get plain device memory
+    if (properties & VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT)
+    {
+        VkPhysicalDeviceMemoryProperties memProperties;
+        vkGetPhysicalDeviceMemoryProperties(physicalDevice, &memProperties);
+
+        bool available = false;
+        for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++)
+        {
+            available |= (memRequirements.memoryTypeBits & (1 << i)) &&
+                         (memProperties.memoryTypes[i].propertyFlags & properties) == properties;
+        }
+
+        if (!available)
+        {
+            properties &= ~VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT;
+        }
+    }
+
     VkMemoryAllocateInfo allocInfo {
         .sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
         .allocationSize  = memRequirements.size,
@@ -593,40 +1047,189 @@ void VulkanHandler::createImage(
     vkBindImageMemory(device, image, imageMemory, 0);
 }
 
+void VulkanHandler::selectDepthFormat()
+{
+    TRACE_ZONE("VulkanHandler::selectDepthFormat");
+
+    if (!getSupportedDepthFormat(physicalDevice, &depthFormat))
+    {
+        throw std::runtime_error("Failed to find a supported depth format!");
+    }
+}
+
+void VulkanHandler::selectSampleCount()
+{
+    TRACE_ZONE("VulkanHandler::selectSampleCount");
+
+    VkPhysicalDeviceProperties properties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &properties);
+
+    supportedSampleCounts = properties.limits.framebufferColorSampleCounts & properties.limits.framebufferDepthSampleCounts;
+
+    const char *requested = std::getenv("BASICVULKAN_MSAA");
+    sampleCount = clampSampleCount(requested != nullptr ? std::atoi(requested) : 4);
+}
+
+VkSampleCountFlagBits VulkanHandler::clampSampleCount(uint32_t samples)
+{
+    for (uint32_t count = std::min(samples, 8u); count > 1; count /= 2)
+    {
+        if (supportedSampleCounts & count)
+        {
+            return static_cast<VkSampleCountFlagBits>(count);
+        }
+    }
+
+    return VK_SAMPLE_COUNT_1_BIT;
+}
+
+void VulkanHandler::createColorTarget()
+{
+    TRACE_ZONE("VulkanHandler::createColorTarget");
+
+    if (sampleCount == VK_SAMPLE_COUNT_1_BIT)
+    {
+        colorImage = VK_NULL_HANDLE;
+        colorImageMemory = VK_NULL_HANDLE;
+        colorImageView = VK_NULL_HANDLE;
+        return;
+    }
+
+    createImage(
+        swapchainSize.width, swapchainSize.height, 1, sampleCount,
+        colorFormat, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+        colorImage, colorImageMemory);
+
+    colorImageView = createImageView(colorImage, colorFormat, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
 void VulkanHandler::setupDepthStencil()
 {
-    VkBool32 validDepthFormat = getSupportedDepthFormat(physicalDevice, &depthFormat);
+    TRACE_ZONE("VulkanHandler::setupDepthStencil");
 
+    // Depth is never read after the render pass: transient, and only backed by memory where the driver needs it
     createImage(
-        swapchainSize.width, swapchainSize.height,
-        VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_TILING_OPTIMAL,
-        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        swapchainSize.width, swapchainSize.height, 1, sampleCount,
+        depthFormat, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
         depthImage, depthImageMemory);
 
-    depthImageView = createImageView(depthImage, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_IMAGE_ASPECT_DEPTH_BIT);
+    depthImageView = createImageView(depthImage, depthFormat, VK_IMAGE_ASPECT_DEPTH_BIT);
+}
+
+void VulkanHandler::destroyRenderTargets()
+{
+    for (auto framebuffer : swapchainFramebuffers)
+    {
+        vkDestroyFramebuffer(device, framebuffer, nullptr);
+    }
+
+    if (colorImage != VK_NULL_HANDLE)
+    {
+        vkDestroyImageView(device, colorImageView, nullptr);
+        vkDestroyImage(device, colorImage, nullptr);
+        vkFreeMemory(device, colorImageMemory, nullptr);
+    }
+
+    vkDestroyImageView(device, depthImageView, nullptr);
+    vkDestroyImage(device, depthImage, nullptr);
+    vkFreeMemory(device, depthImageMemory, nullptr);
+}
+
+VkSampleCountFlagBits VulkanHandler::getSampleCount() const
+{
+    return sampleCount;
+}
+
+void VulkanHandler::setSampleCount(uint32_t samples)
+{
+    VkSampleCountFlagBits selected = clampSampleCount(samples);
+
+    if (selected == sampleCount)
+    {
+        return;
+    }
+
+    TRACE_ZONE("VulkanHandler::setSampleCount");
+
+    vkDeviceWaitIdle(device);
+    destroyRenderTargets();
+
+    sampleCount = selected;
+
+    createColorTarget();
+    setupDepthStencil();
+    createRenderPass();
+    // Compiled in the background the first time a sample count is used; cached afterwards
+    requestGraphicsPipeline();
+    meshlets->requestPipelines(colorFormat, depthFormat, sampleCount);
+    instances->requestPipelines(colorFormat, depthFormat, sampleCount);
+    if (particles)
+    {
+        particles->requestPipelines(colorFormat, depthFormat, sampleCount);
+    }
+    if (texturedQuad)
+    {
+        texturedQuad->requestPipelines(colorFormat, depthFormat, sampleCount);
+    }
+    createFramebuffers();
+
+    LOG_INFO("MSAA: {}x", static_cast<uint32_t>(sampleCount));
+}
+
+void VulkanHandler::cycleSampleCount()
+{
+    for (uint32_t count = sampleCount * 2; count <= 8; count *= 2)
+    {
+        if (supportedSampleCounts & count)
+        {
+            setSampleCount(count);
+            return;
+        }
+    }
+
+    setSampleCount(1);
 }
 
 void VulkanHandler::createRenderPass()
 {
+    TRACE_ZONE("VulkanHandler::createRenderPass");
+
+    // Render passes are kept per sample count, so that switching back and forth only rebuilds the attachments
+    auto cached = renderPasses.find(sampleCount);
+    if (cached != renderPasses.end())
+    {
+        renderPass = cached->second;
+        return;
+    }
+
+    bool multisampled = sampleCount != VK_SAMPLE_COUNT_1_BIT;
+    // With post-processing the pass renders the scene image, which compute shaders then sample
+    VkImageLayout finalLayout = post ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : colorTargetLayout;
+
     std::vector<VkAttachmentDescription> attachments;
 
+    // Multisampled color is resolved within the subpass and never stored: on tiled GPUs it stays in tile memory
     VkAttachmentDescription colorAttachment {
-        .format         = surfaceFormat.format,
-        .samples        = VK_SAMPLE_COUNT_1_BIT,
+        .format         = colorFormat,
+        .samples        = sampleCount,
         .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+        .storeOp        = multisampled ? VK_ATTACHMENT_STORE_OP_DONT_CARE : VK_ATTACHMENT_STORE_OP_STORE,
         .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
-        .finalLayout    = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR,
+        .finalLayout    = multisampled ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : finalLayout,
     };
     attachments.push_back(colorAttachment);
 
     VkAttachmentDescription depthAttachment {
         .format         = depthFormat,
-        .samples        = VK_SAMPLE_COUNT_1_BIT,
+        .samples        = sampleCount,
         .loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR,
-        .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+        .storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_CLEAR,
         .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
         .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -634,6 +1237,21 @@ void VulkanHandler::createRenderPass()
     };
     attachments.push_back(depthAttachment);
 
+    if (multisampled)
+    {
+        VkAttachmentDescription resolveAttachment {
+            .format         = colorFormat,
+            .samples        = VK_SAMPLE_COUNT_1_BIT,
+            .loadOp         = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .storeOp        = VK_ATTACHMENT_STORE_OP_STORE,
+            .stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE,
+            .stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE,
+            .initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED,
+            .finalLayout    = finalLayout,
+        };
+        attachments.push_back(resolveAttachment);
+    }
+
     VkAttachmentReference colorReference {
         .attachment = 0,
         .layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
@@ -644,13 +1262,18 @@ void VulkanHandler::createRenderPass()
         .layout     = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
     };
 
+    VkAttachmentReference resolveReference {
+        .attachment = 2,
+        .layout     = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+    };
+
     VkSubpassDescription subpassDescription {
         .pipelineBindPoint       = VK_PIPELINE_BIND_POINT_GRAPHICS,
         .inputAttachmentCount    = 0,
         .pInputAttachments       = nullptr,
         .colorAttachmentCount    = 1,
         .pColorAttachments       = &colorReference,
-        .pResolveAttachments     = nullptr,
+        .pResolveAttachments     = multisampled ? &resolveReference : nullptr,
         .pDepthStencilAttachment = &depthReference,
         .preserveAttachmentCount = 0,
         .pPreserveAttachments    = nullptr,
@@ -661,14 +1284,36 @@ void VulkanHandler::createRenderPass()
     VkSubpassDependency dependency {
         .srcSubpass      = VK_SUBPASS_EXTERNAL,
         .dstSubpass      = 0,
-        .srcStageMask    = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        // Chains with the wait on the acquired image, which happens at this same stage
+        .srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
         .dstStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
-        .srcAccessMask   = VK_ACCESS_MEMORY_READ_BIT,
+        .srcAccessMask   = 0,
         .dstAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
         .dependencyFlags = VK_DEPENDENCY_BY_REGION_BIT,
     };
+
+    if (post)
+    {
+        // The scene image is shared by the frames: the previous frame's post-processing must be done reading it
+        dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT | VK_PIPELINE_STAGE_TRANSFER_BIT;
+        dependency.dependencyFlags = 0;
+    }
     dependencies.push_back(dependency);
 
+    if (post)
+    {
+        VkSubpassDependency postDependency {
+            .srcSubpass      = 0,
+            .dstSubpass      = VK_SUBPASS_EXTERNAL,
+            .srcStageMask    = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT,
+            .dstStageMask    = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+            .srcAccessMask   = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+            .dstAccessMask   = VK_ACCESS_SHADER_READ_BIT,
+            .dependencyFlags = 0,
+        };
+        dependencies.push_back(postDependency);
+    }
+
     VkRenderPassCreateInfo renderPassInfo {
         .sType           = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO,
         .attachmentCount = static_cast<uint32_t>(attachments.size()),
@@ -683,125 +1328,173 @@ void VulkanHandler::createRenderPass()
     {
         throw std::runtime_error("Failed to create render pass!");
     }
+
+    renderPasses[sampleCount] = renderPass;
+    pipelines->registerRenderPass(colorFormat, depthFormat, sampleCount, renderPass);
 }
 
-VkShaderModule VulkanHandler::createShaderModule(const std::vector<char> &code)
+void VulkanHandler::createPipelineManager()
 {
-    VkShaderModuleCreateInfo createInfo {
-        .sType    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO,
-        .codeSize = code.size(),
-        .pCode    = reinterpret_cast<const uint32_t *>(code.data()),
-    };
+    TRACE_ZONE("VulkanHandler::createPipelineManager");
 
-    VkShaderModule shaderModule;
-    if (vkCreateShaderModule(device, &createInfo, nullptr, &shaderModule) != VK_SUCCESS)
-    {
-        throw std::runtime_error("Failed to create shader module!");
-    }
+    uint32_t workerCount = std::max(2u, std::thread::hardware_concurrency()) - 1;
+
+    shaders = std::make_unique<ShaderLibrary>(SHADER_SOURCE_DIR);
+    pipelines = std::make_unique<PipelineManager>(device, *shaders, workerCount, MAX_FRAMES_IN_FLIGHT);
+
+#ifdef SHADER_HOT_RELOAD
+    shaderHotReload = std::make_unique<ShaderHotReload>(*shaders, *pipelines);
+#endif
+}
+
+void VulkanHandler::createGpuProfiler()
+{
+    TRACE_ZONE("VulkanHandler::createGpuProfiler");
+
+    gpuProfiler = std::make_unique<GpuProfiler>(device, physicalDevice, graphicsQueueFamilyIndex, MAX_FRAMES_IN_FLIGHT, 16);
+}
+
+void VulkanHandler::createSubmitScheduler()
+{
+    TRACE_ZONE("VulkanHandler::createSubmitScheduler");
+
+    submitter = std::make_unique<SubmitScheduler>(device, graphicsQueue, synchronization2);
+
+    LOG_INFO("Queue submissions through {}", synchronization2 ? "vkQueueSubmit2" : "vkQueueSubmit");
+}
+
+void VulkanHandler::createMemoryBudget()
+{
+    TRACE_ZONE("VulkanHandler::createMemoryBudget");
+
+    // Freed memory is released once the frames in flight, and the one being recorded, are done with it
+    memory = std::make_unique<MemoryBudget>(device, physicalDevice, memoryBudget, MAX_FRAMES_IN_FLIGHT + 1);
+}
+
+void VulkanHandler::createTextureManager()
+{
+    TRACE_ZONE("VulkanHandler::createTextureManager");
 
-    return shaderModule;
+    // 32 MiB of staging shared by the frames in flight, at most 8 MiB of texel data uploaded per frame
+    textures = std::make_unique<TextureManager>(
+        device, physicalDevice, *memory, MAX_FRAMES_IN_FLIGHT, 32 << 20, 8 << 20);
 }
 
-static std::vector<char> readFile(const std::string &filename)
+void VulkanHandler::createMeshManager()
 {
-    std::ifstream file(filename, std::ios::ate | std::ios::binary);
+    TRACE_ZONE("VulkanHandler::createMeshManager");
 
-    if (!file.is_open())
+    meshes = std::make_unique<MeshManager>(
+        device, physicalDevice, *memory, MAX_FRAMES_IN_FLIGHT, 32 << 20, 16 << 20, meshletFeatures.meshShaders);
+}
+
+void VulkanHandler::createShadowMaps()
+{
+    TRACE_ZONE("VulkanHandler::createShadowMaps");
+
+    // Rendered then sampled with comparisons: 32-bit float depth where it can be both, 16-bit otherwise, which every
+    // device can
+    shadowFormat = VK_FORMAT_D16_UNORM;
+
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, VK_FORMAT_D32_SFLOAT, &formatProperties);
+
+    VkFormatFeatureFlags features =
+        VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT;
+    if ((formatProperties.optimalTilingFeatures & features) == features)
     {
-        throw std::runtime_error("Failed to open file!");
+        shadowFormat = VK_FORMAT_D32_SFLOAT;
     }
 
-    size_t fileSize = (size_t)file.tellg();
-    std::vector<char> buffer(fileSize);
-
-    file.seekg(0);
-    file.read(buffer.data(), fileSize);
+    createImage(
+        ShadowMaps::MapSize, ShadowMaps::MapSize, ShadowMaps::CascadeCount, VK_SAMPLE_COUNT_1_BIT,
+        shadowFormat, VK_IMAGE_TILING_OPTIMAL,
+        VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        shadowImage, shadowImageMemory);
+
+    shadows = std::make_unique<ShadowMaps>(
+        device, physicalDevice, *memory, *pipelines, shadowImage, shadowFormat, MAX_FRAMES_IN_FLIGHT);
+}
 
-    file.close();
+void VulkanHandler::createClusteredLighting()
+{
+    TRACE_ZONE("VulkanHandler::createClusteredLighting");
 
-    return buffer;
+    lighting = std::make_unique<ClusteredLighting>(device, *memory, *pipelines, *shadows, MAX_FRAMES_IN_FLIGHT);
 }
 
-void VulkanHandler::createGraphicsPipeline()
+void VulkanHandler::createPostProcessor()
 {
-    auto vertShaderCode = readFile("shaders/vert.spv");
-    auto fragShaderCode = readFile("shaders/frag.spv");
+    TRACE_ZONE("VulkanHandler::createPostProcessor");
 
-    VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
-    VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
+    colorFormat = surfaceFormat.format;
 
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo {
-        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage  = VK_SHADER_STAGE_VERTEX_BIT,
-        .module = vertShaderModule,
-        .pName  = "main",
-    };
+    const char *effects = std::getenv("BASICVULKAN_POST");
+    const char *budget = std::getenv("BASICVULKAN_FRAME_BUDGET");
+    if (effects == nullptr && budget == nullptr)
+    {
+        return;
+    }
 
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo {
-        .sType  = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-        .stage  = VK_SHADER_STAGE_FRAGMENT_BIT,
-        .module = fragShaderModule,
-        .pName  = "main",
-    };
+    // The processed frame is blitted into the swapchain image
+    VkFormatProperties formatProperties;
+    vkGetPhysicalDeviceFormatProperties(physicalDevice, surfaceFormat.format, &formatProperties);
 
-    VkPipelineShaderStageCreateInfo shaderStages[] {vertShaderStageInfo, fragShaderStageInfo};
+    bool blittable = (formatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) &&
+        (applicationType == ApplicationType::Headless ||
+         (surfaceCapabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT));
 
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo {
-        .sType                           = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
-        .vertexBindingDescriptionCount   = 0,
-        .vertexAttributeDescriptionCount = 0,
-    };
+    if (!blittable)
+    {
+        LOG_WARNING("Post-processing and dynamic resolution disabled: swapchain images cannot be blitted to");
+        return;
+    }
 
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly {
-        .sType                  = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO,
-        .topology               = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST,
-        .primitiveRestartEnable = VK_FALSE,
-    };
+    // Dynamic resolution alone upscales through post-processing with every effect off
+    post = std::make_unique<PostProcessor>(device, *memory, *pipelines, swapchainSize, subgroupQuad);
+    post->setEffects(effects != nullptr ? effects : "");
+    colorFormat = PostProcessor::SceneFormat;
 
-    VkPipelineViewportStateCreateInfo viewportState {
-        .sType         = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO,
-        .viewportCount = 1,
-        .scissorCount  = 1,
-    };
+    if (budget == nullptr)
+    {
+        return;
+    }
 
-    VkPipelineRasterizationStateCreateInfo rasterizer {
-        .sType                   = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO,
-        .depthClampEnable        = VK_FALSE,
-        .rasterizerDiscardEnable = VK_FALSE,
-        .polygonMode             = VK_POLYGON_MODE_FILL,
-        .cullMode                = VK_CULL_MODE_BACK_BIT,
-        .frontFace               = VK_FRONT_FACE_CLOCKWISE,
-        .depthBiasEnable         = VK_FALSE,
-        .lineWidth               = 1.0f,
-    };
+    double milliseconds = std::atof(budget);
+    if (milliseconds <= 0.0)
+    {
+        LOG_WARNING("Dynamic resolution disabled: invalid frame budget '{}'", budget);
+        return;
+    }
 
-    VkPipelineMultisampleStateCreateInfo multisampling {
-        .sType                = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO,
-        .rasterizationSamples = VK_SAMPLE_COUNT_1_BIT,
-        .sampleShadingEnable  = VK_FALSE,
-    };
+    resolution = std::make_unique<DynamicResolution>(swapchainSize, milliseconds, MAX_FRAMES_IN_FLIGHT);
+    LOG_INFO(
+        "Dynamic resolution: {} ms of GPU time per frame, rendering at {} to {} of {}x{}", milliseconds,
+        DynamicResolution::MinScale, DynamicResolution::MaxScale, swapchainSize.width, swapchainSize.height);
+}
 
-    VkPipelineColorBlendAttachmentState colorBlendAttachment {
-        .blendEnable    = VK_FALSE,
-        .colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT,
-    };
+void VulkanHandler::createMeshletRenderer()
+{
+    TRACE_ZONE("VulkanHandler::createMeshletRenderer");
 
-    VkPipelineColorBlendStateCreateInfo colorBlending {
-        .sType           = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
-        .logicOpEnable   = VK_FALSE,
-        .logicOp         = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
-        .pAttachments    = &colorBlendAttachment,
-        .blendConstants  = {0.0f, 0.0f, 0.0f, 0.0f},
-    };
+    meshlets = std::make_unique<MeshletRenderer>(
+        device, *memory, *pipelines, *meshes, *lighting, MAX_FRAMES_IN_FLIGHT, meshletFeatures);
+    meshlets->requestPipelines(colorFormat, depthFormat, sampleCount);
+}
 
-    std::vector<VkDynamicState> dynamicStates {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+void VulkanHandler::createInstanceRenderer()
+{
+    TRACE_ZONE("VulkanHandler::createInstanceRenderer");
 
-    VkPipelineDynamicStateCreateInfo dynamicState {
-        .sType             = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO,
-        .dynamicStateCount = static_cast<uint32_t>(dynamicStates.size()),
-        .pDynamicStates    = dynamicStates.data(),
-    };
+    instances = std::make_unique<InstanceRenderer>(
+        device, *memory, *pipelines, *meshes, *lighting, MAX_FRAMES_IN_FLIGHT);
+    instances->requestPipelines(colorFormat, depthFormat, sampleCount);
+}
+
+void VulkanHandler::createGraphicsPipeline()
+{
+    TRACE_ZONE("VulkanHandler::createGraphicsPipeline");
 
     VkPipelineLayoutCreateInfo pipelineLayoutInfo {
         .sType                  = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
@@ -814,60 +1507,42 @@ void VulkanHandler::createGraphicsPipeline()
         throw std::runtime_error("Failed to create pipeline layout!");
     }
 
-    VkPipelineDepthStencilStateCreateInfo depthStencil {
-        .sType                 = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO,
-        .depthTestEnable       = VK_TRUE,
-        .depthWriteEnable      = VK_TRUE,
-        .depthBoundsTestEnable = VK_FALSE,
-        .stencilTestEnable     = VK_FALSE,
-    };
+    requestGraphicsPipeline();
+}
 
-    VkGraphicsPipelineCreateInfo pipelineInfo {
-        .sType               = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
-        .pNext               = nullptr,
-        .flags               = 0,
-        .stageCount          = 2,
-        .pStages             = shaderStages,
-        .pVertexInputState   = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssembly,
-        .pTessellationState  = nullptr,
-        .pViewportState      = &viewportState,
-        .pRasterizationState = &rasterizer,
-        .pMultisampleState   = &multisampling,
-        .pDepthStencilState  = &depthStencil,
-        .pColorBlendState    = &colorBlending,
-        .pDynamicState       = &dynamicState,
-        .layout              = pipelineLayout,
-        .renderPass          = renderPass,
-        .subpass             = 0,
-        .basePipelineHandle  = VK_NULL_HANDLE,
-        //.basePipelineIndex   = -1,
+void VulkanHandler::requestGraphicsPipeline()
+{
+    PipelineKey key {
+        .vertexShader   = "shader.vert",
+        .fragmentShader = "shader.frag",
+        .colorFormat    = colorFormat,
+        .depthFormat    = depthFormat,
+        .samples        = sampleCount,
+        .layout         = pipelineLayout,
     };
 
-    if (vkCreateGraphicsPipelines(device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &graphicsPipeline) != VK_SUCCESS)
-    {
-        throw std::runtime_error("failed to create graphics pipeline!");
-    }
-
-    vkDestroyShaderModule(device, fragShaderModule, nullptr);
-    vkDestroyShaderModule(device, vertShaderModule, nullptr);
+    // Compiled in the background: frames are drawn without the triangle until the pipeline is ready
+    graphicsPipeline = pipelines->request(key);
 }
 
 void VulkanHandler::createFramebuffers()
 {
+    TRACE_ZONE("VulkanHandler::createFramebuffers");
+
     swapchainFramebuffers.resize(swapchainImageViews.size());
 
     for (size_t i = 0; i < swapchainImageViews.size(); i++)
     {
-        std::vector<VkImageView> attachments(2);
-        attachments[0] = swapchainImageViews[i];
-        attachments[1] = depthImageView;
+        VkImageView colorView = post ? post->getSceneView() : swapchainImageViews[i];
+        VkImageView singleSampled[] {colorView, depthImageView};
+        VkImageView multisampled[] {colorImageView, depthImageView, colorView};
+        bool resolve = sampleCount != VK_SAMPLE_COUNT_1_BIT;
 
         VkFramebufferCreateInfo framebufferInfo {
             .sType           = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO,
             .renderPass      = renderPass,
-            .attachmentCount = static_cast<uint32_t>(attachments.size()),
-            .pAttachments    = attachments.data(),
+            .attachmentCount = resolve ? 3u : 2u,
+            .pAttachments    = resolve ? multisampled : singleSampled,
             .width           = swapchainSize.width,
             .height          = swapchainSize.height,
             .layers          = 1,
@@ -882,6 +1557,8 @@ void VulkanHandler::createFramebuffers()
 
 void VulkanHandler::createCommandPool()
 {
+    TRACE_ZONE("VulkanHandler::createCommandPool");
+
     VkCommandPoolCreateInfo createInfo {
         .sType            = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO,
         .flags            = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT,
@@ -896,7 +1573,10 @@ void VulkanHandler::createCommandPool()
 
 void VulkanHandler::createCommandBuffers()
 {
+    TRACE_ZONE("VulkanHandler::createCommandBuffers");
+
     commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
+    earlyCommandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
 
     VkCommandBufferAllocateInfo allocateInfo {
         .sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO,
@@ -909,6 +1589,11 @@ void VulkanHandler::createCommandBuffers()
     {
         throw std::runtime_error("Failed to allocate command buffer!");
     }
+
+    if (vkAllocateCommandBuffers(device, &allocateInfo, earlyCommandBuffers.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate command buffer!");
+    }
 }
 
 void VulkanHandler::createSemaphore(VkSemaphore *semaphore)
@@ -925,12 +1610,25 @@ void VulkanHandler::createSemaphore(VkSemaphore *semaphore)
 
 void VulkanHandler::createSemaphores()
 {
-    createSemaphore(&imageAvailableSemaphore);
-    createSemaphore(&renderingFinishedSemaphore);
+    TRACE_ZONE("VulkanHandler::createSemaphores");
+
+    imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
+    for (auto &semaphore : imageAvailableSemaphores)
+    {
+        createSemaphore(&semaphore);
+    }
+
+    renderingFinishedSemaphores.resize(swapchainImageCount);
+    for (auto &semaphore : renderingFinishedSemaphores)
+    {
+        createSemaphore(&semaphore);
+    }
 }
 
 void VulkanHandler::createFences()
 {
+    TRACE_ZONE("VulkanHandler::createFences");
+
     fences.resize(MAX_FRAMES_IN_FLIGHT);
 
     for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++)
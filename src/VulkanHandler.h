@@ -1,13 +1,36 @@
 #ifndef VULKAN_HANDLER_H_
 #define VULKAN_HANDLER_H_
 
+#include <map>
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <SDL.h>
 #include <GLFW/glfw3.h>
 #include <vulkan/vulkan.h>
 
-enum ApplicationType { SDL, GLFW };
+#include "DynamicResolution.h"
+#include "FrameCapture.h"
+#include "GpuProfiler.h"
+#include "InstanceRenderer.h"
+#include "MemoryBudget.h"
+#include "MeshManager.h"
+#include "MeshletRenderer.h"
+#include "ParticleSystem.h"
+#include "PipelineManager.h"
+#include "PostProcessor.h"
+#include "ShadowMaps.h"
+#include "ShaderLibrary.h"
+#include "SubmitScheduler.h"
+#include "TextureManager.h"
+#include "TexturedQuad.h"
+#include "Validation.h"
+#ifdef SHADER_HOT_RELOAD
+#include "ShaderHotReload.h"
+#endif
+
+enum ApplicationType { SDL, GLFW, Headless };
 
 class VulkanHandler
 {
@@ -16,30 +39,52 @@ class VulkanHandler
         GLFWwindow *glfwWindow;
         char *windowName;
         enum ApplicationType applicationType;
+        ValidationLevel validationLevel;
 
         VkInstance instance;
+        uint32_t instanceApiVersion;
         std::vector<VkExtensionProperties> instance_extension;
-        VkDebugReportCallbackEXT debugCallback;
+        VkDebugUtilsMessengerEXT debugMessenger;
         VkSurfaceKHR surface;
         VkPhysicalDevice physicalDevice;
         uint32_t graphicsQueueFamilyIndex;
         uint32_t presentQueueFamilyIndex;
         VkSurfaceCapabilitiesKHR surfaceCapabilities;
         VkSurfaceFormatKHR surfaceFormat;
+        // Of the main pass' color attachments: the swapchain's, or the HDR scene's with post-processing
+        VkFormat colorFormat;
         uint32_t swapchainImageCount;
         std::vector<VkImageView> swapchainImageViews;
+        std::vector<VkDeviceMemory> offscreenImageMemory;
         VkFormat depthFormat;
+        VkSampleCountFlags supportedSampleCounts;
+        VkSampleCountFlagBits sampleCount;
+        VkImage colorImage;
+        VkDeviceMemory colorImageMemory;
+        VkImageView colorImageView;
         VkImage depthImage;
         VkDeviceMemory depthImageMemory;
         VkImageView depthImageView;
-        PFN_vkCreateDebugReportCallbackEXT SDL2_vkCreateDebugReportCallbackEXT;
+        // The layers of the shadow cascades, rendered and sampled
+        VkFormat shadowFormat;
+        VkImage shadowImage;
+        VkDeviceMemory shadowImageMemory;
         VkPipelineLayout pipelineLayout;
+        MeshletFeatures meshletFeatures;
+        bool synchronization2;
+        bool subgroupQuad;
+        // VK_EXT_memory_budget is enabled
+        bool memoryBudget;
+        std::map<VkSampleCountFlagBits, VkRenderPass> renderPasses;
+        std::unique_ptr<ShaderLibrary> shaders;
 
         VkImageView createImageView(VkImage image, VkFormat format, VkImageAspectFlags aspectFlags);
         uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
         VkBool32 getSupportedDepthFormat(VkPhysicalDevice physicalDevice, VkFormat *depthFormat);
 
-        void createImage(uint32_t width, uint32_t height, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+        VkSampleCountFlagBits clampSampleCount(uint32_t samples);
+
+        void createImage(uint32_t width, uint32_t height, uint32_t arrayLayers, VkSampleCountFlagBits samples, VkFormat format, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
         void createInstance();
         void createDebug();
         void createSurface();
@@ -47,11 +92,27 @@ class VulkanHandler
         void selectQueueFamily();
         void createDevice();
         void createSwapchain(bool resize);
+        void createOffscreenTargets();
         void createImageViews();
+        void selectDepthFormat();
+        void selectSampleCount();
+        void createColorTarget();
         void setupDepthStencil();
+        void destroyRenderTargets();
         void createRenderPass();
-        VkShaderModule createShaderModule(const std::vector<char> &code);
+        void createPipelineManager();
+        void createGpuProfiler();
+        void createSubmitScheduler();
+        void createMemoryBudget();
+        void createTextureManager();
+        void createMeshManager();
+        void createShadowMaps();
+        void createClusteredLighting();
+        void createPostProcessor();
+        void createMeshletRenderer();
+        void createInstanceRenderer();
         void createGraphicsPipeline();
+        void requestGraphicsPipeline();
         void createFramebuffers();
         void createCommandPool();
         void createCommandBuffers();
@@ -60,12 +121,14 @@ class VulkanHandler
         void createFences();
         void checkSupportedInstanceExtensions();
         void checkAvailablePhysicalDevices();
-        void checkInstanceLayers();
+        bool checkInstanceLayers();
         void checkPhysicalDevice(VkPhysicalDevice *device);
         std::vector<const char *> getRequiredInstanceExtensions();
 
     public:
         std::vector<VkCommandBuffer> commandBuffers;
+        // Work of a frame not touching its swapchain image, submitted before the image is acquired
+        std::vector<VkCommandBuffer> earlyCommandBuffers;
         std::vector<VkFence> fences;
         std::vector<VkFramebuffer> swapchainFramebuffers;
         std::vector<VkImage> swapchainImages;
@@ -73,20 +136,61 @@ class VulkanHandler
         VkCommandPool commandPool;
         VkDevice device;
         VkExtent2D swapchainSize;
+        VkImageLayout colorTargetLayout;
         VkQueue graphicsQueue;
         VkQueue presentQueue;
-        VkPipeline graphicsPipeline;
+        std::unique_ptr<PipelineManager> pipelines;
+#ifdef SHADER_HOT_RELOAD
+        std::unique_ptr<ShaderHotReload> shaderHotReload;
+#endif
+        PipelineHandle graphicsPipeline;
+        std::unique_ptr<GpuProfiler> gpuProfiler;
+        std::unique_ptr<SubmitScheduler> submitter;
+        std::unique_ptr<FrameCapture> capture;
+        // Before the managers allocating from it
+        std::unique_ptr<MemoryBudget> memory;
+        std::unique_ptr<TextureManager> textures;
+        std::unique_ptr<MeshManager> meshes;
+        // Before the lighting sampling them
+        std::unique_ptr<ShadowMaps> shadows;
+        // Before the renderers drawing with it
+        std::unique_ptr<ClusteredLighting> lighting;
+        std::unique_ptr<MeshletRenderer> meshlets;
+        std::unique_ptr<InstanceRenderer> instances;
+        // Only once created
+        std::unique_ptr<ParticleSystem> particles;
+        // Only once created, drawing from the texture manager
+        std::unique_ptr<TexturedQuad> texturedQuad;
+        // Only with BASICVULKAN_POST or BASICVULKAN_FRAME_BUDGET set
+        std::unique_ptr<PostProcessor> post;
+        // Only with BASICVULKAN_FRAME_BUDGET set, upscaled by post-processing
+        std::unique_ptr<DynamicResolution> resolution;
         VkRenderPass renderPass;
-        VkSemaphore imageAvailableSemaphore;
-        VkSemaphore renderingFinishedSemaphore;
+        // Per frame in flight, signaled by acquiring the slot's swapchain image
+        std::vector<VkSemaphore> imageAvailableSemaphores;
+        // Per swapchain image rather than per frame in flight: the present of an image may still wait on its semaphore
+        // when the slot that signaled it comes round again, never once the image itself is acquired again
+        std::vector<VkSemaphore> renderingFinishedSemaphores;
         VkSwapchainKHR swapchain;
 
         int MAX_FRAMES_IN_FLIGHT;
 
         VulkanHandler(SDL_Window *sdlWindow, char *sdlWindowName);
         VulkanHandler(GLFWwindow *glfwWindow, char *glfwWindowName);
+        // Renders into images owned by the handler instead of a swapchain, without any window
+        VulkanHandler(VkExtent2D headlessSize, char *name);
 
         void init();
+        void createFrameCapture(const std::string &path);
+        // Replaces the particles, if any, waiting for the device
+        void createParticleSystem(uint32_t capacity);
+        void createTexturedQuad();
+
+        // MSAA sample count, clamped to what the device supports for both color and depth; switching waits for the
+        // device and rebuilds the render targets, the device itself is kept
+        VkSampleCountFlagBits getSampleCount() const;
+        void setSampleCount(uint32_t samples);
+        void cycleSampleCount();
 
         ~VulkanHandler();
 };
@@ -0,0 +1,90 @@
+// Scheduling overhead per job of the job system, against the mutex-guarded pool used at startup
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "JobSystem.h"
+#include "ThreadPool.h"
+
+struct Timing
+{
+    double minimum;
+    double median;
+};
+
+// Nanoseconds per job over `jobs` jobs, best and median of the runs
+static Timing measure(int runs, uint32_t jobs, const std::function<void()> &run)
+{
+    std::vector<double> samples;
+
+    // Untimed, so that threads are started and job rings touched before the first sample
+    run();
+
+    for (int i = 0; i < runs; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        samples.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / jobs);
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return {samples.front(), samples[samples.size() / 2]};
+}
+
+int main(int argc, char *argv[])
+{
+    uint32_t jobs = argc > 1 ? static_cast<uint32_t>(std::max(std::atoi(argv[1]), 1)) : 100000;
+    int runs = argc > 2 ? std::max(std::atoi(argv[2]), 1) : 20;
+
+    JobSystem &jobSystem = JobSystem::instance();
+    ThreadPool pool(jobSystem.workerCount());
+
+    // Empty jobs: only the cost of getting them run is measured
+    std::atomic<uint32_t> sink {0};
+    auto empty = [](const void *data, uint32_t begin, uint32_t end) {
+        static_cast<std::atomic<uint32_t> *>(const_cast<void *>(data))->fetch_add(end - begin, std::memory_order_relaxed);
+    };
+
+    Timing spawned = measure(runs, jobs, [&] {
+        JobCounter counter;
+        for (uint32_t i = 0; i < jobs; i++)
+        {
+            jobSystem.spawn(empty, &sink, i, i + 1, counter);
+        }
+        jobSystem.wait(counter);
+    });
+
+    Timing split = measure(runs, jobs, [&] {
+        JobCounter counter;
+        jobSystem.spawn(empty, &sink, 0, jobs, counter, 1);
+        jobSystem.wait(counter);
+    });
+
+    Timing parallelFor = measure(runs, jobs, [&] {
+        jobSystem.parallelFor(0, jobs, 1, [&](uint32_t begin, uint32_t end) {
+            sink.fetch_add(end - begin, std::memory_order_relaxed);
+        });
+    });
+
+    Timing threadPool = measure(runs, jobs, [&] {
+        for (uint32_t i = 0; i < jobs; i++)
+        {
+            pool.submit([&] { sink.fetch_add(1, std::memory_order_relaxed); });
+        }
+        pool.waitIdle();
+    });
+
+    fmt::print("{} jobs, {} workers, {} runs\n", jobs, jobSystem.workerCount(), runs);
+    fmt::print("{:<28} {:>12} {:>12}\n", "", "min ns/job", "median ns/job");
+    fmt::print("{:<28} {:>12.1f} {:>12.1f}\n", "spawn from one thread", spawned.minimum, spawned.median);
+    fmt::print("{:<28} {:>12.1f} {:>12.1f}\n", "one job split in halves", split.minimum, split.median);
+    fmt::print("{:<28} {:>12.1f} {:>12.1f}\n", "parallelFor, grain 1", parallelFor.minimum, parallelFor.median);
+    fmt::print("{:<28} {:>12.1f} {:>12.1f}\n", "ThreadPool", threadPool.minimum, threadPool.median);
+
+    return sink.load() > 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
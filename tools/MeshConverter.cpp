@@ -0,0 +1,531 @@
+// Offline conversion of glTF meshes to the binary mesh format loaded by MeshManager
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <unordered_map>
+
+#include <fmt/format.h>
+
+#include "GltfLoader.h"
+#include "MeshFile.h"
+
+// Mesh shader friendly limits: 64 vertices and 124 triangles fit the output of one workgroup on every vendor
+const uint32_t MeshletMaxVertices = 64;
+const uint32_t MeshletMaxTriangles = 124;
+
+static uint16_t toHalf(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t biasedExponent = (bits >> 23) & 0xFF;
+    int32_t exponent = static_cast<int32_t>(biasedExponent) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (biasedExponent == 0xFF)
+    {
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31)
+    {
+        return sign | 0x7C00;
+    }
+    if (exponent <= 0)
+    {
+        // Subnormal half, or zero
+        if (exponent < -10)
+        {
+            return sign;
+        }
+
+        mantissa |= 0x800000;
+        uint32_t shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        half += (mantissa >> (shift - 1)) & 1;
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    // Rounding may carry into the exponent, which is still the right result
+    uint32_t half = (static_cast<uint32_t>(exponent) << 10) | (mantissa >> 13);
+    half += (mantissa >> 12) & 1;
+    return static_cast<uint16_t>(sign | half);
+}
+
+static int16_t toSnorm16(float value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static void encodeOctahedral(const float *normal, int16_t *encoded)
+{
+    float l1 = std::fabs(normal[0]) + std::fabs(normal[1]) + std::fabs(normal[2]);
+    float x = l1 > 0 ? normal[0] / l1 : 0;
+    float y = l1 > 0 ? normal[1] / l1 : 0;
+
+    // The lower hemisphere is folded over the diagonals
+    if (normal[2] < 0)
+    {
+        float foldedX = (1 - std::fabs(y)) * (x >= 0 ? 1 : -1);
+        float foldedY = (1 - std::fabs(x)) * (y >= 0 ? 1 : -1);
+        x = foldedX;
+        y = foldedY;
+    }
+
+    encoded[0] = toSnorm16(x);
+    encoded[1] = toSnorm16(y);
+}
+
+static void quantizeVertices(const MeshGeometry &geometry, MeshFileContents &contents)
+{
+    size_t vertexCount = geometry.positions.size() / 3;
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        contents.boundsMin[axis] = vertexCount > 0 ? INFINITY : 0;
+        contents.boundsMax[axis] = vertexCount > 0 ? -INFINITY : 0;
+    }
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            contents.boundsMin[axis] = std::min(contents.boundsMin[axis], geometry.positions[v * 3 + axis]);
+            contents.boundsMax[axis] = std::max(contents.boundsMax[axis], geometry.positions[v * 3 + axis]);
+        }
+    }
+
+    contents.vertices.resize(vertexCount);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        MeshVertex &vertex = contents.vertices[v];
+
+        for (int axis = 0; axis < 3; axis++)
+        {
+            float extent = contents.boundsMax[axis] - contents.boundsMin[axis];
+            float normalized = extent > 0 ? (geometry.positions[v * 3 + axis] - contents.boundsMin[axis]) / extent : 0;
+            vertex.position[axis] = static_cast<uint16_t>(std::lround(normalized * 65535.0f));
+        }
+        vertex.position[3] = 0;
+
+        encodeOctahedral(&geometry.normals[v * 3], vertex.normal);
+        vertex.texcoord[0] = toHalf(geometry.texcoords[v * 2]);
+        vertex.texcoord[1] = toHalf(geometry.texcoords[v * 2 + 1]);
+    }
+}
+
+static void finishMeshlet(
+    const MeshGeometry &geometry, const MeshFileContents &contents, Meshlet &meshlet, float quantizationError)
+{
+    const uint32_t *vertices = &contents.meshletVertices[meshlet.vertexOffset];
+    const uint8_t *triangles = &contents.meshletTriangles[meshlet.triangleOffset];
+
+    // Bounding sphere around the center of the bounding box
+    float low[3] {INFINITY, INFINITY, INFINITY}, high[3] {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+    {
+        for (int axis = 0; axis < 3; axis++)
+        {
+            low[axis] = std::min(low[axis], geometry.positions[vertices[v] * 3 + axis]);
+            high[axis] = std::max(high[axis], geometry.positions[vertices[v] * 3 + axis]);
+        }
+    }
+
+    float radius = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        meshlet.center[axis] = (low[axis] + high[axis]) / 2;
+    }
+    for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+    {
+        const float *p = &geometry.positions[vertices[v] * 3];
+        float dx = p[0] - meshlet.center[0], dy = p[1] - meshlet.center[1], dz = p[2] - meshlet.center[2];
+        radius = std::max(radius, std::sqrt(dx * dx + dy * dy + dz * dz));
+    }
+    meshlet.radius = radius + quantizationError;
+
+    // Normal cone: average of the face normals, opened up to the one furthest from it
+    std::vector<float> normals;
+    float axis[3] {0, 0, 0};
+
+    for (uint32_t t = 0; t < meshlet.triangleCount; t++)
+    {
+        const float *a = &geometry.positions[vertices[triangles[t * 3]] * 3];
+        const float *b = &geometry.positions[vertices[triangles[t * 3 + 1]] * 3];
+        const float *c = &geometry.positions[vertices[triangles[t * 3 + 2]] * 3];
+
+        float e1[3] {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+        float e2[3] {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+        float n[3] {e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0]};
+        float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+        if (length == 0)
+        {
+            continue;
+        }
+
+        for (int i = 0; i < 3; i++)
+        {
+            normals.push_back(n[i] / length);
+            axis[i] += n[i] / length;
+        }
+    }
+
+    float axisLength = std::sqrt(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+    float minimumDot = 1;
+
+    for (size_t i = 0; i < normals.size(); i += 3)
+    {
+        float dot = axisLength > 0 ?
+            (normals[i] * axis[0] + normals[i + 1] * axis[1] + normals[i + 2] * axis[2]) / axisLength : -1;
+        minimumDot = std::min(minimumDot, dot);
+    }
+
+    for (int i = 0; i < 3; i++)
+    {
+        meshlet.coneAxis[i] = axisLength > 0 ? axis[i] / axisLength : 0;
+    }
+
+    // Beyond roughly 84 degrees the cone rejects too little to be worth testing
+    meshlet.coneCutoff = minimumDot <= 0.1f ? 1.0f : std::sqrt(1 - minimumDot * minimumDot);
+}
+
+static uint32_t countNewVertices(const uint32_t *triangle, const std::vector<uint32_t> &localIndex)
+{
+    uint32_t newVertices = 0;
+    for (int corner = 0; corner < 3; corner++)
+    {
+        bool repeated = corner > 0 && triangle[corner] == triangle[0];
+        repeated |= corner > 1 && triangle[corner] == triangle[1];
+        newVertices += localIndex[triangle[corner]] == UINT32_MAX && !repeated;
+    }
+
+    return newVertices;
+}
+
+// Greedy over the triangle adjacency: the next triangle is the neighbour adding the fewest vertices to the current
+// meshlet, which keeps meshlets compact so that their bounds and cones stay tight. A meshlet that has no neighbour left
+// continues with the first triangle not yet emitted. The triangles are appended to the index section in meshlet order
+static void buildMeshlets(const MeshGeometry &geometry, const std::vector<uint32_t> &indices, MeshFileContents &contents)
+{
+    size_t vertexCount = geometry.positions.size() / 3;
+    size_t triangleCount = indices.size() / 3;
+    std::vector<uint32_t> localIndex(vertexCount, UINT32_MAX);
+
+    float quantizationError = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        float step = (contents.boundsMax[axis] - contents.boundsMin[axis]) / 65535.0f;
+        quantizationError += step * step / 4;
+    }
+    quantizationError = std::sqrt(quantizationError);
+
+    // Triangles around each vertex, as offsets into one array
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t index : indices)
+    {
+        adjacencyOffsets[index + 1]++;
+    }
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    }
+
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> filled(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        adjacency[filled[indices[i]]++] = static_cast<uint32_t>(i / 3);
+    }
+
+    std::vector<bool> emitted(triangleCount, false);
+    size_t nextUnemitted = 0;
+
+    Meshlet meshlet {};
+    meshlet.vertexOffset = static_cast<uint32_t>(contents.meshletVertices.size());
+    meshlet.triangleOffset = static_cast<uint32_t>(contents.meshletTriangles.size());
+    meshlet.firstIndex = static_cast<uint32_t>(contents.indices.size());
+
+    auto flush = [&]() {
+        if (meshlet.triangleCount == 0)
+        {
+            return;
+        }
+
+        finishMeshlet(geometry, contents, meshlet, quantizationError);
+        contents.meshlets.push_back(meshlet);
+
+        for (uint32_t v = 0; v < meshlet.vertexCount; v++)
+        {
+            localIndex[contents.meshletVertices[meshlet.vertexOffset + v]] = UINT32_MAX;
+        }
+
+        // Triangle lists start on 4 bytes so that shaders can read them as uints
+        contents.meshletTriangles.resize((contents.meshletTriangles.size() + 3) / 4 * 4);
+
+        meshlet = {};
+        meshlet.vertexOffset = static_cast<uint32_t>(contents.meshletVertices.size());
+        meshlet.triangleOffset = static_cast<uint32_t>(contents.meshletTriangles.size());
+        meshlet.firstIndex = static_cast<uint32_t>(contents.indices.size());
+    };
+
+    for (size_t remaining = triangleCount; remaining > 0; remaining--)
+    {
+        uint32_t best = UINT32_MAX;
+        uint32_t bestNewVertices = UINT32_MAX;
+
+        for (uint32_t v = 0; v < meshlet.vertexCount && bestNewVertices > 0; v++)
+        {
+            uint32_t vertex = contents.meshletVertices[meshlet.vertexOffset + v];
+
+            for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; a++)
+            {
+                uint32_t candidate = adjacency[a];
+                if (emitted[candidate])
+                {
+                    continue;
+                }
+
+                uint32_t newVertices = countNewVertices(&indices[candidate * 3], localIndex);
+                if (newVertices < bestNewVertices)
+                {
+                    best = candidate;
+                    bestNewVertices = newVertices;
+                }
+            }
+        }
+
+        if (best == UINT32_MAX)
+        {
+            while (emitted[nextUnemitted])
+            {
+                nextUnemitted++;
+            }
+
+            best = static_cast<uint32_t>(nextUnemitted);
+            bestNewVertices = countNewVertices(&indices[best * 3], localIndex);
+        }
+
+        // The best neighbour not fitting starts the next meshlet, which then grows from where this one stopped
+        if (meshlet.vertexCount + bestNewVertices > MeshletMaxVertices || meshlet.triangleCount + 1u > MeshletMaxTriangles)
+        {
+            flush();
+        }
+
+        const uint32_t *triangle = &indices[best * 3];
+
+        for (int corner = 0; corner < 3; corner++)
+        {
+            if (localIndex[triangle[corner]] == UINT32_MAX)
+            {
+                localIndex[triangle[corner]] = meshlet.vertexCount++;
+                contents.meshletVertices.push_back(triangle[corner]);
+            }
+
+            contents.meshletTriangles.push_back(static_cast<uint8_t>(localIndex[triangle[corner]]));
+            contents.indices.push_back(triangle[corner]);
+        }
+
+        meshlet.triangleCount++;
+        emitted[best] = true;
+    }
+
+    flush();
+}
+
+// Vertex clustering: vertices are grouped by the cell of a grid they fall in, and each cell collapses to its vertex
+// nearest to the cell's average position, so that every level of detail keeps drawing from the full mesh's vertices.
+// Triangles left with two corners in one cell disappear, and so do the duplicates. Returns the largest distance by
+// which a vertex moved
+static float simplifyMesh(
+    const MeshGeometry &geometry, const MeshFileContents &contents, float cellSize, std::vector<uint32_t> &simplified)
+{
+    size_t vertexCount = geometry.positions.size() / 3;
+
+    std::unordered_map<uint64_t, uint32_t> cells;
+    std::vector<uint32_t> cluster(vertexCount);
+    std::vector<float> sums;
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        uint64_t key = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            auto cell = static_cast<uint64_t>((geometry.positions[v * 3 + axis] - contents.boundsMin[axis]) / cellSize);
+            key = (key << 21) | std::min<uint64_t>(cell, (1 << 21) - 1);
+        }
+
+        auto [found, inserted] = cells.emplace(key, static_cast<uint32_t>(cells.size()));
+        if (inserted)
+        {
+            sums.insert(sums.end(), {0.0f, 0.0f, 0.0f, 0.0f});
+        }
+
+        cluster[v] = found->second;
+        float *sum = &sums[found->second * 4];
+        sum[0] += geometry.positions[v * 3];
+        sum[1] += geometry.positions[v * 3 + 1];
+        sum[2] += geometry.positions[v * 3 + 2];
+        sum[3] += 1.0f;
+    }
+
+    auto distance = [&](size_t v, const float *point) {
+        const float *p = &geometry.positions[v * 3];
+        float dx = p[0] - point[0], dy = p[1] - point[1], dz = p[2] - point[2];
+        return std::sqrt(dx * dx + dy * dy + dz * dz);
+    };
+
+    std::vector<uint32_t> representative(cells.size(), UINT32_MAX);
+    std::vector<float> representativeDistance(cells.size(), INFINITY);
+
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        const float *sum = &sums[cluster[v] * 4];
+        float average[3] {sum[0] / sum[3], sum[1] / sum[3], sum[2] / sum[3]};
+        float d = distance(v, average);
+
+        if (d < representativeDistance[cluster[v]])
+        {
+            representative[cluster[v]] = static_cast<uint32_t>(v);
+            representativeDistance[cluster[v]] = d;
+        }
+    }
+
+    float error = 0;
+    for (size_t v = 0; v < vertexCount; v++)
+    {
+        error = std::max(error, distance(v, &geometry.positions[representative[cluster[v]] * 3]));
+    }
+
+    // Rotated to start at their smallest index, which keeps the winding, for duplicates to compare equal
+    std::vector<std::array<uint32_t, 3>> triangles;
+
+    for (size_t i = 0; i + 2 < geometry.indices.size(); i += 3)
+    {
+        std::array<uint32_t, 3> triangle;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            triangle[corner] = representative[cluster[geometry.indices[i + corner]]];
+        }
+
+        if (triangle[0] == triangle[1] || triangle[1] == triangle[2] || triangle[0] == triangle[2])
+        {
+            continue;
+        }
+
+        std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+        triangles.push_back(triangle);
+    }
+
+    std::sort(triangles.begin(), triangles.end());
+    triangles.erase(std::unique(triangles.begin(), triangles.end()), triangles.end());
+
+    simplified.clear();
+    for (const auto &triangle : triangles)
+    {
+        simplified.insert(simplified.end(), triangle.begin(), triangle.end());
+    }
+
+    return error;
+}
+
+// Each level has at most half the triangles of the previous one: the grid is coarsened until it gets there. The chain
+// ends with MeshMaxLods levels or once a level is small enough to cost about as much as a draw call anyway
+static void buildLods(const MeshGeometry &geometry, MeshFileContents &contents)
+{
+    const size_t MinLodTriangles = 64;
+
+    float diagonal = 0;
+    for (int axis = 0; axis < 3; axis++)
+    {
+        diagonal += (contents.boundsMax[axis] - contents.boundsMin[axis]) * (contents.boundsMax[axis] - contents.boundsMin[axis]);
+    }
+    diagonal = std::max(std::sqrt(diagonal), 1e-6f);
+
+    auto addLod = [&](const std::vector<uint32_t> &indices, float error) {
+        MeshLod lod {};
+        lod.firstIndex = static_cast<uint32_t>(contents.indices.size());
+        lod.firstMeshlet = static_cast<uint32_t>(contents.meshlets.size());
+        lod.error = error;
+
+        buildMeshlets(geometry, indices, contents);
+
+        lod.indexCount = static_cast<uint32_t>(contents.indices.size()) - lod.firstIndex;
+        lod.meshletCount = static_cast<uint32_t>(contents.meshlets.size()) - lod.firstMeshlet;
+        contents.lods.push_back(lod);
+    };
+
+    addLod(geometry.indices, 0.0f);
+
+    size_t triangleCount = geometry.indices.size() / 3;
+    // Finer than the spacing of the vertices of a mesh with this many triangles: the first grids merge little
+    float cellSize = diagonal / (2 * std::sqrt(static_cast<float>(std::max<size_t>(triangleCount, 1))));
+    std::vector<uint32_t> simplified;
+
+    while (contents.lods.size() < MeshMaxLods && triangleCount > MinLodTriangles)
+    {
+        float error = 0;
+        do
+        {
+            cellSize *= 1.25f;
+            error = simplifyMesh(geometry, contents, cellSize, simplified);
+        }
+        while (simplified.size() / 3 > triangleCount / 2 && cellSize < diagonal);
+
+        if (simplified.empty() || simplified.size() / 3 >= triangleCount)
+        {
+            break;
+        }
+
+        addLod(simplified, std::max(error, contents.lods.back().error));
+        triangleCount = simplified.size() / 3;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        fmt::print(stderr, "Usage: {} <input.gltf|input.glb> <output.bvmesh>\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    try
+    {
+        auto start = std::chrono::steady_clock::now();
+
+        MeshGeometry geometry = loadGltf(argv[1]);
+
+        MeshFileContents contents {};
+        quantizeVertices(geometry, contents);
+        buildLods(geometry, contents);
+
+        writeMeshFile(argv[2], contents);
+
+        auto elapsed = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        fmt::print(
+            "{}: {} vertices, {} levels of detail, {} meshlets in {:.1f} ms\n", argv[2], contents.vertices.size(),
+            contents.lods.size(), contents.meshlets.size(), elapsed);
+
+        for (size_t level = 0; level < contents.lods.size(); level++)
+        {
+            const MeshLod &lod = contents.lods[level];
+            fmt::print(
+                "  LOD {}: {} triangles, {} meshlets ({:.1f} triangles each), error {:.3g}\n", level, lod.indexCount / 3,
+                lod.meshletCount, lod.meshletCount == 0 ? 0.0 : double(lod.indexCount / 3) / lod.meshletCount, lod.error);
+        }
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(stderr, "{}\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}
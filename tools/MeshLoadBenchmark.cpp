@@ -0,0 +1,99 @@
+// Load time of a glTF mesh against its converted binary form, up to the point where vertices are in a staging buffer
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "GltfLoader.h"
+#include "MappedFile.h"
+#include "MeshFile.h"
+
+struct Timing
+{
+    double minimum;
+    double median;
+};
+
+static Timing measure(int iterations, const std::function<void()> &load)
+{
+    std::vector<double> samples;
+
+    // One untimed run first, so that both paths start with the files in the page cache
+    load();
+
+    for (int i = 0; i < iterations; i++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        load();
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    std::sort(samples.begin(), samples.end());
+    return {samples.front(), samples[samples.size() / 2]};
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 3)
+    {
+        fmt::print(stderr, "Usage: {} <mesh.gltf|mesh.glb> <mesh.bvmesh> [iterations]\n", argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    int iterations = argc > 3 ? std::max(std::atoi(argv[3]), 1) : 20;
+
+    try
+    {
+        // Stands in for the persistently mapped staging buffer: allocated once, outside of the timed loads
+        std::vector<uint8_t> staging;
+        size_t stagedBytes[2] {0, 0};
+
+        Timing gltf = measure(iterations, [&] {
+            MeshGeometry geometry = loadGltf(argv[1]);
+
+            // Interleaved as a float vertex layout would need it: position, normal, texture coordinates
+            size_t vertexCount = geometry.positions.size() / 3;
+            size_t size = vertexCount * 8 * sizeof(float) + geometry.indices.size() * sizeof(uint32_t);
+            staging.resize(std::max(staging.size(), size));
+
+            float *vertex = reinterpret_cast<float *>(staging.data());
+            for (size_t v = 0; v < vertexCount; v++)
+            {
+                memcpy(vertex, &geometry.positions[v * 3], 3 * sizeof(float));
+                memcpy(vertex + 3, &geometry.normals[v * 3], 3 * sizeof(float));
+                memcpy(vertex + 6, &geometry.texcoords[v * 2], 2 * sizeof(float));
+                vertex += 8;
+            }
+            memcpy(vertex, geometry.indices.data(), geometry.indices.size() * sizeof(uint32_t));
+
+            stagedBytes[0] = size;
+        });
+
+        Timing binary = measure(iterations, [&] {
+            MappedFile file(argv[2]);
+            parseMeshFile(file);
+
+            staging.resize(std::max(staging.size(), file.size()));
+            memcpy(staging.data(), file.data(), file.size());
+
+            stagedBytes[1] = file.size();
+        });
+
+        fmt::print("{:<8} {:>12} {:>12} {:>12}\n", "format", "min ms", "median ms", "staged MiB");
+        fmt::print("{:<8} {:>12.3f} {:>12.3f} {:>12.2f}\n", "glTF", gltf.minimum, gltf.median, stagedBytes[0] / 1048576.0);
+        fmt::print("{:<8} {:>12.3f} {:>12.3f} {:>12.2f}\n", "binary", binary.minimum, binary.median, stagedBytes[1] / 1048576.0);
+        fmt::print("Binary loads {:.1f}x faster (median)\n", gltf.median / std::max(binary.median, 1e-6));
+    }
+    catch (const std::exception &e)
+    {
+        fmt::print(stderr, "{}\n", e.what());
+        return EXIT_FAILURE;
+    }
+
+    return EXIT_SUCCESS;
+}